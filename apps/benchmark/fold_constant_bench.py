@@ -0,0 +1,81 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark FoldConstant on a model with many constant subgraphs.
+
+Each layer of the model rescales, transposes and blocks its weight before the
+convolution, the way quantized and layout converted models look after import.
+Reports the time of FoldConstant with the simple ops run on the host, and with
+every op compiled.
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay
+
+
+def get_model(num_layers, channels):
+    x = relay.var("x", shape=(1, channels, 14, 14), dtype="float32")
+    y = x
+    for i in range(num_layers):
+        kernel = 1 + 2 * (i % 2)
+        weight = relay.const(
+            np.random.uniform(size=(kernel, kernel, channels, channels)).astype("float32")
+        )
+        scale = relay.const(np.random.uniform(size=(channels, 1, 1, 1)).astype("float32"))
+        weight = relay.transpose(weight, axes=(3, 2, 0, 1))
+        weight = relay.cast(relay.cast(relay.multiply(weight, scale), "float16"), "float32")
+        weight = relay.layout_transform(weight, "OIHW", "OIHW4i4o")
+        y = relay.layout_transform(y, "NCHW", "NCHW4c")
+        y = relay.nn.contrib_conv2d_nchwc(
+            y,
+            weight,
+            channels=channels,
+            kernel_size=(kernel, kernel),
+            padding=(kernel // 2, kernel // 2),
+            data_layout="NCHW4c",
+            kernel_layout="OIHW4i4o",
+            out_layout="NCHW4c",
+        )
+        y = relay.layout_transform(y, "NCHW4c", "NCHW")
+    mod = tvm.IRModule.from_expr(relay.Function([x], y))
+    return relay.transform.InferType()(mod)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--num-layers", type=int, default=100)
+    parser.add_argument("--channels", type=int, default=64)
+    parser.add_argument("--repeat", type=int, default=3)
+    args = parser.parse_args()
+
+    mod = get_model(args.num_layers, args.channels)
+    for native in [True, False]:
+        config = {"relay.FoldConstant.native_kernels": native}
+        times = []
+        for _ in range(args.repeat):
+            start = time.time()
+            with tvm.transform.PassContext(config=config):
+                relay.transform.FoldConstant()(mod)
+            times.append(time.time() - start)
+        print(
+            "native kernels %-5s: best %.3f s, mean %.3f s"
+            % (native, min(times), sum(times) / len(times))
+        )
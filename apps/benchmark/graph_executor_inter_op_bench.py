@@ -0,0 +1,89 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for inter-operator parallel execution in the graph executor.
+
+Runs branchy graphs with the operators one by one and with independent
+operators scheduled on a pool of threads, splitting the cores between them.
+"""
+
+import argparse
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.contrib import graph_executor
+from tvm.relay import testing
+
+
+def get_multi_branch(num_branches, depth, channels, size):
+    """Parallel towers of small convolutions joined by a concatenation, like a multi-head model."""
+    data = relay.var("data", shape=(1, channels, size, size), dtype="float32")
+    params = {}
+    branches = []
+    for b in range(num_branches):
+        out = data
+        for d in range(depth):
+            name = "w_%d_%d" % (b, d)
+            weight = relay.var(name, shape=(channels, channels, 3, 3), dtype="float32")
+            params[name] = np.random.uniform(-0.1, 0.1, (channels, channels, 3, 3)).astype(
+                "float32"
+            )
+            out = relay.nn.relu(relay.nn.conv2d(out, weight, padding=(1, 1)))
+        branches.append(out)
+    out = relay.concatenate(branches, axis=1)
+    func = relay.Function(relay.analysis.free_vars(out), out)
+    return tvm.IRModule.from_expr(func), params, (1, channels, size, size)
+
+
+def get_network(name):
+    if name == "inception_v3":
+        mod, params = testing.inception_v3.get_workload(batch_size=1)
+        return mod, params, (1, 3, 299, 299)
+    return get_multi_branch(num_branches=8, depth=4, channels=32, size=28)
+
+
+def benchmark(network, target, inter_op_threads, repeat):
+    mod, params, shape = get_network(network)
+    with tvm.transform.PassContext(opt_level=3):
+        lib = relay.build(mod, target=target, params=params)
+    dev = tvm.cpu()
+    module = graph_executor.GraphModule(lib["default"](dev))
+    module.set_input("data", np.random.uniform(size=shape).astype("float32"))
+    print("%-16s %12s %16s" % ("network", "inter-op", "mean time (ms)"))
+    for num_threads in inter_op_threads:
+        module.set_inter_op_threads(num_threads)
+        prof = module.benchmark(dev, number=10, repeat=repeat)
+        print("%-16s %12d %16.2f" % (network, num_threads, prof.mean * 1000))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--network", type=str, choices=["multi_branch", "inception_v3"], default="multi_branch"
+    )
+    parser.add_argument("--target", type=str, default="llvm")
+    parser.add_argument(
+        "--inter-op-threads",
+        type=int,
+        nargs="+",
+        default=[1, 2, 4],
+        help="The numbers of operators run at once to compare.",
+    )
+    parser.add_argument("--repeat", type=int, default=5)
+    args = parser.parse_args()
+    benchmark(args.network, args.target, args.inter_op_threads, args.repeat)
@@ -0,0 +1,89 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for serving one graph from many threads.
+
+Compares one GraphExecutor per thread against one executor with a session per
+thread, reporting the throughput of each and the resident memory they take.
+"""
+
+import argparse
+import resource
+import threading
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.contrib import graph_executor
+from tvm.relay import testing
+
+
+def build(network, batch_size):
+    if network == "resnet-18":
+        mod, params = testing.resnet.get_workload(num_layers=18, batch_size=batch_size)
+        shape = (batch_size, 3, 224, 224)
+    else:
+        mod, params = testing.mlp.get_workload(batch_size)
+        shape = (batch_size, 1, 28, 28)
+    with tvm.transform.PassContext(opt_level=3):
+        lib = relay.build(mod, target="llvm", params=params)
+    return lib, shape
+
+
+def max_rss_mb():
+    return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024
+
+
+def run_threads(modules, shape, num_iters):
+    def worker(mod):
+        mod.set_input("data", np.random.uniform(size=shape).astype("float32"))
+        for _ in range(num_iters):
+            mod.run()
+
+    threads = [threading.Thread(target=worker, args=(mod,)) for mod in modules]
+    start = time.time()
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    return len(modules) * num_iters / (time.time() - start)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--network", type=str, choices=["resnet-18", "mlp"], default="resnet-18")
+    parser.add_argument("--batch-size", type=int, default=1)
+    parser.add_argument("--num-threads", type=int, default=4)
+    parser.add_argument("--num-iters", type=int, default=20)
+    parser.add_argument("--mode", type=str, choices=["executors", "sessions"], default="sessions")
+    args = parser.parse_args()
+
+    lib, data_shape = build(args.network, args.batch_size)
+    base_rss = max_rss_mb()
+    dev = tvm.cpu()
+    if args.mode == "executors":
+        mods = [graph_executor.GraphModule(lib["default"](dev)) for _ in range(args.num_threads)]
+    else:
+        parent = graph_executor.GraphModule(lib["default"](dev))
+        mods = [parent.create_session() for _ in range(args.num_threads)]
+    setup_rss = max_rss_mb() - base_rss
+    throughput = run_threads(mods, data_shape, args.num_iters)
+    print(
+        "%s, %d threads: %.2f inferences/s, %.1f MB for the executors"
+        % (args.mode, args.num_threads, throughput, setup_rss)
+    )
@@ -0,0 +1,96 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark incremental type inference in the Relay optimization pipeline.
+
+Runs the optimizations relay.build applies, for the CPU, on large models with
+and without the "relay.InferType.incremental" option. Reports the time spent in
+InferType, which runs after nearly every pass, and the time of the whole
+pipeline.
+"""
+
+import argparse
+import time
+
+import tvm
+from tvm import relay
+from tvm.relay import testing
+
+
+@tvm.instrument.pass_instrument
+class InferTypeTimer:
+    """Sums the time spent in the InferType passes."""
+
+    def __init__(self):
+        self.seconds = 0.0
+        self.count = 0
+        self._starts = []
+
+    def run_before_pass(self, mod, info):
+        if info.name == "InferType":
+            self._starts.append(time.time())
+
+    def run_after_pass(self, mod, info):
+        if info.name == "InferType":
+            self.seconds += time.time() - self._starts.pop()
+            self.count += 1
+
+
+def get_model(name, batch_size):
+    if name == "resnet-152":
+        return testing.resnet.get_workload(num_layers=152, batch_size=batch_size)
+    if name == "inception_v3":
+        return testing.inception_v3.get_workload(batch_size=batch_size)
+    if name == "densenet-201":
+        return testing.densenet.get_workload(densenet_size=201, batch_size=batch_size)
+    raise ValueError("Unknown model " + name)
+
+
+def time_pipeline(mod, params, target, incremental):
+    timer = InferTypeTimer()
+    config = {"relay.InferType.incremental": incremental}
+    start = time.time()
+    with tvm.transform.PassContext(opt_level=3, config=config, instruments=[timer]):
+        relay.optimize(mod, target=target, params=params)
+    return time.time() - start, timer.seconds, timer.count
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--model",
+        type=str,
+        nargs="+",
+        default=["resnet-152", "inception_v3", "densenet-201"],
+        choices=["resnet-152", "inception_v3", "densenet-201"],
+    )
+    parser.add_argument("--batch-size", type=int, default=1)
+    parser.add_argument("--target", type=str, default="llvm")
+    parser.add_argument("--repeat", type=int, default=3)
+    args = parser.parse_args()
+
+    print(
+        "%-14s %-12s %10s %14s %14s"
+        % ("model", "incremental", "InferTypes", "InferType (s)", "pipeline (s)")
+    )
+    for name in args.model:
+        mod, params = get_model(name, args.batch_size)
+        for incremental in [False, True]:
+            results = [
+                time_pipeline(mod, params, args.target, incremental) for _ in range(args.repeat)
+            ]
+            total, infer, count = min(results)
+            print("%-14s %-12s %10d %14.3f %14.3f" % (name, incremental, count, infer, total))
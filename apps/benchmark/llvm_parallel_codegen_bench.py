@@ -0,0 +1,75 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark the build time of a large model with parallel LLVM code generation.
+
+Builds a model for the CPU with the PrimFuncs split into 1, 2, 4 and 8 LLVM
+modules, then exports it to a shared library. Reports the time of relay.build,
+which optimizes and emits the object code of the parts in parallel, and of
+export_library, which then only writes and links the objects.
+"""
+
+import argparse
+import os
+import tempfile
+import time
+
+from tvm import relay
+import tvm
+from tvm.relay import testing
+
+
+def get_model(name, batch_size):
+    if name == "resnet-50":
+        return testing.resnet.get_workload(num_layers=50, batch_size=batch_size)
+    if name == "mobilenet":
+        return testing.mobilenet.get_workload(batch_size=batch_size)
+    if name == "inception_v3":
+        return testing.inception_v3.get_workload(batch_size=batch_size)
+    raise ValueError("Unknown model " + name)
+
+
+def time_build(mod, params, target, num_modules, tmpdir):
+    config = {"codegen.llvm.num_parallel_modules": num_modules}
+    start = time.time()
+    with tvm.transform.PassContext(opt_level=3, config=config):
+        lib = relay.build(mod, target=target, params=params)
+    build = time.time() - start
+    start = time.time()
+    lib.export_library(os.path.join(tmpdir, "model_%d.so" % num_modules))
+    export = time.time() - start
+    return build, export
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--model",
+        type=str,
+        default="inception_v3",
+        choices=["resnet-50", "mobilenet", "inception_v3"],
+    )
+    parser.add_argument("--batch-size", type=int, default=1)
+    parser.add_argument("--target", type=str, default="llvm")
+    parser.add_argument("--modules", type=int, nargs="+", default=[1, 2, 4, 8])
+    args = parser.parse_args()
+
+    mod, params = get_model(args.model, args.batch_size)
+    print("%-8s %12s %12s %12s" % ("modules", "build (s)", "export (s)", "total (s)"))
+    with tempfile.TemporaryDirectory() as tmpdir:
+        for num_modules in args.modules:
+            build, export = time_build(mod, params, args.target, num_modules, tmpdir)
+            print("%-8d %12.2f %12.2f %12.2f" % (num_modules, build, export, build + export))
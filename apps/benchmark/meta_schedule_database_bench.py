@@ -0,0 +1,148 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark loading and querying large meta_schedule tuning record databases.
+
+Fills a JSONDatabase and an IndexedDatabase with the same records, spread over
+matmuls of different shapes, then times opening each database, the first
+get_top_k of every workload, which parses the records of the IndexedDatabase,
+and the following ones.
+"""
+
+import argparse
+import json
+import os
+import tempfile
+import time
+
+import numpy as np
+
+import tvm
+from tvm import te
+from tvm.meta_schedule.arg_info import ArgInfo
+from tvm.meta_schedule.database import IndexedDatabase, JSONDatabase, TuningRecord
+from tvm.meta_schedule.utils import _json_de_tvm
+
+
+def get_workloads(num_workloads):
+    mods = []
+    for i in range(num_workloads):
+        n = 16 + i
+        A = te.placeholder((n, n), name="A")
+        B = te.placeholder((n, n), name="B")
+        k = te.reduce_axis((0, n), name="k")
+        C = te.compute((n, n), lambda x, y: te.sum(A[x, k] * B[k, y], axis=k), name="C")
+        mods.append(tvm.IRModule({"main": te.create_prim_func([A, B, C])}))
+    return mods
+
+
+def get_template(mod, workload):
+    sch = tvm.tir.Schedule(mod)
+    i, j, _ = sch.get_loops(sch.get_block("C"))
+    sch.split(i, factors=[None, 4])
+    sch.split(j, factors=[None, 8])
+    return TuningRecord(
+        sch.trace,
+        [1.0],
+        workload,
+        tvm.target.Target("llvm"),
+        ArgInfo.from_prim_func(mod["main"]),  # pylint: disable=unsubscriptable-object
+    )
+
+
+def fill_json(tmpdir, mods, run_secs):
+    path_workload = os.path.join(tmpdir, "workloads.json")
+    path_tuning_record = os.path.join(tmpdir, "tuning_records.json")
+    # Write the files directly, committing a million records one by one takes too long.
+    database = JSONDatabase(path_workload, path_tuning_record)
+    templates = []
+    for mod in mods:
+        record = get_template(mod, database.commit_workload(mod))
+        templates.append(_json_de_tvm(record.as_json()))
+    with open(path_tuning_record, "w") as records:
+        for i, secs in enumerate(run_secs):
+            index = i % len(mods)
+            template = templates[index]
+            line = [index, [template[0], [float(secs)], template[2], template[3]]]
+            records.write(json.dumps(line) + "\n")
+    return path_workload, path_tuning_record
+
+
+def fill_indexed(tmpdir, mods, run_secs, keep_top_k):
+    path = os.path.join(tmpdir, "tuning_records.bin")
+    database = IndexedDatabase(path, keep_top_k)
+    templates = [get_template(mod, database.commit_workload(mod)) for mod in mods]
+    start = time.time()
+    for i, secs in enumerate(run_secs):
+        template = templates[i % len(mods)]
+        database.commit_tuning_record(
+            TuningRecord(
+                template.trace,
+                [float(secs)],
+                template.workload,
+                template.target,
+                template.args_info,
+            )
+        )
+    print("IndexedDatabase commits: %.2f us/record" % ((time.time() - start) / len(run_secs) * 1e6))
+    return path
+
+
+def time_database(name, open_database, mods, top_k, nbytes):
+    start = time.time()
+    database = open_database()
+    load = time.time() - start
+    workloads = [database.commit_workload(mod) for mod in mods]
+    lookups = []
+    for _ in range(2):
+        start = time.time()
+        for workload in workloads:
+            database.get_top_k(workload, top_k)
+        lookups.append((time.time() - start) / len(workloads))
+    print(
+        "%-16s %10.1f MB %10.3f s %14.3f ms %14.3f ms"
+        % (name, nbytes / 2**20, load, lookups[0] * 1e3, lookups[1] * 1e3)
+    )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--records", type=int, default=1000000)
+    parser.add_argument("--workloads", type=int, default=100)
+    parser.add_argument("--top-k", type=int, default=32)
+    parser.add_argument("--keep-top-k", type=int, default=512)
+    args = parser.parse_args()
+
+    mods = get_workloads(args.workloads)
+    run_secs = np.random.lognormal(mean=-7, sigma=1, size=args.records)
+    with tempfile.TemporaryDirectory() as tmpdir:
+        path_workload, path_tuning_record = fill_json(tmpdir, mods, run_secs)
+        path = fill_indexed(tmpdir, mods, run_secs, args.keep_top_k)
+        print("%-16s %13s %12s %17s %17s" % ("", "size", "load", "first top-k", "next top-k"))
+        time_database(
+            "IndexedDatabase",
+            lambda: IndexedDatabase(path, args.keep_top_k, allow_missing=False),
+            mods,
+            args.top_k,
+            os.path.getsize(path),
+        )
+        time_database(
+            "JSONDatabase",
+            lambda: JSONDatabase(path_workload, path_tuning_record, allow_missing=False),
+            mods,
+            args.top_k,
+            os.path.getsize(path_workload) + os.path.getsize(path_tuning_record),
+        )
@@ -0,0 +1,106 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for the startup time of a model with large parameters.
+
+Builds a synthetic MLP with the requested amount of weights, saves its parameters
+in the serialized and in the mapped format, then measures in a fresh process for
+each format the time to create a graph executor with loaded parameters, the time
+of the first inference and the peak resident memory.
+"""
+
+import argparse
+import os
+import resource
+import subprocess
+import sys
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay, runtime
+from tvm.contrib import graph_executor
+
+
+def get_mlp(hidden, num_layers):
+    data = relay.var("data", shape=(1, hidden), dtype="float32")
+    out = data
+    params = {}
+    for i in range(num_layers):
+        name = "dense%d_weight" % i
+        weight = relay.var(name, shape=(hidden, hidden), dtype="float32")
+        params[name] = np.random.uniform(-0.01, 0.01, (hidden, hidden)).astype("float32")
+        out = relay.nn.relu(relay.nn.dense(out, weight))
+    func = relay.Function(relay.analysis.free_vars(out), out)
+    return tvm.IRModule.from_expr(func), params
+
+
+def prepare(workdir, hidden, num_layers):
+    mod, params = get_mlp(hidden, num_layers)
+    with tvm.transform.PassContext(opt_level=3):
+        lib = relay.build(mod, target="llvm")
+    lib.export_library(os.path.join(workdir, "lib.so"))
+    with open(os.path.join(workdir, "graph.json"), "w") as f:
+        f.write(lib.get_graph_json())
+    with open(os.path.join(workdir, "params.bin"), "wb") as f:
+        f.write(runtime.save_param_dict(params))
+    runtime.save_mapped_param_dict(params, os.path.join(workdir, "params.mapped"))
+    total = sum(p.nbytes for p in params.values())
+    print("Synthetic model with %.1f MB of parameters" % (total / 2**20))
+
+
+def measure(workdir, mode, hidden):
+    lib = runtime.load_module(os.path.join(workdir, "lib.so"))
+    with open(os.path.join(workdir, "graph.json")) as f:
+        graph = f.read()
+    start = time.time()
+    mod = graph_executor.create(graph, lib, tvm.cpu())
+    if mode == "mapped":
+        mod.load_mapped_params(os.path.join(workdir, "params.mapped"))
+    else:
+        with open(os.path.join(workdir, "params.bin"), "rb") as f:
+            mod.load_params(f.read())
+    load_time = time.time() - start
+    start = time.time()
+    mod.run(data=np.ones((1, hidden), dtype="float32"))
+    mod.get_output(0).numpy()
+    first_run = time.time() - start
+    rss = resource.getrusage(resource.RUSAGE_SELF).ru_maxrss / 1024
+    print("%-12s %12.1f %16.1f %14.1f" % (mode, load_time * 1000, first_run * 1000, rss))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--hidden", type=int, default=4096)
+    parser.add_argument("--num-layers", type=int, default=32, help="64 MB of weights per layer.")
+    parser.add_argument("--workdir", type=str, default="params_load_bench")
+    parser.add_argument("--measure", type=str, choices=["serialized", "mapped"])
+    args = parser.parse_args()
+
+    if args.measure:
+        measure(args.workdir, args.measure, args.hidden)
+        sys.exit(0)
+
+    os.makedirs(args.workdir, exist_ok=True)
+    prepare(args.workdir, args.hidden, args.num_layers)
+    print("%-12s %12s %16s %14s" % ("format", "load (ms)", "first run (ms)", "peak RSS (MB)"))
+    for fmt in ["serialized", "mapped"]:
+        subprocess.run(
+            [sys.executable, __file__, "--hidden", str(args.hidden), "--workdir", args.workdir]
+            + ["--measure", fmt],
+            check=True,
+        )
@@ -0,0 +1,135 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for stage balancing in the pipeline executor.
+
+Builds a chain of dense layers of uneven widths, profiles the per-layer cost
+of the whole model, and compares a pipeline split into stages with the same
+number of layers against one split at the points suggested by
+pipeline_executor.suggest_split_points. Reports the throughput and the stage
+profile of both pipelines.
+"""
+
+import argparse
+import json
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.contrib import pipeline_executor
+
+
+def get_layers(widths, batch):
+    """The input shape and the weights of a chain of dense + relu layers."""
+    weights = []
+    for i in range(len(widths) - 1):
+        weights.append(np.random.uniform(size=(widths[i + 1], widths[i])).astype("float32"))
+    return (batch, widths[0]), weights
+
+
+def get_chain(dshape, weights):
+    data = relay.var("data_0", shape=dshape, dtype="float32")
+    out = data
+    for weight in weights:
+        out = relay.nn.relu(relay.nn.dense(out, relay.const(weight)))
+    return tvm.IRModule.from_expr(relay.Function([data], out))
+
+
+def layer_costs(dshape, weights, dev, number):
+    """The cost of every layer, from the cost of the operator nodes of the whole model."""
+    with tvm.transform.PassContext(opt_level=3):
+        lib = relay.build(get_chain(dshape, weights), target="llvm")
+    costs = pipeline_executor.profile_node_costs(lib, dev, number=number)
+    nodes = json.loads(lib.get_graph_json())["nodes"]
+    return [cost for cost, node in zip(costs, nodes) if node["op"] == "tvm_op"]
+
+
+def build_pipeline(dshape, weights, splits):
+    bounds = [0] + list(splits) + [len(weights)]
+    mods = []
+    shape = dshape
+    for i in range(len(bounds) - 1):
+        stage_weights = weights[bounds[i] : bounds[i + 1]]
+        mods.append(get_chain(shape, stage_weights))
+        shape = (dshape[0], stage_weights[-1].shape[0])
+    pipe_config = pipeline_executor.PipelineConfig()
+    pipe_config["input"]["data"].connect(pipe_config[mods[0]]["input"]["data_0"])
+    for prev, mod in zip(mods, mods[1:]):
+        pipe_config[prev]["output"][0].connect(pipe_config[mod]["input"]["data_0"])
+    pipe_config[mods[-1]]["output"][0].connect(pipe_config["output"]["0"])
+    for mod in mods:
+        pipe_config[mod].target = "llvm"
+        pipe_config[mod].dev = tvm.cpu(0)
+    with tvm.transform.PassContext(opt_level=3):
+        return pipeline_executor.PipelineModule(pipeline_executor.build(pipe_config))
+
+
+def run_pipeline(pipeline, dshape, num_requests):
+    data = np.random.uniform(size=dshape).astype("float32")
+    pipeline.reset_stage_profile()
+    num_outputs = 0
+    start = time.time()
+    for _ in range(num_requests):
+        pipeline.set_input("data", data)
+        pipeline.run()
+        while len(pipeline.get_output()) != 0:
+            num_outputs += 1
+    while num_outputs < num_requests:
+        if len(pipeline.get_output()) != 0:
+            num_outputs += 1
+    return num_requests / (time.time() - start), pipeline.get_stage_profile()
+
+
+def report(name, splits, throughput, profile):
+    print("%s split at %s: %.1f requests/s" % (name, splits, throughput))
+    for stage in profile["stages"]:
+        print(
+            "  stage %d: %8.1f us/request, waiting %8.1f us"
+            % (stage["mod_idx"], stage["per_request_us"], stage["wait_us"] / stage["requests"])
+        )
+    print(
+        "  bottleneck stage %d bounds the pipeline at %.1f us/request, serial %.1f us/request"
+        % (profile["bottleneck"], profile["bound_us"], profile["serial_us"])
+    )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument(
+        "--widths", type=int, nargs="+", default=[256, 256, 2048, 2048, 256, 256, 256, 256, 256]
+    )
+    parser.add_argument("--batch", type=int, default=16)
+    parser.add_argument("--num-stages", type=int, default=2)
+    parser.add_argument("--num-requests", type=int, default=200)
+    parser.add_argument("--number", type=int, default=20)
+    args = parser.parse_args()
+
+    if not pipeline_executor.pipeline_executor_enabled():
+        raise RuntimeError("Build TVM with USE_PIPELINE_EXECUTOR to run this benchmark.")
+    data_shape, layer_weights = get_layers(args.widths, args.batch)
+    costs = layer_costs(data_shape, layer_weights, tvm.cpu(0), args.number)
+    suggested, stage_costs = pipeline_executor.suggest_split_points(costs, args.num_stages)
+    print(
+        "Layer costs (us): %s" % ", ".join("%.1f" % (c * 1e6) for c in costs),
+        "\nSuggested stage costs (us): %s" % ", ".join("%.1f" % (c * 1e6) for c in stage_costs),
+    )
+    num_layers = len(layer_weights)
+    even = [num_layers * i // args.num_stages for i in range(1, args.num_stages)]
+    for label, split_points in (("Even", even), ("Suggested", suggested)):
+        pipe = build_pipeline(data_shape, layer_weights, split_points)
+        report(label, split_points, *run_pipeline(pipe, data_shape, args.num_requests))
@@ -0,0 +1,142 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Stress benchmark for the forwarding queues of the pipeline executor.
+
+Offers requests to a three stage pipeline at a fixed rate from one thread
+while another thread waits for the outputs, and reports the p50 and p99
+latency and the throughput as the offered load grows. With --shed, requests
+that find the pipeline full are dropped through try_run instead of waiting,
+which keeps the latency bounded past saturation. The queue occupancy and wait
+times of the highest load are printed at the end.
+"""
+
+import argparse
+import threading
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.contrib import pipeline_executor
+
+
+def get_stage(dshape, num_layers):
+    data = relay.var("data_0", shape=dshape, dtype="float32")
+    out = data
+    for _ in range(num_layers):
+        weight = np.random.uniform(size=(dshape[1], dshape[1])).astype("float32")
+        out = relay.nn.relu(relay.nn.dense(out, relay.const(weight)))
+    return tvm.IRModule.from_expr(relay.Function([data], out))
+
+
+def build_pipeline(dshape, layers, queue_capacity):
+    mods = [get_stage(dshape, num_layers) for num_layers in layers]
+    pipe_config = pipeline_executor.PipelineConfig()
+    pipe_config["input"]["data"].connect(pipe_config[mods[0]]["input"]["data_0"])
+    for prev, mod in zip(mods, mods[1:]):
+        pipe_config[prev]["output"][0].connect(pipe_config[mod]["input"]["data_0"])
+    pipe_config[mods[-1]]["output"][0].connect(pipe_config["output"]["0"])
+    for mod in mods:
+        pipe_config[mod].target = "llvm"
+        pipe_config[mod].dev = tvm.cpu(0)
+        pipe_config[mod].queue_capacity = queue_capacity
+    with tvm.transform.PassContext(opt_level=3):
+        return pipeline_executor.PipelineModule(pipeline_executor.build(pipe_config))
+
+
+def offer_load(pipeline, dshape, rate, duration, shed):
+    """Offer requests at 'rate' per second, return the latencies and the dropped count."""
+    data = np.random.uniform(size=dshape).astype("float32")
+    submitted, completed = [], []
+    done = threading.Event()
+
+    def collect():
+        while not done.is_set() or len(completed) < len(submitted):
+            if len(pipeline.get_output(timeout_ms=100)) != 0:
+                completed.append(time.perf_counter())
+
+    collector = threading.Thread(target=collect)
+    collector.start()
+    dropped = 0
+    num_requests = int(rate * duration)
+    start = time.perf_counter()
+    for i in range(num_requests):
+        delay = start + i / rate - time.perf_counter()
+        if delay > 0:
+            time.sleep(delay)
+        pipeline.set_input("data", data)
+        now = time.perf_counter()
+        if shed:
+            if not pipeline.try_run():
+                dropped += 1
+                continue
+        else:
+            pipeline.run()
+        submitted.append(now)
+    elapsed = time.perf_counter() - start
+    done.set()
+    collector.join()
+    latencies = np.array(completed) - np.array(submitted)
+    return latencies, dropped, len(submitted) / elapsed
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--hidden", type=int, default=512)
+    parser.add_argument("--batch", type=int, default=8)
+    parser.add_argument("--layers", type=int, nargs="+", default=[2, 2, 2])
+    parser.add_argument("--queue-capacity", type=int, default=8)
+    parser.add_argument("--duration", type=float, default=2.0)
+    parser.add_argument("--rates", type=float, nargs="+", default=[100, 200, 400, 800, 1600])
+    parser.add_argument("--shed", action="store_true", help="Drop requests with try_run.")
+    args = parser.parse_args()
+
+    if not pipeline_executor.pipeline_executor_enabled():
+        raise RuntimeError("Build TVM with USE_PIPELINE_EXECUTOR to run this benchmark.")
+    data_shape = (args.batch, args.hidden)
+    print("%10s %12s %10s %10s %10s" % ("offered/s", "achieved/s", "p50 ms", "p99 ms", "dropped"))
+    for offered in args.rates:
+        pipe = build_pipeline(data_shape, args.layers, args.queue_capacity)
+        lat, num_dropped, achieved = offer_load(pipe, data_shape, offered, args.duration, args.shed)
+        print(
+            "%10.0f %12.1f %10.3f %10.3f %10d"
+            % (
+                offered,
+                achieved,
+                np.percentile(lat, 50) * 1e3,
+                np.percentile(lat, 99) * 1e3,
+                num_dropped,
+            )
+        )
+    for queue in pipe.get_queue_stats():
+        print(
+            "queue %d.%d -> %d.%d: mean occupancy %.2f/%d, %d blocked pushes for %.1f us, "
+            "mean wait %.1f us, max wait %.1f us"
+            % (
+                queue["mod_idx"],
+                queue["output_idx"],
+                queue["child_mod_idx"],
+                queue["child_input_idx"],
+                queue["mean_occupancy"],
+                queue["capacity"],
+                queue["blocked_pushes"],
+                queue["blocked_us"],
+                queue["mean_wait_us"],
+                queue["max_wait_us"],
+            )
+        )
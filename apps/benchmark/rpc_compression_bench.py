@@ -0,0 +1,137 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for compressed transfers over RPC on a slow link.
+
+Connects to a loopback RPC server through a relay that limits the bandwidth,
+standing in for a board on a slow network. Reports the effective upload and
+download bandwidth of arrays, and the time to upload a compiled module, with
+compression off and on. The arrays are pruned weights, where most values are
+zero, and random values, which do not compress and show what compression costs.
+"""
+
+import argparse
+import socket
+import threading
+import time
+
+import numpy as np
+
+import tvm
+from tvm import rpc, te
+from tvm.contrib import utils
+
+
+class ThrottledLink:
+    """Relay connections to a local port, each direction at most 'bandwidth' bytes/s."""
+
+    def __init__(self, port, bandwidth):
+        self.target_port = port
+        self.bandwidth = bandwidth
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        self.sock.bind(("127.0.0.1", 0))
+        self.sock.listen(4)
+        self.port = self.sock.getsockname()[1]
+        threading.Thread(target=self._accept, daemon=True).start()
+
+    def _accept(self):
+        while True:
+            conn, _ = self.sock.accept()
+            upstream = socket.create_connection(("127.0.0.1", self.target_port))
+            for src, dst in ((conn, upstream), (upstream, conn)):
+                threading.Thread(target=self._pump, args=(src, dst), daemon=True).start()
+
+    def _pump(self, src, dst):
+        start = time.perf_counter()
+        sent = 0
+        while True:
+            data = src.recv(64 << 10)
+            if not data:
+                dst.shutdown(socket.SHUT_WR)
+                return
+            sent += len(data)
+            delay = start + sent / self.bandwidth - time.perf_counter()
+            if delay > 0:
+                time.sleep(delay)
+            else:
+                # do not bank the idle time as credit for a later burst
+                start -= delay
+            dst.sendall(data)
+
+
+def make_weights(kind, nbytes):
+    if kind == "pruned":
+        data = np.random.uniform(-1, 1, size=nbytes // 4).astype("float32")
+        data[np.abs(data) < 0.8] = 0
+        return data
+    return np.random.uniform(size=nbytes // 4).astype("float32")
+
+
+def measure(remote, data, number):
+    arr = tvm.nd.empty(data.shape, data.dtype, remote.cpu(0))
+    start = time.perf_counter()
+    for _ in range(number):
+        arr.copyfrom(data)
+    upload = number * data.nbytes / (time.perf_counter() - start) / 2**20
+    start = time.perf_counter()
+    for _ in range(number):
+        arr.numpy()
+    download = number * data.nbytes / (time.perf_counter() - start) / 2**20
+    return upload, download
+
+
+def export_module(temp):
+    n = te.var("n")
+    A = te.placeholder((n,), name="A")
+    B = te.compute(A.shape, lambda *i: A(*i) * 2.0 + 1.0, name="B")
+    path = temp.relpath("module.so")
+    tvm.build(te.create_schedule(B.op), [A, B], "llvm").export_library(path)
+    return path
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--size", type=int, default=4 << 20, help="Bytes per copy.")
+    parser.add_argument("--number", type=int, default=3, help="Copies per measurement.")
+    parser.add_argument(
+        "--bandwidths", type=float, nargs="+", default=[10, 100], help="Link speeds in MB/s."
+    )
+    parser.add_argument("--min-bytes", type=int, default=64 << 10)
+    args = parser.parse_args()
+
+    server = rpc.Server(host="127.0.0.1")
+    module_path = export_module(utils.tempdir())
+    print("%8s %-8s %-10s %12s %14s" % ("link", "data", "compress", "upload MB/s", "download MB/s"))
+    for mbps in args.bandwidths:
+        link = ThrottledLink(server.port, mbps * 2**20)
+        remote = rpc.connect("127.0.0.1", link.port)
+        for kind in ("pruned", "random"):
+            weights = make_weights(kind, args.size)
+            for min_bytes in (0, args.min_bytes):
+                remote.set_compression(min_bytes)
+                up, down = measure(remote, weights, args.number)
+                print(
+                    "%8.0f %-8s %-10s %12.1f %14.1f"
+                    % (mbps, kind, "on" if min_bytes else "off", up, down)
+                )
+        for min_bytes in (0, args.min_bytes):
+            remote.set_compression(min_bytes)
+            begin = time.perf_counter()
+            remote.upload(module_path)
+            print(
+                "%8.0f %-8s %-10s module upload %.3f s"
+                % (mbps, "module", "on" if min_bytes else "off", time.perf_counter() - begin)
+            )
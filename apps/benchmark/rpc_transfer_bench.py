@@ -0,0 +1,112 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for pipelined transfers over RPC.
+
+Connects to a loopback RPC server over a socket and over shared memory, and to
+a minrpc server over a pipe, and reports the upload and download bandwidth and the calls per second,
+once with every request waiting for its reply and once with the requests
+pipelined: uploads in a batch, copies split into chunks, and calls made through
+get_pipelined_function.
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+import tvm
+from tvm import rpc
+from tvm.contrib import cc, utils
+
+
+def measure_upload(remote, data, number, pipelined):
+    dev = remote.cpu(0)
+    arrays = [tvm.nd.empty(data.shape, data.dtype, dev) for _ in range(number)]
+    start = time.perf_counter()
+    if pipelined:
+        with remote.batch():
+            for arr in arrays:
+                arr.copyfrom(data)
+    else:
+        for arr in arrays:
+            arr.copyfrom(data)
+    return number * data.nbytes / (time.perf_counter() - start) / 2**20
+
+
+def measure_download(remote, data, number):
+    arr = tvm.nd.array(data, remote.cpu(0))
+    start = time.perf_counter()
+    for _ in range(number):
+        arr.numpy()
+    return number * data.nbytes / (time.perf_counter() - start) / 2**20
+
+
+def measure_calls(remote, number, pipelined):
+    if pipelined:
+        func = remote.get_pipelined_function("testing.nop")
+    else:
+        func = remote.get_function("testing.nop")
+    start = time.perf_counter()
+    for i in range(number):
+        func(i)
+    remote.wait()
+    return number / (time.perf_counter() - start)
+
+
+def run(name, remote, args, window_bytes):
+    data = np.random.uniform(size=args.size // 4).astype("float32")
+    for pipelined in (False, True):
+        if pipelined:
+            remote.set_transfer_options(args.chunk_bytes, window_bytes)
+        upload = measure_upload(remote, data, args.number, pipelined)
+        download = measure_download(remote, data, args.number)
+        calls = measure_calls(remote, args.num_calls, pipelined)
+        print(
+            "%-8s %-10s %12.1f %12.1f %12.0f"
+            % (name, "pipelined" if pipelined else "sync", upload, download, calls)
+        )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--size", type=int, default=16 << 20, help="Bytes per copy.")
+    parser.add_argument("--number", type=int, default=20, help="Copies per measurement.")
+    parser.add_argument("--num-calls", type=int, default=5000)
+    parser.add_argument("--chunk-bytes", type=int, default=64 << 10)
+    parser.add_argument(
+        "--socket-window", type=int, default=128 << 10, help="Must fit the socket buffers."
+    )
+    parser.add_argument(
+        "--pipe-window", type=int, default=32 << 10, help="Must fit the pipe buffer."
+    )
+    parser.add_argument(
+        "--shm-window", type=int, default=4 << 20, help="Must fit the shared memory ring."
+    )
+    args = parser.parse_args()
+
+    print(
+        "%-8s %-10s %12s %12s %12s" % ("channel", "mode", "upload MB/s", "download MB/s", "calls/s")
+    )
+    server = rpc.Server(host="127.0.0.1")
+    run("socket", rpc.connect("127.0.0.1", server.port), args, args.socket_window)
+    shm_remote = rpc.connect("127.0.0.1", server.port, transport="shm")
+    run("shm", shm_remote, args, args.shm_window)
+
+    temp = utils.tempdir()
+    minrpc_exec = temp.relpath("minrpc")
+    tvm.rpc.with_minrpc(cc.create_executable)(minrpc_exec, [])
+    run("pipe", rpc.PopenSession(minrpc_exec), args, args.pipe_window)
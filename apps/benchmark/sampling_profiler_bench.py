@@ -0,0 +1,99 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark the overhead of the sampling profiler of the graph executor and the VM.
+
+Runs a model made of many small operators, where per operator costs show the
+most, with the profiler disabled and sampling one run out of several rates.
+Reports the mean time per run and the overhead over the disabled profiler, then
+the slowest operators found by the last profile.
+"""
+
+import argparse
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.contrib import graph_executor
+from tvm.runtime.vm import VirtualMachine
+
+
+def get_model(hidden, num_layers):
+    data = relay.var("data", shape=(1, hidden))
+    out = data
+    for _ in range(num_layers):
+        weight = relay.const(np.random.uniform(size=(hidden, hidden)).astype("float32"))
+        out = relay.nn.relu(relay.nn.dense(out, weight))
+        out = relay.tanh(relay.add(out, relay.const(0.5)))
+    return tvm.IRModule.from_expr(relay.Function([data], out))
+
+
+def time_graph(mod, sample_every, args):
+    mod.set_sampling_profiler(sample_every)
+    timer = mod.module.time_evaluator("run", tvm.cpu(0), number=args.number, repeat=args.repeat)
+    return min(timer().results)
+
+
+def time_vm(vm, sample_every, args):
+    vm.set_sampling_profiler(sample_every)
+    timer = vm.module.time_evaluator("invoke", tvm.cpu(0), number=args.number, repeat=args.repeat)
+    return min(timer("main").results)
+
+
+def report(name, timings):
+    base = timings[0][1]
+    for sample_every, seconds in timings:
+        print(
+            "%-6s %-14s %10.2f %9.2f%%"
+            % (
+                name,
+                "off" if sample_every == 0 else "1/%d" % sample_every,
+                seconds * 1e6,
+                (seconds / base - 1) * 100,
+            )
+        )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--hidden", type=int, default=64)
+    parser.add_argument("--layers", type=int, default=32)
+    parser.add_argument("--number", type=int, default=1000)
+    parser.add_argument("--repeat", type=int, default=5)
+    parser.add_argument("--rates", type=int, nargs="+", default=[0, 1000, 100, 10, 1])
+    args = parser.parse_args()
+
+    irmod = get_model(args.hidden, args.layers)
+    data = np.random.uniform(size=(1, args.hidden)).astype("float32")
+    print("%-6s %-14s %10s %10s" % ("", "sampled runs", "us/run", "overhead"))
+
+    lib = relay.build(irmod, "llvm")
+    graph_mod = graph_executor.GraphModule(lib["default"](tvm.cpu(0)))
+    graph_mod.set_input(data=data)
+    report("graph", [(rate, time_graph(graph_mod, rate, args)) for rate in args.rates])
+
+    exe = relay.vm.compile(irmod, "llvm")
+    vm = VirtualMachine(exe, tvm.cpu(0))
+    vm.set_input("main", data=data)
+    report("vm", [(rate, time_vm(vm, rate, args)) for rate in args.rates])
+
+    print("slowest operators of the graph executor, sampling every run:")
+    for op in graph_mod.get_sampling_profile()["ops"][:5]:
+        print(
+            "  %-40s p50 %8.2f us  p95 %8.2f us  p99 %8.2f us"
+            % (op["name"], op["p50_us"], op["p95_us"], op["p99_us"])
+        )
@@ -0,0 +1,101 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for the work-stealing mode of the runtime thread pool.
+
+Runs parallel kernels whose iterations have very different costs, so that a
+static split of the parallel loop leaves most workers idle while one finishes,
+and compares p50 and p99 latency of the static and work-stealing modes. With
+--noise, a busy background process competes with the pool for one core.
+"""
+import argparse
+import multiprocessing
+
+import numpy as np
+
+import tvm
+from tvm import te
+
+
+def build_row_kernel(n, row_cost, name):
+    """A parallel loop over rows where row i sums row_cost(i) elements of A[i]."""
+
+    def gen_ir(a, b):
+        ib = tvm.tir.ir_builder.create()
+        a = ib.buffer_ptr(a)
+        b = ib.buffer_ptr(b)
+        with ib.for_range(0, n, kind="parallel", name="i") as i:
+            b[i] = 0.0
+            with ib.for_range(0, row_cost(i), name="k") as k:
+                b[i] = b[i] + a[i * n + k]
+        return ib.get()
+
+    A = te.placeholder((n, n), name="A")
+    B = te.extern((n,), [A], lambda ins, outs: gen_ir(ins[0], outs[0]), name="B")
+    s = te.create_schedule(B.op)
+    return tvm.build(s, [A, B], target="llvm", name=name)
+
+
+def triangular_kernel(n):
+    """Row i sums i elements, so later rows are much more expensive."""
+    return build_row_kernel(n, lambda i: i, "triangular")
+
+
+def skewed_kernel(n):
+    """The last eighth of the rows does 16x more work than the others."""
+    return build_row_kernel(n, lambda i: tvm.tir.Select(i >= n - n // 8, n, n // 16), "skewed")
+
+
+def busy_loop():
+    while True:
+        pass
+
+
+def measure(func, n, repeat):
+    dev = tvm.cpu()
+    a = tvm.nd.array(np.random.uniform(size=(n, n)).astype("float32"), dev)
+    b = tvm.nd.empty((n,), "float32", dev)
+    timer = func.time_evaluator(func.entry_name, dev, number=1, repeat=repeat)
+    results = np.array(timer(a, b).results) * 1000
+    return np.percentile(results, 50), np.percentile(results, 99)
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--n", type=int, default=2048)
+    parser.add_argument("--repeat", type=int, default=500)
+    parser.add_argument("--chunks", type=int, default=8, help="Chunks per worker when stealing.")
+    parser.add_argument("--noise", action="store_true", help="Run a busy process alongside.")
+    args = parser.parse_args()
+
+    noise = None
+    if args.noise:
+        noise = multiprocessing.Process(target=busy_loop, daemon=True)
+        noise.start()
+
+    config = tvm.get_global_func("runtime.config_threadpool_work_stealing")
+    print("threads: %d" % tvm.runtime.num_threads())
+    print("%-12s %-10s %10s %10s" % ("kernel", "mode", "p50 ms", "p99 ms"))
+    for name, build in [("triangular", triangular_kernel), ("skewed", skewed_kernel)]:
+        func = build(args.n)
+        for mode, chunks in [("static", 0), ("stealing", args.chunks)]:
+            config(chunks)
+            p50, p99 = measure(func, args.n, args.repeat)
+            print("%-12s %-10s %10.3f %10.3f" % (name, mode, p50, p99))
+    config(0)
+
+    if noise is not None:
+        noise.terminate()
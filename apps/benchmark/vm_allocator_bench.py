@@ -0,0 +1,105 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for the Relay VM memory allocators.
+
+Records the allocation trace of a dynamic-shape model executed by the VM and
+replays it against each allocator type, reporting the reuse rate and the peak
+bytes held from the device. A trace saved with --save-trace can be replayed
+later with --trace, e.g. one recorded from a production model.
+"""
+
+import argparse
+import json
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.runtime.vm import VirtualMachine
+
+ALLOCATORS = {
+    "naive": VirtualMachine.NAIVE_ALLOCATOR,
+    "pooled": VirtualMachine.POOLED_ALLOCATOR,
+    "slab": VirtualMachine.SLAB_ALLOCATOR,
+}
+
+
+def get_dynamic_mlp(hidden):
+    """An MLP with a dynamic batch dimension and a dynamic sequence length."""
+    data = relay.var("data", shape=(relay.Any(), relay.Any(), hidden), dtype="float32")
+    weight = relay.var("weight", shape=(hidden * 4, hidden), dtype="float32")
+    out = relay.reshape(data, (-1, hidden))
+    out = relay.nn.relu(relay.nn.dense(out, weight))
+    out = relay.sum(out, axis=1)
+    return tvm.IRModule.from_expr(relay.Function([data, weight], out))
+
+
+def record_trace(hidden, num_requests, max_batch, max_seq_len):
+    mod = get_dynamic_mlp(hidden)
+    exe = relay.vm.compile(mod, target="llvm")
+    vm = VirtualMachine(exe, tvm.cpu())
+    weight = np.random.uniform(size=(hidden * 4, hidden)).astype("float32")
+    rng = np.random.default_rng(0)
+
+    tvm.get_global_func("vm.memory_manager.start_alloc_trace")()
+    for _ in range(num_requests):
+        batch = int(rng.integers(1, max_batch + 1))
+        seq_len = int(rng.integers(1, max_seq_len + 1))
+        data = np.random.uniform(size=(batch, seq_len, hidden)).astype("float32")
+        vm.invoke("main", data, weight)
+    return tvm.get_global_func("vm.memory_manager.stop_alloc_trace")()
+
+
+def replay(trace):
+    replay_func = tvm.get_global_func("vm.memory_manager.replay_alloc_trace")
+    dev = tvm.cpu()
+    print(
+        "%-10s %10s %12s %16s %16s"
+        % ("allocator", "allocs", "reuse rate", "peak MB", "peak live MB")
+    )
+    for name, alloc_type in ALLOCATORS.items():
+        stats = json.loads(replay_func(trace, alloc_type, dev.device_type, dev.device_id))
+        print(
+            "%-10s %10d %12.3f %16.2f %16.2f"
+            % (
+                name,
+                stats["num_allocs"],
+                stats["reuse_rate"],
+                stats["peak_bytes"] / 2**20,
+                stats["peak_live_bytes"] / 2**20,
+            )
+        )
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--trace", type=str, help="Replay a trace saved with --save-trace.")
+    parser.add_argument("--save-trace", type=str, help="Save the recorded trace as .npy.")
+    parser.add_argument("--hidden", type=int, default=256)
+    parser.add_argument("--num-requests", type=int, default=200)
+    parser.add_argument("--max-batch", type=int, default=32)
+    parser.add_argument("--max-seq-len", type=int, default=128)
+    args = parser.parse_args()
+
+    if args.trace:
+        alloc_trace = tvm.nd.array(np.load(args.trace))
+    else:
+        alloc_trace = record_trace(args.hidden, args.num_requests, args.max_batch, args.max_seq_len)
+    if args.save_trace:
+        np.save(args.save_trace, alloc_trace.numpy())
+    print("Replaying %d events" % alloc_trace.shape[0])
+    replay(alloc_trace)
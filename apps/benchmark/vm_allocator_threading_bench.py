@@ -0,0 +1,107 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for Relay VM allocator scaling across inference threads.
+
+Every thread drives its own VirtualMachine over a shared executable whose
+program is dominated by small allocations, and the script reports the
+aggregate invocations per second as the number of threads grows. The memory
+manager holds one allocator per device for the whole process, so every
+allocator type is measured in a fresh subprocess.
+"""
+import argparse
+import json
+import subprocess
+import sys
+import threading
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.runtime.vm import VirtualMachine
+
+
+def get_alloc_heavy_model(num_layers, shape):
+    """A chain of small elementwise ops, each of which allocates its output."""
+    x = relay.var("x", shape=shape, dtype="float32")
+    out = x
+    for i in range(num_layers):
+        out = relay.add(out, relay.const(float(i)))
+        out = relay.nn.relu(out) if i % 2 else relay.negative(out)
+    mod = tvm.IRModule.from_expr(relay.Function([x], out))
+    # Disable fusion so every op keeps its own allocation.
+    with tvm.transform.PassContext(opt_level=0):
+        return relay.vm.compile(mod, target="llvm")
+
+
+def run(allocator, max_threads, duration, num_layers):
+    shape = (4, 16)
+    exe = get_alloc_heavy_model(num_layers, shape)
+    data = np.random.uniform(size=shape).astype("float32")
+    results = {}
+    for num_threads in range(1, max_threads + 1):
+        vms = [VirtualMachine(exe, tvm.cpu(), memory_cfg=allocator) for _ in range(num_threads)]
+        counts = [0] * num_threads
+        stop = threading.Event()
+
+        def worker(idx):
+            vm = vms[idx]
+            vm.set_input("main", data)
+            while not stop.is_set():
+                vm.invoke_stateful("main")
+                counts[idx] += 1
+
+        threads = [threading.Thread(target=worker, args=(i,)) for i in range(num_threads)]
+        for t in threads:
+            t.start()
+        time.sleep(duration)
+        stop.set()
+        for t in threads:
+            t.join()
+        results[num_threads] = sum(counts) / duration
+    if allocator == "thread_cached":
+        dev = tvm.cpu()
+        stats = tvm.get_global_func("vm.memory_manager.thread_cache_stats")
+        print(stats(dev.device_type, dev.device_id), file=sys.stderr)
+    print(json.dumps(results))
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--threads", type=int, default=8)
+    parser.add_argument("--duration", type=float, default=2.0, help="Seconds per measurement.")
+    parser.add_argument("--num-layers", type=int, default=64)
+    parser.add_argument("--allocator", type=str, help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.allocator:
+        run(args.allocator, args.threads, args.duration, args.num_layers)
+        sys.exit(0)
+
+    table = {}
+    for name in ["pooled", "slab", "thread_cached"]:
+        out = subprocess.check_output(
+            [sys.executable, __file__, "--allocator", name]
+            + ["--threads", str(args.threads), "--duration", str(args.duration)]
+            + ["--num-layers", str(args.num_layers)]
+        )
+        table[name] = json.loads(out.decode().strip().splitlines()[-1])
+    print("%-8s" % "threads" + "".join("%16s" % name for name in table))
+    for num_threads in range(1, args.threads + 1):
+        row = "".join("%16.1f" % table[name][str(num_threads)] for name in table)
+        print("%-8d" % num_threads + row)
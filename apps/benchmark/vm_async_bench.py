@@ -0,0 +1,84 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for asynchronous invocation of the Relay VM.
+
+Serves a batch of requests to a control-flow-heavy model from a single Python
+thread, first with the blocking invoke and then with invoke_async and a
+growing number of worker VMs, and reports the throughput.
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.relay.scope_builder import ScopeBuilder
+from tvm.runtime.vm import VirtualMachine
+
+
+def get_model(steps, hidden):
+    """A recurrent cell applied a data-dependent number of times."""
+    mod = tvm.IRModule()
+    loop = relay.GlobalVar("loop")
+    i = relay.var("i", shape=[], dtype="int32")
+    h = relay.var("h", shape=(1, hidden), dtype="float32")
+    w = relay.var("w", shape=(hidden, hidden), dtype="float32")
+    sb = ScopeBuilder()
+    with sb.if_scope(relay.equal(i, relay.const(0, "int32"))):
+        sb.ret(h)
+    with sb.else_scope():
+        new_h = relay.tanh(relay.nn.dense(h, w))
+        sb.ret(loop(relay.subtract(i, relay.const(1, "int32")), new_h, w))
+    mod[loop] = relay.Function([i, h, w], sb.get())
+    harg = relay.var("h", shape=(1, hidden), dtype="float32")
+    weight = relay.const(np.random.uniform(size=(hidden, hidden)).astype("float32"))
+    mod["main"] = relay.Function([harg], loop(relay.const(steps, "int32"), harg, weight))
+    return mod
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--num-requests", type=int, default=64)
+    parser.add_argument("--steps", type=int, default=50)
+    parser.add_argument("--hidden", type=int, default=256)
+    parser.add_argument("--workers", type=int, nargs="+", default=[1, 2, 4, 8])
+    args = parser.parse_args()
+
+    exe = relay.vm.compile(get_model(args.steps, args.hidden), target="llvm")
+    vm = VirtualMachine(exe, tvm.cpu())
+    requests = [
+        np.random.uniform(size=(1, args.hidden)).astype("float32") for _ in range(args.num_requests)
+    ]
+    vm.invoke("main", requests[0])
+
+    start = time.perf_counter()
+    for data in requests:
+        vm.invoke("main", data)
+    elapsed = time.perf_counter() - start
+    print("%-14s %12.1f req/s" % ("blocking", args.num_requests / elapsed))
+
+    for num_workers in args.workers:
+        vm.set_async_workers(num_workers)
+        vm.invoke_async("main", requests[0]).result()
+        start = time.perf_counter()
+        futures = [vm.invoke_async("main", data) for data in requests]
+        for future in futures:
+            future.result()
+        elapsed = time.perf_counter() - start
+        print("%-14s %12.1f req/s" % ("%d workers" % num_workers, args.num_requests / elapsed))
@@ -0,0 +1,114 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Micro-benchmarks of the Relay VM dispatch loop.
+
+Runs control-flow-heavy programs whose kernels are tiny, so the time is spent
+interpreting bytecode: a recursive counter, a fold over an ADT list and an RNN
+cell applied in a loop. Each program is timed with the superinstructions of the
+VM enabled and disabled.
+"""
+
+import argparse
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.relay.prelude import Prelude
+from tvm.relay.scope_builder import ScopeBuilder
+from tvm.runtime.vm import VirtualMachine
+
+
+def count_loop(n):
+    mod = tvm.IRModule()
+    loop = relay.GlobalVar("loop")
+    i = relay.var("i", shape=[], dtype="int32")
+    acc = relay.var("acc", shape=[], dtype="int32")
+    sb = ScopeBuilder()
+    with sb.if_scope(relay.equal(i, relay.const(0, "int32"))):
+        sb.ret(acc)
+    with sb.else_scope():
+        sb.ret(loop(relay.subtract(i, relay.const(1, "int32")), relay.add(acc, i)))
+    mod[loop] = relay.Function([i, acc], sb.get())
+    mod["main"] = relay.Function([], loop(relay.const(n, "int32"), relay.const(0, "int32")))
+    return mod, []
+
+
+def list_sum(n):
+    mod = tvm.IRModule()
+    Prelude(mod)
+    _, cons, nil = mod.get_type("List")
+    items = nil()
+    for k in range(n):
+        items = cons(relay.const(k), items)
+    mod["main"] = relay.Function([], mod.get_global_var("sum")(items))
+    return mod, []
+
+
+def rnn_loop(n, hidden=16):
+    mod = tvm.IRModule()
+    loop = relay.GlobalVar("loop")
+    i = relay.var("i", shape=[], dtype="int32")
+    h = relay.var("h", shape=(1, hidden), dtype="float32")
+    w = relay.var("w", shape=(hidden, hidden), dtype="float32")
+    sb = ScopeBuilder()
+    with sb.if_scope(relay.equal(i, relay.const(0, "int32"))):
+        sb.ret(h)
+    with sb.else_scope():
+        new_h = relay.tanh(relay.add(relay.nn.dense(h, w), h))
+        sb.ret(loop(relay.subtract(i, relay.const(1, "int32")), new_h, w))
+    mod[loop] = relay.Function([i, h, w], sb.get())
+    harg = relay.var("h", shape=(1, hidden), dtype="float32")
+    warg = relay.var("w", shape=(hidden, hidden), dtype="float32")
+    mod["main"] = relay.Function([harg, warg], loop(relay.const(n, "int32"), harg, warg))
+    args = [
+        np.random.uniform(size=(1, hidden)).astype("float32"),
+        np.random.uniform(size=(hidden, hidden)).astype("float32"),
+    ]
+    return mod, args
+
+
+PROGRAMS = {"count_loop": count_loop, "list_sum": list_sum, "rnn_loop": rnn_loop}
+
+
+def measure(vm, args, repeat):
+    vm.invoke("main", *args)
+    start = time.perf_counter()
+    for _ in range(repeat):
+        vm.invoke("main", *args)
+    return (time.perf_counter() - start) / repeat * 1e6
+
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--iterations", type=int, default=200, help="Loop trip count.")
+    parser.add_argument("--repeat", type=int, default=50)
+    parser.add_argument("--program", choices=list(PROGRAMS), action="append")
+    args = parser.parse_args()
+
+    print("%-12s %10s %16s %16s" % ("program", "instrs", "fused us", "unfused us"))
+    for name in args.program or PROGRAMS:
+        mod, inputs = PROGRAMS[name](args.iterations)
+        exe = relay.vm.compile(mod, target="llvm")
+        vm = VirtualMachine(exe, tvm.cpu())
+        num_instrs = exe.bytecode.count("\n")
+        times = []
+        for enabled in [True, False]:
+            vm.module["set_superinstructions"](enabled)
+            times.append(measure(vm, inputs, args.repeat))
+        print("%-12s %10d %16.1f %16.1f" % (name, num_instrs, times[0], times[1]))
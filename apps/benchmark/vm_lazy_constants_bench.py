@@ -0,0 +1,122 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Benchmark script for lazy constant loading in the Relay VM.
+
+Saves a VM executable with many large constants, only a few of which are used
+by the function that is invoked, then loads it eagerly from bytes and lazily
+from the mapped file, each in a fresh process. Reports the load time, the time
+to the first inference and the bytes the executable holds on the host: the
+deserialized constants plus its copy of the bytecode.
+"""
+
+import argparse
+import json
+import os
+import subprocess
+import sys
+import tempfile
+import time
+
+import numpy as np
+
+import tvm
+from tvm import relay
+from tvm.runtime import vm as vm_rt
+
+
+def build(path, num_layers, hidden):
+    """A module whose "main" uses the first layer and "full" uses all of them."""
+    x = relay.var("x", shape=(1, hidden), dtype="float32")
+    weights = [
+        relay.const(np.random.uniform(size=(hidden, hidden)).astype("float32"))
+        for _ in range(num_layers)
+    ]
+    mod = tvm.IRModule()
+    mod["main"] = relay.Function([x], relay.nn.relu(relay.nn.dense(x, weights[0])))
+    y = relay.var("y", shape=(1, hidden), dtype="float32")
+    out = y
+    for weight in weights:
+        out = relay.nn.relu(relay.nn.dense(out, weight))
+    mod["full"] = relay.Function([y], out)
+    exe = relay.vm.compile(mod, target="llvm")
+    code, lib = exe.save()
+    lib.export_library(path + ".so")
+    with open(path + ".ro", "wb") as f:
+        f.write(code)
+
+
+def measure(path, num_layers, hidden, lazy):
+    start = time.perf_counter()
+    lib = tvm.runtime.load_module(path + ".so")
+    if lazy:
+        exe = vm_rt.Executable.load_exec_from_file(path + ".ro", lib, lazy_constants=True)
+    else:
+        with open(path + ".ro", "rb") as f:
+            code = bytearray(f.read())
+        exe = vm_rt.Executable.load_exec(code, lib)
+    vm = vm_rt.VirtualMachine(exe, tvm.cpu())
+    loaded = time.perf_counter()
+    vm.invoke("main", np.random.uniform(size=(1, hidden)).astype("float32"))
+    first = time.perf_counter()
+    stats = exe.get_lazy_constant_stats()
+    print(
+        json.dumps(
+            {
+                "load_ms": (loaded - start) * 1000,
+                "first_inference_ms": (first - start) * 1000,
+                "held_bytes": stats["code_bytes"]
+                + (stats["resident_bytes"] if lazy else num_layers * hidden * hidden * 4),
+            }
+        )
+    )
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--num-layers", type=int, default=32)
+    parser.add_argument("--hidden", type=int, default=1024)
+    parser.add_argument("--measure", choices=["eager", "lazy"], help=argparse.SUPPRESS)
+    parser.add_argument("--path", type=str, help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.measure:
+        measure(args.path, args.num_layers, args.hidden, args.measure == "lazy")
+        return
+
+    with tempfile.TemporaryDirectory() as tmp:
+        path = os.path.join(tmp, "exe")
+        build(path, args.num_layers, args.hidden)
+        print("%-8s %12s %22s %20s" % ("mode", "load ms", "first inference ms", "held MB"))
+        for mode in ["eager", "lazy"]:
+            out = subprocess.check_output(
+                [sys.executable, __file__, "--measure", mode, "--path", path]
+                + ["--num-layers", str(args.num_layers), "--hidden", str(args.hidden)]
+            )
+            res = json.loads(out.decode().strip().splitlines()[-1])
+            print(
+                "%-8s %12.2f %22.2f %20.2f"
+                % (
+                    mode,
+                    res["load_ms"],
+                    res["first_inference_ms"],
+                    res["held_bytes"] / 2**20,
+                )
+            )
+
+
+if __name__ == "__main__":
+    main()
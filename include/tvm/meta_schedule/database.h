@@ -288,6 +288,14 @@ class Database : public runtime::ObjectRef {
    */
   TVM_DLL static Database JSONDatabase(String path_workload, String path_tuning_record,
                                        bool allow_missing);
+  /*!
+   * \brief Create a database that keeps the best records of each workload in a binary log,
+   *  indexed by workload and parsed lazily.
+   * \param path The path to the log.
+   * \param keep_top_k The number of records kept for each workload, slower ones are dropped.
+   * \param allow_missing Whether to create new file when the given path is not found.
+   */
+  TVM_DLL static Database IndexedDatabase(String path, int keep_top_k, bool allow_missing);
   /*!
    * \brief Create a database with customized methods on the python-side.
    * \param f_has_workload The packed function of `HasWorkload`.
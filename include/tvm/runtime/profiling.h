@@ -181,7 +181,7 @@ class ReportNode : public Object {
    * Each element is a mapping from metric name to value. Some metrics that
    * appear in every call are "Name" (the function name), "Argument Shapes",
    * and "Duration (us)". Values are one of `String`, `PercentNode`,
-   * `DurationNode`, or `CountNode`.
+   * `DurationNode`, `CountNode`, or `RatioNode`.
    */
   Array<Map<String, ObjectRef>> calls;
   /*! \brief Metrics collected for the entire run of the model on a per-device basis.
@@ -192,6 +192,14 @@ class ReportNode : public Object {
    * because these metrics include the overhead of the executor.
    */
   Map<String, Map<String, ObjectRef>> device_metrics;
+  /*! \brief Spans of time recorded when profiling with a timeline, empty otherwise.
+   *
+   * Each element holds the "Name", "Device", "Thread", "Start (us)" and
+   * "Duration (us)" of a call, or of a task of a parallel launch run by the
+   * thread pool, next to the other metrics of the call. "Start (us)" is relative
+   * to the start of the profiler.
+   */
+  Array<Map<String, ObjectRef>> timeline;
   /*! \brief Output `calls` in CSV format.
    *
    * Note that this does not include `device_metrics`, it only includes per-call metrics.
@@ -243,8 +251,18 @@ class ReportNode : public Object {
    *    }
    *  }
    * \endcode
+   *
+   * Reports with a timeline also have a "timeline" list in the format of "calls".
    */
   String AsJSON() const;
+  /*! \brief Convert the timeline of this report to the Chrome trace event format.
+   *
+   * The output can be loaded in Perfetto (ui.perfetto.dev) or chrome://tracing.
+   * Every device is a process and every thread a track of it. Calls on devices
+   * other than the CPU start when the host launched them and last as long as the
+   * device timer measured.
+   */
+  String AsChromeTrace() const;
 
   static constexpr const char* _type_key = "runtime.profiling.Report";
   TVM_DECLARE_FINAL_OBJECT_INFO(ReportNode, Object);
@@ -255,9 +273,11 @@ class Report : public ObjectRef {
   /*! Construct a Report from a set of calls (with associated metrics) and per-device metrics.
    * \param calls Function calls and associated metrics.
    * \param device_metrics Per-device metrics for overall execution.
+   * \param timeline Spans of time of the calls, see `ReportNode::timeline`.
    */
   explicit Report(Array<Map<String, ObjectRef>> calls,
-                  Map<String, Map<String, ObjectRef>> device_metrics);
+                  Map<String, Map<String, ObjectRef>> device_metrics,
+                  Array<Map<String, ObjectRef>> timeline = {});
 
   /*! Deserialize a Report from a JSON object. Needed for sending the report over RPC.
    * \param json Serialized json report from `ReportNode::AsJSON`.
@@ -302,7 +322,7 @@ class MetricCollectorNode : public Object {
   /*! \brief Stop collecting metrics.
    * \param obj The object created by the corresponding `Start` call.
    * \returns A set of metric names and the associated values. Values must be
-   * one of DurationNode, PercentNode, CountNode, or StringObj.
+   * one of DurationNode, PercentNode, CountNode, RatioNode, or StringObj.
    */
   virtual Map<String, ObjectRef> Stop(ObjectRef obj) = 0;
 
@@ -332,6 +352,50 @@ struct CallFrame {
    * associated data (returned from MetricCollector.Start).
    */
   std::vector<std::pair<MetricCollector, ObjectRef>> extra_collectors;
+  /*! Host time in nanoseconds when the call started and stopped, only set with a timeline */
+  int64_t start_ns{0};
+  int64_t stop_ns{0};
+  /*! Timeline id of the thread which made the call */
+  int64_t thread{0};
+};
+
+/*! A span of time spent by a thread of the runtime outside of profiled calls. */
+struct TimelineSpan {
+  /*! What the thread did */
+  const char* name;
+  /*! Timeline id of the thread */
+  int64_t thread;
+  /*! Host time in nanoseconds of the start and the end of the span */
+  int64_t start_ns;
+  int64_t stop_ns;
+  /*! Index of the task of a parallel launch, -1 if none */
+  int64_t task;
+};
+
+/*! \brief Whether a running profiler records a timeline. */
+TVM_DLL bool TimelineActive();
+/*! \return The host time in nanoseconds used by timelines. */
+TVM_DLL int64_t TimelineNow();
+/*! \return A small number identifying the current thread in timelines. */
+TVM_DLL int64_t TimelineThreadId();
+/*! \brief Add a span of the current thread to the timelines being recorded. */
+TVM_DLL void RecordTimelineSpan(const char* name, int64_t start_ns, int64_t task = -1);
+
+/*! \brief Records the lifetime of the object as a span of the current thread on the
+ *  timelines being recorded. It costs one atomic load when no timeline is.
+ */
+class ScopedTimelineSpan {
+ public:
+  explicit ScopedTimelineSpan(const char* name, int64_t task = -1)
+      : name_(name), task_(task), start_ns_(TimelineActive() ? TimelineNow() : -1) {}
+  ~ScopedTimelineSpan() {
+    if (start_ns_ >= 0) RecordTimelineSpan(name_, start_ns_, task_);
+  }
+
+ private:
+  const char* name_;
+  int64_t task_;
+  int64_t start_ns_;
 };
 
 /*! Runtime profiler for function and/or operator calls. Used in the graph
@@ -366,8 +430,11 @@ class Profiler {
    * \param devs The list of devices the profiler will be running on. Should
    *             include all devices used by profiled operators.
    * \param metric_collectors Additional `MetricCollector`s to use with this profiler.
+   * \param timeline Whether to record when each call ran, and on which thread,
+   *                 along with the tasks run by the thread pool in the meantime.
    */
-  explicit Profiler(std::vector<Device> devs, std::vector<MetricCollector> metric_collectors);
+  explicit Profiler(std::vector<Device> devs, std::vector<MetricCollector> metric_collectors,
+                    bool timeline = false);
   /*! \brief Start the profiler.
    *
    * This function should only be called once per object.
@@ -412,6 +479,12 @@ class Profiler {
   std::vector<CallFrame> calls_;
   std::stack<CallFrame> in_flight_;
   std::vector<MetricCollector> collectors_;
+  bool timeline_{false};
+  // Host time of Start, timeline offsets are relative to it.
+  int64_t timeline_origin_ns_{0};
+  // Index of the first span recorded by the thread pool while this profiler runs.
+  size_t timeline_begin_{0};
+  std::vector<TimelineSpan> timeline_spans_;
 };
 
 /* \brief A duration in time. */
@@ -459,6 +532,21 @@ class CountNode : public Object {
   TVM_DECLARE_FINAL_OBJECT_INFO(CountNode, Object);
 };
 
+/* A ratio of two quantities, such as instructions per cycle. Aggregated calls report the mean. */
+class RatioNode : public Object {
+ public:
+  /* The ratio as a floating point number. */
+  double ratio;
+
+  /* \brief Construct a new ratio.
+   * \param a The ratio.
+   */
+  explicit RatioNode(double a) : ratio(a) {}
+
+  static constexpr const char* _type_key = "runtime.profiling.Ratio";
+  TVM_DECLARE_FINAL_OBJECT_INFO(RatioNode, Object);
+};
+
 /*! \brief String representation of an array of NDArray shapes
  *  \param shapes Array of NDArrays to get the shapes of.
  *  \return A textual representation of the shapes. For example: `float32[2], int64[1, 2]`.
@@ -511,6 +599,22 @@ String ShapeString(const std::vector<int64_t>& shape, DLDataType dtype);
 PackedFunc ProfileFunction(Module mod, std::string func_name, int device_type, int device_id,
                            int warmup_iters, Array<MetricCollector> collectors);
 
+/*! \brief Construct a metric collector that reads the hardware performance counters of
+ * the CPU with the `perf_event_open` system call of Linux.
+ *
+ * Counters which cannot be opened, for lack of permission or of support by the CPU, are
+ * skipped with a warning. On other systems the collector records nothing.
+ *
+ * \param metrics Names of the counters to read: "Cycles", "Instructions", "Cache
+ * References", "Cache Misses", "Branches", "Branch Misses", "Stalled Cycles Frontend",
+ * "Stalled Cycles Backend", or raw events of the CPU written "r<hex code>". Empty for
+ * the default set.
+ * \param flop_events Raw events counting floating point instructions, written
+ * "r<hex code>*<flops per instruction>". Their weighted sum is reported as "FLOPs".
+ */
+TVM_DLL MetricCollector CreatePerfEventMetricCollector(Array<String> metrics,
+                                                       Array<String> flop_events);
+
 }  // namespace profiling
 }  // namespace runtime
 }  // namespace tvm
@@ -140,6 +140,52 @@ void ResetThreadPool();
 void Configure(tvm::runtime::threading::ThreadGroup::AffinityMode mode, int nthreads,
                std::vector<unsigned int> cpus);
 
+/*!
+ * \brief Configure the work-stealing mode of the thread pool.
+ *
+ * When enabled, a parallel launch is split into chunks_per_worker tasks per worker,
+ * queued on per-worker deques, and workers that run out of tasks take the remaining
+ * ones of other workers. Can also be enabled with TVM_THREAD_POOL_WORK_STEALING.
+ *
+ * A kernel is only split once one of its launches has finished without reaching a
+ * barrier, the tasks of kernels with barriers always run on a worker each.
+ *
+ * Note that this does nothing when openmp is used.
+ *
+ * \param chunks_per_worker The number of tasks per worker, 0 to use one static task
+ *  per worker.
+ */
+void ConfigureWorkStealing(int chunks_per_worker);
+
+/*!
+ * \brief Configure the process-wide shared thread pool.
+ *
+ * When enabled, parallel launches from every thread are submitted into one shared
+ * set of workers instead of a pool per calling thread, and launches from inside a
+ * parallel task run in parallel as well. Can also be enabled with
+ * TVM_THREAD_POOL_SHARED and TVM_THREAD_POOL_SHARED_MAX_CONCURRENCY.
+ *
+ * Note that this does nothing when openmp is used.
+ *
+ * \param enable Whether to use the shared pool.
+ * \param max_concurrency The maximum number of pool workers running tasks at once
+ *  (0 = all cores). The calling threads are not counted, each of them runs tasks of
+ *  its own launches in addition to these workers.
+ */
+void ConfigureSharedPool(bool enable, int max_concurrency);
+
+/*!
+ * \brief Set the number of workers used by parallel launches from the calling thread only,
+ *  leaving the maximum concurrency of the process unchanged.
+ *
+ * Note that this does nothing when openmp is used.
+ *
+ * \param nthreads The number of threads to use (0 = use all).
+ * \param cpus The CPUs the calling thread and its workers are bound to, empty to use the
+ *  big cores like the default pool.
+ */
+void ConfigureLocalThreads(int nthreads, std::vector<unsigned int> cpus = {});
+
 /*!
  * \brief Get the number of threads being used by the TVM runtime
  * \returns The number of threads used.
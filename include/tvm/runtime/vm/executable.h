@@ -32,12 +32,17 @@
 #include <tvm/runtime/vm/bytecode.h>
 
 #include <map>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 namespace tvm {
 namespace runtime {
+
+class MappedFile;
+
 namespace vm {
 
 struct VMFunction;
@@ -105,10 +110,31 @@ class Executable : public ModuleNode {
    *
    * \param code The bytecode in string.
    * \param lib The compiled runtime library.
+   * \param lazy_constants Whether to leave the constants serialized in the code until they are
+   *  first used, see \p GetConstant. The executable keeps its copy of \p code, so this saves
+   *  the deserialized copies only, see \p LoadFromFile.
    *
    * \return exe The constructed executable.
    */
-  static runtime::Module Load(const std::string& code, const runtime::Module lib);
+  static runtime::Module Load(const std::string& code, const runtime::Module lib,
+                              bool lazy_constants = false);
+
+  /*!
+   * \brief Load the VM executable saved to the file at \p path.
+   *
+   * The file is mapped into memory rather than read. With \p lazy_constants, the serialized
+   * constants stay in the file and are only paged in while one is deserialized, so memory
+   * holds the constants in use rather than all of them.
+   *
+   * \param path The file holding the bytecode.
+   * \param lib The compiled runtime library.
+   * \param lazy_constants Whether to leave the constants serialized in the file until they are
+   *  first used, see \p GetConstant.
+   *
+   * \return exe The constructed executable.
+   */
+  static runtime::Module LoadFromFile(const std::string& path, const runtime::Module lib,
+                                      bool lazy_constants = false);
 
   /*!
    * \brief Returns the late-bound constants for the executable (if any) as a byte-stream.
@@ -123,8 +149,11 @@ class Executable : public ModuleNode {
 
   /*!
    * \brief As for \p MoveLateBoundConstantsToStream, but save to file at \p path.
+   * If \p mapped, the file uses the aligned format that is loaded by mapping it into
+   * memory instead of reading and copying it.
    */
-  void MoveLateBoundConstantsToFile(const std::string& path, size_t byte_limit);
+  void MoveLateBoundConstantsToFile(const std::string& path, size_t byte_limit,
+                                    bool mapped = false);
 
   /*!
    * \brief Restores the late-bound constants for the executable (if any) from given byte-stream.
@@ -136,6 +165,8 @@ class Executable : public ModuleNode {
 
   /*!
    * \brief As for \p LoadLateBoundConstantsFromStream, but load from file at \p path.
+   * Files in the mapped format are mapped into memory and the constants are views into
+   * them, so they are only read as they are used.
    */
   void LoadLateBoundConstantsFromFile(const std::string& path);
 
@@ -240,6 +271,30 @@ class Executable : public ModuleNode {
    */
   std::string GetFunctionParameterName(std::string func, uint32_t index) const;
 
+  /*!
+   * \brief Get the constant at \p index. A lazy constant is deserialized from the code on
+   * first use and kept until it is evicted. Thread-safe.
+   *
+   * \param index The constant index.
+   * \return The constant.
+   */
+  ObjectRef GetConstant(Index index);
+
+  /*!
+   * \brief Drop the deserialized copy of a lazy constant, it is deserialized again on next use.
+   *
+   * \param index The constant index.
+   * \return The number of bytes dropped, 0 if the constant is not lazy or not loaded.
+   */
+  size_t EvictConstant(Index index);
+
+  /*!
+   * \brief Returns the statistics of the lazy constants as a JSON object: their number and
+   * bytes, the bytes currently deserialized, the bytes of serialized code held in memory, and
+   * the loads, evictions and time spent loading.
+   */
+  std::string LazyConstantStats();
+
   virtual ~Executable() {}
 
   const char* type_key() const final { return "VMExecutable"; }
@@ -279,8 +334,59 @@ class Executable : public ModuleNode {
   std::vector<VMFunction> functions;
   /*! \brief The index of the device holding each constant. */
   std::vector<Index> const_device_indexes;
+  /*! \brief Whether constants are deserialized on first use when loading the executable. */
+  bool lazy_constants = false;
 
  private:
+  /*! \brief Where a lazy constant is serialized in the code, and what it holds. */
+  struct LazyConstant {
+    static constexpr size_t kNotLazy = static_cast<size_t>(-1);
+    size_t offset = kNotLazy;
+    DLDataType dtype;
+    std::vector<int64_t> shape;
+    size_t nbytes = 0;
+  };
+
+  /*!
+   * \brief Skip over a serialized constant, recording where it is.
+   *
+   * \param stream The stream positioned at the constant.
+   * \param lazy The location and description of the constant.
+   * \return Whether the constant header could be read.
+   */
+  static bool SkipConstant(dmlc::SeekStream* stream, LazyConstant* lazy);
+
+  /*! \brief Whether the constant at \p index is lazy, must hold lazy_mutex_. */
+  bool IsLazyConstant(Index index) const;
+
+  /*! \brief Deserialize the constant at \p index if it is lazy and not loaded, must hold
+   *  lazy_mutex_. */
+  ObjectRef LoadLazyConstant(Index index);
+
+  /*!
+   * \brief Load every section of the executable.
+   *
+   * \param strm The input stream, positioned at the header.
+   */
+  void LoadSections(dmlc::SeekStream* strm);
+
+  /*! \brief Deserialize every lazy constant and leave the lazy mode. */
+  void LoadAllConstants();
+
+  /*!
+   * \brief Move the constants of at least \p byte_limit bytes out of the executable.
+   *
+   * \return The late-bound constants by name.
+   */
+  Map<String, NDArray> MoveLateBoundConstantsToMap(size_t byte_limit);
+
+  /*!
+   * \brief Bind the late-bound constants from \p map.
+   *
+   * \param map The late-bound constants by name.
+   */
+  void LoadLateBoundConstantsFromMap(Map<String, NDArray> map);
+
   /*!
    * \brief Save the virtual devices
    *
@@ -351,6 +457,19 @@ class Executable : public ModuleNode {
    */
   void LoadCodeSection(dmlc::Stream* strm);
 
+  /*! \brief The lazy constants by index, empty unless loaded with lazy constants. */
+  std::vector<LazyConstant> lazy_constants_;
+  /*! \brief Whether any constant was loaded lazily, fixed once loading finished. */
+  bool has_lazy_constants_ = false;
+  /*! \brief The file the lazy constants are read from, null when they are read from code_. */
+  std::shared_ptr<MappedFile> mapped_code_;
+  /*! \brief Protects the constants, the lazy constants and their counters after loading. */
+  mutable std::mutex lazy_mutex_;
+  size_t lazy_resident_bytes_ = 0;
+  int64_t lazy_num_loads_ = 0;
+  int64_t lazy_num_evictions_ = 0;
+  /*! \brief Seconds spent deserializing lazy constants. */
+  double lazy_load_time_ = 0;
   /*! \brief The serialized bytecode. */
   std::string code_;
 };
@@ -28,6 +28,7 @@
 #include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/object.h>
 
+#include <atomic>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -50,6 +51,8 @@ struct Buffer {
 enum AllocatorType {
   kNaive = 1,
   kPooled,
+  kSlab,
+  kThreadCached,
 };
 
 class Allocator {
@@ -101,6 +104,13 @@ class MemoryManager {
    * \return The memory allocator.
    */
   static Allocator* GetAllocator(Device dev);
+  /*!
+   * \brief Create a standalone allocator that is not registered with the manager.
+   * \param dev The TVM device
+   * \param type The allocator type
+   * \return The memory allocator.
+   */
+  static std::unique_ptr<Allocator> CreateAllocator(Device dev, AllocatorType type);
 
  private:
   MemoryManager() {}
@@ -110,11 +120,49 @@ class MemoryManager {
   std::unordered_map<Device, std::unique_ptr<Allocator>> allocators_;
 };
 
+/*!
+ * \brief Records the stream of allocations and frees issued by the VM so that it can
+ *  be replayed offline against different allocator types.
+ *
+ * Each event is stored as (kind, id, nbytes, alignment) where kind is 0 for an
+ * allocation and 1 for a free, and id pairs a free with its allocation.
+ */
+class AllocTraceRecorder {
+ public:
+  static AllocTraceRecorder* Global();
+  /*! \brief Whether recording is enabled, cheap enough to check on every allocation. */
+  bool enabled() const { return enabled_.load(std::memory_order_relaxed); }
+  /*! \brief Discard any previous trace and start recording. */
+  void Start();
+  /*!
+   * \brief Stop recording.
+   * \return The recorded events as an int64 NDArray of shape (num_events, 4).
+   */
+  NDArray Stop();
+  /*! \brief Record the allocation of buffer for a request of nbytes. */
+  void RecordAlloc(const Buffer& buffer, size_t nbytes, size_t alignment);
+  /*! \brief Record the release of buffer. */
+  void RecordFree(const Buffer& buffer);
+
+ private:
+  std::atomic<bool> enabled_{false};
+  std::mutex mu_;
+  std::vector<int64_t> events_;
+  /*! \brief The trace id of each live buffer, keyed by its data pointer. */
+  std::unordered_map<const void*, int64_t> live_;
+  int64_t next_id_{0};
+};
+
 /*! \brief An object representing a storage allocation. */
 class StorageObj : public Object {
  public:
   /*! \brief The index into the VM function table. */
   Buffer buffer;
+  /*!
+   * \brief The allocator which owns the buffer. When unset it is looked up
+   *  from the MemoryManager on release, which takes the manager's lock.
+   */
+  Allocator* allocator{nullptr};
 
   /*! \brief Allocate an NDArray from a given piece of storage. */
   NDArray AllocNDArray(size_t offset, std::vector<int64_t> shape, DLDataType dtype);
@@ -123,7 +171,10 @@ class StorageObj : public Object {
   static void Deleter(Object* ptr);
 
   ~StorageObj() {
-    auto alloc = MemoryManager::Global()->GetAllocator(buffer.device);
+    if (AllocTraceRecorder::Global()->enabled()) {
+      AllocTraceRecorder::Global()->RecordFree(buffer);
+    }
+    auto alloc = allocator ? allocator : MemoryManager::Global()->GetAllocator(buffer.device);
     alloc->Free(buffer);
   }
 
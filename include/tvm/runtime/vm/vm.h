@@ -41,6 +41,9 @@
 
 namespace tvm {
 namespace runtime {
+
+class SamplingProfiler;
+
 namespace vm {
 
 /*!
@@ -134,6 +137,23 @@ struct VMFrame {
         caller_return_register(0) {}
 };
 
+class VMAsyncExecutor;
+
+/*!
+ * \brief Instruction sequences the dispatch loop executes as a single step.
+ *
+ * They are found when the executable is loaded and recorded for the first
+ * instruction of each sequence, so the bytecode itself is left unchanged.
+ */
+enum class SuperInstruction : uint8_t {
+  /*! \brief Execute the instruction on its own. */
+  kNone = 0,
+  /*! \brief An AllocStorage followed by an AllocTensor from the new storage. */
+  kAllocStorageTensor = 1,
+  /*! \brief An InvokePacked followed by one or more KillRegister. */
+  kInvokePackedKill = 2,
+};
+
 /*!
  * \brief The virtual machine.
  *
@@ -194,13 +214,14 @@ class VirtualMachine : public runtime::ModuleNode {
    * \param obj The object to write to.
    */
   inline void WriteRegister(RegName reg, const ObjectRef& obj);
+  inline void WriteRegister(RegName reg, ObjectRef&& obj);
 
   /*!
    * \brief Read a VM register.
    * \param reg The register to read from.
-   * \return The read object.
+   * \return The read object, valid until the register is written or the frame is popped.
    */
-  ObjectRef ReadRegister(RegName reg) const;
+  const ObjectRef& ReadRegister(RegName reg) const;
 
   /*!
    * \brief Read a VM register and cast it to int32_t
@@ -255,6 +276,44 @@ class VirtualMachine : public runtime::ModuleNode {
   Device GetDevice(Index device_index) const;
   Allocator* GetAllocator(Index device_index) const;
 
+  /*! \brief Find the superinstructions of every function in the executable. */
+  void DecodeSuperInstructions();
+
+  /*! \brief The superinstruction table of a function, nullptr if there is none. */
+  const SuperInstruction* GetSuperInstructions(Index func_index) const;
+
+  /*!
+   * \brief Copy a constant of the executable into the constant pool, evicting the least
+   *  recently used constants if the pool exceeds its memory budget.
+   * \param const_index The index of the constant.
+   */
+  void LoadConstant(Index const_index);
+
+  /*! \brief The constant pool counters as a JSON object. */
+  std::string ConstantStats() const;
+
+  /*!
+   * \brief Time the kernels of one invocation out of every sample_every.
+   * \param sample_every Sample one invocation out of this many, 0 to stop sampling.
+   * \param min_interval_ms The least time between two sampled invocations, 0 for no limit.
+   * \param window_s The histograms cover the samples of the last one to two windows.
+   */
+  void SetSamplingProfiler(int64_t sample_every, double min_interval_ms, double window_s);
+
+  /*!
+   * \brief Create a VM that runs the same executable on the same devices and allocators,
+   *  starting with the constants this VM has already loaded.
+   */
+  ObjectPtr<VirtualMachine> CreateWorker() const;
+
+  /*!
+   * \brief Invoke a function on a worker VM of the async executor.
+   * \param func_name The function's name.
+   * \param args The arguments to the function.
+   * \return A module whose "wait" returns the result, and "is_ready" tells whether it has one.
+   */
+  Module InvokeAsync(const std::string& func_name, std::vector<ObjectRef> args);
+
   /*!
    * \brief Invoke a global setting up the VM state to execute.
    *
@@ -272,6 +331,16 @@ class VirtualMachine : public runtime::ModuleNode {
    */
   void SetInput(std::string name, TVMArgs args, int offset);
 
+  /*!
+   * \brief Convert the arguments to the inputs of a function, copying them to the devices of
+   *  its parameters.
+   * \param func_name The function name.
+   * \param args args[offset:] are the arguments to the function.
+   * \param offset Starting position in args.
+   * \return The inputs.
+   */
+  std::vector<ObjectRef> ConvertInputs(const std::string& func_name, TVMArgs args, int offset);
+
   /*!
    * \brief Set one input tensor with index or name to a function.
    * \param name The function name.
@@ -290,7 +359,7 @@ class VirtualMachine : public runtime::ModuleNode {
    *
    * \param instr Instruction that will be executed after this hook fires
    */
-  virtual void OpStartHook(Instruction instr);
+  virtual void OpStartHook(const Instruction& instr);
 
   /*!
    * \brief Internal hook for profiling the end of an op.
@@ -348,6 +417,20 @@ class VirtualMachine : public runtime::ModuleNode {
   Index func_index_;
   /*! \brief The current pointer to the code section. */
   const Instruction* code_;
+  /*! \brief The superinstructions of the current function, indexed by pc, or nullptr. */
+  const SuperInstruction* super_code_{nullptr};
+  /*! \brief The superinstruction table of each function. */
+  std::vector<std::vector<SuperInstruction>> super_instructions_;
+  /*! \brief Whether the dispatch loop executes superinstructions. */
+  bool use_super_instructions_{true};
+  /*! \brief Reused argument buffer of InvokePacked, cleared after each call. */
+  std::vector<ObjectRef> packed_args_;
+  /*! \brief Runs invoke_async requests, created on the first one. */
+  std::shared_ptr<VMAsyncExecutor> async_executor_;
+  /*! \brief The number of worker VMs of the async executor, 0 for the default. */
+  int num_async_workers_{0};
+  /*! \brief The threads of the parallel kernels of each async worker, 0 to split the cores. */
+  int async_intra_op_threads_{0};
   /*! \brief The virtual machine PC. */
   Index pc_;
   /*! \brief The special return register. */
@@ -369,6 +452,20 @@ class VirtualMachine : public runtime::ModuleNode {
    * object to avoid rellocation of constants during inference.
    */
   std::vector<ObjectRef> const_pool_;
+  /*! \brief The bytes of each constant in the pool. */
+  std::vector<size_t> const_pool_sizes_;
+  /*! \brief The logical time each constant was last loaded, to evict the least recent. */
+  std::vector<uint64_t> const_last_use_;
+  uint64_t const_clock_{0};
+  /*! \brief The bytes held by the constant pool. */
+  size_t const_pool_bytes_{0};
+  /*! \brief The bytes the constant pool may hold before evicting, 0 for no limit. */
+  size_t const_budget_bytes_{0};
+  int64_t const_pool_evictions_{0};
+  /*! \brief The profiler of sampled invocations, shared with the async workers, or null. */
+  std::shared_ptr<SamplingProfiler> sampling_profiler_;
+  /*! \brief Whether the kernels of the current invocation are timed. */
+  bool sampling_run_{false};
 };
 
 }  // namespace vm
@@ -23,6 +23,7 @@ as a schedule configuration here.
 """
 # pylint: disable=invalid-name
 
+import hashlib
 import logging
 import pathlib
 
@@ -32,7 +33,7 @@ from tvm.contrib.utils import tempdir
 from tvm.tir.expr import FloatImm
 from .cost_model import RandomModel, XGBModel
 from .measure import LocalRPCMeasureContext
-from .measure_record import RecordToFile, load_records
+from .measure_record import RecordToFile, dump_record_to_string, load_records
 from .search_policy import PreloadMeasuredStates, SketchPolicy
 from .search_task import SearchTask, TuningOptions
 from .utils import calc_workload_dis_factor, decode_workload_key
@@ -115,6 +116,17 @@ class DispatchContext(object):
         """
         raise NotImplementedError()
 
+    def identity(self):
+        """Text that changes whenever the states this context gives may change.
+
+        Returns
+        -------
+        identity : Optional[str]
+            The identity, or None when the states depend on more than the state of
+            the context.
+        """
+        return None
+
     def __enter__(self):
         self._old_ctx = DispatchContext.current
         DispatchContext.current = self
@@ -151,6 +163,8 @@ class ApplyHistoryBest(DispatchContext):
         self.best_by_targetkey = {}
         self.best_by_model = {}
         self._best_user_defined = {}
+        # Digest of everything loaded or updated, in order.
+        self._digest = hashlib.sha256(repr(include_compatible).encode())
 
         self.load(records, n_lines)
 
@@ -199,7 +213,11 @@ class ApplyHistoryBest(DispatchContext):
         if isinstance(records, pathlib.Path):
             records = str(records)
 
-        if isinstance(records, str):
+        from_file = isinstance(records, str)
+        if from_file:
+            with open(records, "rb") as log:
+                self._digest.update(repr(n_lines).encode())
+                self._digest.update(log.read())
             records = load_records(records)
 
         if not records:
@@ -213,6 +231,8 @@ class ApplyHistoryBest(DispatchContext):
             if n_lines is not None and counter >= n_lines:
                 break
             counter += 1
+            if not from_file:
+                self._digest.update(dump_record_to_string(inp, res).encode())
             if res.error_no != 0:
                 continue
 
@@ -300,6 +320,7 @@ class ApplyHistoryBest(DispatchContext):
         return None
 
     def update(self, target, workload_key, state):
+        self._digest.update(repr((str(target), workload_key, str(state))).encode())
         entry, _, workload_args = self.get_workload_entry(
             self._best_user_defined, target.model, workload_key
         )
@@ -309,6 +330,9 @@ class ApplyHistoryBest(DispatchContext):
             entry, _, _ = self.get_workload_entry(self._best_user_defined, k, workload_key)
             entry[workload_args] = (state, 1)
 
+    def identity(self):
+        return "ApplyHistoryBest " + self._digest.hexdigest()
+
 
 class ApplyHistoryBestOrSample(ApplyHistoryBest):
     """
@@ -359,6 +383,10 @@ class ApplyHistoryBestOrSample(ApplyHistoryBest):
             ret = self._old_ctx.query(target, workload_key, has_complex_op, dag, func_name)
         return ret
 
+    def identity(self):
+        # The sampled states are random.
+        return None
+
     def _query_inside(self, target, workload_key, func_name):
         ret = super(ApplyHistoryBestOrSample, self)._query_inside(target, workload_key, func_name)
         if ret is not None:
@@ -451,5 +479,9 @@ class FallbackContext(DispatchContext):
         key = (str(target), workload_key)
         self.memory[key] = state
 
+    def identity(self):
+        # Without records, every workload gets the TOPI schedule.
+        return "FallbackContext"
+
 
 DispatchContext.current = FallbackContext()
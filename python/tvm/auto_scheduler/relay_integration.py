@@ -238,6 +238,30 @@ class TracingEnvironment:
         self.wkl_key_to_input_names[workload_key] = input_names
 
 
+@tvm._ffi.register_func("auto_scheduler.dispatch_context_key")
+def dispatch_context_key():
+    """Identify the states the auto-scheduler gives, for the Relay compilation cache.
+
+    Returns
+    -------
+    key : Optional[str]
+        The identities of the current dispatch context and those it falls back to, or None
+        when lowerings must not be cached: while tracing, or under a context without an
+        identity.
+    """
+    if TracingEnvironment.current is not None:
+        return None
+    identities = []
+    context = DispatchContext.current
+    while context is not None:
+        identity = context.identity()
+        if identity is None:
+            return None
+        identities.append(identity)
+        context = context._old_ctx  # pylint: disable=protected-access
+    return " ".join(identities)
+
+
 @tvm._ffi.register_func("auto_scheduler.enter_layout_rewrite")
 def enter_layout_rewrite():
     """Enter layout rewrite tracing environment"""
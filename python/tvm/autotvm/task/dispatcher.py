@@ -30,6 +30,7 @@ of the DispatchContext base class.
 
 from __future__ import absolute_import as _abs
 
+import hashlib
 import logging
 
 import numpy as np
@@ -144,6 +145,17 @@ class DispatchContext(object):
         """
         raise NotImplementedError()
 
+    def identity(self):
+        """Text that changes whenever the configs this context gives may change.
+
+        Returns
+        -------
+        identity : Optional[str]
+            The identity, or None when the configs depend on more than the state of
+            the context, such as the order of the queries.
+        """
+        return None
+
     def __enter__(self):
         self._old_ctx = DispatchContext.current
         DispatchContext.current = self
@@ -196,6 +208,8 @@ class ApplyHistoryBest(DispatchContext):
         self.best_by_targetkey = {}
         self.best_by_model = {}
         self._best_user_defined = {}
+        # Digest of everything loaded or updated, in order.
+        self._digest = hashlib.sha256()
 
         if records:
             self.load(records)
@@ -212,12 +226,15 @@ class ApplyHistoryBest(DispatchContext):
         """
         # pylint: disable=import-outside-toplevel
         from pathlib import Path
-        from ..record import load_from_file
+        from ..record import encode, load_from_file
 
         if isinstance(records, Path):
             records = str(records)
 
-        if isinstance(records, str):
+        from_file = isinstance(records, str)
+        if from_file:
+            with open(records, "rb") as log:
+                self._digest.update(log.read())
             records = load_from_file(records)
         if not records:
             return
@@ -228,6 +245,8 @@ class ApplyHistoryBest(DispatchContext):
         counter = 0
         for inp, res in records:
             counter += 1
+            if not from_file:
+                self._digest.update(encode(inp, res).encode())
             if res.error_no != 0:
                 continue
 
@@ -283,6 +302,7 @@ class ApplyHistoryBest(DispatchContext):
     def update(self, target, workload, cfg):
         model = target.model
         key = (model, workload)
+        self._digest.update(repr((str(target), workload, str(cfg))).encode())
         # assume user provided config is the best
         cfg.cost = 0
         self._best_user_defined[key] = cfg
@@ -291,6 +311,9 @@ class ApplyHistoryBest(DispatchContext):
             key = (k, workload)
             self._best_user_defined[key] = cfg
 
+    def identity(self):
+        return "ApplyHistoryBest " + self._digest.hexdigest()
+
 
 class FallbackContext(DispatchContext):
     """
@@ -342,6 +365,10 @@ class FallbackContext(DispatchContext):
         key = (str(target), workload)
         self.memory[key] = cfg
 
+    def identity(self):
+        # The fallback configs only depend on the workloads.
+        return "FallbackContext"
+
 
 DispatchContext.current = FallbackContext()
 
@@ -28,6 +28,7 @@ See tvm/topi/python/topi/arm_cpu/depthwise_conv2d.py for example usage.
 """
 import functools
 
+import tvm._ffi
 import tvm.te._ffi_api
 from tvm.target import Target
 from tvm.te import tensor
@@ -123,6 +124,31 @@ class TaskExtractEnv:
         return TaskExtractEnv.current
 
 
+@tvm._ffi.register_func("autotvm.dispatch_context_key")
+def dispatch_context_key():
+    """Identify the configs tunable templates get, for the Relay compilation cache.
+
+    Returns
+    -------
+    key : Optional[str]
+        The identities of the current dispatch context and those it falls back to, or None
+        when lowerings must not be cached: during task extraction, or under a context
+        without an identity.
+    """
+    env = TaskExtractEnv.current
+    if env is not None and env.tracing:
+        return None
+    identities = []
+    context = DispatchContext.current
+    while context is not None:
+        identity = context.identity()
+        if identity is None:
+            return None
+        identities.append(identity)
+        context = context._old_ctx  # pylint: disable=protected-access
+    return " ".join(identities)
+
+
 def register_topi_compute(task_name, func=None):
     """Register a tunable template for a topi compute function.
 
@@ -281,7 +281,7 @@ class GraphModuleDebug(graph_executor.GraphModule):
         ret = self._run_individual(number, repeat, min_repeat_ms)
         return ret.strip(",").split(",") if ret else []
 
-    def profile(self, collectors=None, **input_dict):
+    def profile(self, collectors=None, timeline=False, **input_dict):
         """Run forward execution of the graph and collect overall and per-op
         performance metrics.
 
@@ -290,6 +290,9 @@ class GraphModuleDebug(graph_executor.GraphModule):
         collectors : Optional[Sequence[MetricCollector]]
             Extra metrics to collect. If profiling over RPC, collectors must be `None`.
 
+        timeline : bool
+            Whether to record when each op ran, see :py:meth:`Report.chrome_trace`.
+
         input_dict : dict of str to NDArray
             List of input values to be feed to
 
@@ -304,8 +307,12 @@ class GraphModuleDebug(graph_executor.GraphModule):
         if self.module.type_key == "rpc":
             # We cannot serialize MetricCollectors over RPC
             assert collectors is None, "Profiling with collectors is not supported over RPC"
-            return Report.from_json(self._profile_rpc())
-        return self._profile(collectors)
+            # The timeline variants are looked up only when asked for, a remote runtime may
+            # predate them.
+            profile_rpc = self.module["profile_rpc_timeline"] if timeline else self._profile_rpc
+            return Report.from_json(profile_rpc())
+        profile = self.module["profile_timeline"] if timeline else self._profile
+        return profile(collectors)
 
     def exit(self):
         """Exits the dump folder and all its contents"""
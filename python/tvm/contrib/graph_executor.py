@@ -15,6 +15,8 @@
 # specific language governing permissions and limitations
 # under the License.
 """Minimum graph executor that executes graph containing TVM PackedFunc."""
+import json
+
 import numpy as np
 import tvm._ffi
 
@@ -325,6 +327,19 @@ class GraphModule(object):
         """
         self._load_params(bytearray(params_bytes))
 
+    def load_mapped_params(self, path):
+        """Load parameters from a file saved by tvm.runtime.save_mapped_param_dict.
+
+        CPU parameters are used in place from a memory mapping of the file, so they are
+        only read as the model touches them and their pages are shared between processes.
+
+        Parameters
+        ----------
+        path : str
+            The parameter file.
+        """
+        self.module["load_mapped_params"](path)
+
     def share_params(self, other, params_bytes):
         """Share parameters from pre-existing GraphExecutor instance.
 
@@ -338,6 +353,75 @@ class GraphModule(object):
         """
         self._share_params(other.module, bytearray(params_bytes))
 
+    def set_inter_op_threads(self, num_threads, intra_op_threads=0):
+        """Run independent operators of the graph at the same time.
+
+        Operators are dispatched to a pool of num_threads threads as soon as the
+        operators they depend on have finished. Each thread and its intra-op
+        workers are bound to a separate slice of the cores. Sessions created
+        afterwards inherit the setting. Can also be enabled with the
+        TVM_GRAPH_EXECUTOR_INTER_OP_THREADS environment variable.
+
+        Parameters
+        ----------
+        num_threads : int
+            The number of operators run at once, 0 or 1 to run them one by one.
+
+        intra_op_threads : int
+            The number of threads each operator uses, 0 to split the cores evenly.
+        """
+        self.module["set_inter_op_threads"](num_threads, intra_op_threads)
+
+    def set_sampling_profiler(self, sample_every=100, min_interval_ms=0, window_s=60):
+        """Time the operators of a sample of the runs, cheap enough to leave on.
+
+        Runs that are not sampled only count themselves. Sessions created
+        afterwards share the profiler. Can also be enabled with the
+        TVM_SAMPLING_PROFILER_EVERY environment variable.
+
+        Parameters
+        ----------
+        sample_every : int
+            Sample one run out of this many, 0 to stop sampling.
+
+        min_interval_ms : float
+            The least time between two sampled runs, 0 for no limit.
+
+        window_s : float
+            The report covers the samples of the last one to two windows.
+        """
+        self.module["set_sampling_profiler"](sample_every, min_interval_ms, window_s)
+
+    def get_sampling_profile(self):
+        """Get the durations of the sampled runs and of their operators.
+
+        Returns
+        -------
+        profile : dict
+            The number of runs and of sampled runs, the statistics of whole
+            runs under "run" and of each operator under "ops", the slowest in
+            total first. Statistics are the count and the mean, p50, p95 and
+            p99 durations in microseconds.
+        """
+        return json.loads(self.module["get_sampling_profile"]())
+
+    def create_session(self):
+        """Create a session that shares the parameters and code of this module.
+
+        The session has its own inputs, outputs and intermediate buffers, so
+        sessions can be run from different threads at the same time. Parameters
+        must be set before the session is created; setting a parameter input on a
+        session writes to the storage shared with every other session. Other
+        inputs, such as weights given through set_input, start out as a copy of
+        their value in this module and are not affected by later changes to it.
+
+        Returns
+        -------
+        session : GraphModule
+            The session, with the same interface as this module.
+        """
+        return GraphModule(self.module["create_session"]())
+
     def __getitem__(self, key):
         """Get internal module function
 
@@ -21,6 +21,7 @@ import tvm._ffi
 from tvm import relay
 from tvm.relay.transform import InferType
 from tvm.contrib import graph_executor
+from tvm.contrib.debugger import debug_executor
 
 
 def pipeline_executor_enabled():
@@ -34,6 +35,81 @@ def pipeline_executor_enabled():
     return tvm._ffi.get_global_func("tvm.pipeline_executor.create", allow_missing=True) is not None
 
 
+def profile_node_costs(lib, dev, number=10):
+    """Measure the running time of every operator node of a built module, in the order the
+    graph executor runs them. The result can be passed to `suggest_split_points`.
+
+    Parameters
+    ----------
+    lib : tvm.runtime.Module
+        The module built by `relay.build` from the whole model.
+
+    dev : Device
+        The device to profile on.
+
+    number : int
+        The number of runs to average over.
+
+    Returns
+    -------
+    costs : List[float]
+        The running time in seconds of every node, zero for the nodes that are not operators.
+    """
+    debug_mod = debug_executor.create(lib.get_graph_json(), lib.get_lib(), dev, dump_root=None)
+    debug_mod.set_input(**lib.get_params())
+    times = debug_mod.run_individual(number=number, repeat=1, min_repeat_ms=0)
+    return [float(t) for t in times]
+
+
+def suggest_split_points(costs, num_stages):
+    """Suggest where to split a sequence of operators into pipeline stages so that the slowest
+    stage, which bounds the throughput of the pipeline, is as fast as possible.
+
+    Parameters
+    ----------
+    costs : List[float]
+        The cost of every operator in execution order, for example from `profile_node_costs`.
+
+    num_stages : int
+        The number of pipeline stages.
+
+    Returns
+    -------
+    split_points : List[int]
+        The index of the first operator of every stage but the first one.
+
+    stage_costs : List[float]
+        The total cost of every stage.
+    """
+    if num_stages < 1:
+        raise RuntimeError("num_stages should be positive, but got %d" % num_stages)
+    num_stages = min(num_stages, max(len(costs), 1))
+
+    def greedy_split(bound):
+        splits, total = [], 0.0
+        for i, cost in enumerate(costs):
+            if total + cost > bound and total > 0:
+                splits.append(i)
+                total = 0.0
+            total += cost
+        return splits
+
+    # Binary search the smallest bound for which at most 'num_stages' stages are needed.
+    low, high = max(costs, default=0.0), float(sum(costs))
+    for _ in range(64):
+        if high - low <= 1e-9 * max(high, 1e-12):
+            break
+        mid = (low + high) / 2
+        if len(greedy_split(mid)) < num_stages:
+            high = mid
+        else:
+            low = mid
+    splits = greedy_split(high)
+    bounds = [0] + splits + [len(costs)]
+    stage_costs = [float(sum(costs[bounds[i] : bounds[i + 1]])) for i in range(len(bounds) - 1)]
+    return splits, stage_costs
+
+
 def build(pipe_configs):
     """Build modules used in the pipeline executor, then use these modules and configuration
     to create a pipeline executor.
@@ -117,6 +193,7 @@ class PipelineModule(object):
         # Get the packed functions from the pipeline executor.
         self._get_params_group_pipeline_map = self.module["get_params_group_pipeline_map"]
         self._run = self.module["run"]
+        self._try_run = self.module["try_run"]
         self._set_param = self.module["set_param"]
         self._set_input = self.module["set_input"]
         self._get_input = self.module["get_input"]
@@ -124,11 +201,26 @@ class PipelineModule(object):
         self._get_num_outputs = self.module["get_num_outputs"]
         self._get_input_pipeline_map = self.module["get_input_pipeline_map"]
         self._get_pipe_execute_count = self.module["get_execute_count"]
+        self._get_stage_profile = self.module["get_stage_profile"]
+        self._reset_stage_profile = self.module["reset_stage_profile"]
+        self._get_queue_stats = self.module["get_queue_stats"]
 
     def run(self):
-        """Run the pipeline executor."""
+        """Run the pipeline executor. When a later stage has fallen behind and the queue in
+        front of it is full, this waits until the stage frees a slot."""
         self._run()
 
+    def try_run(self):
+        """Run the pipeline executor only when the request can enter the pipeline without
+        waiting, so that the caller can shed or delay load when the pipeline is saturated.
+
+        Returns
+        -------
+        accepted : bool
+            Whether the request was run.
+        """
+        return bool(self._try_run())
+
     def get_input_pipeline_map(self, name):
         """Using the "name" to get the corresponding subgraph index and also get the "input name"
         of the corresponding subgraph interface.
@@ -200,14 +292,35 @@ class PipelineModule(object):
         """
         return self._get_input(key)
 
-    def get_output(self):
+    def get_output(self, timeout_ms=0):
         """Get the output.
+
+        Parameters
+        ----------
+        timeout_ms : int
+            The longest time to wait for the output in milliseconds, zero to return right away
+            and a negative value to wait until the output is ready.
+
         Returns
         -------
         data : Array[NDArray]
             A list of output data.
         """
-        return self._get_output()
+        return self._get_output(timeout_ms)
+
+    def get_queue_stats(self):
+        """Get the occupancy and the wait time of every queue forwarding data between the
+        stages and to the pipeline outputs.
+
+        Returns
+        -------
+        stats : List[dict]
+            For every queue the producing "mod_idx" and "output_idx", the consuming
+            "child_mod_idx" and "child_input_idx" (-1 for a pipeline output), its "capacity",
+            the mean and max occupancy, the number of pushes that waited for a free slot and
+            how long they waited, and the mean and max time data waited to be consumed.
+        """
+        return json.loads(self._get_queue_stats())
 
     @property
     def num_executing_pipeline(self):
@@ -219,6 +332,24 @@ class PipelineModule(object):
         """
         return self._get_pipe_execute_count()
 
+    def get_stage_profile(self):
+        """Get the timing of every pipeline stage since creation or the last reset. The
+        stage with the largest time per request is the bottleneck of the pipeline.
+
+        Returns
+        -------
+        profile : dict
+            "stages" lists for every stage the number of runs and requests, the time spent
+            running, forwarding outputs and waiting for inputs in microseconds, and the time
+            per request. "bottleneck" is the index of the slowest stage and "bound_us" its time
+            per request, "serial_us" is the time per request of running all stages serially.
+        """
+        return json.loads(self._get_stage_profile())
+
+    def reset_stage_profile(self):
+        """Reset the timing of every pipeline stage."""
+        self._reset_stage_profile()
+
     @property
     def num_outputs(self):
         """Get the number of outputs.
@@ -511,6 +642,12 @@ class PipelineConfig(object):
             self.name = None
             self.dev = None
             self.cpu_affinity = ""
+            # The number of requests coalesced into one run, the module needs to be built with
+            # this many requests stacked along the first axis of every input and output.
+            self.micro_batch = 1
+            # The capacity of the queues forwarding the outputs of the module, zero to use the
+            # default one which the TVM_PIPELINE_QUEUE_CAPACITY environment variable can set.
+            self.queue_capacity = 0
             self.idx = None
             self.mod = mod
             self.input_params = InferType()(mod)["main"].params
@@ -687,6 +824,10 @@ class PipelineConfig(object):
 
             mconf["mod_idx"] = module.idx
             mconf["cpu_affinity"] = module.cpu_affinity
+            if module.micro_batch > 1:
+                mconf["micro_batch"] = module.micro_batch
+            if module.queue_capacity > 0:
+                mconf["queue_capacity"] = module.queue_capacity
             mconf["output"] = output_conf
 
             module_connection[mod] = {
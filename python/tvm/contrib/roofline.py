@@ -0,0 +1,340 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""Roofline analysis of the operators of a model.
+
+Each fused operator is placed on the roofline of the hardware: the FLOPs and
+bytes the compiler estimates for its PrimFunc, divided by the time the profiler
+measured, give the achieved GFLOP/s and GB/s. Comparing them with the peaks of
+the hardware tells whether the operator is compute or memory bound, and how far
+it is from its bound.
+
+The bytes of an operator are the sizes of its arguments, the traffic it cannot
+avoid. Operators which read their inputs more than once from memory move more,
+so their percent of the roofline is an upper bound.
+"""
+
+import json
+
+import numpy as np
+
+import tvm
+from tvm import relay, te, tir
+from tvm.contrib.debugger import debug_executor
+from tvm.runtime.profiling import Report
+from tvm.tir.analysis import estimate_tir_flops
+
+# Peak float32 GFLOP/s and memory GB/s of the common data center GPU of each CUDA
+# architecture. Pass the peaks explicitly for other parts.
+GPU_PEAKS = {
+    "sm_70": (15700.0, 900.0),  # V100
+    "sm_75": (8100.0, 320.0),  # T4
+    "sm_80": (19500.0, 1555.0),  # A100
+    "sm_86": (31200.0, 600.0),  # A10
+    "sm_89": (30300.0, 300.0),  # L4
+    "sm_90": (67000.0, 3350.0),  # H100
+}
+
+
+def estimate_bytes(func):
+    """Estimate the bytes a PrimFunc moves from and to memory.
+
+    Parameters
+    ----------
+    func : tvm.tir.PrimFunc
+        The function.
+
+    Returns
+    -------
+    nbytes : Optional[int]
+        The total size of the buffer arguments, None if one of them has a dynamic shape.
+    """
+    nbytes = 0
+    for param in func.params:
+        buf = func.buffer_map.get(param, None)
+        if buf is None:
+            continue
+        size = tvm.DataType(buf.dtype).bits * tvm.DataType(buf.dtype).lanes // 8
+        for dim in buf.shape:
+            if not isinstance(dim, tir.IntImm):
+                return None
+            size *= dim.value
+        nbytes += size
+    return nbytes
+
+
+def measure_peak_bandwidth(target, dev, nbytes=1 << 28, number=10):
+    """Measure the memory bandwidth of a CPU with a parallel copy.
+
+    Parameters
+    ----------
+    target : tvm.target.Target
+        An llvm target.
+    dev : tvm.runtime.Device
+        The device.
+    nbytes : int
+        The bytes to copy, much larger than the last level cache.
+    number : int
+        The number of copies to time.
+
+    Returns
+    -------
+    bandwidth : float
+        The bytes read and written per second, in GB/s.
+    """
+    n = nbytes // 4
+    A = te.placeholder((n,), name="A")
+    B = te.compute((n,), lambda i: A[i] + 1.0, name="B")
+    s = te.create_schedule(B.op)
+    outer, inner = s[B].split(B.op.axis[0], factor=64)
+    s[B].parallel(outer)
+    s[B].vectorize(inner)
+    f = tvm.build(s, [A, B], target)
+    a = tvm.nd.empty((n,), "float32", dev)
+    b = tvm.nd.empty((n,), "float32", dev)
+    seconds = f.time_evaluator(f.entry_name, dev, number=number)(a, b).mean
+    return 2 * n * 4 / seconds / 1e9
+
+
+def measure_peak_flops(target, dev, lanes=16, accumulators=8, iters=100000, number=10):
+    """Measure the float32 FLOP/s of a CPU with independent fused multiply-adds.
+
+    Parameters
+    ----------
+    target : tvm.target.Target
+        An llvm target.
+    dev : tvm.runtime.Device
+        The device.
+    lanes : int
+        The vector width, at least the one of the CPU.
+    accumulators : int
+        The independent accumulators of each thread, to hide the latency of the FMAs.
+    iters : int
+        The multiply-adds of each accumulator.
+    number : int
+        The number of runs to time.
+
+    Returns
+    -------
+    flops : float
+        The floating point operations per second, in GFLOP/s.
+    """
+    num_threads = tvm.get_global_func("runtime.NumThreads")()
+    A = te.placeholder((num_threads, accumulators, lanes), name="A")
+    B = te.placeholder((iters,), name="B")
+    k = te.reduce_axis((0, iters), name="k")
+    C = te.compute(A.shape, lambda t, u, l: te.sum(A[t, u, l] * B[k], axis=k), name="C")
+    s = te.create_schedule(C.op)
+    # Keep the accumulators in registers for the whole reduction.
+    CL = s.cache_write(C, "local")
+    t, u, l = s[C].op.axis
+    s[C].parallel(t)
+    s[C].vectorize(l)
+    s[CL].compute_at(s[C], t)
+    _, ul, ll = s[CL].op.axis
+    s[CL].reorder(s[CL].op.reduce_axis[0], ul, ll)
+    s[CL].unroll(ul)
+    s[CL].vectorize(ll)
+    f = tvm.build(s, [A, B, C], target)
+    a = tvm.nd.array(np.ones(A.shape, "float32"), dev)
+    b = tvm.nd.array(np.ones(B.shape, "float32"), dev)
+    c = tvm.nd.empty(C.shape, "float32", dev)
+    seconds = f.time_evaluator(f.entry_name, dev, number=number)(a, b, c).mean
+    return 2 * num_threads * accumulators * lanes * iters / seconds / 1e9
+
+
+def estimate_peaks(target, dev):
+    """Find the peak float32 GFLOP/s and memory GB/s of the hardware of a target.
+
+    GPUs are looked up in `GPU_PEAKS` by architecture, CPUs are measured.
+
+    Returns
+    -------
+    peaks : Tuple[float, float]
+        The peak GFLOP/s and GB/s.
+    """
+    target = tvm.target.Target(target)
+    if target.kind.name == "llvm":
+        return measure_peak_flops(target, dev), measure_peak_bandwidth(target, dev)
+    arch = str(target.attrs.get("arch", ""))
+    if target.kind.name == "cuda" and arch in GPU_PEAKS:
+        return GPU_PEAKS[arch]
+    raise ValueError(
+        "Unknown peaks for target %s, pass peak_gflops and peak_gbps explicitly" % target
+    )
+
+
+def attach_roofline(report, functions, peak_gflops, peak_gbps):
+    """Add the roofline metrics of each call to a profiling report.
+
+    Calls to a PrimFunc of `functions` get the metrics "Estimated FLOPs", "Estimated
+    Bytes", "GFLOP/s", "GB/s", "Arithmetic Intensity", "Bound" (compute or memory) and
+    "Percent of Roofline", the achieved performance over the best attainable one at its
+    arithmetic intensity. The device metrics get the peaks used.
+
+    Parameters
+    ----------
+    report : tvm.runtime.profiling.Report
+        The report of a profiling run.
+    functions : Dict[str, tvm.tir.PrimFunc]
+        The PrimFunc of each operator, by name.
+    peak_gflops : float
+        The peak floating point operations per second of the device, in GFLOP/s.
+    peak_gbps : float
+        The peak memory bandwidth of the device, in GB/s.
+
+    Returns
+    -------
+    report : tvm.runtime.profiling.Report
+        A copy of the report with the roofline metrics.
+    """
+    ridge = peak_gflops / peak_gbps
+    estimates = {}
+    for name, func in functions.items():
+        try:
+            flops = estimate_tir_flops(func.body)
+        except tvm.TVMError:
+            # dynamic loop extents
+            continue
+        nbytes = estimate_bytes(func)
+        if nbytes:
+            estimates[name] = (int(flops), nbytes)
+
+    data = json.loads(report.json())
+    for call in data["calls"]:
+        name = call["Name"]["string"]
+        if name not in estimates:
+            continue
+        flops, nbytes = estimates[name]
+        nanoseconds = call["Duration (us)"]["microseconds"] * 1e3
+        if nanoseconds <= 0:
+            continue
+        intensity = flops / nbytes
+        gflops = flops / nanoseconds
+        gbps = nbytes / nanoseconds
+        attainable = min(peak_gflops, intensity * peak_gbps)
+        if flops > 0:
+            percent = 100 * gflops / attainable
+        else:
+            percent = 100 * gbps / peak_gbps
+        call["Estimated FLOPs"] = {"count": flops}
+        call["Estimated Bytes"] = {"count": nbytes}
+        call["GFLOP/s"] = {"ratio": gflops}
+        call["GB/s"] = {"ratio": gbps}
+        call["Arithmetic Intensity"] = {"ratio": intensity}
+        call["Bound"] = {"string": "compute" if intensity >= ridge else "memory"}
+        call["Percent of Roofline"] = {"percent": percent}
+    for metrics in data["device_metrics"].values():
+        metrics["Peak GFLOP/s"] = {"ratio": peak_gflops}
+        metrics["Peak GB/s"] = {"ratio": peak_gbps}
+    return Report.from_json(json.dumps(data))
+
+
+def roofline_table(report, top=20):
+    """Format the operators furthest from their bound in a report with roofline metrics.
+
+    Operators are sorted by the time they would save at 100% of the roofline.
+
+    Parameters
+    ----------
+    report : tvm.runtime.profiling.Report
+        A report returned by `attach_roofline` or `roofline_analysis`.
+    top : int
+        The number of operators to show.
+
+    Returns
+    -------
+    table : str
+        One line per operator.
+    """
+    rows = []
+    for call in json.loads(report.json())["calls"]:
+        if "Percent of Roofline" not in call:
+            continue
+        duration = call["Duration (us)"]["microseconds"]
+        percent = call["Percent of Roofline"]["percent"]
+        rows.append((duration * max(0.0, 1 - percent / 100), duration, percent, call))
+    rows.sort(key=lambda row: row[0], reverse=True)
+    lines = [
+        "%-48s %12s %12s %9s %9s %8s %10s"
+        % ("Name", "Duration (us)", "Saving (us)", "GFLOP/s", "GB/s", "Bound", "Roofline %")
+    ]
+    for saving, duration, percent, call in rows[:top]:
+        lines.append(
+            "%-48s %12.2f %12.2f %9.2f %9.2f %8s %10.2f"
+            % (
+                call["Name"]["string"][:48],
+                duration,
+                saving,
+                call["GFLOP/s"]["ratio"],
+                call["GB/s"]["ratio"],
+                call["Bound"]["string"],
+                percent,
+            )
+        )
+    return "\n".join(lines)
+
+
+def roofline_analysis(mod, params, target, dev, inputs=None, peak_gflops=None, peak_gbps=None):
+    """Build a model with the graph executor, profile it and place its operators on the
+    roofline of the device.
+
+    Parameters
+    ----------
+    mod : tvm.IRModule
+        The Relay module of the model.
+    params : Dict[str, tvm.nd.NDArray]
+        The parameters of the model.
+    target : tvm.target.Target
+        The target to build for.
+    dev : tvm.runtime.Device
+        The device to run on.
+    inputs : Optional[Dict[str, np.ndarray]]
+        The inputs of the model, random for the missing ones.
+    peak_gflops : Optional[float]
+        The peak GFLOP/s of the device, found with `estimate_peaks` when not given.
+    peak_gbps : Optional[float]
+        The peak GB/s of the device, found with `estimate_peaks` when not given.
+
+    Returns
+    -------
+    report : tvm.runtime.profiling.Report
+        The profiling report with the roofline metrics of `attach_roofline`.
+    """
+    if peak_gflops is None or peak_gbps is None:
+        measured_gflops, measured_gbps = estimate_peaks(target, dev)
+        peak_gflops = peak_gflops or measured_gflops
+        peak_gbps = peak_gbps or measured_gbps
+
+    lib = relay.build(mod, target, params=params)
+    executor = debug_executor.create(lib.get_graph_json(), lib.lib, dev)
+    inputs = dict(inputs or {})
+    mod = relay.transform.InferType()(mod)
+    for param in mod["main"].params:
+        name = param.name_hint
+        if name in inputs or (params and name in params):
+            continue
+        ty = param.checked_type
+        shape = [int(dim) for dim in ty.shape]
+        inputs[name] = np.random.uniform(size=shape).astype(ty.dtype)
+    report = executor.profile(**inputs)
+
+    functions = {}
+    for lowered in lib.lowered_ir_mods.values():
+        for global_var, func in lowered.functions.items():
+            if isinstance(func, tir.PrimFunc):
+                functions[global_var.name_hint] = func
+    return attach_roofline(report, functions, peak_gflops, peak_gbps)
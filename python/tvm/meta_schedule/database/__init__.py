@@ -19,4 +19,5 @@ The tvm.meta_schedule.database package.
 The database that stores serialized tuning records and workloads
 """
 from .database import Database, PyDatabase, TuningRecord, Workload
+from .indexed_database import IndexedDatabase
 from .json_database import JSONDatabase
@@ -0,0 +1,66 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+"""A database that keeps the best tuning records of each workload in an indexed binary log"""
+from tvm._ffi import register_object
+
+from .. import _ffi_api
+from .database import Database
+
+
+@register_object("meta_schedule.IndexedDatabase")
+class IndexedDatabase(Database):
+    """A database that keeps the best tuning records of each workload in memory, indexed by
+    workload, and stores them in a binary log.
+
+    Loading reads only the workload and run time of each record; a record is parsed the first
+    time `get_top_k` returns it. Records slower than the `keep_top_k` best of their workload are
+    dropped, and the log is compacted once it holds more dropped records than kept ones.
+
+    Parameters
+    ----------
+    path : str
+        The path to the log.
+    keep_top_k : int
+        The number of records kept for each workload.
+    """
+
+    path: str
+    keep_top_k: int
+
+    def __init__(
+        self,
+        path: str,
+        keep_top_k: int = 512,
+        allow_missing: bool = True,
+    ) -> None:
+        """Constructor.
+
+        Parameters
+        ----------
+        path : str
+            The path to the log.
+        keep_top_k : int
+            The number of records kept for each workload, `get_top_k` returns at most as many.
+        allow_missing : bool
+            Whether to create new file when the given path is not found.
+        """
+        self.__init_handle_by_constructor__(
+            _ffi_api.DatabaseIndexedDatabase,  # type: ignore # pylint: disable=no-member
+            path,
+            keep_top_k,
+            allow_missing,
+        )
@@ -15,6 +15,7 @@
 # specific language governing permissions and limitations
 # under the License.
 """RPC client tools"""
+import contextlib
 import os
 import socket
 import stat
@@ -40,6 +41,7 @@ class RPCSession(object):
         self._sess = sess
         self._tbl_index = _ffi_api.SessTableIndex(sess)
         self._remote_funcs = {}
+        self._compress_min_bytes = 0
 
     def system_lib(self):
         """Get system-wide library module.
@@ -70,6 +72,91 @@ class RPCSession(object):
         """
         return self._sess.get_function(name)
 
+    def get_pipelined_function(self, name, mod=None):
+        """Get a function whose calls return without waiting for the reply.
+
+        The remote serves requests in order, so calls made through the result
+        are sent back to back and their replies are read later. Use it for
+        functions that return nothing, such as setting inputs or running a
+        graph executor.
+
+        Parameters
+        ----------
+        name : str
+            The name of the function
+
+        mod : runtime.Module, optional
+            The remote module to get the function from, the global functions
+            of the remote by default.
+
+        Returns
+        -------
+        f : Function
+            The result function. Its calls return None, their return values are
+            dropped, freeing the remote objects in them, and their errors are
+            raised by a later call that waits.
+        """
+        return _ffi_api.GetPipelinedFunction(self._sess if mod is None else mod, name)
+
+    @contextlib.contextmanager
+    def batch(self):
+        """Pipeline the copies to the remote and the frees of remote objects.
+
+        Inside the block, copying an array to the remote returns once the data
+        is sent. The replies are read at the end of the block, which raises the
+        first error returned by the remote.
+
+        Examples
+        --------
+        .. code-block:: python
+
+            set_input = remote.get_pipelined_function("set_input", gmod)
+            with remote.batch():
+                for name, value in inputs.items():
+                    set_input(name, tvm.nd.array(value, dev))
+        """
+        _ffi_api.SessSetBatchMode(self._sess, True)
+        try:
+            yield self
+        finally:
+            _ffi_api.SessSetBatchMode(self._sess, False)
+
+    def wait(self):
+        """Wait for the replies of all the pipelined requests."""
+        _ffi_api.SessWaitPending(self._sess)
+
+    def set_transfer_options(self, chunk_bytes=0, window_bytes=0):
+        """Configure how copies between the client and the remote are pipelined.
+
+        Parameters
+        ----------
+        chunk_bytes : int
+            Split copies into chunks of this size, so the remote copies one
+            chunk while the next one is in flight. 0 sends each copy whole.
+
+        window_bytes : int
+            The maximum reply bytes left unread on the channel. It must stay
+            below what the channel buffers, larger windows let more chunks of a
+            copy from the remote be in flight. 0 keeps the current window.
+        """
+        _ffi_api.SessSetTransferOptions(self._sess, chunk_bytes, window_bytes)
+
+    def set_compression(self, min_bytes):
+        """Compress array copies and file uploads of at least min_bytes.
+
+        Each block of a copy is sent compressed only when that saves enough
+        bytes, so data that does not compress costs little. Compression only
+        pays off on links slower than the codec, a few hundred MB/s. Remotes
+        that do not provide the codec keep receiving raw data.
+
+        Parameters
+        ----------
+        min_bytes : int
+            The smallest copy or upload to compress, 0 disables compression.
+        """
+        _ffi_api.SessSetCompression(self._sess, min_bytes)
+        self._compress_min_bytes = min_bytes
+
     def device(self, dev_type, dev_id=0):
         """Construct a remote device.
 
@@ -110,6 +197,19 @@ class RPCSession(object):
             if not target:
                 target = os.path.basename(data)
 
+        if self._compress_min_bytes and len(blob) >= self._compress_min_bytes:
+            if "upload_compressed" not in self._remote_funcs:
+                try:
+                    func = self.get_function("tvm.rpc.server.upload_compressed")
+                except AttributeError:
+                    func = None
+                self._remote_funcs["upload_compressed"] = func
+            func = self._remote_funcs["upload_compressed"]
+            if func is not None:
+                compressed = _ffi_api.LZCompress(blob)
+                if len(compressed) < len(blob) - len(blob) // 8:
+                    func(target, compressed, len(blob))
+                    return
         if "upload" not in self._remote_funcs:
             self._remote_funcs["upload"] = self.get_function("tvm.rpc.server.upload")
         self._remote_funcs["upload"](target, blob)
@@ -459,7 +559,9 @@ class TrackerSession(object):
         )
 
 
-def connect(url, port, key="", session_timeout=0, session_constructor_args=None):
+def connect(
+    url, port, key="", session_timeout=0, session_constructor_args=None, transport="socket"
+):
     """Connect to RPC Server
 
     Parameters
@@ -483,6 +585,12 @@ def connect(url, port, key="", session_timeout=0, session_constructor_args=None)
         The first element of the list is always a string specifying the name of
         the session constructor, the following args are the positional args to that function.
 
+    transport: str, optional
+        "socket" sends the session over the socket. "shm" sends it through a
+        shared memory segment instead, which skips the kernel copies and system
+        calls of the socket. It needs the server to run on the same host, the
+        socket then only carries the handshake and tells when a peer exits.
+
     Returns
     -------
     sess : RPCSession
@@ -514,7 +622,12 @@ def connect(url, port, key="", session_timeout=0, session_constructor_args=None)
         session_constructor_args = session_constructor_args if session_constructor_args else []
         if not isinstance(session_constructor_args, (list, tuple)):
             raise TypeError("Expect the session constructor to be a list or tuple")
-        sess = _ffi_api.Connect(url, port, key, *session_constructor_args)
+        if transport == "shm":
+            sess = _ffi_api.ConnectShm(url, port, key, *session_constructor_args)
+        elif transport == "socket":
+            sess = _ffi_api.Connect(url, port, key, *session_constructor_args)
+        else:
+            raise ValueError("Unknown transport %s, expect socket or shm" % transport)
     except NameError:
         raise RuntimeError("Please compile with USE_RPC=1")
     return RPCSession(sess)
@@ -109,11 +109,15 @@ def _server_env(load_library, work_path=None):
     return temp
 
 
-def _serve_loop(sock, addr, load_library, work_path=None):
+def _serve_loop(sock, addr, load_library, work_path=None, shm_name=None):
     """Server loop"""
     sockfd = sock.fileno()
     temp = _server_env(load_library, work_path)
-    _ffi_api.ServerLoop(sockfd)
+    if shm_name:
+        # The client is on the same host and asked for the shared memory channel.
+        _ffi_api.ServerLoop(sockfd, shm_name)
+    else:
+        _ffi_api.ServerLoop(sockfd)
     if not work_path:
         temp.remove()
     logger.info("Finish serving %s", addr)
@@ -125,6 +129,8 @@ def _parse_server_opt(opts):
     for kv in opts:
         if kv.startswith("-timeout="):
             ret["timeout"] = float(kv[9:])
+        elif kv.startswith("-shm="):
+            ret["shm"] = kv[5:]
     return ret
 
 
@@ -231,7 +237,7 @@ def _listen_loop(sock, port, rpc_key, tracker_addr, load_library, custom_addr):
         work_path = utils.tempdir()
         logger.info("connection from %s", addr)
         server_proc = multiprocessing.Process(
-            target=_serve_loop, args=(conn, addr, load_library, work_path)
+            target=_serve_loop, args=(conn, addr, load_library, work_path, opts.get("shm"))
         )
 
         server_proc.start()
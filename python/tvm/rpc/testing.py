@@ -67,3 +67,16 @@ def _my_module(name):
     if name == "get_arr_elem":
         return lambda arr, idx: arr.numpy()[idx]
     raise RuntimeError("unknown name")
+
+
+_SHARED_ND = tvm.nd.array(np.zeros(10).astype("float32"))
+
+
+@tvm.register_func("rpc.test.get_shared_nd")
+def _get_shared_nd():
+    return _SHARED_ND
+
+
+@tvm.register_func("rpc.test.shared_nd_use_count")
+def _shared_nd_use_count():
+    return tvm.testing.object_use_count(_SHARED_ND)
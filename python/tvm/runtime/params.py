@@ -67,3 +67,40 @@ def load_param_dict(param_bytes):
     if isinstance(param_bytes, (bytes, str)):
         param_bytes = bytearray(param_bytes)
     return _ffi_api.LoadParams(param_bytes)
+
+
+def save_mapped_param_dict(params, path):
+    """Save parameter dictionary to a file that can be mapped into memory.
+
+    Every tensor is stored aligned in the file, so that the loader can use it in
+    place. Processes mapping the same file share its pages.
+
+    Parameters
+    ----------
+    params : dict of str to NDArray
+        The parameter dictionary.
+
+    path : str
+        The file to write.
+    """
+    transformed = {k: ndarray.array(v) for (k, v) in params.items()}
+    _ffi_api.SaveMappedParams(transformed, path)
+
+
+def load_mapped_param_dict(path):
+    """Map a file saved by save_mapped_param_dict into memory.
+
+    The returned arrays are views into the file, which is only read as they are
+    accessed.
+
+    Parameters
+    ----------
+    path : str
+        The file to map.
+
+    Returns
+    -------
+    params : dict of str to NDArray
+        The parameter dictionary.
+    """
+    return _ffi_api.LoadMappedParams(path)
@@ -60,7 +60,7 @@ class VirtualMachineProfiler(vm.VirtualMachine):
         warnings.warn("get_stat has been removed, use profile instead")
         return ""
 
-    def profile(self, *args, func_name="main", collectors=None, **kwargs):
+    def profile(self, *args, func_name="main", collectors=None, timeline=False, **kwargs):
         """Profile a function call.
 
         Parameters
@@ -71,6 +71,9 @@ class VirtualMachineProfiler(vm.VirtualMachine):
         collectors : Optional[Sequence[MetricCollector]]
             Extra metrics to collect. If profiling over RPC, collectors must be `None`.
 
+        timeline : bool
+            Whether to record when each op ran, see :py:meth:`Report.chrome_trace`.
+
         args : list[tvm.runtime.NDArray] or list[np.ndarray]
             The arguments to the function.
 
@@ -87,5 +90,7 @@ class VirtualMachineProfiler(vm.VirtualMachine):
         if self.module.type_key == "rpc":
             # We cannot serialize MetricCollectors over RPC
             assert collectors is None, "Profiling with collectors is not supported over RPC"
-            return Report.from_json(self._profile_rpc(func_name))
-        return self._profile(func_name, collectors)
+            profile_rpc = self.module["profile_rpc_timeline"] if timeline else self._profile_rpc
+            return Report.from_json(profile_rpc(func_name))
+        profile = self.module["profile_timeline"] if timeline else self._profile
+        return profile(func_name, collectors)
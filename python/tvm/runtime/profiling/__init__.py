@@ -33,6 +33,10 @@ class Report(Object):
 
     device_metrics : Dict[Device, Dict[str, Object]]
         Per-device metrics collected over the entire run.
+
+    timeline : Array[Dict[str, Object]]
+        Start time, duration and thread of each call and of each task of the parallel
+        launches run meanwhile. Only recorded when profiling with `timeline=True`.
     """
 
     def csv(self):
@@ -133,6 +137,19 @@ class Report(Object):
         """
         return _ffi_api.AsJSON(self)
 
+    def chrome_trace(self):
+        """Convert the timeline of this report into the Chrome trace event format.
+
+        Save the output to a file and open it in https://ui.perfetto.dev or
+        chrome://tracing. Each device is shown as a process with one track per thread.
+
+        Returns
+        -------
+        trace : str
+            The trace events as JSON.
+        """
+        return _ffi_api.AsChromeTrace(self)
+
     @classmethod
     def from_json(cls, s):
         """Deserialize a report from JSON.
@@ -215,6 +232,42 @@ def profile_function(mod, dev, collectors, func_name=None, warmup_iters=10):
     )
 
 
+@_ffi.register_object("runtime.profiling.PerfEventMetricCollector")
+class PerfEventMetricCollector(MetricCollector):
+    """Collects hardware performance counters of the CPU with the Linux perf_event API.
+
+    Besides the counters, reports the instructions per cycle ("IPC"), the "Branch Miss
+    Rate", and an estimate of the traffic to memory from the cache misses ("Memory Bytes"
+    and "Memory Bandwidth (GB/s)"). Counters which cannot be opened, for instance when
+    `/proc/sys/kernel/perf_event_paranoid` is above 2 or in a VM without a virtual PMU,
+    are skipped with a warning.
+    """
+
+    def __init__(
+        self,
+        metrics: Optional[Sequence[str]] = None,
+        flop_events: Optional[Dict[str, int]] = None,
+    ):
+        """
+        Parameters
+        ----------
+        metrics : Optional[Sequence[str]]
+            Counters to read among "Cycles", "Instructions", "Cache References", "Cache
+            Misses", "Branches", "Branch Misses", "Stalled Cycles Frontend" and "Stalled
+            Cycles Backend", or raw events of the CPU written "r<hex code>". Defaults to
+            cycles, instructions, cache misses, branches and branch misses.
+
+        flop_events : Optional[Dict[str, int]]
+            Raw events counting floating point instructions, such as "r04c7" for 128 bit
+            packed double instructions on Intel CPUs, mapped to the number of FLOPs of one
+            instruction. Their weighted sum is reported as "FLOPs", along with "Bytes/FLOP".
+        """
+        metrics = [] if metrics is None else list(metrics)
+        flop_events = {} if flop_events is None else flop_events
+        encoded = ["%s*%d" % (event, flops) for event, flops in flop_events.items()]
+        self.__init_handle_by_constructor__(_ffi_api.PerfEventMetricCollector, metrics, encoded)
+
+
 # We only enable this class when TVM is build with PAPI support
 if _ffi.get_global_func("runtime.profiling.PAPIMetricCollector", allow_missing=True) is not None:
 
@@ -20,6 +20,8 @@ The Relay Virtual Machine runtime.
 
 Implements a Python interface to executing the compiled VM object.
 """
+import json
+
 import numpy as np
 
 import tvm
@@ -87,6 +89,7 @@ class Executable(object):
         self._get_function_param_name = self.mod["get_function_param_name"]
         self._move_late_bound_consts = self.mod["move_late_bound_consts"]
         self._load_late_bound_consts = self.mod["load_late_bound_consts"]
+        self._get_lazy_constant_stats = self.mod["get_lazy_constant_stats"]
 
     def save(self):
         """Save the Relay VM Executable.
@@ -155,7 +158,7 @@ class Executable(object):
         return self._save(), self._get_lib()
 
     @staticmethod
-    def load_exec(bytecode, lib):
+    def load_exec(bytecode, lib, lazy_constants=False):
         """Construct an executable from saved artifacts.
 
         Parameters
@@ -166,6 +169,12 @@ class Executable(object):
         lib : :py:class:`~tvm.runtime.Module`
             The runtime module that contains the generated code.
 
+        lazy_constants : bool
+            Whether to defer deserializing each constant tensor until the VM first
+            loads it, keeping only its offset in the bytecode until then. The
+            executable keeps a copy of the bytecode, so only the deserialized
+            copies are saved; see load_exec_from_file.
+
         Returns
         -------
         exec: Executable
@@ -185,7 +194,34 @@ class Executable(object):
                 + ", but received {}".format(type(lib))
             )
 
-        return Executable(_ffi_api.Load_Executable(bytecode, lib))
+        return Executable(_ffi_api.Load_Executable(bytecode, lib, lazy_constants))
+
+    @staticmethod
+    def load_exec_from_file(path, lib, lazy_constants=False):
+        """Construct an executable from bytecode saved to a file.
+
+        The file is mapped into memory instead of read. With lazy_constants, the
+        constants stay in the file until the VM first loads them, and the memory
+        they take is bounded by the constant memory budget of the VM.
+
+        Parameters
+        ----------
+        path : str
+            The file holding the bytecode returned by :py:meth:`save`.
+
+        lib : :py:class:`~tvm.runtime.Module`
+            The runtime module that contains the generated code.
+
+        lazy_constants : bool
+            Whether to defer deserializing each constant tensor until the VM first
+            loads it.
+
+        Returns
+        -------
+        exec: Executable
+            An executable constructed using the provided artifacts.
+        """
+        return Executable(_ffi_api.Load_ExecutableFromFile(path, lib, lazy_constants))
 
     @property
     def lib(self):
@@ -308,14 +344,69 @@ class Executable(object):
         self._function_params[func_name] = params
         return params
 
-    def move_late_bound_consts(self, path, byte_limit):
-        """Move all constants of byte size greater or equal to byte_limit to file at path"""
-        return self._move_late_bound_consts(path, byte_limit)
+    def move_late_bound_consts(self, path, byte_limit, mapped=False):
+        """Move all constants of byte size greater or equal to byte_limit to file at path.
+        If mapped, the file is written in the aligned format that is loaded by mapping it
+        into memory instead of copying it."""
+        return self._move_late_bound_consts(path, byte_limit, mapped)
 
     def load_late_bound_consts(self, path):
-        """Re-load constants previously saved to file at path"""
+        """Re-load constants previously saved to file at path, mapping files in the
+        mapped format into memory"""
         return self._load_late_bound_consts(path)
 
+    def get_lazy_constant_stats(self):
+        """Get the counters of the constants deserialized on demand.
+
+        Returns
+        -------
+        stats : Dict[str, Union[int, float]]
+            The number of lazy constants and their bytes, the bytes deserialized,
+            the bytes of serialized code held in memory, the number of loads and
+            evictions, and the total load time in milliseconds.
+        """
+        return json.loads(self._get_lazy_constant_stats())
+
+
+class VMFuture(object):
+    """The handle of a function invoked with :py:meth:`VirtualMachine.invoke_async`.
+
+    Parameters
+    ----------
+    mod : tvm.runtime.Module
+        The module returned by the VM "invoke_async" function.
+    """
+
+    def __init__(self, mod):
+        self.module = mod
+        self._is_ready = mod["is_ready"]
+        self._wait = mod["wait"]
+        self._get_output = mod["get_output"]
+        self._get_num_outputs = mod["get_num_outputs"]
+
+    def done(self):
+        """Whether the invocation has finished."""
+        return bool(self._is_ready())
+
+    def result(self):
+        """Wait for the invocation to finish.
+
+        Returns
+        -------
+        result : Object
+            The output. An error raised by the invocation is raised here.
+        """
+        return self._wait()
+
+    def get_outputs(self):
+        """Wait for the invocation to finish and get its outputs.
+
+        Returns
+        -------
+        outputs : List[NDArray]
+        """
+        return [self._get_output(i) for i in range(self._get_num_outputs())]
+
 
 class VirtualMachine(object):
     """Relay VM runtime.
@@ -331,15 +422,17 @@ class VirtualMachine(object):
 
     memory_cfg : str or Dict[tvm.runtime.Device, str], optional
         Config the type of memory allocator. The allocator type can be ["naive",
-        "pooled"]. If memory_cfg is None, all devices will use pooled allocator
-        by default. If memory_cfg is string, all devices will use the specified
-        allocator type. If memory_cfg is a dict, each device uses the allocator
-        type specified in the dict, or pooled allocator if not specified in the
-        dict.
+        "pooled", "slab", "thread_cached"]. If memory_cfg is None, all devices
+        will use pooled allocator by default. If memory_cfg is string, all
+        devices will use the specified allocator type. If memory_cfg is a dict,
+        each device uses the allocator type specified in the dict, or pooled
+        allocator if not specified in the dict.
     """
 
     NAIVE_ALLOCATOR = 1
     POOLED_ALLOCATOR = 2
+    SLAB_ALLOCATOR = 3
+    THREAD_CACHED_ALLOCATOR = 4
 
     def __init__(self, exe, device, memory_cfg=None):
         """
@@ -389,6 +482,10 @@ class VirtualMachine(object):
         self._get_input_index = self.module["get_input_index"]
         self._set_input = self.module["set_input"]
         self._set_one_input = self.module["set_one_input"]
+        # Fetched on first use, so that a VM loaded over RPC from a runtime without it still works.
+        self._invoke_async = None
+        self._set_sampling_profiler = self.module["set_sampling_profiler"]
+        self._get_sampling_profile = self.module["get_sampling_profile"]
         self._setup_device(device, memory_cfg)
 
     def _setup_device(self, dev, memory_cfg):
@@ -407,9 +504,13 @@ class VirtualMachine(object):
         if memory_cfg is None:
             memory_cfg = {}
         elif isinstance(memory_cfg, str):
-            assert memory_cfg in ["naive", "pooled"]
+            assert memory_cfg in ["naive", "pooled", "slab", "thread_cached"]
             if memory_cfg == "naive":
                 default_alloc_type = VirtualMachine.NAIVE_ALLOCATOR
+            elif memory_cfg == "slab":
+                default_alloc_type = VirtualMachine.SLAB_ALLOCATOR
+            elif memory_cfg == "thread_cached":
+                default_alloc_type = VirtualMachine.THREAD_CACHED_ALLOCATOR
             memory_cfg = {}
         elif not isinstance(memory_cfg, dict):
             raise TypeError(
@@ -438,6 +539,10 @@ class VirtualMachine(object):
         kwargs: dict of str to tvm.runtime.NDArray or np.ndarray
             Named arguments to the function.
         """
+        self._set_input(func_name, *self._convert_inputs(func_name, args, kwargs))
+
+    def _convert_inputs(self, func_name, args, kwargs):
+        """Order the positional and named arguments of a function and convert them."""
         if kwargs:
             # kwargs is a super set of the required function parameters. We
             # only find the ones that are needed.
@@ -456,8 +561,7 @@ class VirtualMachine(object):
                     new_args[i] = args[idx]
                     idx += 1
             args = new_args
-        cargs = convert(args)
-        self._set_input(func_name, *cargs)
+        return convert(args)
 
     def set_one_input(self, func_name, *args, **kwargs):
         """Set the one input tensor with tag to a function.
@@ -506,6 +610,58 @@ class VirtualMachine(object):
             self.set_input(func_name, *args, **kwargs)
         return self._invoke(func_name)
 
+    def invoke_async(self, func_name, *args, **kwargs):
+        """Invoke a function without waiting for it to finish.
+
+        The invocation runs on one of the worker VMs of this VM, see
+        :py:meth:`set_async_workers`. Many invocations may be in flight at once.
+
+        Parameters
+        ----------
+        func_name : str
+            The name of the function.
+
+        args : list[tvm.runtime.NDArray] or list[np.ndarray]
+            The arguments to the function. If none are given, the inputs set by
+            :py:meth:`set_input` are used.
+
+        kwargs: dict of str to tvm.runtime.NDArray or np.ndarray
+            Named arguments to the function.
+
+        Returns
+        -------
+        future : VMFuture
+            The handle to wait for the output.
+        """
+        if self._invoke_async is None:
+            self._invoke_async = self.module["invoke_async"]
+        if args or kwargs:
+            cargs = self._convert_inputs(func_name, args, kwargs)
+            return VMFuture(self._invoke_async(func_name, *cargs))
+        return VMFuture(self._invoke_async(func_name))
+
+    def set_async_workers(self, num_workers, intra_op_threads=0):
+        """Set the number of worker VMs that run :py:meth:`invoke_async`.
+
+        Each worker has its own thread and registers, and shares the executable,
+        devices, allocators and loaded constants with this VM. Its parallel
+        kernels run on a thread pool of its own, bound to cores no other worker
+        is given while there are enough of them.
+
+        This call blocks until the invocations already queued have finished on
+        the previous workers, which are then joined.
+
+        Parameters
+        ----------
+        num_workers : int
+            The number of workers. 0 uses TVM_VM_ASYNC_WORKERS if set, or 2.
+
+        intra_op_threads : int
+            The threads of the parallel kernels of each worker. 0 splits the
+            cores evenly between the workers.
+        """
+        self.module["set_async_workers"](num_workers, intra_op_threads)
+
     def run(self, *args, **kwargs):
         """Run the main function.
 
@@ -571,6 +727,66 @@ class VirtualMachine(object):
         """
         return self._get_input_index(input_name, func_name)
 
+    def set_constant_memory_budget(self, budget_bytes):
+        """Limit the bytes of constants the VM keeps copied on its devices.
+
+        When loading a constant exceeds the budget, the least recently used
+        constants are dropped and loaded again on their next use. For an
+        executable loaded with lazy_constants, they are also dropped from the
+        executable and deserialized again from the bytecode. The serialized
+        bytecode stays in memory unless the executable was loaded with
+        Executable.load_exec_from_file.
+
+        Parameters
+        ----------
+        budget_bytes : int
+            The budget in bytes, 0 for no limit.
+        """
+        self.module["set_constant_memory_budget"](budget_bytes)
+
+    def get_constant_stats(self):
+        """Get the counters of the VM constant pool.
+
+        Returns
+        -------
+        stats : Dict[str, int]
+            The number of constants, how many are cached and their bytes, the
+            budget and the number of evictions.
+        """
+        return json.loads(self.module["get_constant_stats"]())
+
+    def set_sampling_profiler(self, sample_every=100, min_interval_ms=0, window_s=60):
+        """Time the kernels of a sample of the invocations, cheap enough to leave on.
+
+        Invocations that are not sampled only count themselves. The workers of
+        invoke_async share the profiler.
+
+        Parameters
+        ----------
+        sample_every : int
+            Sample one invocation out of this many, 0 to stop sampling.
+
+        min_interval_ms : float
+            The least time between two sampled invocations, 0 for no limit.
+
+        window_s : float
+            The report covers the samples of the last one to two windows.
+        """
+        self._set_sampling_profiler(sample_every, min_interval_ms, window_s)
+
+    def get_sampling_profile(self):
+        """Get the durations of the sampled invocations and of their kernels.
+
+        Returns
+        -------
+        profile : dict
+            The number of invocations and of sampled ones, the statistics of
+            whole invocations under "run" and of each kernel under "ops", the
+            slowest in total first. Statistics are the count and the mean, p50,
+            p95 and p99 durations in microseconds.
+        """
+        return json.loads(self._get_sampling_profile())
+
     def benchmark(
         self,
         device,
@@ -0,0 +1,369 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <unordered_map>
+
+#include "../utils.h"
+
+namespace tvm {
+namespace meta_schedule {
+
+namespace {
+
+/*! \brief The first bytes of the log, which also version its format. Numbers are stored in the
+ *  byte order of the host. */
+constexpr const char kLogMagic[] = "TVMMSDB1";
+constexpr size_t kLogMagicSize = sizeof(kLogMagic) - 1;
+/*! \brief The kind of an entry of the log. */
+constexpr uint8_t kWorkloadEntry = 'W';
+constexpr uint8_t kRecordEntry = 'R';
+/*! \brief The least number of dropped records which triggers a compaction. */
+constexpr int64_t kMinDeadToCompact = 1024;
+
+template <typename T>
+bool ReadPOD(std::istream& is, T* value) {
+  return static_cast<bool>(is.read(reinterpret_cast<char*>(value), sizeof(T)));
+}
+
+template <typename T>
+void WritePOD(std::ostream& os, const T& value) {
+  os.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+/*!
+ * \brief Append a workload entry: the kind, the length of the JSON and the JSON of the workload.
+ * \return The number of bytes written.
+ */
+uint64_t WriteWorkloadEntry(std::ostream& os, const std::string& json) {
+  WritePOD(os, kWorkloadEntry);
+  WritePOD(os, static_cast<uint32_t>(json.size()));
+  os.write(json.data(), json.size());
+  return sizeof(uint8_t) + sizeof(uint32_t) + json.size();
+}
+
+/*!
+ * \brief Append a record entry: the kind, the workload index, the mean run seconds, the length
+ *  of the JSON and the JSON of the record. The index and the mean are all the loader reads.
+ * \return The offset of the JSON from the start of the entry.
+ */
+uint64_t WriteRecordEntry(std::ostream& os, uint32_t workload_index, double mean_secs,
+                          const std::string& json) {
+  WritePOD(os, kRecordEntry);
+  WritePOD(os, workload_index);
+  WritePOD(os, mean_secs);
+  WritePOD(os, static_cast<uint32_t>(json.size()));
+  os.write(json.data(), json.size());
+  return sizeof(uint8_t) + sizeof(uint32_t) + sizeof(double) + sizeof(uint32_t);
+}
+
+}  // namespace
+
+/*!
+ * \brief A database which keeps the K best records of each workload in memory, indexed by
+ *  workload, and stores them in a binary log file.
+ *
+ *  Loading only reads the workload index and the mean run time of each record, the JSON of a
+ *  record is parsed the first time GetTopK returns it. Records which fall out of the top K of
+ *  their workload are dropped, and the log is rewritten without them once they outnumber the
+ *  records kept.
+ */
+class IndexedDatabaseNode : public DatabaseNode {
+ public:
+  /*! \brief A record of the index, sorted by mean run seconds. */
+  struct Entry {
+    double mean_secs;
+    /*! \brief The offset of the JSON of the record in the log. */
+    uint64_t offset;
+    uint32_t length;
+    /*! \brief The record, parsed on the first lookup. */
+    TuningRecord record{nullptr};
+  };
+
+  /*! \brief The path to the log */
+  String path;
+  /*! \brief The number of records kept for each workload */
+  int64_t keep_top_k;
+  /*! \brief All the workloads in the database */
+  std::unordered_map<Workload, int, WorkloadHash, WorkloadEqual> workloads2idx_;
+  /*! \brief The workloads in the order of the log */
+  std::vector<Workload> workloads_;
+  /*! \brief The best records of each workload, fastest first */
+  std::vector<std::vector<Entry>> index_;
+  /*! \brief The size of the log in bytes */
+  uint64_t log_size_ = 0;
+  /*! \brief The number of records kept */
+  int64_t num_live_ = 0;
+  /*! \brief The number of records in the log which were dropped from the index */
+  int64_t num_dead_ = 0;
+
+  void VisitAttrs(tvm::AttrVisitor* v) {
+    v->Visit("path", &path);
+    v->Visit("keep_top_k", &keep_top_k);
+    // `workloads2idx_` is not visited
+    // `workloads_` is not visited
+    // `index_` is not visited
+  }
+
+  static constexpr const char* _type_key = "meta_schedule.IndexedDatabase";
+  TVM_DECLARE_FINAL_OBJECT_INFO(IndexedDatabaseNode, DatabaseNode);
+
+ public:
+  bool HasWorkload(const IRModule& mod) {
+    return workloads2idx_.find(Workload(mod, tvm::StructuralHash()(mod))) != workloads2idx_.end();
+  }
+
+  Workload CommitWorkload(const IRModule& mod) {
+    decltype(this->workloads2idx_)::iterator it;
+    bool inserted = false;
+    std::tie(it, inserted) =
+        this->workloads2idx_.emplace(Workload(mod, tvm::StructuralHash()(mod)), -1);
+    if (inserted) {
+      it->second = static_cast<int>(this->workloads_.size());
+      this->workloads_.push_back(it->first);
+      this->index_.emplace_back();
+      std::ofstream os = OpenLogForAppend();
+      log_size_ += WriteWorkloadEntry(os, JSONObj2Str(it->first->AsJSON()));
+    }
+    return it->first;
+  }
+
+  void CommitTuningRecord(const TuningRecord& record) {
+    int workload_index = this->workloads2idx_.at(record->workload);
+    double mean_secs = SortTuningRecordByMeanRunSecs::Mean(record->run_secs);
+    std::vector<Entry>& entries = this->index_[workload_index];
+    auto pos = std::upper_bound(
+        entries.begin(), entries.end(), mean_secs,
+        [](double mean, const Entry& entry) { return mean < entry.mean_secs; });
+    if (static_cast<int64_t>(pos - entries.begin()) >= keep_top_k) {
+      // Slower than every record kept, there is no need to store it.
+      return;
+    }
+    std::string json = JSONObj2Str(record->AsJSON());
+    {
+      std::ofstream os = OpenLogForAppend();
+      uint64_t header = WriteRecordEntry(os, workload_index, mean_secs, json);
+      entries.insert(pos, Entry{mean_secs, log_size_ + header,
+                                static_cast<uint32_t>(json.size()), record});
+      log_size_ += header + json.size();
+    }
+    ++num_live_;
+    if (static_cast<int64_t>(entries.size()) > keep_top_k) {
+      entries.pop_back();
+      --num_live_;
+      ++num_dead_;
+    }
+    if (num_dead_ > std::max(num_live_, kMinDeadToCompact)) {
+      Compact();
+    }
+  }
+
+  Array<TuningRecord> GetTopK(const Workload& workload, int top_k) {
+    CHECK_GE(top_k, 0) << "ValueError: top_k must be non-negative";
+    auto it = this->workloads2idx_.find(workload);
+    if (top_k == 0 || it == this->workloads2idx_.end()) {
+      return {};
+    }
+    std::vector<Entry>& entries = this->index_[it->second];
+    int n = std::min(static_cast<int>(entries.size()), top_k);
+    // Parse the records which were never returned in one batch.
+    std::vector<int> missing;
+    for (int i = 0; i < n; ++i) {
+      if (!entries[i].record.defined()) {
+        missing.push_back(i);
+      }
+    }
+    if (!missing.empty()) {
+      std::ifstream is(path, std::ifstream::binary);
+      CHECK(is.good()) << "ValueError: Cannot open the file to read: " << path;
+      Array<String> lines;
+      lines.reserve(missing.size());
+      for (int i : missing) {
+        lines.push_back(ReadPayload(is, entries[i]));
+      }
+      Array<ObjectRef> json_objs = JSONStr2Obj(lines);
+      for (size_t i = 0; i < missing.size(); ++i) {
+        entries[missing[i]].record =
+            TuningRecord::FromJSON(json_objs[i], this->workloads_[it->second]);
+      }
+    }
+    Array<TuningRecord> results;
+    results.reserve(n);
+    for (int i = 0; i < n; ++i) {
+      results.push_back(entries[i].record);
+    }
+    return results;
+  }
+
+  int64_t Size() { return num_live_; }
+
+  /*! \brief Read the log, keeping the best records of each workload without parsing them. */
+  void Load(bool allow_missing) {
+    std::ifstream is(path, std::ifstream::binary);
+    if (!is.good()) {
+      CHECK(allow_missing) << "ValueError: File doesn't exist: " << path;
+      std::ofstream os(path, std::ofstream::binary);
+      CHECK(os.good()) << "ValueError: Cannot create new file: " << path;
+      os.write(kLogMagic, kLogMagicSize);
+      log_size_ = kLogMagicSize;
+      return;
+    }
+    is.seekg(0, std::ios_base::end);
+    uint64_t file_size = is.tellg();
+    is.seekg(0);
+    char magic[kLogMagicSize];
+    CHECK(is.read(magic, kLogMagicSize) && std::equal(magic, magic + kLogMagicSize, kLogMagic))
+        << "ValueError: Not a tuning record log: " << path;
+    uint64_t offset = kLogMagicSize;
+    Array<String> workload_jsons;
+    bool truncated = false;
+    for (uint8_t kind; ReadPOD(is, &kind);) {
+      uint32_t workload_index = 0;
+      double mean_secs = 0.0;
+      uint32_t length = 0;
+      uint64_t header = sizeof(uint8_t) + sizeof(uint32_t);
+      if (kind == kRecordEntry) {
+        header += sizeof(uint32_t) + sizeof(double);
+        if (!ReadPOD(is, &workload_index) || !ReadPOD(is, &mean_secs)) {
+          truncated = true;
+          break;
+        }
+        CHECK_LT(workload_index, workload_jsons.size())
+            << "ValueError: Corrupted tuning record log: " << path;
+      } else {
+        CHECK_EQ(kind, kWorkloadEntry) << "ValueError: Corrupted tuning record log: " << path;
+      }
+      if (!ReadPOD(is, &length)) {
+        truncated = true;
+        break;
+      }
+      if (kind == kWorkloadEntry) {
+        std::string json(length, '\0');
+        if (!is.read(&json[0], length)) {
+          truncated = true;
+          break;
+        }
+        workload_jsons.push_back(json);
+        index_.emplace_back();
+      } else {
+        // Only the index and the mean were needed, skip the record itself.
+        if (offset + header + length > file_size) {
+          truncated = true;
+          break;
+        }
+        is.seekg(offset + header + length);
+        InsertLoaded(workload_index, Entry{mean_secs, offset + header, length});
+      }
+      offset += header + length;
+    }
+    log_size_ = offset;
+    Array<ObjectRef> json_objs = JSONStr2Obj(workload_jsons);
+    for (size_t i = 0; i < json_objs.size(); ++i) {
+      Workload workload = Workload::FromJSON(json_objs[i]);
+      workloads2idx_.emplace(workload, static_cast<int>(i));
+      workloads_.push_back(workload);
+    }
+    if (truncated) {
+      LOG(WARNING) << "The tuning record log " << path << " ends with an incomplete entry, "
+                   << "which is dropped";
+    }
+    if (truncated || num_dead_ > std::max(num_live_, kMinDeadToCompact)) {
+      is.close();
+      Compact();
+    }
+  }
+
+ private:
+  std::ofstream OpenLogForAppend() const {
+    std::ofstream os(path, std::ofstream::binary | std::ofstream::app);
+    CHECK(os.good()) << "ValueError: Cannot open the file to write: " << path;
+    return os;
+  }
+
+  std::string ReadPayload(std::istream& is, const Entry& entry) const {
+    std::string json(entry.length, '\0');
+    CHECK(is.seekg(entry.offset) && is.read(&json[0], entry.length))
+        << "ValueError: Cannot read a tuning record at offset " << entry.offset << " of " << path;
+    return json;
+  }
+
+  void InsertLoaded(uint32_t workload_index, Entry entry) {
+    std::vector<Entry>& entries = index_[workload_index];
+    auto pos = std::upper_bound(
+        entries.begin(), entries.end(), entry.mean_secs,
+        [](double mean, const Entry& e) { return mean < e.mean_secs; });
+    if (static_cast<int64_t>(pos - entries.begin()) >= keep_top_k) {
+      ++num_dead_;
+      return;
+    }
+    entries.insert(pos, std::move(entry));
+    ++num_live_;
+    if (static_cast<int64_t>(entries.size()) > keep_top_k) {
+      entries.pop_back();
+      --num_live_;
+      ++num_dead_;
+    }
+  }
+
+  /*! \brief Rewrite the log with the workloads and the records kept, then swap it in. */
+  void Compact() {
+    std::string tmp_path = std::string(path) + ".compact";
+    {
+      std::ifstream is(path, std::ifstream::binary);
+      CHECK(is.good()) << "ValueError: Cannot open the file to read: " << path;
+      std::ofstream os(tmp_path, std::ofstream::binary | std::ofstream::trunc);
+      CHECK(os.good()) << "ValueError: Cannot create new file: " << tmp_path;
+      os.write(kLogMagic, kLogMagicSize);
+      uint64_t offset = kLogMagicSize;
+      for (const Workload& workload : workloads_) {
+        offset += WriteWorkloadEntry(os, JSONObj2Str(workload->AsJSON()));
+      }
+      for (size_t i = 0; i < index_.size(); ++i) {
+        for (Entry& entry : index_[i]) {
+          std::string json = ReadPayload(is, entry);
+          entry.offset = offset + WriteRecordEntry(os, i, entry.mean_secs, json);
+          offset = entry.offset + json.size();
+        }
+      }
+      os.flush();
+      CHECK(os.good()) << "ValueError: Cannot write the file: " << tmp_path;
+      log_size_ = offset;
+    }
+    CHECK_EQ(std::rename(tmp_path.c_str(), path.c_str()), 0)
+        << "ValueError: Cannot replace " << path << " with its compacted copy";
+    num_dead_ = 0;
+  }
+};
+
+Database Database::IndexedDatabase(String path, int keep_top_k, bool allow_missing) {
+  CHECK_GT(keep_top_k, 0) << "ValueError: keep_top_k must be positive";
+  ObjectPtr<IndexedDatabaseNode> n = make_object<IndexedDatabaseNode>();
+  n->path = path;
+  n->keep_top_k = keep_top_k;
+  n->Load(allow_missing);
+  return Database(n);
+}
+
+TVM_REGISTER_NODE_TYPE(IndexedDatabaseNode);
+TVM_REGISTER_GLOBAL("meta_schedule.DatabaseIndexedDatabase")
+    .set_body_typed(Database::IndexedDatabase);
+
+}  // namespace meta_schedule
+}  // namespace tvm
@@ -38,6 +38,7 @@
 
 #include <functional>
 #include <limits>
+#include <memory>
 #include <mutex>
 #include <tuple>
 #include <unordered_map>
@@ -49,6 +50,7 @@
 #include "../op/memory/device_copy.h"
 #include "../transforms/device_aware_visitors.h"
 #include "./te_compiler_cache.h"
+#include "./te_compiler_disk_cache.h"
 #include "./utils.h"
 
 namespace tvm {
@@ -71,6 +73,7 @@ class TECompilerImpl : public TECompilerNode {
         name_map_[kv.first->name_hint] = 1;
       }
     }
+    disk_cache_ = DiskCompileCache::FromPassContext();
   }
 
   // Lower the function.
@@ -316,10 +319,17 @@ class TECompilerImpl : public TECompilerNode {
     With<Target> target_scope(key->target);
 
     ICHECK(!value->cached_func.defined());
-    value->cached_func = PrimFuncFor(key->source_func, key->target, [&](std::string name) {
+    std::string readable_name;
+    auto renamer = [&](std::string name) {
+      readable_name = name;
       auto mangled = mangle_fn(name);
       return GetUniqueName(mangled, &name_map_);
-    });
+    };
+    if (disk_cache_ != nullptr) {
+      value->cached_func = disk_cache_->Lookup(key, renamer);
+      if (value->cached_func.defined()) return value;
+    }
+    value->cached_func = PrimFuncFor(key->source_func, key->target, renamer);
 
     if (value->cached_func->prim_func.defined()) {
       VLOG(1) << "Lowering PrimFunc";
@@ -371,6 +381,9 @@ class TECompilerImpl : public TECompilerNode {
             << "with definitions:" << std::endl
             << PrettyPrint(value->cached_func->funcs);
 
+    if (disk_cache_ != nullptr) {
+      disk_cache_->Insert(key, readable_name, value->cached_func);
+    }
     return value;
   }
 
@@ -438,6 +451,8 @@ class TECompilerImpl : public TECompilerNode {
   CCacheKey cur_ccache_key_;
   /*! \brief Map of GlobalVar to C Device API context names */
   Map<GlobalVar, String> device_contexts_;
+  /*! \brief The compilation cache shared with other processes, nullptr when disabled */
+  std::unique_ptr<DiskCompileCache> disk_cache_;
 };
 
 TECompiler::TECompiler(Optional<IRModule> opt_mod) {
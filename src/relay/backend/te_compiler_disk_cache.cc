@@ -0,0 +1,314 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file relay/backend/te_compiler_disk_cache.cc
+ * \brief A cache of lowered primitive functions kept in a directory.
+ */
+#include "./te_compiler_disk_cache.h"
+
+#include <tvm/ir/transform.h>
+#include <tvm/meta_schedule/integration.h>
+#include <tvm/node/serialization.h>
+#include <tvm/runtime/c_runtime_api.h>
+#include <tvm/runtime/registry.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <map>
+#include <random>
+#include <sstream>
+#include <utility>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <utime.h>
+#endif
+
+#include "./utils.h"
+
+namespace tvm {
+namespace relay {
+namespace tec {
+
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.te_compiler_cache_dir", String);
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.te_compiler_cache_max_mb", Integer);
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.backend.te_compiler_cache_key", String);
+
+namespace {
+
+/*! \brief The first line of an entry starts with this, which also versions the format. */
+constexpr const char* kEntryMagic = "TVMTECACHE1";
+/*! \brief The extension of the entries, to leave other files of the directory alone. */
+constexpr const char* kEntryExtension = ".tecache";
+
+uint64_t FNV1a(const std::string& text, uint64_t hash = 0xcbf29ce484222325ULL) {
+  for (unsigned char c : text) {
+    hash = (hash ^ c) * 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+std::string ToHex(uint64_t value) {
+  std::ostringstream os;
+  os << std::hex << value;
+  return os.str();
+}
+
+void MakeDirectory(const std::string& dir) {
+#ifdef _WIN32
+  _mkdir(dir.c_str());
+#else
+  mkdir(dir.c_str(), 0755);
+#endif
+}
+
+/*! \brief Mark an entry as used, which is what eviction goes by. */
+void Touch(const std::string& path) {
+#ifndef _WIN32
+  utime(path.c_str(), nullptr);
+#endif
+}
+
+/*!
+ * \brief Write the identities of the dispatch contexts the schedules come from, such as the
+ *  TopHub context relay.build enters, which hash the tuning records they loaded.
+ * \param os The stream to write to.
+ * \return False when the lowering must not be cached: while tasks are extracted, under a
+ *  context without an identity, or with the meta schedule, whose databases have none.
+ */
+bool WriteDispatchContexts(std::ostream* os) {
+  if (backend::IsMetaScheduleEnabled() || meta_schedule::MetaScheduleContext::Current().defined()) {
+    return false;
+  }
+  std::vector<const char*> names = {"autotvm.dispatch_context_key"};
+  if (backend::IsAutoSchedulerEnabled()) names.push_back("auto_scheduler.dispatch_context_key");
+  for (const char* name : names) {
+    // Registered once the package is imported, before which only its fallback context exists.
+    const runtime::PackedFunc* context_key = runtime::Registry::Get(name);
+    if (context_key == nullptr) continue;
+    TVMRetValue value = (*context_key)();
+    if (value.type_code() == kTVMNullptr) return false;
+    *os << "\n" << name << " " << value.operator std::string();
+  }
+  return true;
+}
+
+/*! \brief The number of lowerings loaded from any cache of the process. */
+std::atomic<int64_t> num_hits{0};
+
+}  // namespace
+
+TVM_REGISTER_GLOBAL("relay.backend._TECompilerDiskCacheHits").set_body_typed([]() {
+  return static_cast<int64_t>(num_hits.load());
+});
+
+std::unique_ptr<DiskCompileCache> DiskCompileCache::FromPassContext() {
+  transform::PassContext ctx = transform::PassContext::Current();
+  Optional<String> dir = ctx->GetConfig<String>("relay.backend.te_compiler_cache_dir");
+  if (!dir.defined() || dir.value().empty()) {
+    return nullptr;
+  }
+  Integer max_mb = ctx->GetConfig<Integer>("relay.backend.te_compiler_cache_max_mb", Integer(1024))
+                       .value();
+  String salt = ctx->GetConfig<String>("relay.backend.te_compiler_cache_key", String("")).value();
+  return std::unique_ptr<DiskCompileCache>(
+      new DiskCompileCache(dir.value(), max_mb->value << 20, salt));
+}
+
+DiskCompileCache::DiskCompileCache(std::string dir, int64_t max_bytes, std::string salt)
+    : dir_(std::move(dir)), max_bytes_(max_bytes), salt_(std::move(salt)) {
+  MakeDirectory(dir_);
+  Evict();
+}
+
+bool DiskCompileCache::KeyText(const CCacheKey& key, std::string* text) const {
+  transform::PassContext ctx = transform::PassContext::Current();
+  std::ostringstream os;
+  os << "tvm " << TVM_VERSION << "\ntarget " << key->target->str() << "\nopt_level "
+     << ctx->opt_level << "\nrequired_pass " << ctx->required_pass << "\ndisabled_pass "
+     << ctx->disabled_pass;
+  // Sort the options so that the key does not depend on the order they were set in.
+  std::map<std::string, std::string> options;
+  for (const auto& kv : ctx->config) {
+    if (std::string(kv.first).rfind("relay.backend.te_compiler_cache_", 0) == 0) continue;
+    std::ostringstream value;
+    value << kv.second;
+    options[kv.first] = value.str();
+  }
+  for (const auto& kv : options) {
+    os << "\nconfig " << kv.first << "=" << kv.second;
+  }
+  if (!WriteDispatchContexts(&os)) return false;
+  os << "\nsalt " << salt_ << "\nfunction " << ToHex(tvm::StructuralHash()(key->source_func));
+  *text = os.str();
+  return true;
+}
+
+std::string DiskCompileCache::PathOf(const std::string& key_text) const {
+  return dir_ + "/" + ToHex(FNV1a(key_text)) + kEntryExtension;
+}
+
+CachedFunc DiskCompileCache::Lookup(const CCacheKey& key,
+                                    std::function<std::string(std::string)> renamer) {
+  std::string key_text;
+  if (!KeyText(key, &key_text)) return CachedFunc();
+  std::string path = PathOf(key_text);
+  std::ifstream is(path, std::ios::binary);
+  if (!is.good()) return CachedFunc();
+
+  // An entry is "<magic> <key size> <payload size> <checksum>\n<key><payload>".
+  std::string magic;
+  size_t key_size = 0, payload_size = 0;
+  uint64_t checksum = 0;
+  is >> magic >> key_size >> payload_size >> std::hex >> checksum;
+  is.get();
+  std::string stored_key(key_size, '\0');
+  std::string payload(payload_size, '\0');
+  if (!is || magic != kEntryMagic || !is.read(&stored_key[0], key_size) ||
+      !is.read(&payload[0], payload_size) || FNV1a(payload, FNV1a(stored_key)) != checksum) {
+    LOG(WARNING) << "Removing the corrupted compilation cache entry " << path;
+    std::remove(path.c_str());
+    return CachedFunc();
+  }
+  if (stored_key != key_text) return CachedFunc();
+
+  Map<String, ObjectRef> entry = Downcast<Map<String, ObjectRef>>(LoadJSON(payload));
+  // Tells apart the functions whose structural hashes collide.
+  if (!tvm::StructuralEqual()(entry["source_func"], key->source_func)) return CachedFunc();
+  Touch(path);
+
+  String name = renamer(Downcast<String>(entry["name"]));
+  GlobalVar prim_fn_var(name);
+  prim_fn_var->checked_type_ = key->source_func->checked_type();
+  tir::PrimFunc prim_func =
+      WithAttr(Downcast<tir::PrimFunc>(entry["prim_func"]), tvm::attr::kGlobalSymbol, name);
+  IRModule funcs(Map<GlobalVar, BaseFunc>({{prim_fn_var, prim_func}}));
+  ++num_hits;
+  VLOG(1) << "loaded " << name << " from the compilation cache entry " << path;
+  return CachedFunc(key->target, prim_fn_var, {}, {}, te::Schedule{nullptr},
+                    tir::PrimFunc{nullptr}, {}, funcs);
+}
+
+void DiskCompileCache::Insert(const CCacheKey& key, const std::string& readable_name,
+                              const CachedFunc& cached_func) {
+  if (cached_func->funcs->functions.size() != 1) return;
+  const auto* prim_func =
+      cached_func->funcs->Lookup(cached_func->prim_fn_var).as<tir::PrimFuncNode>();
+  std::string key_text;
+  if (prim_func == nullptr || !KeyText(key, &key_text)) return;
+
+  std::string payload;
+  try {
+    payload = SaveJSON(Map<String, ObjectRef>({{"source_func", key->source_func},
+                                               {"name", String(readable_name)},
+                                               {"prim_func", GetRef<tir::PrimFunc>(prim_func)}}));
+  } catch (const Error& e) {
+    VLOG(1) << "cannot serialize " << cached_func->prim_fn_var->name_hint
+            << " for the compilation cache: " << e.what();
+    return;
+  }
+
+  std::string path = PathOf(key_text);
+  // A name no other writer picks, so that the rename below is the only step others can see.
+  std::random_device rd;
+  std::string tmp_path = path + ".tmp" + ToHex((static_cast<uint64_t>(rd()) << 32) | rd());
+  {
+    std::ofstream os(tmp_path, std::ios::binary | std::ios::trunc);
+    if (!os.good()) {
+      LOG(WARNING) << "Cannot write the compilation cache entry " << tmp_path;
+      return;
+    }
+    os << kEntryMagic << " " << key_text.size() << " " << payload.size() << " " << std::hex
+       << FNV1a(payload, FNV1a(key_text)) << "\n"
+       << key_text << payload;
+    if (!os.good()) {
+      os.close();
+      std::remove(tmp_path.c_str());
+      return;
+    }
+  }
+#ifdef _WIN32
+  // rename does not replace an existing file on Windows.
+  std::remove(path.c_str());
+#endif
+  if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    return;
+  }
+
+  approx_bytes_ += key_text.size() + payload.size();
+  if (approx_bytes_ > max_bytes_) {
+    Evict();
+  }
+}
+
+void DiskCompileCache::Evict() {
+#ifndef _WIN32
+  DIR* dir = opendir(dir_.c_str());
+  if (dir == nullptr) return;
+  std::vector<std::pair<time_t, std::string>> entries;
+  std::vector<int64_t> sizes;
+  int64_t total = 0;
+  const std::string extension = kEntryExtension;
+  for (dirent* ent = readdir(dir); ent != nullptr; ent = readdir(dir)) {
+    std::string name = ent->d_name;
+    if (name.size() <= extension.size() ||
+        name.compare(name.size() - extension.size(), extension.size(), extension) != 0) {
+      continue;
+    }
+    std::string path = dir_ + "/" + name;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) continue;
+    entries.emplace_back(st.st_mtime, path);
+    sizes.push_back(st.st_size);
+    total += st.st_size;
+  }
+  closedir(dir);
+
+  if (total > max_bytes_) {
+    // Trim below the limit, so that the next writes do not scan the directory again at once.
+    int64_t target = max_bytes_ - max_bytes_ / 4;
+    std::vector<size_t> order(entries.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(),
+              [&](size_t a, size_t b) { return entries[a].first < entries[b].first; });
+    for (size_t i : order) {
+      if (total <= target) break;
+      // Another process may have removed it first, which is as good.
+      std::remove(entries[i].second.c_str());
+      total -= sizes[i];
+    }
+  }
+  approx_bytes_ = total;
+#else
+  // Eviction lists the directory with POSIX calls, entries are kept on Windows.
+  approx_bytes_ = 0;
+#endif
+}
+
+}  // namespace tec
+}  // namespace relay
+}  // namespace tvm
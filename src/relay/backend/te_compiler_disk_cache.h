@@ -0,0 +1,111 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file relay/backend/te_compiler_disk_cache.h
+ * \brief A cache of lowered primitive functions kept in a directory, shared by the builds of
+ *  every process which uses the same directory.
+ */
+#ifndef TVM_RELAY_BACKEND_TE_COMPILER_DISK_CACHE_H_
+#define TVM_RELAY_BACKEND_TE_COMPILER_DISK_CACHE_H_
+
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "./te_compiler_cache.h"
+
+namespace tvm {
+namespace relay {
+namespace tec {
+
+/*!
+ * \brief Stores the PrimFunc a primitive function was lowered to, one file per entry.
+ *
+ *  Enabled by setting the "relay.backend.te_compiler_cache_dir" option of the PassContext.
+ *  Entries are keyed by the structural hash of the primitive function, the target, the
+ *  PassContext and the TVM version, and hold the primitive function itself so that a hash
+ *  collision is a miss. Files are written under a temporary name and renamed into place, so
+ *  concurrent builds never read a partial entry. Once the directory exceeds its size limit, the
+ *  least recently used entries are removed.
+ *
+ *  The key also holds the identities of the AutoTVM and auto-scheduler dispatch contexts, which
+ *  hash the tuning records they loaded. The cache is bypassed while tuning tasks are extracted,
+ *  under contexts whose answers cannot be identified and when the meta schedule is used. Builds
+ *  using other custom schedules should set "relay.backend.te_compiler_cache_key" to tell them
+ *  apart.
+ */
+class DiskCompileCache {
+ public:
+  /*!
+   * \brief Create the cache configured by the current PassContext.
+   * \return The cache, or nullptr when it is not enabled.
+   */
+  static std::unique_ptr<DiskCompileCache> FromPassContext();
+
+  /*!
+   * \brief Create a cache.
+   * \param dir The directory of the entries, created when missing.
+   * \param max_bytes The size the entries are trimmed to.
+   * \param salt Extra text mixed into the keys.
+   */
+  DiskCompileCache(std::string dir, int64_t max_bytes, std::string salt);
+
+  /*!
+   * \brief Look up the lowering of a primitive function.
+   * \param key The primitive function and the target.
+   * \param renamer Gives the unique name of the function from its readable name.
+   * \return The lowered function with the name given by \p renamer, or an undefined CachedFunc.
+   *  Each hit is counted by "relay.backend._TECompilerDiskCacheHits". The TE tensors and schedule
+   *  of a cached function are not kept.
+   */
+  CachedFunc Lookup(const CCacheKey& key, std::function<std::string(std::string)> renamer);
+
+  /*!
+   * \brief Store the lowering of a primitive function, ignoring lowerings into several PrimFuncs.
+   * \param key The primitive function and the target.
+   * \param readable_name The name of the function before it was made unique.
+   * \param cached_func The lowered function.
+   */
+  void Insert(const CCacheKey& key, const std::string& readable_name,
+              const CachedFunc& cached_func);
+
+ private:
+  /*!
+   * \brief Write every input of the lowering of \p key into \p text.
+   * \return False when the lowering must not be cached.
+   */
+  bool KeyText(const CCacheKey& key, std::string* text) const;
+  /*! \return The path of the entry of a key. */
+  std::string PathOf(const std::string& key_text) const;
+  /*! \brief Remove the least recently used entries until the directory fits in its limit. */
+  void Evict();
+
+  std::string dir_;
+  int64_t max_bytes_;
+  std::string salt_;
+  /*! \brief The size of the directory, as of the last scan plus the entries written since. */
+  int64_t approx_bytes_{0};
+};
+
+}  // namespace tec
+}  // namespace relay
+}  // namespace tvm
+
+#endif  // TVM_RELAY_BACKEND_TE_COMPILER_DISK_CACHE_H_
@@ -32,14 +32,23 @@
 #include <tvm/runtime/ndarray.h>
 #include <tvm/runtime/object.h>
 
+#include <atomic>
+#include <unordered_map>
+
 #include "../op/memory/on_device.h"
+#include "./fold_constant_kernels.h"
 #include "./pattern_utils.h"
 
 namespace tvm {
 namespace relay {
 namespace transform {
 
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.FoldConstant.native_kernels", Bool);
+
 namespace {
+/*! \brief The number of kernels compiled for calls on constant tensors, across all folders. */
+std::atomic<int64_t> num_compiled_kernels{0};
+
 /*!
  * \brief Returns whether \p expr is a literal \p Constant, optionally wrapped by an "on_device"
  * annotation CallNode (which serves only to associate an \p VirtualDevice to the constant and has
@@ -73,7 +82,10 @@ class ConstantFolder : public MixedModeMutator {
         shape_of_op_(Op::Get("shape_of")),
         vm_shape_of_op_(Op::Get("vm.shape_of")),
         cast_op_(Op::Get("cast")),
-        ndarray_size_op_(Op::Get("ndarray_size")) {}
+        ndarray_size_op_(Op::Get("ndarray_size")),
+        native_kernels_(transform::PassContext::Current()
+                            ->GetConfig<Bool>("relay.FoldConstant.native_kernels", Bool(true))
+                            .value()) {}
 
  private:
   using ExprMutator::VisitExpr_;
@@ -193,7 +205,7 @@ class ConstantFolder : public MixedModeMutator {
     }
     // During evaluation we have obviously lost all on_device annotations. However any
     // on_device wrapping this call will be left in place.
-    return ConstEvaluate(post_call);
+    return EvaluateCall(pre_call, post_call);
   }
 
   Expr VisitExpr_(const IfNode* if_node) final {
@@ -242,6 +254,73 @@ class ConstantFolder : public MixedModeMutator {
     }
   }
 
+  /*!
+   * \brief Evaluates \p post_call, a call to a primitive op whose arguments are all constants.
+   * \p pre_call is the call before its arguments were folded, which still has its checked type.
+   *
+   * The ops FoldConstant sees most (reshapes, transposes, layout transforms, casts and
+   * elementwise arithmetic on weights) are run on the host directly. Other calls on tensors
+   * share one compiled kernel per op, attributes and argument types. Only the remaining calls,
+   * such as those on tuples, go through the interpreter one by one.
+   */
+  Expr EvaluateCall(const Call& pre_call, const Call& post_call) {
+    Array<runtime::NDArray> values;
+    for (const Expr& arg : post_call->args) {
+      const auto* constant_node = AsIgnoringOnDevice<ConstantNode>(arg);
+      if (constant_node == nullptr) {
+        return ConstEvaluate(post_call);
+      }
+      values.push_back(constant_node->data);
+    }
+    if (native_kernels_ && pre_call->checked_type_.defined()) {
+      if (const auto* tensor_type = pre_call->checked_type().as<TensorTypeNode>()) {
+        runtime::NDArray result =
+            EvaluateNativeKernel(post_call, values, GetRef<TensorType>(tensor_type));
+        if (result.defined()) {
+          VLOG(1) << "Evaluated natively:" << std::endl << PrettyPrint(post_call);
+          return Constant(result);
+        }
+      }
+    }
+    return EvaluateWithSharedKernel(post_call, values);
+  }
+
+  /*!
+   * \brief Evaluates \p call, whose arguments have the values \p values, with the kernel
+   * compiled for the first structurally equal call with arguments of the same types.
+   */
+  Expr EvaluateWithSharedKernel(const Call& call, const Array<runtime::NDArray>& values) {
+    Array<Var> params;
+    Array<Expr> args;
+    for (size_t i = 0; i < values.size(); ++i) {
+      const runtime::NDArray& value = values[i];
+      Array<PrimExpr> shape;
+      for (int j = 0; j < value->ndim; ++j) {
+        shape.push_back(Integer(value->shape[j]));
+      }
+      Var param("p" + std::to_string(i), TensorType(shape, value.DataType()));
+      params.push_back(param);
+      args.push_back(Constant(value));
+    }
+    Function kernel(params, Call(call->op, {params.begin(), params.end()}, call->attrs,
+                                 call->type_args),
+                    Type(), {});
+
+    // The kernels are compiled and run in a fresh build context, as for ConstEvaluate.
+    With<transform::PassContext> fresh_build_ctx(transform::PassContext::Create());
+    auto it = kernels_.find(kernel);
+    if (it == kernels_.end()) {
+      VLOG(1) << "Compiling kernel:" << std::endl << PrettyPrint(kernel);
+      ++num_compiled_kernels;
+      IRModule mod({}, module_->type_definitions, module_->Imports());
+      it = kernels_.emplace(kernel, EvalFunction(mod, kernel, eval_cpu_dev_, eval_cpu_target_))
+               .first;
+    }
+    Expr result = ObjectToExpr(it->second(args));
+    VLOG(1) << "Evaluated to constant:" << std::endl << PrettyPrint(result);
+    return result;
+  }
+
   // Constant evaluate an expression.
   Expr ConstEvaluate(const Expr& expr) {
     VLOG_CONTEXT << "ConstEvaluate";
@@ -368,8 +447,9 @@ class ConstantFolder : public MixedModeMutator {
     // Cast the constant into correct dtype
     auto cast_attrs = make_object<CastAttrs>();
     cast_attrs->dtype = dtype;
-    Expr ret = Call(cast_op_, {value}, Attrs(cast_attrs), {});
-    return ConstEvaluate(ret);
+    Call ret = Call(cast_op_, {value}, Attrs(cast_attrs), {});
+    ret->checked_type_ = TensorType(Downcast<Constant>(value)->tensor_type()->shape, dtype);
+    return EvaluateCall(ret, ret);
   }
 
   Optional<tvm::Array<IndexExpr>> GetConstantShape(const Expr& input) {
@@ -403,12 +483,23 @@ class ConstantFolder : public MixedModeMutator {
 
   // True if currently within a "primitive" Relay Function.
   bool inside_primitive_ = false;
+
+  // Whether to run the simple ops on the host instead of compiling them.
+  bool native_kernels_;
+  // The kernels compiled so far, by the function applying the op to parameters.
+  std::unordered_map<Function, TypedPackedFunc<ObjectRef(Array<Expr>)>, StructuralHash,
+                     StructuralEqual>
+      kernels_;
 };
 
 }  // namespace
 
 TVM_REGISTER_GLOBAL("relay.analysis.check_constant").set_body_typed(IsComplexConstant);
 
+TVM_REGISTER_GLOBAL("relay._transform.FoldConstantNumCompiledKernels").set_body_typed([]() {
+  return static_cast<int64_t>(num_compiled_kernels.load());
+});
+
 /*!
  * \brief Returns \p expr with any constants expressions evaluated and let-bound constants
  * inlined. Returns \p expr unchanged if no change.
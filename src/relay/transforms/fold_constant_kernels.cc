@@ -0,0 +1,463 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file relay/transforms/fold_constant_kernels.cc
+ * \brief Host implementations of simple ops for constant folding.
+ */
+#include "./fold_constant_kernels.h"
+
+#include <tvm/relay/attrs/transform.h>
+#include <tvm/relay/op.h>
+#include <tvm/tir/data_layout.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <unordered_set>
+#include <vector>
+
+namespace tvm {
+namespace relay {
+namespace transform {
+
+namespace {
+
+using runtime::NDArray;
+
+constexpr Device kCPU{kDLCPU, 0};
+
+std::vector<int64_t> ShapeOf(const NDArray& arr) {
+  return std::vector<int64_t>(arr->shape, arr->shape + arr->ndim);
+}
+
+int64_t NumElements(const std::vector<int64_t>& shape) {
+  int64_t size = 1;
+  for (int64_t dim : shape) size *= dim;
+  return size;
+}
+
+size_t ElementBytes(DLDataType dtype) { return (dtype.bits * dtype.lanes + 7) / 8; }
+
+/*! \brief The row-major strides of a shape, in elements. */
+std::vector<int64_t> RowMajorStrides(const std::vector<int64_t>& shape) {
+  std::vector<int64_t> strides(shape.size());
+  int64_t stride = 1;
+  for (size_t i = shape.size(); i > 0; --i) {
+    strides[i - 1] = stride;
+    stride *= shape[i - 1];
+  }
+  return strides;
+}
+
+/*!
+ * \brief Get the strides which read an input of shape \p in_shape at each element of an output
+ *  of shape \p out_shape, following numpy broadcasting.
+ * \return Whether the input broadcasts to the output.
+ */
+bool BroadcastStrides(const std::vector<int64_t>& in_shape, const std::vector<int64_t>& out_shape,
+                      std::vector<int64_t>* strides) {
+  if (in_shape.size() > out_shape.size()) return false;
+  std::vector<int64_t> in_strides = RowMajorStrides(in_shape);
+  size_t lead = out_shape.size() - in_shape.size();
+  strides->assign(out_shape.size(), 0);
+  for (size_t i = 0; i < in_shape.size(); ++i) {
+    if (in_shape[i] == out_shape[lead + i]) {
+      (*strides)[lead + i] = in_strides[i];
+    } else if (in_shape[i] != 1) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/*!
+ * \brief Call \p f(out, a, b) for each element of a row-major tensor of shape \p shape, with
+ *  the offsets of the elements of two inputs read at it with strides \p a_strides and \p b_strides.
+ */
+template <typename F>
+void ForEachElement(const std::vector<int64_t>& shape, const std::vector<int64_t>& a_strides,
+                    const std::vector<int64_t>& b_strides, F f) {
+  int64_t total = NumElements(shape);
+  if (total == 0) return;
+  if (shape.empty()) {
+    f(0, 0, 0);
+    return;
+  }
+  size_t inner_dim = shape.size() - 1;
+  int64_t inner = shape[inner_dim];
+  int64_t a_inner = a_strides[inner_dim];
+  int64_t b_inner = b_strides[inner_dim];
+  std::vector<int64_t> index(shape.size(), 0);
+  int64_t a = 0;
+  int64_t b = 0;
+  for (int64_t out = 0; out < total; out += inner) {
+    for (int64_t i = 0; i < inner; ++i) {
+      f(out + i, a + i * a_inner, b + i * b_inner);
+    }
+    for (size_t d = inner_dim; d > 0; --d) {
+      a += a_strides[d - 1];
+      b += b_strides[d - 1];
+      if (++index[d - 1] < shape[d - 1]) break;
+      a -= a_strides[d - 1] * shape[d - 1];
+      b -= b_strides[d - 1] * shape[d - 1];
+      index[d - 1] = 0;
+    }
+  }
+}
+
+/*! \brief Copy the element of \p data at each offset \p strides gives into a new tensor. */
+NDArray Gather(const NDArray& data, const std::vector<int64_t>& out_shape,
+               const std::vector<int64_t>& strides) {
+  NDArray out = NDArray::Empty(out_shape, data->dtype, kCPU);
+  size_t bytes = ElementBytes(data->dtype);
+  const auto* src = static_cast<const uint8_t*>(data->data);
+  auto* dst = static_cast<uint8_t*>(out->data);
+  ForEachElement(out_shape, strides, std::vector<int64_t>(out_shape.size(), 0),
+                 [&](int64_t o, int64_t i, int64_t) {
+                   std::memcpy(dst + o * bytes, src + i * bytes, bytes);
+                 });
+  return out;
+}
+
+/*!
+ * \brief Call \p f with a value of the C++ type of \p dtype, which must be a scalar float32,
+ *  float64 or integer type.
+ * \return Whether \p dtype is one of these types.
+ */
+template <typename F>
+bool DispatchArithType(DataType dtype, F f) {
+  if (dtype == DataType::Float(32)) {
+    f(float());
+  } else if (dtype == DataType::Float(64)) {
+    f(double());
+  } else if (dtype == DataType::Int(8)) {
+    f(int8_t());
+  } else if (dtype == DataType::Int(16)) {
+    f(int16_t());
+  } else if (dtype == DataType::Int(32)) {
+    f(int32_t());
+  } else if (dtype == DataType::Int(64)) {
+    f(int64_t());
+  } else if (dtype == DataType::UInt(8)) {
+    f(uint8_t());
+  } else if (dtype == DataType::UInt(16)) {
+    f(uint16_t());
+  } else if (dtype == DataType::UInt(32)) {
+    f(uint32_t());
+  } else if (dtype == DataType::UInt(64)) {
+    f(uint64_t());
+  } else {
+    return false;
+  }
+  return true;
+}
+
+/*! \brief Like DispatchArithType, also accepting bool. */
+template <typename F>
+bool DispatchType(DataType dtype, F f) {
+  if (dtype == DataType::Bool()) {
+    f(bool());
+    return true;
+  }
+  return DispatchArithType(dtype, f);
+}
+
+/*!
+ * \brief The type integer arithmetic is done in, unsigned so that it wraps around like the
+ *  compiled kernel instead of overflowing, and no narrower than int so that it is not promoted.
+ */
+template <typename T, bool = std::is_integral<T>::value>
+struct WrapType {
+  using type = T;
+};
+
+template <typename T>
+struct WrapType<T, true> {
+  using type = typename std::conditional<(sizeof(T) < sizeof(uint32_t)), uint32_t,
+                                         typename std::make_unsigned<T>::type>::type;
+};
+
+/*!
+ * \brief Convert to bool, like the compiled kernel, by an ordered comparison with zero, which
+ *  makes NaN false.
+ */
+template <typename TOut, typename TIn>
+typename std::enable_if<std::is_same<TOut, bool>::value, bool>::type Convert(TIn value,
+                                                                             TOut* out) {
+  *out = value < TIn(0) || value > TIn(0);
+  return true;
+}
+
+/*! \brief Convert a float to an integer, failing where the compiled kernel is undefined. */
+template <typename TOut, typename TIn>
+typename std::enable_if<!std::is_same<TOut, bool>::value && std::is_integral<TOut>::value &&
+                            std::is_floating_point<TIn>::value,
+                        bool>::type
+Convert(TIn value, TOut* out) {
+  // The conversion truncates, so the values in range are those strictly between min - 1 and
+  // max + 1. NaN fails both comparisons.
+  if (!(value > static_cast<TIn>(std::numeric_limits<TOut>::min()) - 1 &&
+        value < static_cast<TIn>(std::numeric_limits<TOut>::max()) + 1)) {
+    return false;
+  }
+  *out = static_cast<TOut>(value);
+  return true;
+}
+
+/*! \brief Convert between integers, which wraps around, or to a float, which rounds. */
+template <typename TOut, typename TIn>
+typename std::enable_if<!std::is_same<TOut, bool>::value && !(std::is_integral<TOut>::value &&
+                                                              std::is_floating_point<TIn>::value),
+                        bool>::type
+Convert(TIn value, TOut* out) {
+  *out = static_cast<TOut>(value);
+  return true;
+}
+
+NDArray EvaluateCast(const NDArray& data, DataType out_dtype) {
+  NDArray out = NDArray::Empty(ShapeOf(data), out_dtype, kCPU);
+  int64_t size = NumElements(ShapeOf(data));
+  bool converted = false;
+  bool out_supported = false;
+  bool in_supported = DispatchType(DataType(data->dtype), [&](auto in_value) {
+    using TIn = decltype(in_value);
+    out_supported = DispatchType(out_dtype, [&](auto out_value) {
+      using TOut = decltype(out_value);
+      const auto* src = static_cast<const TIn*>(data->data);
+      auto* dst = static_cast<TOut*>(out->data);
+      converted = true;
+      for (int64_t i = 0; i < size && converted; ++i) {
+        converted = Convert(src[i], &dst[i]);
+      }
+    });
+  });
+  return in_supported && out_supported && converted ? out : NDArray();
+}
+
+NDArray EvaluateTranspose(const NDArray& data, const TransposeAttrs* attrs,
+                          const std::vector<int64_t>& out_shape) {
+  std::vector<int64_t> in_shape = ShapeOf(data);
+  int64_t ndim = static_cast<int64_t>(in_shape.size());
+  std::vector<int64_t> axes;
+  if (!attrs->axes.defined() || attrs->axes.empty()) {
+    for (int64_t i = ndim - 1; i >= 0; --i) axes.push_back(i);
+  } else {
+    for (const Integer& axis : attrs->axes) {
+      int64_t value = axis->value < 0 ? axis->value + ndim : axis->value;
+      if (value < 0 || value >= ndim) return NDArray();
+      axes.push_back(value);
+    }
+  }
+  if (static_cast<int64_t>(axes.size()) != ndim) return NDArray();
+  std::vector<int64_t> in_strides = RowMajorStrides(in_shape);
+  std::vector<int64_t> strides;
+  std::vector<int64_t> shape;
+  for (int64_t axis : axes) {
+    strides.push_back(in_strides[axis]);
+    shape.push_back(in_shape[axis]);
+  }
+  if (shape != out_shape) return NDArray();
+  return Gather(data, out_shape, strides);
+}
+
+NDArray EvaluateLayoutTransform(const NDArray& data, const LayoutTransformAttrs* attrs,
+                                const std::vector<int64_t>& out_shape) {
+  std::vector<int64_t> in_shape = ShapeOf(data);
+  tir::Layout src_layout(attrs->src_layout);
+  tir::Layout dst_layout(attrs->dst_layout);
+  if (!src_layout.defined() || !dst_layout.defined() || src_layout.ndim() != in_shape.size() ||
+      dst_layout.ndim() != out_shape.size() ||
+      src_layout.ndim_primal() != dst_layout.ndim_primal()) {
+    return NDArray();
+  }
+  // Number the primal axes in the order of the source layout. Each axis of a layout is the
+  // primal axis it is part of, and the factor its index is multiplied with (the outer part of a
+  // split axis) or taken modulo (the inner part). Its index in the unsplit layout is the sum of
+  // the outer index times the factor and the inner index.
+  struct Axis {
+    int primal;
+    bool inner;
+    int64_t factor;
+  };
+  std::vector<std::string> primals;
+  for (size_t i = 0; i < src_layout.ndim(); ++i) {
+    if (src_layout[i].IsPrimal()) primals.push_back(src_layout[i].name());
+  }
+  auto describe = [&](const tir::Layout& layout, std::vector<Axis>* axes) {
+    for (size_t i = 0; i < layout.ndim(); ++i) {
+      const tir::LayoutAxis& axis = layout[i];
+      const tir::LayoutAxis& primal = axis.ToPrimal();
+      int index = static_cast<int>(
+          std::find(primals.begin(), primals.end(), primal.name()) - primals.begin());
+      if (index == static_cast<int>(primals.size()) || !layout.Contains(primal)) return false;
+      int64_t factor = layout.FactorOf(primal);
+      axes->push_back(Axis{index, !axis.IsPrimal(), factor > 0 ? factor : 1});
+    }
+    return true;
+  };
+  std::vector<Axis> src_axes;
+  std::vector<Axis> dst_axes;
+  if (!describe(src_layout, &src_axes) || !describe(dst_layout, &dst_axes)) return NDArray();
+
+  NDArray out = NDArray::Empty(out_shape, data->dtype, kCPU);
+  size_t bytes = ElementBytes(data->dtype);
+  const auto* src = static_cast<const uint8_t*>(data->data);
+  auto* dst = static_cast<uint8_t*>(out->data);
+  std::vector<int64_t> in_strides = RowMajorStrides(in_shape);
+  std::vector<int64_t> index(out_shape.size(), 0);
+  std::vector<int64_t> logical(primals.size());
+  int64_t total = NumElements(out_shape);
+  for (int64_t o = 0; o < total; ++o) {
+    std::fill(logical.begin(), logical.end(), 0);
+    for (size_t i = 0; i < dst_axes.size(); ++i) {
+      const Axis& axis = dst_axes[i];
+      logical[axis.primal] += axis.inner ? index[i] : index[i] * axis.factor;
+    }
+    // The output is padded with zeros where the source has no element.
+    int64_t offset = 0;
+    bool in_range = true;
+    for (size_t i = 0; i < src_axes.size() && in_range; ++i) {
+      const Axis& axis = src_axes[i];
+      int64_t value = logical[axis.primal];
+      int64_t coord = axis.inner ? value % axis.factor : value / axis.factor;
+      in_range = coord < in_shape[i];
+      offset += coord * in_strides[i];
+    }
+    if (in_range) {
+      std::memcpy(dst + o * bytes, src + offset * bytes, bytes);
+    } else {
+      std::memset(dst + o * bytes, 0, bytes);
+    }
+    for (size_t d = out_shape.size(); d > 0; --d) {
+      if (++index[d - 1] < out_shape[d - 1]) break;
+      index[d - 1] = 0;
+    }
+  }
+  return out;
+}
+
+NDArray EvaluateElementwise(const std::string& name, const Array<NDArray>& args,
+                            const std::vector<int64_t>& out_shape, DataType out_dtype) {
+  for (const NDArray& arg : args) {
+    if (DataType(arg->dtype) != out_dtype) return NDArray();
+  }
+  std::vector<int64_t> a_strides;
+  std::vector<int64_t> b_strides(out_shape.size(), 0);
+  if (!BroadcastStrides(ShapeOf(args[0]), out_shape, &a_strides) ||
+      (args.size() == 2 && !BroadcastStrides(ShapeOf(args[1]), out_shape, &b_strides))) {
+    return NDArray();
+  }
+  NDArray out = NDArray::Empty(out_shape, out_dtype, kCPU);
+  bool evaluated = false;
+  DispatchArithType(out_dtype, [&](auto tag) {
+    using T = decltype(tag);
+    using W = typename WrapType<T>::type;
+    const auto* a = static_cast<const T*>(args[0]->data);
+    const auto* b = args.size() == 2 ? static_cast<const T*>(args[1]->data) : a;
+    auto* dst = static_cast<T*>(out->data);
+    auto apply = [&](auto f) {
+      ForEachElement(out_shape, a_strides, b_strides,
+                     [&](int64_t o, int64_t i, int64_t j) { dst[o] = f(a[i], b[j]); });
+      evaluated = true;
+    };
+    if (name == "negative") {
+      // Like tir's neg, subtract from zero, which gives +0 for +0.
+      apply([](T x, T) { return static_cast<T>(static_cast<W>(0) - static_cast<W>(x)); });
+    } else if (name == "add") {
+      apply([](T x, T y) { return static_cast<T>(static_cast<W>(x) + static_cast<W>(y)); });
+    } else if (name == "subtract") {
+      apply([](T x, T y) { return static_cast<T>(static_cast<W>(x) - static_cast<W>(y)); });
+    } else if (name == "multiply") {
+      apply([](T x, T y) { return static_cast<T>(static_cast<W>(x) * static_cast<W>(y)); });
+    } else if (name == "divide" && std::is_floating_point<T>::value) {
+      // Integer division is left to the compiled kernel, which decides what x / 0 gives.
+      apply([](T x, T y) { return x / y; });
+    } else if (name == "maximum") {
+      apply([](T x, T y) { return x > y ? x : y; });
+    } else if (name == "minimum") {
+      apply([](T x, T y) { return x < y ? x : y; });
+    }
+  });
+  return evaluated ? out : NDArray();
+}
+
+}  // namespace
+
+NDArray EvaluateNativeKernel(const Call& call, const Array<NDArray>& args,
+                             const TensorType& out_type) {
+  static const std::unordered_set<std::string> reshape_ops = {
+      "reshape",     "contrib_reverse_reshape", "reshape_like", "squeeze",
+      "expand_dims", "nn.batch_flatten",        "copy"};
+  static const std::unordered_set<std::string> unary_ops = {"negative"};
+  static const std::unordered_set<std::string> binary_ops = {"add",     "subtract", "multiply",
+                                                             "divide",  "maximum",  "minimum"};
+
+  const auto* op = call->op.as<OpNode>();
+  if (op == nullptr || args.empty()) return NDArray();
+  for (const NDArray& arg : args) {
+    if (arg->device.device_type != kDLCPU || !arg.IsContiguous() || arg->dtype.lanes != 1) {
+      return NDArray();
+    }
+  }
+  std::vector<int64_t> out_shape;
+  for (const PrimExpr& dim : out_type->shape) {
+    const auto* value = dim.as<IntImmNode>();
+    if (value == nullptr) return NDArray();
+    out_shape.push_back(value->value);
+  }
+  const NDArray& data = args[0];
+
+  if (reshape_ops.count(op->name)) {
+    if (DataType(data->dtype) != out_type->dtype ||
+        NumElements(ShapeOf(data)) != NumElements(out_shape)) {
+      return NDArray();
+    }
+    NDArray out = NDArray::Empty(out_shape, data->dtype, kCPU);
+    std::memcpy(out->data, data->data, NumElements(out_shape) * ElementBytes(data->dtype));
+    return out;
+  }
+  if (op->name == "cast" || op->name == "cast_like") {
+    if (ShapeOf(data) != out_shape) return NDArray();
+    return EvaluateCast(data, out_type->dtype);
+  }
+  if (op->name == "transpose") {
+    const auto* attrs = call->attrs.as<TransposeAttrs>();
+    if (attrs == nullptr || args.size() != 1) return NDArray();
+    return EvaluateTranspose(data, attrs, out_shape);
+  }
+  if (op->name == "layout_transform") {
+    const auto* attrs = call->attrs.as<LayoutTransformAttrs>();
+    if (attrs == nullptr || args.size() != 1 || DataType(data->dtype) != out_type->dtype) {
+      return NDArray();
+    }
+    return EvaluateLayoutTransform(data, attrs, out_shape);
+  }
+  if ((unary_ops.count(op->name) && args.size() == 1) ||
+      (binary_ops.count(op->name) && args.size() == 2)) {
+    return EvaluateElementwise(op->name, args, out_shape, out_type->dtype);
+  }
+  return NDArray();
+}
+
+}  // namespace transform
+}  // namespace relay
+}  // namespace tvm
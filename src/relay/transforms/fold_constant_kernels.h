@@ -0,0 +1,57 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file relay/transforms/fold_constant_kernels.h
+ * \brief Host implementations of the ops which only move, convert or combine elements, which
+ *  constant folding runs instead of compiling a kernel for each of them.
+ */
+#ifndef TVM_RELAY_TRANSFORMS_FOLD_CONSTANT_KERNELS_H_
+#define TVM_RELAY_TRANSFORMS_FOLD_CONSTANT_KERNELS_H_
+
+#include <tvm/relay/expr.h>
+#include <tvm/relay/type.h>
+#include <tvm/runtime/ndarray.h>
+
+namespace tvm {
+namespace relay {
+namespace transform {
+
+/*!
+ * \brief Evaluate a call to a reshape-like op, transpose, layout_transform, cast, cast_like,
+ *  negative or a broadcasting add, subtract, multiply, divide, maximum or minimum.
+ *
+ *  The result has the bits the kernel compiled for the llvm target gives. Calls the kernel
+ *  leaves undefined for some inputs, such as out of range float to integer casts, are not
+ *  evaluated.
+ *
+ * \param call The call.
+ * \param args The values of the arguments of the call, contiguous tensors on the CPU.
+ * \param out_type The type of the call, with a static shape.
+ * \return The value of the call, or an undefined NDArray when the op, its attributes or the data
+ *  types are not supported.
+ */
+runtime::NDArray EvaluateNativeKernel(const Call& call, const Array<runtime::NDArray>& args,
+                                      const TensorType& out_type);
+
+}  // namespace transform
+}  // namespace relay
+}  // namespace tvm
+
+#endif  // TVM_RELAY_TRANSFORMS_FOLD_CONSTANT_KERNELS_H_
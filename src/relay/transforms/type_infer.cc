@@ -46,12 +46,34 @@
 #include <tvm/relay/pattern_functor.h>
 #include <tvm/relay/transform.h>
 
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
 #include "../analysis/type_solver.h"
 #include "pass_utils.h"
 
 namespace tvm {
 namespace relay {
 
+/*! \brief The nodes of a function typed by an earlier inference. */
+using TypedNodeSet = std::unordered_set<const Object*>;
+
+/*!
+ * \brief Returns whether \p expr is one of \p typed, and so still has the type inferred for it.
+ *
+ * Global vars and constructors are excluded, their types come from the module.
+ */
+bool IsTyped(const TypedNodeSet* typed, const Expr& expr) {
+  return typed != nullptr && expr->checked_type_.defined() && !expr->IsInstance<OpNode>() &&
+         !expr->IsInstance<GlobalVarNode>() && !expr->IsInstance<ConstructorNode>() &&
+         typed->count(expr.get());
+}
+
 // Necessary deferred relation for TupleGetItem
 struct TupleGetItemAttrs : public tvm::AttrsNode<TupleGetItemAttrs> {
   int index;
@@ -100,8 +122,15 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
  public:
   // constructors
 
-  explicit TypeInferencer(IRModule mod, DiagnosticContext diag_ctx)
-      : mod_(mod), diag_ctx(diag_ctx), solver_(GlobalVar(), diag_ctx) {
+  /*!
+   * \param mod The module.
+   * \param diag_ctx The diagnostic context.
+   * \param typed The nodes whose types are still valid. No constraints are generated for them
+   *  or the nodes below them.
+   */
+  explicit TypeInferencer(IRModule mod, DiagnosticContext diag_ctx,
+                          const TypedNodeSet* typed = nullptr)
+      : mod_(mod), diag_ctx(diag_ctx), solver_(GlobalVar(), diag_ctx), typed_(typed) {
     ICHECK(mod.defined()) << "Module must not be null in the type inferencer.";
   }
 
@@ -133,6 +162,42 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
   /*! \brief Internal map used for memoization. */
   std::unordered_map<Expr, Type, ObjectPtrHash, ObjectPtrEqual> memo_;
 
+  // The nodes whose types are reused, and the typed nodes used by the other ones.
+  const TypedNodeSet* typed_;
+  std::vector<Expr> reused_;
+  // The typed vars without a type annotation which are bound anew, whose types are inferred again.
+  TypedNodeSet retyped_vars_;
+  // Whether each typed node queried since a var was retyped refers to one.
+  std::unordered_map<const Object*, bool> refers_to_retyped_;
+
+  /*!
+   * \brief Returns whether the type \p expr was given by an earlier inference is still valid.
+   *
+   * It is not for the retyped vars, whose binders may bind them to values of other types now,
+   * nor for the nodes which refer to them.
+   */
+  bool IsReused(const Expr& expr) {
+    if (!IsTyped(typed_, expr)) return false;
+    if (retyped_vars_.empty()) return true;
+    if (expr->IsInstance<VarNode>()) return !retyped_vars_.count(expr.get());
+    auto it = refers_to_retyped_.find(expr.get());
+    if (it == refers_to_retyped_.end()) {
+      bool refers = false;
+      for (const Var& var : FreeVars(expr)) {
+        refers = refers || retyped_vars_.count(var.get());
+      }
+      it = refers_to_retyped_.emplace(expr.get(), refers).first;
+    }
+    return !it->second;
+  }
+
+  // Called when \p var is bound by a binder which is not reused.
+  void Rebind(const Var& var) {
+    if (!var->type_annotation.defined() && IsTyped(typed_, var)) {
+      retyped_vars_.insert(var.get());
+    }
+  }
+
   void VisitLeaf(const Expr& expr) {
     if (!memo_.count(expr)) {
       Type ret = this->DispatchVisitExpr(expr);
@@ -141,7 +206,7 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
   }
 
   bool CheckVisited(const Expr& expr) {
-    if (memo_.count(expr)) {
+    if (memo_.count(expr) || IsReused(expr)) {
       return true;
     } else {
       return false;
@@ -177,6 +242,10 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
   // Lazily get type for expr
   // expression, we will populate it now, and return the result.
   Type GetType(const Expr& expr) {
+    if (IsReused(expr)) {
+      reused_.push_back(expr);
+      return expr->checked_type_;
+    }
     auto it = type_map_.find(expr);
     if (it != type_map_.end() && it->second.checked_type.defined()) {
       return it->second.checked_type;
@@ -318,6 +387,7 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
   }
 
   void VisitPattern_(const PatternVarNode* pv, const Type& t) {
+    Rebind(pv->var);
     Type vt = GetType(pv->var);
     Unify(vt, t, pv->span);
   }
@@ -357,6 +427,11 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
 
   Type VisitExpr_(const LetNode* let) final {
     auto pre_visit = [this](const LetNode* op) {
+      // A let reached through the chain of a new one binds its var to the same value as before
+      // only if both it and its value are reused.
+      if (!IsTyped(typed_, GetRef<Expr>(op)) || !IsReused(op->value)) {
+        Rebind(op->var);
+      }
       // if the definition is a function literal, permit recursion
       bool is_functional_literal = op->value.as<FunctionNode>() != nullptr;
       Type let_type = IncompleteType(Kind::kType);
@@ -581,6 +656,7 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
     solver_.Solve();
     Array<Type> arg_types;
     for (auto param : f->params) {
+      Rebind(param);
       arg_types.push_back(GetType(param));
     }
     Type rtype = GetType(f->body);
@@ -626,8 +702,14 @@ class TypeInferencer : private ExprFunctor<Type(const Expr&)>,
 class TypeInferencer::Resolver : public MixedModeMutator, PatternMutator {
  public:
   Resolver(const std::unordered_map<Expr, ResolvedTypeInfo, ObjectPtrHash, ObjectPtrEqual>& tmap,
-           TypeSolver* solver)
-      : tmap_(tmap), solver_(solver) {}
+           TypeSolver* solver, const TypedNodeSet* typed = nullptr,
+           const std::vector<Expr>& reused = {}, const TypedNodeSet* retyped_vars = nullptr)
+      : tmap_(tmap), solver_(solver), typed_(typed), retyped_vars_(retyped_vars) {
+    // The reused nodes are kept as they are, and so are the nodes below them.
+    for (const Expr& expr : reused) {
+      memo_[expr] = expr;
+    }
+  }
 
   using MixedModeMutator::VisitExpr_;
 
@@ -680,6 +762,11 @@ class TypeInferencer::Resolver : public MixedModeMutator, PatternMutator {
   Pattern VisitPattern(const Pattern& p) final { return PatternMutator::VisitPattern(p); }
 
   Var VisitVar(const Var& v) final {
+    // The typed nodes which are kept may refer to the var, which must not be copied. Those which
+    // refer to a retyped var are not kept.
+    if (IsTyped(typed_, v) && (retyped_vars_ == nullptr || !retyped_vars_->count(v.get()))) {
+      return v;
+    }
     if (vmap_.count(v) == 0) {
       vmap_[v] = GetRef<Var>(AttachCheckedType(v.as<VarNode>()).as<VarNode>());
     }
@@ -771,6 +858,8 @@ class TypeInferencer::Resolver : public MixedModeMutator, PatternMutator {
   std::unordered_map<Var, Var, ObjectPtrHash, ObjectPtrEqual> vmap_;
   const std::unordered_map<Expr, ResolvedTypeInfo, ObjectPtrHash, ObjectPtrEqual>& tmap_;
   TypeSolver* solver_;
+  const TypedNodeSet* typed_;
+  const TypedNodeSet* retyped_vars_;
   // whether attach the checked type as type_annotation
   // if original type anntation is missing.
   bool update_missing_type_annotation_{true};
@@ -787,7 +876,8 @@ Expr TypeInferencer::Infer(GlobalVar var, Function function) {
   Solve();
 
   // Step 3: Attach resolved types to checked_type field.
-  auto resolved_expr = Resolver(type_map_, &solver_).VisitExpr(function);
+  auto resolved_expr =
+      Resolver(type_map_, &solver_, typed_, reused_, &retyped_vars_).VisitExpr(function);
 
   if (!WellFormed(resolved_expr, this->diag_ctx)) {
     this->diag_ctx.Emit(Diagnostic::Bug(function->span)
@@ -847,6 +937,145 @@ void AddGlobalTypes(IRModule mod) {
   }
 }
 
+/*!
+ * \brief Returns the type a call to \p var has in \p mod, or an undefined type when it is not
+ * fully annotated.
+ */
+Type GlobalSignature(const IRModule& mod, const GlobalVar& var) {
+  if (mod->ContainGlobalVar(var->name_hint)) {
+    if (const auto* func = mod->Lookup(var->name_hint).as<FunctionNode>()) {
+      for (const Var& param : func->params) {
+        if (!param->type_annotation.defined()) return Type();
+      }
+      return func->ret_type.defined() ? func->func_type_annotation() : Type();
+    }
+  }
+  return var->checked_type_;
+}
+
+/*!
+ * \brief A function typed by InferType, and what its types depend on besides its nodes.
+ *
+ * The function is kept alive, so the nodes it holds cannot be freed and their addresses reused,
+ * and since it holds a reference to them a pass rewriting one of them copies it.
+ */
+struct TypedFunction {
+  Function func;
+  TypedNodeSet nodes;
+  // The signatures of the global functions it refers to.
+  std::vector<std::pair<GlobalVar, Type>> callees;
+  // The ADTs it was typed with, if it constructs or matches any.
+  Optional<Map<GlobalTypeVar, TypeData>> type_definitions;
+
+  /*! \brief Returns whether the types of the nodes are still valid in \p mod. */
+  bool ValidIn(const IRModule& mod) const {
+    if (type_definitions.defined() && !type_definitions.same_as(mod->type_definitions)) {
+      return false;
+    }
+    for (const auto& callee : callees) {
+      Type signature = GlobalSignature(mod, callee.first);
+      if (!callee.second.defined() || !signature.defined() ||
+          !tvm::StructuralEqual()(callee.second, signature)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
+
+/*! \brief Collects the nodes of a typed function and the global functions it refers to. */
+class TypedFunctionCollector : public MixedModeVisitor {
+ public:
+  TypedFunctionCollector(const IRModule& mod, TypedFunction* typed) : mod_(mod), typed_(typed) {}
+
+  using MixedModeVisitor::VisitExpr_;
+
+  void VisitLeaf(const Expr& expr) final {
+    typed_->nodes.insert(expr.get());
+    MixedModeVisitor::VisitLeaf(expr);
+  }
+
+  void VisitExpr_(const GlobalVarNode* op) final {
+    GlobalVar var = GetRef<GlobalVar>(op);
+    typed_->callees.emplace_back(var, GlobalSignature(mod_, var));
+  }
+
+  void VisitExpr_(const ConstructorNode* op) final {
+    typed_->type_definitions = mod_->type_definitions;
+  }
+
+  void VisitExpr_(const MatchNode* op) final {
+    typed_->type_definitions = mod_->type_definitions;
+    MixedModeVisitor::VisitExpr_(op);
+  }
+
+  void VisitExpr_(const LetNode* op) final {
+    auto pre_visit = [this](const LetNode* op) {
+      this->VisitExpr(op->var);
+      this->VisitExpr(op->value);
+    };
+    auto post_visit = [this](const LetNode* op) {
+      this->VisitExpr(op->body);
+      this->typed_->nodes.insert(op);
+      this->visit_counter_[op] += 1;
+    };
+    ExpandANormalForm(op, pre_visit, post_visit);
+  }
+
+ private:
+  IRModule mod_;
+  TypedFunction* typed_;
+};
+
+/*!
+ * \brief The last typed version of each global function, for incremental type inference.
+ *
+ * Entries are keyed by the name of the function and bounded in number, the least recently typed
+ * ones are dropped first.
+ */
+class TypedFunctionCache {
+ public:
+  static TypedFunctionCache* Global() {
+    static TypedFunctionCache* inst = new TypedFunctionCache();
+    return inst;
+  }
+
+  /*! \returns The last typed version of \p var if its types are still valid in \p mod. */
+  std::shared_ptr<const TypedFunction> Lookup(const GlobalVar& var, const IRModule& mod) {
+    std::shared_ptr<const TypedFunction> typed;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto it = entries_.find(var->name_hint);
+      if (it == entries_.end()) return nullptr;
+      typed = it->second.first;
+    }
+    return typed->ValidIn(mod) ? typed : nullptr;
+  }
+
+  /*! \brief Records \p func as the last typed version of \p var. */
+  void Insert(const GlobalVar& var, const IRModule& mod, const Function& func) {
+    auto typed = std::make_shared<TypedFunction>();
+    typed->func = func;
+    TypedFunctionCollector(mod, typed.get()).VisitExpr(func);
+    std::lock_guard<std::mutex> lock(mutex_);
+    entries_[var->name_hint] = {typed, ++clock_};
+    if (entries_.size() > kMaxEntries) {
+      auto oldest = entries_.begin();
+      for (auto it = entries_.begin(); it != entries_.end(); ++it) {
+        if (it->second.second < oldest->second.second) oldest = it;
+      }
+      entries_.erase(oldest);
+    }
+  }
+
+ private:
+  static constexpr size_t kMaxEntries = 64;
+  std::mutex mutex_;
+  std::unordered_map<std::string, std::pair<std::shared_ptr<const TypedFunction>, uint64_t>>
+      entries_;
+  uint64_t clock_{0};
+};
+
 /*!
  * \brief Returns a possibly much smaller subgraph whose inner nodes have the same type.
  *
@@ -949,12 +1178,20 @@ TVM_REGISTER_GLOBAL("relay._transform.InferTypeLocal").set_body_typed([](const E
   return InferTypeLocal(expr);
 });
 
+TVM_REGISTER_PASS_CONFIG_OPTION("relay.InferType.incremental", Bool);
+
 Pass InferType() {
   auto pass_info = PassInfo(0, "InferType", {});
   return tvm::transform::CreateModulePass(
       [=](IRModule mod, const PassContext& pass_ctx) {
         // Execute the pass function and return a new module.
         IRModule updated_mod = mod->ShallowCopy();
+        // In incremental mode, only the nodes created since the last inference of a function are
+        // typed, the others keep their types as long as the signatures of the functions they
+        // call are the same. The typed functions are kept until they are typed again, or until
+        // enough other functions are.
+        bool incremental =
+            pass_ctx->GetConfig<Bool>("relay.InferType.incremental", Bool(false)).value();
 
         pass_ctx->diag_ctx = DiagnosticContext::Default(updated_mod);
 
@@ -972,14 +1209,21 @@ Pass InferType() {
           if (auto* func_node = it.second.as<FunctionNode>()) {
             auto func = GetRef<Function>(func_node);
 
-            // // If a function already has type information we can skip checking it.
-            // if (func->checked_type_.defined()) {
-            //   continue;
-            // }
+            std::shared_ptr<const TypedFunction> typed;
+            if (incremental) {
+              // The functions of updated_mod are the ones given to the pass, AddGlobalTypes
+              // copied those of mod.
+              typed = TypedFunctionCache::Global()->Lookup(it.first, updated_mod);
+              if (typed != nullptr && typed->func.same_as(func)) {
+                it.first->checked_type_ = func->checked_type();
+                continue;
+              }
+            }
 
             // TODO(@jroesch): we should be able to move the type inferencer outside
             // of this function but it seems to be more stateful then I expect.
-            auto inferencer = TypeInferencer(mod, pass_ctx->diag_ctx.value());
+            auto inferencer = TypeInferencer(mod, pass_ctx->diag_ctx.value(),
+                                             typed != nullptr ? &typed->nodes : nullptr);
             auto updated_func = inferencer.Infer(it.first, func);
 
             pass_ctx->diag_ctx.value().Render();
@@ -1003,6 +1247,13 @@ Pass InferType() {
         for (const auto& pair : updates) {
           updated_mod->Add(pair.first, pair.second, true);
         }
+        if (incremental) {
+          // The signatures of the callees are recorded as the next inference looks them up, in
+          // the typed module, where the inference filled in their missing annotations.
+          for (const auto& pair : updates) {
+            TypedFunctionCache::Global()->Insert(pair.first, updated_mod, pair.second);
+          }
+        }
 
         return updated_mod;
       },
@@ -27,6 +27,8 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <sstream>
+#include <string>
 
 #include "workspace_pool.h"
 
@@ -92,11 +94,43 @@ struct CPUWorkspacePool : public WorkspacePool {
   CPUWorkspacePool() : WorkspacePool(kDLCPU, CPUDeviceAPI::Global()) {}
 };
 
+/*!
+ * \brief Whether the workspaces come from one pool shared by every thread instead of one pool
+ *  per thread, set by the environment variable TVM_WORKSPACE_POOL_SHARED. It is read once,
+ *  since a workspace has to be freed to the pool which allocated it.
+ */
+bool UseSharedWorkspacePool() {
+  static bool enabled = [] {
+    const char* val = getenv("TVM_WORKSPACE_POOL_SHARED");
+    return val != nullptr && atoi(val) != 0;
+  }();
+  return enabled;
+}
+
+SharedWorkspacePool* GetSharedCPUWorkspacePool() {
+  // NOTE: explicitly use new to avoid exit-time destruction of global state
+  static auto* pool = [] {
+    auto* pool = new SharedWorkspacePool(kDLCPU, CPUDeviceAPI::Global());
+    if (const char* val = getenv("TVM_WORKSPACE_POOL_CACHE_LIMIT")) {
+      pool->SetCacheLimit(atoll(val));
+    }
+    return pool;
+  }();
+  return pool;
+}
+
 void* CPUDeviceAPI::AllocWorkspace(Device dev, size_t size, DLDataType type_hint) {
+  if (UseSharedWorkspacePool()) {
+    return GetSharedCPUWorkspacePool()->AllocWorkspace(dev, size);
+  }
   return dmlc::ThreadLocalStore<CPUWorkspacePool>::Get()->AllocWorkspace(dev, size);
 }
 
 void CPUDeviceAPI::FreeWorkspace(Device dev, void* data) {
+  if (UseSharedWorkspacePool()) {
+    GetSharedCPUWorkspacePool()->FreeWorkspace(dev, data);
+    return;
+  }
   dmlc::ThreadLocalStore<CPUWorkspacePool>::Get()->FreeWorkspace(dev, data);
 }
 
@@ -104,5 +138,36 @@ TVM_REGISTER_GLOBAL("device_api.cpu").set_body([](TVMArgs args, TVMRetValue* rv)
   DeviceAPI* ptr = CPUDeviceAPI::Global();
   *rv = static_cast<void*>(ptr);
 });
+
+TVM_REGISTER_GLOBAL("runtime.workspace_stats").set_body_typed([](int device_type, int device_id) {
+  Device dev{static_cast<DLDeviceType>(device_type), device_id};
+  WorkspaceStats stats = GetWorkspaceStats(dev);
+  std::ostringstream os;
+  os << "{\"live_bytes\": " << stats.live_bytes << ", \"peak_live_bytes\": "
+     << stats.peak_live_bytes << ", \"held_bytes\": " << stats.held_bytes
+     << ", \"peak_held_bytes\": " << stats.peak_held_bytes;
+  if (dev.device_type == kDLCPU && UseSharedWorkspacePool()) {
+    os << ", \"cached_bytes\": " << GetSharedCPUWorkspacePool()->CachedBytes(dev);
+  }
+  os << "}";
+  return std::string(os.str());
+});
+
+TVM_REGISTER_GLOBAL("runtime.workspace_reset_peak").set_body_typed([](int device_type,
+                                                                      int device_id) {
+  ResetWorkspacePeak(Device{static_cast<DLDeviceType>(device_type), device_id});
+});
+
+TVM_REGISTER_GLOBAL("runtime.config_cpu_workspace_pool").set_body_typed([](int64_t cache_limit) {
+  ICHECK(UseSharedWorkspacePool()) << "The cache limit only applies to the shared workspace pool, "
+                                   << "set TVM_WORKSPACE_POOL_SHARED=1 to use it";
+  GetSharedCPUWorkspacePool()->SetCacheLimit(cache_limit);
+});
+
+TVM_REGISTER_GLOBAL("runtime.trim_cpu_workspace_pool").set_body_typed([](int device_id) {
+  if (UseSharedWorkspacePool()) {
+    GetSharedCPUWorkspacePool()->Trim(Device{kDLCPU, device_id});
+  }
+});
 }  // namespace runtime
 }  // namespace tvm
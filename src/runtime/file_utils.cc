@@ -24,12 +24,24 @@
 
 #include <dmlc/json.h>
 #include <dmlc/memory_io.h>
+#include <tvm/runtime/device_api.h>
 #include <tvm/runtime/logging.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/serializer.h>
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cstring>
 #include <fstream>
+#include <memory>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace tvm {
@@ -216,6 +228,173 @@ std::string SaveParams(const Map<String, NDArray>& params) {
   return bytes;
 }
 
+namespace {
+/*! \brief Page size assumed by the mapped params format, a multiple of the OS page size. */
+constexpr uint64_t kMappedParamsPageSize = 4096;
+
+uint64_t RoundUp(uint64_t value, uint64_t align) { return (value + align - 1) / align * align; }
+
+/*! \brief The DLPack context of a view into a mapped file. */
+struct MappedTensorContext {
+  std::shared_ptr<MappedFile> file;
+  std::vector<int64_t> shape;
+};
+
+void MappedTensorDeleter(DLManagedTensor* tensor) {
+  delete static_cast<MappedTensorContext*>(tensor->manager_ctx);
+  delete tensor;
+}
+}  // namespace
+
+MappedFile::MappedFile(const std::string& path) {
+#ifndef _WIN32
+  int fd = open(path.c_str(), O_RDONLY);
+  ICHECK_GE(fd, 0) << "Cannot open file " << path;
+  struct stat st;
+  ICHECK_EQ(fstat(fd, &st), 0) << "Cannot stat file " << path;
+  size_ = static_cast<size_t>(st.st_size);
+  if (size_ != 0) {
+    void* addr = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ICHECK(addr != MAP_FAILED) << "Cannot mmap file " << path;
+    data_ = static_cast<char*>(addr);
+  }
+  close(fd);
+#else
+  std::ifstream fs(path, std::ios::in | std::ios::binary);
+  ICHECK(!fs.fail()) << "Cannot open file " << path;
+  fs.seekg(0, std::ios::end);
+  size_ = static_cast<size_t>(fs.tellg());
+  fs.seekg(0, std::ios::beg);
+  buffer_ =
+      NDArray::Empty({static_cast<int64_t>(size_)}, DLDataType{kDLUInt, 8, 1}, Device{kDLCPU, 0});
+  data_ = static_cast<char*>(buffer_->data);
+  fs.read(data_, size_);
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifndef _WIN32
+  if (data_ != nullptr) munmap(data_, size_);
+#endif
+}
+
+void MappedFile::Release(size_t offset, size_t size) {
+#ifndef _WIN32
+  // Only whole pages inside the range can be dropped.
+  size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  size_t begin = (offset + page - 1) / page * page;
+  size_t end = std::min(offset + size, size_) / page * page;
+  if (data_ != nullptr && begin < end) madvise(data_ + begin, end - begin, MADV_DONTNEED);
+#endif
+}
+
+void SaveMappedParams(const std::string& path, const Map<String, NDArray>& params) {
+  ICHECK(DMLC_IO_NO_ENDIAN_SWAP) << "Mapped parameters are only supported on little-endian hosts";
+  std::vector<std::string> names;
+  std::vector<NDArray> arrays;
+  for (auto& p : params) {
+    names.push_back(p.first);
+    NDArray arr = p.second;
+    if (arr->device.device_type != kDLCPU) arr = arr.CopyTo(Device{kDLCPU, 0});
+    ICHECK(arr.IsContiguous()) << "Can only save contiguous parameters, " << p.first
+                               << " is not";
+    arrays.push_back(arr);
+  }
+
+  // The offsets in the table are relative to the start of the data section.
+  std::string table;
+  dmlc::MemoryStringStream table_strm(&table);
+  dmlc::Stream* strm = &table_strm;
+  std::vector<uint64_t> offsets;
+  uint64_t data_size = 0;
+  strm->Write(names);
+  strm->Write(static_cast<uint64_t>(arrays.size()));
+  for (const NDArray& arr : arrays) {
+    uint64_t nbytes = GetDataSize(*arr.operator->());
+    data_size = RoundUp(data_size, nbytes >= kMappedParamsPageSize ? kMappedParamsPageSize
+                                                                   : kAllocAlignment);
+    offsets.push_back(data_size);
+    std::vector<int64_t> shape(arr->shape, arr->shape + arr->ndim);
+    strm->Write(arr->dtype);
+    strm->Write(shape);
+    strm->Write(data_size);
+    strm->Write(nbytes);
+    data_size += nbytes;
+  }
+  uint64_t preamble[] = {kTVMMappedParamsMagic, kTVMMappedParamsVersion, 0, table.size()};
+  uint64_t data_offset = RoundUp(sizeof(preamble) + table.size(), kMappedParamsPageSize);
+  preamble[2] = data_offset;
+
+  std::ofstream fs(path, std::ios::out | std::ios::binary);
+  ICHECK(!fs.fail()) << "Cannot open " << path;
+  fs.write(reinterpret_cast<const char*>(preamble), sizeof(preamble));
+  fs.write(table.data(), table.size());
+  std::string padding(kMappedParamsPageSize, '\0');
+  uint64_t pos = sizeof(preamble) + table.size();
+  for (size_t i = 0; i < arrays.size(); ++i) {
+    uint64_t target = data_offset + offsets[i];
+    fs.write(padding.data(), target - pos);
+    uint64_t nbytes = GetDataSize(*arrays[i].operator->());
+    fs.write(static_cast<const char*>(arrays[i]->data) + arrays[i]->byte_offset, nbytes);
+    pos = target + nbytes;
+  }
+  ICHECK(!fs.fail()) << "Cannot write " << path;
+}
+
+Map<String, NDArray> LoadMappedParams(const std::string& path) {
+  ICHECK(DMLC_IO_NO_ENDIAN_SWAP) << "Mapped parameters are only supported on little-endian hosts";
+  auto file = std::make_shared<MappedFile>(path);
+  uint64_t preamble[4];
+  ICHECK_GE(file->size(), sizeof(preamble)) << "Invalid mapped parameters file " << path;
+  std::memcpy(preamble, file->data(), sizeof(preamble));
+  ICHECK_EQ(preamble[0], kTVMMappedParamsMagic) << "Invalid mapped parameters file " << path;
+  ICHECK_LE(preamble[1], kTVMMappedParamsVersion)
+      << "Mapped parameters file " << path << " has version " << preamble[1]
+      << ", which is newer than the supported version " << kTVMMappedParamsVersion;
+  uint64_t data_offset = preamble[2];
+  ICHECK_LE(sizeof(preamble) + preamble[3], data_offset) << "Invalid mapped parameters file";
+  ICHECK_LE(data_offset, file->size()) << "Invalid mapped parameters file";
+
+  dmlc::MemoryFixedSizeStream table_strm(file->data() + sizeof(preamble), preamble[3]);
+  dmlc::Stream* strm = &table_strm;
+  std::vector<std::string> names;
+  uint64_t size;
+  ICHECK(strm->Read(&names)) << "Invalid mapped parameters file";
+  ICHECK(strm->Read(&size)) << "Invalid mapped parameters file";
+  ICHECK_EQ(size, names.size()) << "Invalid mapped parameters file";
+  Map<String, NDArray> params;
+  for (size_t i = 0; i < size; ++i) {
+    DLDataType dtype;
+    std::vector<int64_t> shape;
+    uint64_t offset, nbytes;
+    ICHECK(strm->Read(&dtype) && strm->Read(&shape) && strm->Read(&offset) && strm->Read(&nbytes))
+        << "Invalid mapped parameters file";
+    ICHECK_LE(data_offset + offset + nbytes, file->size()) << "Truncated parameter " << names[i];
+    auto* ctx = new MappedTensorContext{file, std::move(shape)};
+    auto* tensor = new DLManagedTensor();
+    tensor->dl_tensor.data = file->data() + data_offset + offset;
+    tensor->dl_tensor.device = Device{kDLCPU, 0};
+    tensor->dl_tensor.ndim = static_cast<int>(ctx->shape.size());
+    tensor->dl_tensor.dtype = dtype;
+    tensor->dl_tensor.shape = ctx->shape.data();
+    tensor->dl_tensor.strides = nullptr;
+    tensor->dl_tensor.byte_offset = 0;
+    tensor->manager_ctx = ctx;
+    tensor->deleter = MappedTensorDeleter;
+    NDArray arr = NDArray::FromDLPack(tensor);
+    ICHECK_EQ(GetDataSize(*arr.operator->()), nbytes) << "Invalid parameter " << names[i];
+    params.Set(names[i], arr);
+  }
+  return params;
+}
+
+bool IsMappedParamsFile(const std::string& path) {
+  std::ifstream fs(path, std::ios::in | std::ios::binary);
+  uint64_t magic = 0;
+  fs.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  return !fs.fail() && magic == kTVMMappedParamsMagic;
+}
+
 TVM_REGISTER_GLOBAL("runtime.SaveParams").set_body_typed([](const Map<String, NDArray>& params) {
   std::string s = ::tvm::runtime::SaveParams(params);
   // copy return array so it is owned by the ret value
@@ -226,6 +405,8 @@ TVM_REGISTER_GLOBAL("runtime.SaveParams").set_body_typed([](const Map<String, ND
 TVM_REGISTER_GLOBAL("runtime.LoadParams").set_body_typed([](const String& s) {
   return ::tvm::runtime::LoadParams(s);
 });
+TVM_REGISTER_GLOBAL("runtime.SaveMappedParams").set_body_typed(SaveMappedParams);
+TVM_REGISTER_GLOBAL("runtime.LoadMappedParams").set_body_typed(LoadMappedParams);
 
 }  // namespace runtime
 }  // namespace tvm
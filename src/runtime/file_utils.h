@@ -121,6 +121,66 @@ std::string SaveParams(const Map<String, NDArray>& params);
  * \param params Parameters to save.
  */
 void SaveParams(dmlc::Stream* strm, const Map<String, NDArray>& params);
+
+/*!
+ * \brief A file mapped copy-on-write, or read into memory where mmap is not available.
+ *
+ *  Pages of the mapping are read on first access and can be reclaimed by the OS again
+ *  as long as they are not written.
+ */
+class MappedFile {
+ public:
+  /*! \param path The file to map. */
+  explicit MappedFile(const std::string& path);
+  ~MappedFile();
+
+  /*!
+   * \brief Drop the resident pages of a range which has not been written, they are read
+   *  from the file again on next access.
+   * \param offset The start of the range.
+   * \param size The size of the range.
+   */
+  void Release(size_t offset, size_t size);
+
+  char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+ private:
+  char* data_{nullptr};
+  size_t size_{0};
+#ifdef _WIN32
+  NDArray buffer_;
+#endif
+};
+
+constexpr uint64_t kTVMMappedParamsMagic = 0xF7E58D4F05049CB8;
+/*! \brief The version of the mapped parameters format written by SaveMappedParams. */
+constexpr uint64_t kTVMMappedParamsVersion = 1;
+/*!
+ * \brief Save parameters to a file that LoadMappedParams can map without copying.
+ *
+ *  The file starts with a table of names, dtypes, shapes and offsets, followed by the
+ *  raw data of every tensor, aligned so that each one can be used in place. Tensors of
+ *  at least a page start on a page boundary.
+ * \param path The file to write.
+ * \param params Parameters to save.
+ */
+void SaveMappedParams(const std::string& path, const Map<String, NDArray>& params);
+/*!
+ * \brief Map a file written by SaveMappedParams into memory.
+ *
+ *  The returned arrays are CPU views into a private mapping of the file, which keeps
+ *  the file mapped until the last of them is freed. Pages are read on first access
+ *  and shared between processes mapping the same file until they are written.
+ * \param path The file to map.
+ * \return Map of parameter name to parameter value.
+ */
+Map<String, NDArray> LoadMappedParams(const std::string& path);
+/*!
+ * \brief Check whether a file was written by SaveMappedParams.
+ * \param path The file to check.
+ */
+bool IsMappedParamsFile(const std::string& path);
 }  // namespace runtime
 }  // namespace tvm
 #endif  // TVM_RUNTIME_FILE_UTILS_H_
@@ -277,12 +277,13 @@ class GraphExecutorDebug : public GraphExecutor {
    * entire graph in order.
    *
    * \param collectors Optional user defined `MetricCollector`s to use with this profiling run.
+   * \param timeline Whether to record a timeline of the run.
    *
    * \returns A table of per-op runtimes and total times.
    */
-  profiling::Report Profile(Array<profiling::MetricCollector> collectors) {
+  profiling::Report Profile(Array<profiling::MetricCollector> collectors, bool timeline) {
     std::vector<profiling::MetricCollector> cs(collectors.begin(), collectors.end());
-    profiling::Profiler prof(devices_, cs);
+    profiling::Profiler prof(devices_, cs, timeline);
 
     // warm up. 1 iteration does not seem enough.
     for (int i = 0; i < 3; i++) {
@@ -362,23 +363,27 @@ PackedFunc GraphExecutorDebug::GetFunction(const std::string& name,
       ICHECK_GE(min_repeat_ms, 0);
       *rv = this->RunIndividual(number, repeat, min_repeat_ms);
     });
-  } else if (name == "profile") {
+  } else if (name == "profile" || name == "profile_timeline") {
+    // The *_timeline variants also record when each op ran, under names of their own so that
+    // existing callers keep their signatures.
+    bool timeline = name == "profile_timeline";
     return TypedPackedFunc<profiling::Report(Array<profiling::MetricCollector>)>(
-        [sptr_to_self, this](Array<profiling::MetricCollector> collectors) {
+        [sptr_to_self, this, timeline](Array<profiling::MetricCollector> collectors) {
           // We cannot send Arrays over rpc, so in order to support profiling
           // on remotes, we accept a nullptr for collectors.
           if (collectors.defined()) {
-            return this->Profile(collectors);
+            return this->Profile(collectors, timeline);
           } else {
-            return this->Profile({});
+            return this->Profile({}, timeline);
           }
         });
-  } else if (name == "profile_rpc") {
+  } else if (name == "profile_rpc" || name == "profile_rpc_timeline") {
     // We cannot return a Report over RPC because TMV RPC mechanism only
     // supports a subset of Object classes. Instead we serialize it on the
     // remote (here) and deserialize it on the other end.
-    return TypedPackedFunc<std::string()>([sptr_to_self, this]() {
-      PackedFunc profile = GetFunction("profile", sptr_to_self);
+    PackedFunc profile =
+        GetFunction(name == "profile_rpc" ? "profile" : "profile_timeline", sptr_to_self);
+    return TypedPackedFunc<std::string()>([profile]() {
       profiling::Report report = profile(Array<profiling::MetricCollector>());
       return report->AsJSON();
     });
@@ -31,17 +31,25 @@
 #include <tvm/runtime/profiling.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/serializer.h>
+#include <tvm/runtime/threading_backend.h>
 
 #include <algorithm>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <exception>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <string>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
 #include "../file_utils.h"
+#include "../sampling_profiler.h"
 
 namespace tvm {
 namespace runtime {
@@ -53,10 +61,119 @@ inline size_t GetDataAlignment(const DLTensor& arr) {
 }
 }  // namespace details
 
+/*!
+ * \brief Threads that run the operators of a graph as their dependencies complete.
+ */
+class InterOpPool {
+ public:
+  InterOpPool(int num_threads, int intra_op_threads) {
+    // Bind each thread and its intra-op workers to a slice of the cores of its own,
+    // left alone they would all pin themselves to the same first cores.
+    int num_cores = threading::MaxConcurrency();
+    for (int i = 0; i < num_threads; ++i) {
+      std::vector<unsigned int> cpus;
+      for (int j = 0; j < intra_op_threads; ++j) {
+        cpus.push_back(static_cast<unsigned int>((i * intra_op_threads + j) % num_cores));
+      }
+      threads_.emplace_back([this, intra_op_threads, cpus]() {
+        threading::ConfigureLocalThreads(intra_op_threads, cpus);
+        this->WorkerLoop();
+      });
+    }
+  }
+
+  ~InterOpPool() {
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      stop_ = true;
+    }
+    ready_cv_.notify_all();
+    for (std::thread& t : threads_) t.join();
+  }
+
+  /*!
+   * \brief Run every operator once and wait for all of them.
+   * \param op_execs The operator of each node, nodes without one are skipped.
+   * \param successors The operators that wait for each operator.
+   * \param num_deps The number of operators each operator waits for.
+   */
+  void Run(const std::vector<std::function<void()>>& op_execs,
+           const std::vector<std::vector<uint32_t>>& successors,
+           const std::vector<uint32_t>& num_deps) {
+    std::unique_lock<std::mutex> lock(mu_);
+    op_execs_ = &op_execs;
+    successors_ = &successors;
+    pending_deps_ = num_deps;
+    error_ = nullptr;
+    remaining_ = 0;
+    for (uint32_t nid = 0; nid < op_execs.size(); ++nid) {
+      if (!op_execs[nid]) continue;
+      ++remaining_;
+      if (num_deps[nid] == 0) ready_.push_back(nid);
+    }
+    if (remaining_ == 0) return;
+    ready_cv_.notify_all();
+    done_cv_.wait(lock, [this]() { return remaining_ == 0; });
+    if (error_ != nullptr) std::rethrow_exception(error_);
+  }
+
+ private:
+  void WorkerLoop() {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+      ready_cv_.wait(lock, [this]() { return stop_ || !ready_.empty(); });
+      if (stop_) return;
+      uint32_t nid = ready_.front();
+      ready_.pop_front();
+      // Once an operator failed, the rest are only drained so that Run returns.
+      bool skip = error_ != nullptr;
+      lock.unlock();
+      std::exception_ptr error = nullptr;
+      if (!skip) {
+        try {
+          (*op_execs_)[nid]();
+        } catch (...) {
+          error = std::current_exception();
+        }
+      }
+      lock.lock();
+      if (error != nullptr && error_ == nullptr) error_ = error;
+      for (uint32_t succ : (*successors_)[nid]) {
+        if (--pending_deps_[succ] == 0) {
+          ready_.push_back(succ);
+          ready_cv_.notify_one();
+        }
+      }
+      if (--remaining_ == 0) done_cv_.notify_all();
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mu_;
+  std::condition_variable ready_cv_;
+  std::condition_variable done_cv_;
+  /*! \brief The operators whose dependencies have all completed. */
+  std::deque<uint32_t> ready_;
+  std::vector<uint32_t> pending_deps_;
+  size_t remaining_{0};
+  const std::vector<std::function<void()>>* op_execs_{nullptr};
+  const std::vector<std::vector<uint32_t>>* successors_{nullptr};
+  std::exception_ptr error_{nullptr};
+  bool stop_{false};
+};
+
 /*!
  * \brief Run all the operations one by one.
  */
 void GraphExecutor::Run() {
+  if (sampling_profiler_ != nullptr && sampling_profiler_->BeginRun()) {
+    this->RunSampled();
+    return;
+  }
+  if (inter_op_pool_ != nullptr) {
+    inter_op_pool_->Run(op_execs_, op_successors_, op_num_deps_);
+    return;
+  }
   // setup the array and requirements.
   for (size_t i = 0; i < op_execs_.size(); ++i) {
     if (op_execs_[i]) op_execs_[i]();
@@ -87,6 +204,12 @@ void GraphExecutor::Init(const std::string& graph_json, tvm::runtime::Module mod
   }
   this->SetupStorage();
   this->SetupOpExecs();
+  if (const char* val = std::getenv("TVM_GRAPH_EXECUTOR_INTER_OP_THREADS")) {
+    this->SetInterOpThreads(atoi(val));
+  }
+  if (const char* val = std::getenv("TVM_SAMPLING_PROFILER_EVERY")) {
+    this->SetSamplingProfiler(atoll(val));
+  }
   for (size_t i = 0; i < input_nodes_.size(); i++) {
     const uint32_t nid = input_nodes_[i];
     std::string& name = nodes_[nid].name;
@@ -156,6 +279,15 @@ void GraphExecutor::SetInput(int index, DLTensor* data_in) {
   uint32_t eid = this->entry_id(input_nodes_[index], 0);
   data_entry_[eid].CopyFrom(data_in);
 }
+/*!
+ * \brief set index-th input to a parameter value.
+ * \param index The input index.
+ * \param data_in The parameter data.
+ */
+void GraphExecutor::SetParam(int index, DLTensor* data_in) {
+  this->SetInput(index, data_in);
+  param_input_indices_.insert(index);
+}
 /*!
  * \brief Check the legality of external DLTensor*.
  * \param external The external DLTensor*.
@@ -280,11 +412,41 @@ void GraphExecutor::LoadParams(dmlc::Stream* strm) {
     param_names_.insert(p.first);
     int in_idx = GetInputIndex(p.first);
     if (in_idx < 0) continue;
+    param_input_indices_.insert(in_idx);
     uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
     data_entry_[eid].CopyFrom(p.second);
   }
 }
 
+void GraphExecutor::LoadMappedParams(const std::string& path) {
+  Map<String, NDArray> params = ::tvm::runtime::LoadMappedParams(path);
+  std::vector<int> sid_uses(storage_pool_.size(), 0);
+  for (int sid : attrs_.storage_id) ++sid_uses[sid];
+  bool rebound = false;
+  for (auto& p : params) {
+    param_names_.insert(p.first);
+    int in_idx = GetInputIndex(p.first);
+    if (in_idx < 0) continue;
+    param_input_indices_.insert(in_idx);
+    uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
+    const DLTensor* entry = data_entry_[eid].operator->();
+    const DLTensor* mapped = p.second.operator->();
+    bool same_layout = entry->ndim == mapped->ndim &&
+                       DataType(entry->dtype) == DataType(mapped->dtype) &&
+                       std::equal(entry->shape, entry->shape + entry->ndim, mapped->shape);
+    if (entry->device.device_type != kDLCPU || !same_layout) {
+      data_entry_[eid].CopyFrom(p.second);
+      continue;
+    }
+    // Use the mapped tensor in place, and release the storage it replaces.
+    int sid = attrs_.storage_id[eid];
+    if (sid_uses[sid] == 1) storage_pool_[sid] = p.second;
+    data_entry_[eid] = p.second;
+    rebound = true;
+  }
+  if (rebound) this->SetupOpExecs();
+}
+
 void GraphExecutor::ShareParams(const GraphExecutor& other, dmlc::Stream* strm) {
   uint64_t header, reserved;
   ICHECK(strm->Read(&header)) << "Invalid parameters file format";
@@ -299,6 +461,7 @@ void GraphExecutor::ShareParams(const GraphExecutor& other, dmlc::Stream* strm)
   for (size_t i = 0; i < size; ++i) {
     int in_idx = GetInputIndex(names[i]);
     if (in_idx < 0) continue;
+    param_input_indices_.insert(in_idx);
     uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
     ICHECK_LT(eid, data_entry_.size());
     ICHECK_EQ(data_entry_[eid].use_count(), 1);
@@ -310,6 +473,103 @@ void GraphExecutor::ShareParams(const GraphExecutor& other, dmlc::Stream* strm)
   this->SetupOpExecs();
 }
 
+Module GraphExecutor::CreateSession() {
+  auto session = make_object<GraphExecutor>();
+  session->InitSession(*this, GetRef<Module>(this));
+  return Module(session);
+}
+
+void GraphExecutor::InitSession(const GraphExecutor& parent, Module parent_module) {
+  // A session of a session aliases the original parameters all the same.
+  parent_ = parent.parent_.defined() ? parent.parent_ : parent_module;
+  nodes_ = parent.nodes_;
+  input_nodes_ = parent.input_nodes_;
+  node_row_ptr_ = parent.node_row_ptr_;
+  outputs_ = parent.outputs_;
+  attrs_ = parent.attrs_;
+  module_ = parent.module_;
+  devices_ = parent.devices_;
+  param_names_ = parent.param_names_;
+  param_input_indices_ = parent.param_input_indices_;
+  input_map_ = parent.input_map_;
+  output_map_ = parent.output_map_;
+  lookup_linked_param_ = parent.lookup_linked_param_;
+  this->SetupStorage(&parent);
+  this->SetupOpExecs();
+  // Every session gets threads of its own, the pool of the parent runs one graph at a time.
+  this->SetInterOpThreads(parent.inter_op_threads_, parent.intra_op_threads_);
+  // The runs of every session go into the histograms of the parent.
+  sampling_profiler_ = parent.sampling_profiler_;
+  if (sampling_profiler_ != nullptr) this->SetupSampledOpExecs();
+}
+
+void GraphExecutor::SetInterOpThreads(int num_threads, int intra_op_threads) {
+  ICHECK_GE(num_threads, 0);
+  ICHECK_GE(intra_op_threads, 0);
+  inter_op_pool_ = nullptr;
+  inter_op_threads_ = num_threads;
+  intra_op_threads_ = intra_op_threads;
+  if (num_threads <= 1) return;
+  if (intra_op_threads == 0) {
+    intra_op_threads = std::max(1, threading::MaxConcurrency() / num_threads);
+  }
+  this->SetupOpDependencies();
+  inter_op_pool_ = std::make_shared<InterOpPool>(num_threads, intra_op_threads);
+}
+
+void GraphExecutor::SetSamplingProfiler(int64_t sample_every, double min_interval_ms,
+                                        double window_s) {
+  ICHECK_GE(sample_every, 0);
+  sampling_profiler_ = nullptr;
+  sampled_op_execs_.clear();
+  if (sample_every == 0) return;
+  std::vector<std::string> op_names;
+  for (const Node& node : nodes_) op_names.push_back(node.name);
+  SamplingProfiler::Config config;
+  config.sample_every = sample_every;
+  config.min_interval_ms = min_interval_ms;
+  config.window_s = window_s;
+  sampling_profiler_ = std::make_shared<SamplingProfiler>(std::move(op_names), config);
+  this->SetupSampledOpExecs();
+}
+
+std::string GraphExecutor::GetSamplingProfile() {
+  ICHECK(sampling_profiler_ != nullptr)
+      << "The sampling profiler is disabled, enable it with set_sampling_profiler";
+  return sampling_profiler_->ReportJSON();
+}
+
+void GraphExecutor::SetupSampledOpExecs() {
+  std::vector<Device> sync_devices;
+  for (const Device& dev : devices_) {
+    if (dev.device_type != kDLCPU) sync_devices.push_back(dev);
+  }
+  sampled_op_execs_.assign(op_execs_.size(), nullptr);
+  for (uint32_t nid = 0; nid < op_execs_.size(); ++nid) {
+    if (!op_execs_[nid]) continue;
+    // op_execs_ is looked up at run time, it is rebuilt when parameters are rebound.
+    sampled_op_execs_[nid] = [this, nid, sync_devices]() {
+      uint64_t start = SamplingProfiler::Now();
+      op_execs_[nid]();
+      // Kernels are asynchronous on accelerators, wait for them so the time is their own.
+      for (const Device& dev : sync_devices) DeviceAPI::Get(dev)->StreamSync(dev, nullptr);
+      sampling_profiler_->Record(nid, SamplingProfiler::Now() - start);
+    };
+  }
+}
+
+void GraphExecutor::RunSampled() {
+  uint64_t start = SamplingProfiler::Now();
+  if (inter_op_pool_ != nullptr) {
+    inter_op_pool_->Run(sampled_op_execs_, op_successors_, op_num_deps_);
+  } else {
+    for (const auto& op_exec : sampled_op_execs_) {
+      if (op_exec) op_exec();
+    }
+  }
+  sampling_profiler_->EndRun(SamplingProfiler::Now() - start);
+}
+
 void GraphExecutor::LinkedNDArrayDeleter(Object* container) {
   // container is the NDArray::Container which needs to get deleted.
   // The data member points to global const memory, so it does not need deleting.
@@ -347,13 +607,32 @@ void GraphExecutor::DefaultLookupLinkedParam(TVMArgs args, TVMRetValue* rv) {
   *rv = NDArray(GetObjectPtr<Object>(container));
 }
 
-void GraphExecutor::SetupStorage() {
+void GraphExecutor::SetupStorage(const GraphExecutor* parent) {
   // Grab saved optimization plan from graph.
   std::vector<DLDataType> vtype;
   for (const std::string& s_type : attrs_.dltype) {
     vtype.push_back(tvm::runtime::String2DLDataType(s_type));
   }
 
+  // When setting up a session, the entries holding parameters are aliased from the
+  // parent instead of being allocated again. A storage id is only shared when no
+  // other entry of the plan lives in it.
+  std::unordered_set<uint32_t> param_eids;
+  std::unordered_set<int> shared_sids;
+  if (parent != nullptr) {
+    for (uint32_t in_idx : param_input_indices_) {
+      uint32_t eid = this->entry_id(input_nodes_[in_idx], 0);
+      param_eids.insert(eid);
+      shared_sids.insert(attrs_.storage_id[eid]);
+    }
+    for (size_t i = 0; i < attrs_.storage_id.size(); ++i) {
+      if (param_eids.count(i) == 0) shared_sids.erase(attrs_.storage_id[i]);
+    }
+    for (auto it = param_eids.begin(); it != param_eids.end();) {
+      it = shared_sids.count(attrs_.storage_id[*it]) ? std::next(it) : param_eids.erase(it);
+    }
+  }
+
   // Size and device type of each storage pool entry.
   std::vector<PoolEntry> pool_entry;
   // Find the maximum space size.
@@ -398,14 +677,17 @@ void GraphExecutor::SetupStorage() {
   }
 
   // Allocate the space.
-  for (const auto& pit : pool_entry) {
+  for (size_t sid = 0; sid < pool_entry.size(); ++sid) {
+    const PoolEntry& pit = pool_entry[sid];
     // This for loop is very fast since there are usually only a couple of
     // devices available on the same hardware.
     const auto& cit = std::find_if(devices_.begin(), devices_.end(), [&pit](const Device& d) {
       return pit.device_type == static_cast<int>(d.device_type);
     });
     Device dev = cit == devices_.end() ? devices_[0] : *cit;
-    if (pit.linked_param.defined()) {
+    if (shared_sids.count(static_cast<int>(sid))) {
+      storage_pool_.push_back(parent->storage_pool_[sid]);
+    } else if (pit.linked_param.defined()) {
       storage_pool_.push_back(pit.linked_param);
     } else {
       std::vector<int64_t> shape;
@@ -422,18 +704,33 @@ void GraphExecutor::SetupStorage() {
   for (size_t i = 0; i < data_entry_.size(); ++i) {
     int storage_id = attrs_.storage_id[i];
     ICHECK_LT(static_cast<size_t>(storage_id), storage_pool_.size());
-    data_entry_[i] = storage_pool_[storage_id].CreateView(attrs_.shape[i], vtype[i]);
+    if (param_eids.count(i)) {
+      // The parent may hold parameters outside its pool after ShareParams.
+      data_entry_[i] = parent->data_entry_[i];
+    } else {
+      data_entry_[i] = storage_pool_[storage_id].CreateView(attrs_.shape[i], vtype[i]);
+    }
 
     const DLTensor* tmp = data_entry_[i].operator->();
     data_alignment_[i] = details::GetDataAlignment(*tmp);
   }
+
+  // Weights fed through SetInput are not known as parameters, and a parameter sharing its
+  // storage with other entries is not aliased, so these inputs take the parent's values.
+  if (parent != nullptr) {
+    for (uint32_t nid : input_nodes_) {
+      uint32_t eid = this->entry_id(nid, 0);
+      if (param_eids.count(eid) == 0) data_entry_[eid].CopyFrom(parent->data_entry_[eid]);
+    }
+  }
 }
 
 void GraphExecutor::SetupOpExecs() {
-  op_execs_.resize(this->GetNumOfNodes());
-  input_dltensors_.resize(num_node_entries());
-  output_dltensors_.resize(num_node_entries());
-  both_output_opinput_dltensors_.resize(num_node_entries());
+  // Called again when parameters are rebound, drop the pointers into the old arguments.
+  op_execs_.assign(this->GetNumOfNodes(), nullptr);
+  input_dltensors_.assign(num_node_entries(), {});
+  output_dltensors_.assign(num_node_entries(), {});
+  both_output_opinput_dltensors_.assign(num_node_entries(), {});
   std::unordered_set<uint32_t> input_node_eids;
   for (size_t i = 0; i < input_nodes_.size(); i++) {
     uint32_t nid = input_nodes_[i];
@@ -487,6 +784,49 @@ void GraphExecutor::SetupOpExecs() {
   }
 }
 
+void GraphExecutor::SetupOpDependencies() {
+  // Per storage entry, the last operator that wrote it and the readers since then.
+  std::vector<int64_t> last_writer(storage_pool_.size(), -1);
+  std::vector<std::vector<uint32_t>> readers(storage_pool_.size());
+  std::vector<std::vector<uint32_t>> deps(this->GetNumOfNodes());
+  auto add_dep = [&](uint32_t nid, int64_t dep) {
+    if (dep < 0 || static_cast<uint32_t>(dep) == nid || !op_execs_[dep]) return;
+    deps[nid].push_back(static_cast<uint32_t>(dep));
+  };
+  for (uint32_t nid = 0; nid < this->GetNumOfNodes(); ++nid) {
+    const auto& inode = nodes_[nid];
+    if (!op_execs_[nid]) continue;
+    for (const auto& e : inode.inputs) add_dep(nid, e.node_id);
+    for (uint32_t dep : inode.control_deps) add_dep(nid, dep);
+    // A nop aliases its input, it neither reads nor writes the storage.
+    if (inode.param.func_name == "__nop") continue;
+    // The storage plan reuses an entry once its tensor is dead in topological order. When
+    // operators run out of order, the next writer must still wait for the old tensor.
+    for (uint32_t index = 0; index < inode.param.num_outputs; ++index) {
+      int sid = attrs_.storage_id[this->entry_id(nid, index)];
+      add_dep(nid, last_writer[sid]);
+      for (uint32_t reader : readers[sid]) add_dep(nid, reader);
+    }
+    for (const auto& e : inode.inputs) {
+      readers[attrs_.storage_id[this->entry_id(e)]].push_back(nid);
+    }
+    for (uint32_t index = 0; index < inode.param.num_outputs; ++index) {
+      int sid = attrs_.storage_id[this->entry_id(nid, index)];
+      last_writer[sid] = nid;
+      readers[sid].clear();
+    }
+  }
+
+  op_successors_.assign(this->GetNumOfNodes(), {});
+  op_num_deps_.assign(this->GetNumOfNodes(), 0);
+  for (uint32_t nid = 0; nid < this->GetNumOfNodes(); ++nid) {
+    std::sort(deps[nid].begin(), deps[nid].end());
+    deps[nid].erase(std::unique(deps[nid].begin(), deps[nid].end()), deps[nid].end());
+    op_num_deps_[nid] = static_cast<uint32_t>(deps[nid].size());
+    for (uint32_t dep : deps[nid]) op_successors_[dep].push_back(nid);
+  }
+}
+
 std::pair<std::function<void()>, std::shared_ptr<GraphExecutor::OpArgs> >
 GraphExecutor::CreateTVMOp(const TVMOpParam& param, const std::vector<DLTensor>& args) {
   std::shared_ptr<GraphExecutor::OpArgs> arg_ptr = std::make_shared<GraphExecutor::OpArgs>();
@@ -627,6 +967,10 @@ PackedFunc GraphExecutor::GetFunction(const std::string& name,
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       this->LoadParams(args[0].operator std::string());
     });
+  } else if (name == "load_mapped_params") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      this->LoadMappedParams(args[0].operator std::string());
+    });
   } else if (name == "share_params") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       const auto& module = args[0].operator Module();
@@ -635,6 +979,24 @@ PackedFunc GraphExecutor::GetFunction(const std::string& name,
       dmlc::MemoryStringStream strm(const_cast<std::string*>(&param_blob));
       this->ShareParams(dynamic_cast<const GraphExecutor&>(*module.operator->()), &strm);
     });
+  } else if (name == "set_inter_op_threads") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int intra_op_threads = args.num_args > 1 ? args[1].operator int() : 0;
+      this->SetInterOpThreads(args[0], intra_op_threads);
+    });
+  } else if (name == "set_sampling_profiler") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      double min_interval_ms = args.num_args > 1 ? args[1].operator double() : 0;
+      double window_s = args.num_args > 2 ? args[2].operator double() : 60;
+      this->SetSamplingProfiler(args[0], min_interval_ms, window_s);
+    });
+  } else if (name == "get_sampling_profile") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetSamplingProfile(); });
+  } else if (name == "create_session") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      *rv = this->CreateSession();
+    });
   } else if (name == "get_input_index") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
       CHECK(String::CanConvertFrom(args[0])) << "Input key is not a string";
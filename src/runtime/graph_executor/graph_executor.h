@@ -58,6 +58,9 @@ struct TVMOpParam {
   uint32_t flatten_data;
 };
 
+class InterOpPool;
+class SamplingProfiler;
+
 /*!
  * \brief Tiny graph executor.
  *
@@ -89,6 +92,37 @@ class TVM_DLL GraphExecutor : public ModuleNode {
   const char* type_key() const final { return "GraphExecutor"; }
   void Run();
 
+  /*!
+   * \brief Run independent operators of the graph at the same time.
+   *
+   *  Operators are scheduled from a ready-queue over the dataflow graph of the nodes.
+   *  Besides the data dependencies, an operator writing a storage entry also waits for
+   *  every reader and writer of the previous tensor planned into that entry, so the
+   *  storage plan stays valid under any interleaving. Each thread is bound to a slice of
+   *  the cores of its own, and sessions created afterwards get threads with the same setting.
+   * \param num_threads The number of operators run at once, 0 or 1 to run them one by one
+   *  on the calling thread.
+   * \param intra_op_threads The number of threads each of them uses for its own parallel
+   *  loops, 0 to split the cores evenly between them.
+   */
+  void SetInterOpThreads(int num_threads, int intra_op_threads = 0);
+
+  /*!
+   * \brief Time the operators of one run out of every sample_every, and keep rolling
+   *  histograms of their durations. Runs that are not sampled are not slowed down.
+   * \param sample_every Sample one run out of this many, 0 to stop sampling.
+   * \param min_interval_ms The least time between two sampled runs, 0 for no limit.
+   * \param window_s The histograms cover the samples of the last one to two windows.
+   */
+  void SetSamplingProfiler(int64_t sample_every, double min_interval_ms = 0,
+                           double window_s = 60);
+
+  /*!
+   * \brief Get the runs and the mean, p50, p95 and p99 duration of each operator.
+   * \return The report as a JSON object.
+   */
+  std::string GetSamplingProfile();
+
   /*!
    * \brief Initialize the graph executor with graph and device.
    * \param graph_json The execution graph.
@@ -136,6 +170,12 @@ class TVM_DLL GraphExecutor : public ModuleNode {
    * \param data_ref The input data that is referred.
    */
   void SetInputZeroCopy(int index, DLTensor* data_ref);
+  /*!
+   * \brief set index-th input to a parameter value, which sessions created later alias.
+   * \param index The input index.
+   * \param data_in The parameter data.
+   */
+  void SetParam(int index, DLTensor* data_in);
   /*!
    * \brief set index-th output to the graph without copying the data.
    * \param index The output index.
@@ -184,6 +224,14 @@ class TVM_DLL GraphExecutor : public ModuleNode {
    * \param param_blob A binary blob of parameter.
    */
   void LoadParams(const std::string& param_blob);
+  /*!
+   * \brief Load parameters from a file written by SaveMappedParams.
+   *
+   *  Parameters of CPU inputs are used in place from the mapping of the file, without
+   *  reading or copying them, others are copied to their device.
+   * \param path The parameter file.
+   */
+  void LoadMappedParams(const std::string& path);
 
   /*!
    * \brief Share parameters from pre-existing GraphExecutor instance.
@@ -193,6 +241,20 @@ class TVM_DLL GraphExecutor : public ModuleNode {
    */
   void ShareParams(const GraphExecutor& other, dmlc::Stream* strm);
 
+  /*!
+   * \brief Create a session that runs the same graph with its own activations.
+   *
+   *  The session is a GraphExecutor over the same code module that aliases the
+   *  parameters loaded into this executor and allocates a fresh arena, from the same
+   *  storage plan, for every other storage entry. Sessions can run concurrently with
+   *  each other and with this executor, so N threads serving one model cost
+   *  params + N x activations. Parameters must be loaded before the session is created.
+   *  Every other input starts out as a copy of its value in this executor, so weights
+   *  given through SetInput are taken over, though later changes to them are not.
+   * \return The session module.
+   */
+  Module CreateSession();
+
   /*!
    * \brief Get total number of nodes.
    * \return Total number of nodes.
@@ -399,10 +461,22 @@ class TVM_DLL GraphExecutor : public ModuleNode {
   void DefaultLookupLinkedParam(TVMArgs args, TVMRetValue* rv);
   /*! \brief Delete NDArray::Container with linked (i.e. static) data. */
   static void LinkedNDArrayDeleter(Object* container);
-  /*! \brief Setup the temporal storage */
-  void SetupStorage();
+  /*!
+   * \brief Setup the temporal storage.
+   * \param parent If given, alias its parameter storage instead of allocating it, and copy
+   *  the values of the inputs which are not aliased.
+   */
+  void SetupStorage(const GraphExecutor* parent = nullptr);
   /*! \brief Setup the executors. */
   void SetupOpExecs();
+  /*! \brief Build the dependencies between operators used by the inter-op parallel mode. */
+  void SetupOpDependencies();
+  /*! \brief Build the operators of sampled runs, which time the ones in op_execs_. */
+  void SetupSampledOpExecs();
+  /*! \brief Run the operators and record their durations. */
+  void RunSampled();
+  /*! \brief Copy the graph of parent and set up own activations for a session. */
+  void InitSession(const GraphExecutor& parent, Module parent_module);
   /*!
    * \brief Check the legality of external DLTensor*.
    * \param external The external DLTensor*.
@@ -429,6 +503,8 @@ class TVM_DLL GraphExecutor : public ModuleNode {
   std::vector<uint32_t> input_nodes_;
   /*! \brief The parameter names. */
   std::unordered_set<std::string> param_names_;
+  /*! \brief Indices of the inputs that hold parameters, aliased by sessions. */
+  std::unordered_set<uint32_t> param_input_indices_;
   /*! \brief Map of input names to input indices. */
   std::unordered_map<std::string, uint32_t> input_map_;
   /*! \brief Map of output names to output indices. */
@@ -457,6 +533,19 @@ class TVM_DLL GraphExecutor : public ModuleNode {
   std::vector<size_t> data_alignment_;
   /*! \brief Operator on each node. */
   std::vector<std::function<void()>> op_execs_;
+  /*! \brief The operators that wait for each operator in the inter-op parallel mode. */
+  std::vector<std::vector<uint32_t>> op_successors_;
+  /*! \brief The number of operators each operator waits for. */
+  std::vector<uint32_t> op_num_deps_;
+  /*! \brief The workers of the inter-op parallel mode, null when it is disabled. */
+  std::shared_ptr<InterOpPool> inter_op_pool_;
+  /*! \brief The arguments of the last SetInterOpThreads, which sessions inherit. */
+  int inter_op_threads_{0};
+  int intra_op_threads_{0};
+  /*! \brief The profiler of sampled runs, shared with sessions, null when it is disabled. */
+  std::shared_ptr<SamplingProfiler> sampling_profiler_;
+  /*! \brief The operators run instead of op_execs_ by sampled runs. */
+  std::vector<std::function<void()>> sampled_op_execs_;
   /*! \brief Linked parameter lookup function. */
   PackedFunc lookup_linked_param_;
   /*! \brief Module's _lookup_linked_param function, used by DefaultLookupLinkedParam. */
@@ -466,6 +555,8 @@ class TVM_DLL GraphExecutor : public ModuleNode {
    * When the module does not include linked parmeters, module_lookup_linked_param_ will be nullptr.
    */
   bool module_lookup_linked_param_valid_;
+  /*! \brief The executor whose parameters this session aliases, undefined if not a session. */
+  Module parent_;
 };
 
 std::vector<Device> GetAllDevice(const TVMArgs& args, int dev_start_arg);
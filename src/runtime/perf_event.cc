@@ -0,0 +1,296 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file src/runtime/perf_event.cc
+ * \brief Metric collector reading CPU performance counters with Linux perf_event.
+ */
+#include <tvm/runtime/logging.h>
+#include <tvm/runtime/profiling.h>
+#include <tvm/runtime/registry.h>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace profiling {
+
+namespace {
+
+/*! \brief Counter values of the CPU at the start of a call. */
+struct PerfEventStartNode : public Object {
+  /*! \brief Value, time enabled and time running of each counter. */
+  std::vector<uint64_t> values;
+  std::chrono::steady_clock::time_point start;
+
+  static constexpr const char* _type_key = "PerfEventStartNode";
+  TVM_DECLARE_FINAL_OBJECT_INFO(PerfEventStartNode, Object);
+};
+
+/*! \brief An event to count and the metric it is reported as. */
+struct PerfEventCounter {
+  std::string name;
+  uint32_t type;
+  uint64_t config;
+  // FLOPs per event for the events counting floating point instructions, 0 otherwise.
+  int64_t flops;
+  int fd;
+};
+
+#if defined(__linux__)
+const std::vector<std::pair<std::string, uint64_t>>& HardwareEvents() {
+  static const std::vector<std::pair<std::string, uint64_t>> events = {
+      {"Cycles", PERF_COUNT_HW_CPU_CYCLES},
+      {"Instructions", PERF_COUNT_HW_INSTRUCTIONS},
+      {"Cache References", PERF_COUNT_HW_CACHE_REFERENCES},
+      {"Cache Misses", PERF_COUNT_HW_CACHE_MISSES},
+      {"Branches", PERF_COUNT_HW_BRANCH_INSTRUCTIONS},
+      {"Branch Misses", PERF_COUNT_HW_BRANCH_MISSES},
+      {"Stalled Cycles Frontend", PERF_COUNT_HW_STALLED_CYCLES_FRONTEND},
+      {"Stalled Cycles Backend", PERF_COUNT_HW_STALLED_CYCLES_BACKEND}};
+  return events;
+}
+
+// Parse "r<hex>" into a raw event code.
+bool ParseRawEvent(const std::string& name, uint64_t* config) {
+  if (name.size() < 2 || name[0] != 'r') return false;
+  char* end = nullptr;
+  *config = std::strtoull(name.c_str() + 1, &end, 16);
+  return *end == '\0';
+}
+
+std::string ParanoidLevel() {
+  std::ifstream file("/proc/sys/kernel/perf_event_paranoid");
+  std::string level;
+  if (!(file >> level)) return "unknown";
+  return level;
+}
+#endif
+
+}  // namespace
+
+/*! \brief MetricCollectorNode for the hardware counters of the CPU.
+ *
+ * Counters are opened on the thread calling `Init` and inherited by the
+ * threads it creates afterwards, which includes the thread pool as the
+ * profiler resets it. A call is measured by the difference of the counters
+ * between `Start` and `Stop`, scaled up when the kernel had to multiplex them.
+ * Workers of the shared thread pool, which outlive the reset, are not counted.
+ */
+struct PerfEventMetricCollectorNode final : public MetricCollectorNode {
+  PerfEventMetricCollectorNode(Array<String> metrics, Array<String> flop_events) {
+    if (metrics.empty()) {
+      metrics = {"Cycles", "Instructions", "Cache Misses", "Branches", "Branch Misses"};
+    }
+    for (const String& metric : metrics) metric_names.push_back(metric);
+    for (const String& event : flop_events) flop_event_names.push_back(event);
+  }
+
+  void Init(Array<DeviceWrapper> devices) final {
+#if defined(__linux__)
+    std::vector<PerfEventCounter> wanted;
+    for (const std::string& name : metric_names) {
+      bool found = false;
+      for (const auto& event : HardwareEvents()) {
+        if (event.first == name) {
+          wanted.push_back({name, PERF_TYPE_HARDWARE, event.second, 0, -1});
+          found = true;
+        }
+      }
+      uint64_t config;
+      if (!found && ParseRawEvent(name, &config)) {
+        wanted.push_back({name, PERF_TYPE_RAW, config, 0, -1});
+        found = true;
+      }
+      CHECK(found) << "Unknown perf_event metric \"" << name << "\"";
+    }
+    for (const std::string& spec : flop_event_names) {
+      size_t star = spec.find('*');
+      uint64_t config;
+      CHECK(star != std::string::npos && ParseRawEvent(spec.substr(0, star), &config))
+          << "FLOP events are written r<hex code>*<flops per instruction>, got \"" << spec
+          << "\"";
+      int64_t flops = std::stoll(spec.substr(star + 1));
+      wanted.push_back({spec.substr(0, star), PERF_TYPE_RAW, config, flops, -1});
+    }
+
+    for (PerfEventCounter& counter : wanted) {
+      perf_event_attr attr;
+      std::memset(&attr, 0, sizeof(attr));
+      attr.size = sizeof(attr);
+      attr.type = counter.type;
+      attr.config = counter.config;
+      attr.inherit = 1;
+      attr.exclude_kernel = 1;
+      attr.exclude_hv = 1;
+      attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      counter.fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+      if (counter.fd < 0) {
+        int err = errno;
+        if (err == EACCES || err == EPERM) {
+          LOG(WARNING) << "No permission to read the performance counter " << counter.name
+                       << " (perf_event_paranoid is " << ParanoidLevel() << "). Try setting "
+                       << "`sudo sh -c 'echo 2 >/proc/sys/kernel/perf_event_paranoid'`.";
+        } else {
+          LOG(WARNING) << "The performance counter " << counter.name
+                       << " is not available on this machine: " << std::strerror(err);
+        }
+        continue;
+      }
+      counters.push_back(counter);
+    }
+    if (!devices.empty() && counters.empty()) {
+      LOG(WARNING) << "No performance counter could be opened, perf_event metrics are skipped";
+    }
+    long line_size = sysconf(_SC_LEVEL1_DCACHE_LINESIZE);  // NOLINT(runtime/int)
+    if (line_size > 0) cache_line_bytes = line_size;
+#else
+    LOG(WARNING) << "perf_event performance counters are only available on Linux";
+#endif
+  }
+
+  ObjectRef Start(Device dev) final {
+    if (dev.device_type != kDLCPU || counters.empty()) return ObjectRef(nullptr);
+    auto node = make_object<PerfEventStartNode>();
+    node->values = ReadCounters();
+    node->start = std::chrono::steady_clock::now();
+    return ObjectRef(node);
+  }
+
+  Map<String, ObjectRef> Stop(ObjectRef obj) final {
+    const PerfEventStartNode* start = obj.as<PerfEventStartNode>();
+    std::vector<uint64_t> end = ReadCounters();
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start->start).count();
+
+    std::unordered_map<std::string, double> counts;
+    Map<String, ObjectRef> metrics;
+    int64_t flops = 0;
+    bool have_flops = false;
+    for (size_t i = 0; i < counters.size(); ++i) {
+      uint64_t value = end[3 * i] - start->values[3 * i];
+      uint64_t enabled = end[3 * i + 1] - start->values[3 * i + 1];
+      uint64_t running = end[3 * i + 2] - start->values[3 * i + 2];
+      // Multiplexed counters only ran part of the time, extrapolate to the whole call.
+      double count = running == 0 ? 0 : static_cast<double>(value) * enabled / running;
+      if (counters[i].flops != 0) {
+        flops += static_cast<int64_t>(count) * counters[i].flops;
+        have_flops = true;
+      } else {
+        counts[counters[i].name] = count;
+        metrics.Set(counters[i].name,
+                    ObjectRef(make_object<CountNode>(static_cast<int64_t>(count))));
+      }
+    }
+
+    // Derived metrics, when the counters they need were read.
+    if (counts.count("Cycles") && counts.count("Instructions") && counts["Cycles"] > 0) {
+      metrics.Set("IPC",
+                  ObjectRef(make_object<RatioNode>(counts["Instructions"] / counts["Cycles"])));
+    }
+    if (counts.count("Branches") && counts.count("Branch Misses") && counts["Branches"] > 0) {
+      metrics.Set("Branch Miss Rate", ObjectRef(make_object<PercentNode>(
+                                          100 * counts["Branch Misses"] / counts["Branches"])));
+    }
+    if (have_flops) metrics.Set("FLOPs", ObjectRef(make_object<CountNode>(flops)));
+    if (counts.count("Cache Misses")) {
+      // Each miss of the last level cache moves one line from or to memory.
+      double bytes = counts["Cache Misses"] * cache_line_bytes;
+      metrics.Set("Memory Bytes", ObjectRef(make_object<CountNode>(static_cast<int64_t>(bytes))));
+      if (seconds > 0) {
+        metrics.Set("Memory Bandwidth (GB/s)",
+                    ObjectRef(make_object<RatioNode>(bytes / seconds / 1e9)));
+      }
+      if (have_flops && flops > 0) {
+        metrics.Set("Bytes/FLOP", ObjectRef(make_object<RatioNode>(bytes / flops)));
+      }
+    }
+    return metrics;
+  }
+
+  ~PerfEventMetricCollectorNode() final {
+#if defined(__linux__)
+    for (const PerfEventCounter& counter : counters) close(counter.fd);
+#endif
+  }
+
+  /*! \brief Names of the counters to read. */
+  std::vector<std::string> metric_names;
+  /*! \brief Raw events counting floating point instructions and their weight. */
+  std::vector<std::string> flop_event_names;
+  /*! \brief The counters which could be opened. */
+  std::vector<PerfEventCounter> counters;
+  /*! \brief Bytes moved by a cache miss. */
+  int64_t cache_line_bytes{64};
+
+  static constexpr const char* _type_key = "runtime.profiling.PerfEventMetricCollector";
+  TVM_DECLARE_FINAL_OBJECT_INFO(PerfEventMetricCollectorNode, MetricCollectorNode);
+
+ private:
+  std::vector<uint64_t> ReadCounters() const {
+    std::vector<uint64_t> values(3 * counters.size(), 0);
+#if defined(__linux__)
+    for (size_t i = 0; i < counters.size(); ++i) {
+      // With inherit set, the kernel adds up the counts of the threads created since Init.
+      if (read(counters[i].fd, &values[3 * i], 3 * sizeof(uint64_t)) !=
+          static_cast<ssize_t>(3 * sizeof(uint64_t))) {
+        LOG(WARNING) << "Could not read the performance counter " << counters[i].name;
+      }
+    }
+#endif
+    return values;
+  }
+};
+
+/*! \brief Wrapper for `PerfEventMetricCollectorNode`. */
+class PerfEventMetricCollector : public MetricCollector {
+ public:
+  PerfEventMetricCollector(Array<String> metrics, Array<String> flop_events) {
+    data_ = make_object<PerfEventMetricCollectorNode>(metrics, flop_events);
+  }
+  TVM_DEFINE_MUTABLE_OBJECT_REF_METHODS(PerfEventMetricCollector, MetricCollector,
+                                        PerfEventMetricCollectorNode);
+};
+
+MetricCollector CreatePerfEventMetricCollector(Array<String> metrics, Array<String> flop_events) {
+  return PerfEventMetricCollector(metrics, flop_events);
+}
+
+TVM_REGISTER_OBJECT_TYPE(PerfEventStartNode);
+TVM_REGISTER_OBJECT_TYPE(PerfEventMetricCollectorNode);
+
+TVM_REGISTER_GLOBAL("runtime.profiling.PerfEventMetricCollector")
+    .set_body_typed(CreatePerfEventMetricCollector);
+
+}  // namespace profiling
+}  // namespace runtime
+}  // namespace tvm
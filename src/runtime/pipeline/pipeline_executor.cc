@@ -76,12 +76,27 @@ PackedFunc PipelineExecutor::GetFunction(const std::string& name,
     });
   } else if (name == "get_output") {
     return PackedFunc(
-        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetOutput(); });
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+          int64_t timeout_ms = args.num_args > 0 ? args[0].operator int64_t() : 0;
+          *rv = this->GetOutput(timeout_ms);
+        });
   } else if (name == "run") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { this->Run(); });
+  } else if (name == "try_run") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->TryRun(); });
+  } else if (name == "get_queue_stats") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetQueueStats(); });
   } else if (name == "get_execute_count") {
     return PackedFunc(
         [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetExecutionCount(); });
+  } else if (name == "get_stage_profile") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetStageProfile(); });
+  } else if (name == "reset_stage_profile") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { this->ResetStageProfile(); });
   } else {
     LOG(FATAL) << "Unknown packed function: " << name;
     return PackedFunc();
@@ -142,10 +157,46 @@ int PipelineExecutor::GetParamsGroupPipelineMap(const std::string& name) {
 
 /*!\brief Run the pipeline executor.*/
 void PipelineExecutor::Run() { pipeline_scheduler_.PipelineRun(runtimes_, pipeline_config_); }
+/*!\brief Run the pipeline executor when the request does not have to wait.*/
+bool PipelineExecutor::TryRun() {
+  return pipeline_scheduler_.PipelineTryRun(runtimes_, pipeline_config_);
+}
 /*!
  * \brief return A list of global output data.
  */
-Array<NDArray> PipelineExecutor::GetOutput(void) { return pipeline_scheduler_.PipelineGetOutput(); }
+Array<NDArray> PipelineExecutor::GetOutput(int64_t timeout_ms) {
+  return pipeline_scheduler_.PipelineGetOutput(timeout_ms);
+}
+/*!
+ * \brief Getting the counters of every queue forwarding data between the runtimes and to the
+ *  global outputs.
+ */
+std::string PipelineExecutor::GetQueueStats() {
+  std::ostringstream os;
+  os << "[";
+  bool first = true;
+  for (auto runtime : runtimes_) {
+    runtime->VisitOutputQueues([&](int output_idx, const std::shared_ptr<ForwardQueue>& queue) {
+      SPSCQueueStats stats = queue->GetStats();
+      ModuleInterfaceID id = queue->GetID();
+      double pushes = std::max<int64_t>(stats.num_pushes, 1);
+      double polls = std::max<int64_t>(stats.num_polls, 1);
+      os << (first ? "" : ", ") << "{\"mod_idx\": " << runtime->GetModuleIndex()
+         << ", \"output_idx\": " << output_idx << ", \"child_mod_idx\": " << id.runtime_idx
+         << ", \"child_input_idx\": " << id.runtime_interface_idx
+         << ", \"capacity\": " << stats.capacity << ", \"pushes\": " << stats.num_pushes
+         << ", \"mean_occupancy\": " << stats.occupancy_sum / pushes
+         << ", \"max_occupancy\": " << stats.max_occupancy
+         << ", \"blocked_pushes\": " << stats.num_blocked_pushes
+         << ", \"blocked_us\": " << stats.blocked_ns * 1e-3
+         << ", \"mean_wait_us\": " << stats.wait_ns * 1e-3 / polls
+         << ", \"max_wait_us\": " << stats.max_wait_ns * 1e-3 << "}";
+      first = false;
+    });
+  }
+  os << "]";
+  return os.str();
+}
 /*!
  * \brief Use the mod_config information to create a graph runtime list.
  * \param mod_config The config information that generates by the export library function call.
@@ -234,6 +285,45 @@ std::pair<int, int> PipelineExecutor::GetInputIndex(const std::string& name) {
  * \brief Getting the count of running pipeline.
  */
 int PipelineExecutor::GetExecutionCount() { return runtimes_.back()->GetExecutionCount(); }
+/*!
+ * \brief Getting the timing of every backend runtime. The time per request of the slowest
+ *  stage bounds the throughput of the whole pipeline.
+ */
+std::string PipelineExecutor::GetStageProfile() {
+  std::ostringstream os;
+  os << "{\"stages\": [";
+  int bottleneck = -1;
+  double bound = 0, serial = 0;
+  for (size_t i = 0; i < runtimes_.size(); i++) {
+    StageProfile profile = runtimes_[i]->GetProfile();
+    double per_request =
+        profile.num_requests ? (profile.run_time + profile.forward_time) / profile.num_requests
+                             : 0;
+    if (per_request > bound) {
+      bound = per_request;
+      bottleneck = static_cast<int>(i);
+    }
+    serial += per_request;
+    os << (i ? ", " : "") << "{\"mod_idx\": " << i
+       << ", \"micro_batch\": " << runtimes_[i]->GetMicroBatch()
+       << ", \"runs\": " << profile.num_runs << ", \"requests\": " << profile.num_requests
+       << ", \"run_us\": " << profile.run_time * 1e6
+       << ", \"forward_us\": " << profile.forward_time * 1e6
+       << ", \"wait_us\": " << profile.wait_time * 1e6
+       << ", \"per_request_us\": " << per_request * 1e6 << "}";
+  }
+  os << "], \"bottleneck\": " << bottleneck << ", \"bound_us\": " << bound * 1e6
+     << ", \"serial_us\": " << serial * 1e6 << "}";
+  return os.str();
+}
+/*!
+ * \brief Resetting the timing of every backend runtime.
+ */
+void PipelineExecutor::ResetStageProfile() {
+  for (auto runtime : runtimes_) {
+    runtime->ResetProfile();
+  }
+}
 /*!
  * \brief Initialize the pipeline executor with a list of modules to be pipelined
  *  and config in JSON format.
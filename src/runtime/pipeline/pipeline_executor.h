@@ -27,6 +27,7 @@
 #include <tvm/relay/expr.h>
 #include <tvm/runtime/registry.h>
 
+#include <algorithm>
 #include <array>
 #include <iostream>
 #include <memory>
@@ -99,6 +100,14 @@ class TVM_DLL PipelineExecutor : public ModuleNode {
    * \brief Getting the count of running pipeline.
    */
   int GetExecutionCount();
+  /*!
+   * \brief Get the timing of every backend runtime, for balancing the pipeline stages.
+   * \return A JSON object with the per stage timing, the bottleneck stage, the throughput bound
+   *  per request set by the bottleneck and the latency of running the stages serially.
+   */
+  std::string GetStageProfile();
+  /*!\brief Reset the timing of every backend runtime.*/
+  void ResetStageProfile();
   /*!
    * \brief Use the parameters group name to get the specific backend runtime then use
    *  the param_key_name to set param data for the said backend runtime.
@@ -115,11 +124,24 @@ class TVM_DLL PipelineExecutor : public ModuleNode {
   int NumOutputs() const { return num_outputs_; }
   /*!\brief Run the pipeline executor.*/
   void Run();
+  /*!
+   * \brief Run the pipeline executor only when the request can enter the pipeline without
+   *  waiting for a later stage to catch up.
+   * \return Return false when the pipeline is full and the request was not run.
+   */
+  bool TryRun();
   /*!
    * \brief Get a list output data.
+   * \param timeout_ms The longest time to wait for the output in milliseconds, zero to not
+   *  wait and a negative value to wait until the output is ready.
    * \return A list of output data.
    */
-  Array<NDArray> GetOutput();
+  Array<NDArray> GetOutput(int64_t timeout_ms = 0);
+  /*!
+   * \brief Get the occupancy and wait time of every forwarding queue.
+   * \return A JSON list with one object per queue.
+   */
+  std::string GetQueueStats();
   /*!
    * \brief A pipeline params with a specific name correspond with the params of a specific
    *  backend module, this function return the module index for the params name.
@@ -36,6 +36,7 @@ std::vector<std::shared_ptr<BackendRuntime>> PipelineScheduler::PipelineInit(
   // Creating a list of runtimes.
   for (size_t i = 0; i < graph_modules_.size(); i++) {
     auto run_item = std::make_shared<BackendRuntime>(graph_modules_[i], i);
+    run_item->SetMicroBatch(pipeline_config.GetMicroBatch(i));
     runtimes.push_back(run_item);
   }
   // Creating a list of NDArray in order to storage the outputs data.
@@ -63,11 +64,25 @@ void PipelineScheduler::PipelineRun(const std::vector<std::shared_ptr<BackendRun
                                     ConfigPipelineExecution pipeline_config) {
   runtimes.front()->RunPipeline();
 }
+/*!
+ * \brief Running pipeline logic when the first runtime has room to forward its outputs.
+ * \param runtimes A list of backend runtime modules.
+ * \param pipeline_config The dependency configuration of each runtime module.
+ */
+bool PipelineScheduler::PipelineTryRun(
+    const std::vector<std::shared_ptr<BackendRuntime>>& runtimes,
+    ConfigPipelineExecution pipeline_config) {
+  if (!runtimes.front()->CanForwardWithoutWaiting()) {
+    return false;
+  }
+  runtimes.front()->RunPipeline();
+  return true;
+}
 /*!
  * \brief Get a list of output.
  */
-Array<NDArray> PipelineScheduler::PipelineGetOutput() {
-  bool ret = global_runtime_->GetOutput(&output_arrays_);
+Array<NDArray> PipelineScheduler::PipelineGetOutput(int64_t timeout_ms) {
+  bool ret = global_runtime_->GetOutput(&output_arrays_, timeout_ms);
   return ret ? output_arrays_ : Array<NDArray>{};
 }
 }  // namespace runtime
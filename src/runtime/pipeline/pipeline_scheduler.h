@@ -50,10 +50,21 @@ class PipelineScheduler {
    */
   void PipelineRun(const std::vector<std::shared_ptr<BackendRuntime>>& runtimes,
                    ConfigPipelineExecution pipeline_config);
+  /*!
+   * \brief Running the pipeline logic only when the first runtime can forward its outputs
+   *  without waiting, which lets the caller apply backpressure instead of blocking.
+   * \param runtimes A list of backend runtime modules.
+   * \param pipeline_config The dependency configuration of each runtime module.
+   * \return Returning false when the request was not accepted.
+   */
+  bool PipelineTryRun(const std::vector<std::shared_ptr<BackendRuntime>>& runtimes,
+                      ConfigPipelineExecution pipeline_config);
   /*!
    * \brief Get a list of outputs.
+   * \param timeout_ms The longest time to wait for the outputs in milliseconds, zero to not
+   *  wait and a negative value to wait until the outputs are ready.
    */
-  Array<NDArray> PipelineGetOutput();
+  Array<NDArray> PipelineGetOutput(int64_t timeout_ms = 0);
 
  private:
   /*!\brief The list of graph executors.*/
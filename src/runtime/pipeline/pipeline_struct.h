@@ -26,7 +26,9 @@
 #include <tvm/runtime/threading_backend.h>
 
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
+#include <cstdlib>
 #include <functional>
 #include <limits>
 #include <memory>
@@ -118,15 +120,22 @@ struct ModuleIDHash {
     return id.interface_type | id.runtime_interface_idx << offset | id.runtime_idx << offset * 2;
   }
 };
-/*!\brief The data notification structure.*/
+/*!
+ * \brief The data notification structure. The waiting side spins for a short while before
+ *  parking, and the notifying side only takes the lock when the waiting side is parked.
+ */
 class DataNotify {
  private:
+  /*!\brief The number of times the waiting side checks the notification before parking.*/
+  static constexpr int kSpinCount = 256;
   /*!\brief The 'contitional variable' is used to wait for notification.*/
   std::condition_variable notify_cv_;
   /*!\brief The mutex is used to protect the 'conditional variable'.*/
   std::mutex mutex_;
   /*!\brief Whether a data is ready or not.*/
-  bool data_ready_ = false;
+  std::atomic<bool> data_ready_{false};
+  /*!\brief Whether the waiting side is parked on the 'conditional variable'.*/
+  std::atomic<bool> parked_{false};
   /*!\brief Whether the thread should exit or not.*/
   std::atomic<bool> exit_state_{false};
   /*!\brief The 'ModuleInterfaceID' of an interface which sent this notification.*/
@@ -152,18 +161,27 @@ class DataNotify {
    * return true.
    */
   bool Wait(void) {
-    std::unique_lock<std::mutex> lock(mutex_);
-    notify_cv_.wait(lock, [&] { return this->data_ready_; });
-    data_ready_ = false;
+    for (int i = 0; i < kSpinCount; ++i) {
+      if (data_ready_.exchange(false, std::memory_order_acq_rel)) return !GetExitState();
+      std::this_thread::yield();
+    }
+    // Announcing the parking before checking the notification again, so that a notification
+    // sent after this check sees the parked waiter.
+    parked_.store(true, std::memory_order_seq_cst);
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      notify_cv_.wait(lock, [&] { return this->data_ready_.exchange(false); });
+    }
+    parked_.store(false, std::memory_order_relaxed);
     return !GetExitState();
   }
   /*!brief Sending the notification in which the related data is ready.*/
   void Notify(void) {
-    {
+    data_ready_.store(true, std::memory_order_seq_cst);
+    if (parked_.load(std::memory_order_seq_cst)) {
       std::lock_guard<std::mutex> lock(mutex_);
-      data_ready_ = true;
+      notify_cv_.notify_one();
     }
-    notify_cv_.notify_one();
   }
   /*!brief Sending the notification when the notification state changes into 'exit'.*/
   void ExitNotify(void) {
@@ -326,6 +344,8 @@ class ConfigRuntime {
   ConfigRuntime& operator=(const ConfigRuntime& output) {
     output_binding_map_ = output.GetOutBindings();
     cpu_affinity_ = output.GetCPUAffinity();
+    micro_batch_ = output.GetMicroBatch();
+    queue_capacity_ = output.GetQueueCapacity();
     return *this;
   }
 
@@ -343,6 +363,20 @@ class ConfigRuntime {
    * \param Returning the cpu affinity in text form.
    */
   std::string GetCPUAffinity() const { return cpu_affinity_; }
+  /*!
+   * \brief Store the number of requests coalesced into one run of the module.
+   * \param micro_batch The number of requests.
+   */
+  void StoreMicroBatch(int micro_batch) { micro_batch_ = micro_batch; }
+  /*!\brief Getting the number of requests coalesced into one run of the module.*/
+  int GetMicroBatch() const { return micro_batch_; }
+  /*!
+   * \brief Store the capacity of the queues forwarding the outputs of the module.
+   * \param queue_capacity The capacity, zero to use the default one.
+   */
+  void StoreQueueCapacity(int queue_capacity) { queue_capacity_ = queue_capacity; }
+  /*!\brief Getting the capacity of the queues forwarding the outputs of the module.*/
+  int GetQueueCapacity() const { return queue_capacity_; }
   /*!
    * \brief Enumerating the output configuration.
    * \param parse_function The callback function is used to parse the binding configeration.
@@ -414,6 +448,10 @@ class ConfigRuntime {
   std::unordered_map<int, ConfigBindings> output_binding_map_;
   /*!\brief The cpu affinity setting for the tvm thread pool.*/
   std::string cpu_affinity_;
+  /*!\brief The number of requests coalesced into one run of the module.*/
+  int micro_batch_ = 1;
+  /*!\brief The capacity of the queues forwarding the outputs, zero to use the default one.*/
+  int queue_capacity_ = 0;
 };
 
 /*!
@@ -434,6 +472,22 @@ class ConfigPipelineExecution {
     auto config_runtime = config->second;
     return config_runtime.GetCPUAffinity();
   }
+  /*!\brief Get the number of requests coalesced into one run of a runtime.*/
+  int GetMicroBatch(int runtime_idx) const {
+    auto config = config_.find(runtime_idx);
+    if (config == config_.end()) {
+      LOG(FATAL) << "Do not finding the runtime " << runtime_idx;
+    }
+    return config->second.GetMicroBatch();
+  }
+  /*!\brief Get the capacity of the queues forwarding the outputs of a runtime.*/
+  int GetQueueCapacity(int runtime_idx) const {
+    auto config = config_.find(runtime_idx);
+    if (config == config_.end()) {
+      LOG(FATAL) << "Do not finding the runtime " << runtime_idx;
+    }
+    return config->second.GetQueueCapacity();
+  }
   /*!
    * \brief Enumerating the binding configuration for a specified runtime.
    * \param parse_function The callback function is used to parse the binding configuration.
@@ -504,6 +558,8 @@ class ConfigPipelineExecution {
       ConfigRuntime output;
       std::string dev;
       std::string cpu_affinity;
+      int micro_batch = 1;
+      int queue_capacity = 0;
       while (reader->NextObjectItem(&key)) {
         if (key == "mod_idx") {
           reader->Read(&mod_idx);
@@ -513,6 +569,10 @@ class ConfigPipelineExecution {
           reader->Read(&output);
         } else if (key == "cpu_affinity") {
           reader->Read(&cpu_affinity);
+        } else if (key == "micro_batch") {
+          reader->Read(&micro_batch);
+        } else if (key == "queue_capacity") {
+          reader->Read(&queue_capacity);
         } else {
           LOG(FATAL) << "do not support key " << key;
         }
@@ -520,8 +580,12 @@ class ConfigPipelineExecution {
       ICHECK(mod_idx >= 0) << "Invalid mod_idx value " << mod_idx;
       // Check if the output is successfully read.
       ICHECK(!output.Empty()) << "Invalid output binding result.";
+      ICHECK_GE(micro_batch, 1) << "Invalid micro_batch value " << micro_batch;
       // Store the cpu affinity into the 'ConfigRuntime' structure.
       output.StoreCPUAffinity(cpu_affinity);
+      ICHECK_GE(queue_capacity, 0) << "Invalid queue_capacity value " << queue_capacity;
+      output.StoreMicroBatch(micro_batch);
+      output.StoreQueueCapacity(queue_capacity);
       // Build the mapping of mod_idx and "ConfigRuntime".
       config_[mod_idx] = output;
     }
@@ -653,6 +717,29 @@ class BasicRuntime {
    * \param input_index The index of 'input interface' which is ready for data.
    */
   virtual void ParentNotify(int input_index) {}
+  /*!
+   * \brief Visiting the queues which forward the outputs of this runtime.
+   * \param visit The function taking the output index and the queue.
+   */
+  void VisitOutputQueues(std::function<void(int, const std::shared_ptr<ForwardQueue>&)> visit) {
+    for (auto& output : output_queue_) {
+      for (auto& queue : output.second) {
+        visit(output.first, queue.second);
+      }
+    }
+  }
+  /*!
+   * \brief Getting the default capacity of the forwarding queues, which can be set with the
+   *  environment variable 'TVM_PIPELINE_QUEUE_CAPACITY'.
+   */
+  static int DefaultQueueCapacity() {
+    static int capacity = [] {
+      const char* env = std::getenv("TVM_PIPELINE_QUEUE_CAPACITY");
+      int value = env ? std::atoi(env) : 0;
+      return value > 0 ? value : 1024;
+    }();
+    return capacity;
+  }
 
  protected:
   /*!\brief The index of runtime indicates the runtime position in the pipeline.*/
@@ -670,6 +757,8 @@ class BasicRuntime {
    *  other backend cores.
    */
   std::unordered_map<int, ForwardQueueMap> output_queue_;
+  /*!\brief The capacity of the queues forwarding the outputs of this runtime.*/
+  int queue_capacity_ = DefaultQueueCapacity();
   /*!
    * \brief Generate the ID of an input queue.
    * \param runtime_index The index of backend runtime.
@@ -695,7 +784,7 @@ class BasicRuntime {
                  << " is already created!";
       return;
     }
-    auto queue = std::make_shared<ForwardQueue>(queue_id);
+    auto queue = std::make_shared<ForwardQueue>(queue_id, queue_capacity_);
     queue_map[queue_id] = queue;
     // Use the created queue as the consumer queue for the input interface of this forwarding
     // pair.
@@ -717,24 +806,34 @@ class BasicRuntime {
 class GlobalRuntime : public BasicRuntime {
  public:
   explicit GlobalRuntime(int runtime_idx) : BasicRuntime(runtime_idx) {}
-  /*!\brief Whether the output data is ready.*/
-  bool DataIsReady(bool wait_data) {
-    bool data_ready = true;
+  /*!
+   * \brief Whether the output data is ready.
+   * \param timeout_ms The longest time to wait for the data in milliseconds, zero to not wait
+   *  and a negative value to wait until the data is ready.
+   */
+  bool DataIsReady(int64_t timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
     for (auto queue_pair : input_queue_) {
       auto queue = queue_pair.second;
-      if (queue->Empty()) {
-        data_ready = false;
-        break;
+      if (!queue->Empty()) continue;
+      if (timeout_ms == 0) return false;
+      auto no_stop = [] { return false; };
+      if (timeout_ms < 0) {
+        queue->WaitNotEmpty(no_stop);
+      } else if (!queue->WaitNotEmpty(no_stop, deadline - std::chrono::steady_clock::now())) {
+        return false;
       }
     }
-    if (!data_ready && wait_data) {
-      // TODO(huajsj): Waitting the data ready message.
-    }
-    return data_ready;
+    return true;
   }
-  /*!\brief Get the output data.*/
-  bool GetOutput(Array<NDArray>* outputs, bool wait_data = false) {
-    if (!DataIsReady(wait_data)) {
+  /*!
+   * \brief Get the output data.
+   * \param outputs The storage of the output data.
+   * \param timeout_ms The longest time to wait for the data in milliseconds, zero to not wait
+   *  and a negative value to wait until the data is ready.
+   */
+  bool GetOutput(Array<NDArray>* outputs, int64_t timeout_ms = 0) {
+    if (!DataIsReady(timeout_ms)) {
       return false;
     }
     for (auto queue_pair : input_queue_) {
@@ -748,11 +847,25 @@ class GlobalRuntime : public BasicRuntime {
     return true;
   }
 };
+/*!\brief The timing of a backend runtime in the pipeline.*/
+struct StageProfile {
+  /*!\brief The number of times the module ran.*/
+  int64_t num_runs = 0;
+  /*!\brief The number of requests, more than the runs when requests are coalesced.*/
+  int64_t num_requests = 0;
+  /*!\brief The total time spent running the module, in seconds.*/
+  double run_time = 0;
+  /*!\brief The total time spent forwarding outputs to the children, in seconds.*/
+  double forward_time = 0;
+  /*!\brief The total time spent waiting for and loading inputs, in seconds.*/
+  double wait_time = 0;
+};
 /*
  *!\brief Backend Runtime.
  */
 class BackendRuntime : public BasicRuntime {
  private:
+  using Clock = std::chrono::steady_clock;
   /*!The cpu affinity settings for this runtime.*/
   std::string cpu_affinity_ = "";
   /*!\brief The Runtime module of a backend graph executor.*/
@@ -765,6 +878,17 @@ class BackendRuntime : public BasicRuntime {
   std::unordered_map<int, std::shared_ptr<DataNotify>> parents_notify_;
   /*!\brief The execution count of the 'RunPipeline' function. */
   uint32_t pipeline_execution_count_ = 0;
+  /*!
+   *\brief The number of requests coalesced into one run. The module is built for this many
+   * requests stacked along the first axis of every input and output.
+   */
+  int micro_batch_ = 1;
+  /*!\brief The profiling counters, in nanoseconds for the times.*/
+  std::atomic<int64_t> num_runs_{0};
+  std::atomic<int64_t> num_requests_{0};
+  std::atomic<int64_t> run_time_ns_{0};
+  std::atomic<int64_t> forward_time_ns_{0};
+  std::atomic<int64_t> wait_time_ns_{0};
   /*!
    *\brief In order to transfer data from one backend runtime to another, we need a local
    * tensor variable as a medium. "input_tensor_local_copy_" is a map including
@@ -789,8 +913,12 @@ class BackendRuntime : public BasicRuntime {
       // Only launching the worker thread for the runtimes after the first runtime.
       thread_ = std::thread([&]() {
         this->SetCPUAffinity();
-        while (!this->WaitAndLoadPipelineData()) {
-          if (!this->RunPipeline()) {
+        while (true) {
+          auto start = Clock::now();
+          if (this->WaitAndLoadPipelineData()) break;
+          int num_requests = this->LoadMicroBatch();
+          wait_time_ns_.fetch_add(ElapsedNs(start), std::memory_order_relaxed);
+          if (!this->RunPipeline(num_requests)) {
             break;
           }
         }
@@ -811,6 +939,8 @@ class BackendRuntime : public BasicRuntime {
   /*!\brief Stopping the threads in pipeline.*/
   void StopPipeline() {
     SetPipelineState(STOPPING);
+    // Waking the worker thread when it is parked on a full forwarding queue.
+    VisitOutputQueues([](int, const std::shared_ptr<ForwardQueue>& queue) { queue->WakeAll(); });
     for (auto notify : parents_notify_) {
       notify.second->ExitNotify();
     }
@@ -847,9 +977,10 @@ class BackendRuntime : public BasicRuntime {
   /*!
    * \brief Loading the binding data.
    * \param input_index The index of the interface which will receive the forwarding data.
+   * \param slot The position of the request in the micro batch.
    * \return Returning 'true' when data is loaded successfully, otherwise returning 'false'.
    */
-  bool LoadBindingData(int input_index) {
+  bool LoadBindingData(int input_index, int slot = 0) {
     if (input_queue_.find(input_index) == input_queue_.end()) {
       LOG(FATAL) << "Not finding the associated input queue of the input " << input_index << " !";
       return false;
@@ -860,15 +991,62 @@ class BackendRuntime : public BasicRuntime {
     if (!queue->Poll<QueueData>(&data)) {
       return false;
     }
-    SetInput(input_index, data.GetDLData());
+    if (micro_batch_ > 1) {
+      NDArray input = get_input_(input_index);
+      std::vector<int64_t> shape;
+      DLTensor slice = MicroBatchSlice(input.operator->(), slot, &shape);
+      CopyFromTo(data.GetDLData(), &slice);
+    } else {
+      SetInput(input_index, data.GetDLData());
+    }
     return true;
   }
+  /*!
+   * \brief Coalescing the requests that are already queued into the free slots of the micro
+   *  batch, without waiting for more. The first request has been loaded already.
+   * \return The number of requests in the micro batch.
+   */
+  int LoadMicroBatch() {
+    int num_requests = 1;
+    while (num_requests < micro_batch_) {
+      for (auto& queue : input_queue_) {
+        if (queue.second->Empty()) return num_requests;
+      }
+      for (auto& queue : input_queue_) {
+        ICHECK(LoadBindingData(queue.first, num_requests));
+      }
+      num_requests++;
+    }
+    return num_requests;
+  }
+  /*!
+   * \brief Getting the view of the rows of one request in a micro batched tensor.
+   * \param tensor The micro batched tensor.
+   * \param slot The position of the request in the micro batch.
+   * \param shape The storage of the shape of the view.
+   */
+  DLTensor MicroBatchSlice(const DLTensor* tensor, int slot, std::vector<int64_t>* shape) {
+    ICHECK(tensor->ndim > 0 && tensor->shape[0] % micro_batch_ == 0)
+        << "The first axis of a tensor of runtime " << runtime_idx_
+        << " is not a multiple of the micro batch " << micro_batch_;
+    ICHECK(tensor->strides == nullptr) << "Micro batching requires compact tensors.";
+    shape->assign(tensor->shape, tensor->shape + tensor->ndim);
+    (*shape)[0] /= micro_batch_;
+    DLTensor slice = *tensor;
+    slice.shape = shape->data();
+    slice.byte_offset += slot * GetDataSize(*tensor) / micro_batch_;
+    return slice;
+  }
+  static int64_t ElapsedNs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  }
   /*!
    * \brief Forwarding the output data into the child runtimes.
+   * \param num_requests The number of requests in the micro batch.
    * \return bool Return false when the "PipelineIsStop" function returns true or this function
    *  reaches some errors. Otherwise, return true.
    */
-  bool ForwardingOutputDataToChildren(void) {
+  bool ForwardingOutputDataToChildren(int num_requests = 1) {
     for (auto child : children_) {
       auto output_idx = child.first;
       if (output_queue_.find(output_idx) == output_queue_.end()) {
@@ -889,16 +1067,21 @@ class BackendRuntime : public BasicRuntime {
                      << runtime_idx_ << ").output(" << output_idx << ")";
         }
         auto forward_queue = forward_queue_map[queue_id];
-        // If the queue is full, keep try until the push get success or the pipeline run into
-        // a STOP state.
-        while (!forward_queue->Push<NDArray>(output)) {
-          if (PipelineIsStop()) {
+        for (int slot = 0; slot < num_requests; ++slot) {
+          std::vector<int64_t> shape;
+          DLTensor slice;
+          if (micro_batch_ > 1) slice = MicroBatchSlice(output.operator->(), slot, &shape);
+          // If the queue is full, wait until the child frees a slot or the pipeline run into
+          // a STOP state.
+          auto is_stop = [this] { return PipelineIsStop(); };
+          if (micro_batch_ > 1 ? !forward_queue->PushWait<const DLTensor*>(&slice, is_stop)
+                               : !forward_queue->PushWait<NDArray>(output, is_stop)) {
             LOG(INFO) << "The forwarding process is stopped after the pipeline status is changed"
                       << " into stop.";
             return false;
           }
+          child_runtime->ParentNotify(child_input_index);
         }
-        child_runtime->ParentNotify(child_input_index);
       }
     }
     return true;
@@ -1005,6 +1188,9 @@ class BackendRuntime : public BasicRuntime {
                           std::shared_ptr<GlobalRuntime> global_runtime) {
     // Getting the current BackendRuntime's cpu affinity setting.
     cpu_affinity_ = config.GetCPUAffinity(runtime_idx_);
+    if (config.GetQueueCapacity(runtime_idx_) > 0) {
+      queue_capacity_ = config.GetQueueCapacity(runtime_idx_);
+    }
     // Getting the 'binding configuration' for each child runtime.
     config.VisitRuntimeOutputConfig(
         [&](int output_idx, int child_idx, std::string child_input_name) {
@@ -1052,11 +1238,56 @@ class BackendRuntime : public BasicRuntime {
     }
     notify->second->Notify();
   }
+  /*!
+   * \brief Setting the number of requests coalesced into one run. Only the runtimes fed by
+   *  other runtimes can coalesce requests, the first one runs each request the caller sets.
+   */
+  void SetMicroBatch(int micro_batch) {
+    ICHECK(micro_batch == 1 || runtime_idx_ != 0)
+        << "The first runtime of the pipeline does not support micro batching.";
+    micro_batch_ = micro_batch;
+  }
   /*!\brief Creating a NDArray containing same shape and data type with a module output. */
   NDArray CreateFromOutput(int idx) {
     NDArray data = get_output_(idx);
+    if (micro_batch_ > 1) {
+      std::vector<int64_t> shape;
+      DLTensor slice = MicroBatchSlice(data.operator->(), 0, &shape);
+      return CreateNDArrayFromDLTensor(&slice);
+    }
     return CreateNDArrayFromDLTensor(const_cast<DLTensor*>(data.operator->()));
   }
+  /*!\brief Getting the profiling counters.*/
+  StageProfile GetProfile() const {
+    StageProfile profile;
+    profile.num_runs = num_runs_.load(std::memory_order_relaxed);
+    profile.num_requests = num_requests_.load(std::memory_order_relaxed);
+    profile.run_time = run_time_ns_.load(std::memory_order_relaxed) * 1e-9;
+    profile.forward_time = forward_time_ns_.load(std::memory_order_relaxed) * 1e-9;
+    profile.wait_time = wait_time_ns_.load(std::memory_order_relaxed) * 1e-9;
+    return profile;
+  }
+  /*!\brief Resetting the profiling counters.*/
+  void ResetProfile() {
+    num_runs_.store(0, std::memory_order_relaxed);
+    num_requests_.store(0, std::memory_order_relaxed);
+    run_time_ns_.store(0, std::memory_order_relaxed);
+    forward_time_ns_.store(0, std::memory_order_relaxed);
+    wait_time_ns_.store(0, std::memory_order_relaxed);
+  }
+  /*!\brief Getting the number of requests coalesced into one run.*/
+  int GetMicroBatch() const { return micro_batch_; }
+  /*!
+   * \brief Checking whether every forwarding queue has a free slot, that is whether running a
+   *  request now would not wait for the children to catch up.
+   */
+  bool CanForwardWithoutWaiting() {
+    bool has_space = true;
+    VisitOutputQueues([&](int, const std::shared_ptr<ForwardQueue>& queue) {
+      has_space = has_space && !queue->Full();
+    });
+    return has_space;
+  }
   /*!\brief Return the number of output*/
   int NumOutputs() const { return get_num_output_(); }
   /*!\brief Return the number of input*/
@@ -1082,12 +1313,19 @@ class BackendRuntime : public BasicRuntime {
   void Run() { run_(); }
   /*!
    * \brief Running the runtime in the pipeline mode.
+   * \param num_requests The number of requests in the micro batch.
    * \return Returning false if the forwarding function failed. Otherwise, returning true.;
    */
-  bool RunPipeline() {
+  bool RunPipeline(int num_requests = 1) {
+    auto start = Clock::now();
     Run();
-    bool ret = ForwardingOutputDataToChildren();
-    pipeline_execution_count_++;
+    run_time_ns_.fetch_add(ElapsedNs(start), std::memory_order_relaxed);
+    start = Clock::now();
+    bool ret = ForwardingOutputDataToChildren(num_requests);
+    forward_time_ns_.fetch_add(ElapsedNs(start), std::memory_order_relaxed);
+    num_runs_.fetch_add(1, std::memory_order_relaxed);
+    num_requests_.fetch_add(num_requests, std::memory_order_relaxed);
+    pipeline_execution_count_ += num_requests;
     return ret;
   }
 };
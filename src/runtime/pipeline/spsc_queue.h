@@ -18,28 +18,72 @@
  */
 #ifndef TVM_RUNTIME_PIPELINE_SPSC_QUEUE_H_
 #define TVM_RUNTIME_PIPELINE_SPSC_QUEUE_H_
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstddef>
+#include <cstdint>
+#include <mutex>
 #include <thread>
+#include <vector>
+/*!\brief The counters of a queue, the times are in nanoseconds.*/
+struct SPSCQueueStats {
+  /*!\brief The number of slots in the queue.*/
+  size_t capacity = 0;
+  /*!\brief The number of elements pushed into the queue.*/
+  int64_t num_pushes = 0;
+  /*!\brief The sum of the occupancy seen by every push, for the mean occupancy.*/
+  int64_t occupancy_sum = 0;
+  /*!\brief The largest number of elements in the queue.*/
+  int64_t max_occupancy = 0;
+  /*!\brief The number of pushes which found the queue full and had to wait.*/
+  int64_t num_blocked_pushes = 0;
+  /*!\brief The total time the producer waited for a free slot.*/
+  int64_t blocked_ns = 0;
+  /*!\brief The number of elements polled from the queue.*/
+  int64_t num_polls = 0;
+  /*!\brief The total and the largest time an element waited in the queue to be polled.*/
+  int64_t wait_ns = 0;
+  int64_t max_wait_ns = 0;
+};
 /*!\brief A single producer and single consumer lock free queue.
+ *
+ * Push and Poll never take a lock. A side which has to wait for the other one spins for a
+ * short while and then parks on a condition variable, the other side only takes the lock to
+ * wake it when somebody is parked, the same way a futex only enters the kernel when there is
+ * a waiter.
  */
 template <typename SlotType, typename IDType = int, int QueueLength = 1024>
 class SPSCLockFreeQueue {
  public:
-  explicit SPSCLockFreeQueue(IDType id) : id_(id) {}
-  /*A read barrier enforcing the CPU to performe the reads before this barrier.*/
-  inline void read_barrier() { std::atomic_thread_fence(std::memory_order_acquire); }
-  /*A write barrier enforcing the CPU to performe the writes before this barrier.*/
-  inline void write_barrier() { std::atomic_thread_fence(std::memory_order_release); }
+  using Clock = std::chrono::steady_clock;
+  /*!\brief The number of times a waiting side checks the queue again before parking.*/
+  static constexpr int kSpinCount = 256;
+  /*!
+   * \brief Constructing the queue.
+   * \param id The ID of the queue.
+   * \param capacity The number of elements the queue holds before the producer has to wait.
+   */
+  explicit SPSCLockFreeQueue(IDType id, size_t capacity = QueueLength)
+      : id_(id), len_(std::max<size_t>(capacity, 1) + 1), queue_(len_), push_time_(len_, 0) {}
   /*!\brief Checking whether the queue is full.*/
   bool Full() {
-    read_barrier();
-    return ((tail_ + 1) % len_) == head_;
+    return ((tail_.load(std::memory_order_acquire) + 1) % len_) ==
+           head_.load(std::memory_order_acquire);
   }
   /*!brief Checking whether the queue is empty.*/
   bool Empty() {
-    read_barrier();
-    return head_ == tail_;
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+  /*!\brief Getting the number of elements in the queue.*/
+  size_t Size() {
+    size_t head = head_.load(std::memory_order_acquire);
+    size_t tail = tail_.load(std::memory_order_acquire);
+    return (tail + len_ - head) % len_;
   }
+  /*!\brief Getting the number of elements the queue holds.*/
+  size_t Capacity() const { return len_ - 1; }
   /*!
    * \brief Pushing the data into the queue. Only a single producer will call this function.
    * \param data The data which is pushed into the queue.
@@ -48,11 +92,41 @@ class SPSCLockFreeQueue {
   template <typename data_type>
   bool Push(const data_type& data) {
     if (Full()) return false;
-    queue_[tail_] = data;
-    write_barrier();
-    tail_ = (tail_ + 1) % len_;
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    queue_[tail] = data;
+    int64_t now = NowNs();
+    push_time_[tail] = now;
+    tail_.store((tail + 1) % len_, std::memory_order_release);
+    int64_t occupancy = static_cast<int64_t>(Size());
+    num_pushes_.fetch_add(1, std::memory_order_relaxed);
+    occupancy_sum_.fetch_add(occupancy, std::memory_order_relaxed);
+    if (occupancy > max_occupancy_.load(std::memory_order_relaxed)) {
+      max_occupancy_.store(occupancy, std::memory_order_relaxed);
+    }
+    Wake();
     return true;
   }
+  /*!
+   * \brief Pushing the data into the queue, waiting for a free slot when the queue is full.
+   * \param data The data which is pushed into the queue.
+   * \param stop A predicate which aborts the waiting when it returns true.
+   * \return Return false when the waiting is aborted. Otherwise, return true.
+   */
+  template <typename data_type, typename StopPredicate>
+  bool PushWait(const data_type& data, StopPredicate stop) {
+    if (Push<data_type>(data)) return true;
+    auto start = Clock::now();
+    bool pushed = true;
+    while (!Push<data_type>(data)) {
+      if (!Park([this] { return !Full(); }, stop)) {
+        pushed = false;
+        break;
+      }
+    }
+    num_blocked_pushes_.fetch_add(1, std::memory_order_relaxed);
+    blocked_ns_.fetch_add(ElapsedNs(start), std::memory_order_relaxed);
+    return pushed;
+  }
   /*!
    * \brief Poll the data from the front of the queue. Only the single consumer will call this
    *  function.
@@ -62,22 +136,118 @@ class SPSCLockFreeQueue {
   template <typename data_type>
   bool Poll(data_type* data) {
     if (Empty()) return false;
-    *data = queue_[head_];
-    write_barrier();
-    head_ = (head_ + 1) % len_;
+    size_t head = head_.load(std::memory_order_relaxed);
+    *data = queue_[head];
+    int64_t wait = NowNs() - push_time_[head];
+    head_.store((head + 1) % len_, std::memory_order_release);
+    num_polls_.fetch_add(1, std::memory_order_relaxed);
+    wait_ns_.fetch_add(wait, std::memory_order_relaxed);
+    if (wait > max_wait_ns_.load(std::memory_order_relaxed)) {
+      max_wait_ns_.store(wait, std::memory_order_relaxed);
+    }
+    Wake();
     return true;
   }
+  /*!
+   * \brief Waiting until the queue has data.
+   * \param stop A predicate which aborts the waiting when it returns true.
+   * \param timeout The longest time to wait.
+   * \return Returning false when the waiting is aborted or times out. Otherwise, return true.
+   */
+  template <typename StopPredicate>
+  bool WaitNotEmpty(StopPredicate stop, Clock::duration timeout = Clock::duration::max()) {
+    return Park([this] { return !Empty(); }, stop, timeout);
+  }
+  /*!\brief Waking the parked side so that it checks its stop predicate again.*/
+  void WakeAll() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    cv_.notify_all();
+  }
+  /*!\brief Getting the counters of the queue.*/
+  SPSCQueueStats GetStats() const {
+    SPSCQueueStats stats;
+    stats.capacity = len_ - 1;
+    stats.num_pushes = num_pushes_.load(std::memory_order_relaxed);
+    stats.occupancy_sum = occupancy_sum_.load(std::memory_order_relaxed);
+    stats.max_occupancy = max_occupancy_.load(std::memory_order_relaxed);
+    stats.num_blocked_pushes = num_blocked_pushes_.load(std::memory_order_relaxed);
+    stats.blocked_ns = blocked_ns_.load(std::memory_order_relaxed);
+    stats.num_polls = num_polls_.load(std::memory_order_relaxed);
+    stats.wait_ns = wait_ns_.load(std::memory_order_relaxed);
+    stats.max_wait_ns = max_wait_ns_.load(std::memory_order_relaxed);
+    return stats;
+  }
+  /*!\brief Getting the ID of the queue.*/
+  IDType GetID() const { return id_; }
 
  private:
+  static int64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch())
+        .count();
+  }
+  static int64_t ElapsedNs(Clock::time_point start) {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count();
+  }
+  /*!
+   * \brief Spinning and then parking until 'ready' or 'stop' returns true.
+   * \return Returning true when 'ready' returns true, false when stopped or timed out.
+   */
+  template <typename ReadyPredicate, typename StopPredicate>
+  bool Park(ReadyPredicate ready, StopPredicate stop,
+            Clock::duration timeout = Clock::duration::max()) {
+    for (int i = 0; i < kSpinCount; ++i) {
+      if (ready()) return true;
+      if (stop()) return false;
+      std::this_thread::yield();
+    }
+    // Announcing the waiter before checking the predicates again, so that a side which
+    // changes the queue after this check either sees the waiter or is seen by the check.
+    waiters_.fetch_add(1, std::memory_order_seq_cst);
+    bool is_ready;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      auto predicate = [&] { return ready() || stop(); };
+      if (timeout == Clock::duration::max()) {
+        cv_.wait(lock, predicate);
+      } else {
+        cv_.wait_for(lock, timeout, predicate);
+      }
+      is_ready = ready();
+    }
+    waiters_.fetch_sub(1, std::memory_order_seq_cst);
+    return is_ready;
+  }
+  /*!\brief Waking the parked side, only taking the lock when somebody is parked.*/
+  void Wake() {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters_.load(std::memory_order_seq_cst) > 0) {
+      WakeAll();
+    }
+  }
+  /*!\brief The ID of the queue.*/
+  IDType id_;
+  /*!\brief The length of the queue, one slot is kept free to tell a full queue from an empty one.*/
+  size_t len_;
   /*!\brief The pointer points to the first slot with valid data in the queue.*/
-  size_t head_ = 0;
+  std::atomic<size_t> head_{0};
   /*!\brief The end of the queue at which elements are added.*/
-  size_t tail_ = 0;
-  /*!\brief The length of the queue.*/
-  size_t len_ = QueueLength;
+  std::atomic<size_t> tail_{0};
   /*!\brief The queue used to store the data.*/
-  SlotType queue_[QueueLength];
-  /*!\brief The ID of the queue.*/
-  IDType id_;
+  std::vector<SlotType> queue_;
+  /*!\brief The time at which the element in every slot was pushed.*/
+  std::vector<int64_t> push_time_;
+  /*!\brief The parking of the waiting side.*/
+  std::atomic<int> waiters_{0};
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  /*!\brief The counters.*/
+  std::atomic<int64_t> num_pushes_{0};
+  std::atomic<int64_t> occupancy_sum_{0};
+  std::atomic<int64_t> max_occupancy_{0};
+  std::atomic<int64_t> num_blocked_pushes_{0};
+  std::atomic<int64_t> blocked_ns_{0};
+  std::atomic<int64_t> num_polls_{0};
+  std::atomic<int64_t> wait_ns_{0};
+  std::atomic<int64_t> max_wait_ns_{0};
 };
 #endif  // TVM_RUNTIME_PIPELINE_SPSC_QUEUE_H_
@@ -31,10 +31,12 @@
 #include <tvm/runtime/threading_backend.h>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <mutex>
 #include <numeric>
 
 namespace tvm {
@@ -105,8 +107,48 @@ TVM_REGISTER_GLOBAL("profiling.start_timer").set_body_typed(Timer::Start);
 
 namespace profiling {
 
-Profiler::Profiler(std::vector<Device> devs, std::vector<MetricCollector> metric_collectors)
-    : devs_(devs), collectors_(metric_collectors) {
+namespace {
+// Spans recorded by the runtime threads while at least one profiler records a timeline.
+// Spans are only dropped once no profiler records, so the offsets of the profilers hold.
+struct TimelineRecorder {
+  std::atomic<bool> active{false};
+  std::mutex mutex;
+  int num_profilers{0};
+  std::vector<TimelineSpan> spans;
+
+  static TimelineRecorder* Global() {
+    static TimelineRecorder* inst = new TimelineRecorder();
+    return inst;
+  }
+};
+}  // namespace
+
+bool TimelineActive() {
+  return TimelineRecorder::Global()->active.load(std::memory_order_relaxed);
+}
+
+int64_t TimelineNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+int64_t TimelineThreadId() {
+  static std::atomic<int64_t> next_id{0};
+  static thread_local int64_t id = next_id.fetch_add(1);
+  return id;
+}
+
+void RecordTimelineSpan(const char* name, int64_t start_ns, int64_t task) {
+  TimelineSpan span{name, TimelineThreadId(), start_ns, TimelineNow(), task};
+  TimelineRecorder* recorder = TimelineRecorder::Global();
+  std::lock_guard<std::mutex> lock(recorder->mutex);
+  if (recorder->num_profilers > 0) recorder->spans.push_back(span);
+}
+
+Profiler::Profiler(std::vector<Device> devs, std::vector<MetricCollector> metric_collectors,
+                   bool timeline)
+    : devs_(devs), collectors_(metric_collectors), timeline_(timeline) {
   is_running_ = false;
   std::vector<DeviceWrapper> wrapped_devs;
   for (auto dev : devs) {
@@ -121,6 +163,16 @@ Profiler::Profiler(std::vector<Device> devs, std::vector<MetricCollector> metric
 
 void Profiler::Start() {
   is_running_ = true;
+  if (timeline_) {
+    TimelineRecorder* recorder = TimelineRecorder::Global();
+    std::lock_guard<std::mutex> lock(recorder->mutex);
+    if (recorder->num_profilers++ == 0) {
+      recorder->spans.clear();
+      recorder->active = true;
+    }
+    timeline_begin_ = recorder->spans.size();
+    timeline_origin_ns_ = TimelineNow();
+  }
   for (auto dev : devs_) {
     StartCall("Total", dev, {});
   }
@@ -136,10 +188,15 @@ void Profiler::StartCall(String name, Device dev,
     }
   }
   in_flight_.push(CallFrame{dev, name, Timer::Start(dev), extra_metrics, objs});
+  if (timeline_) {
+    in_flight_.top().start_ns = TimelineNow();
+    in_flight_.top().thread = TimelineThreadId();
+  }
 }
 
 void Profiler::StopCall(std::unordered_map<std::string, ObjectRef> extra_metrics) {
   CallFrame cf = in_flight_.top();
+  if (timeline_) cf.stop_ns = TimelineNow();
   cf.timer->Stop();
   for (auto& p : extra_metrics) {
     cf.extra_metrics[p.first] = p.second;
@@ -160,6 +217,15 @@ void Profiler::Stop() {
   for (size_t i = 0; i < devs_.size(); i++) {
     StopCall();
   }
+  if (timeline_) {
+    TimelineRecorder* recorder = TimelineRecorder::Global();
+    std::lock_guard<std::mutex> lock(recorder->mutex);
+    timeline_spans_.assign(recorder->spans.begin() + timeline_begin_, recorder->spans.end());
+    if (--recorder->num_profilers == 0) {
+      recorder->active = false;
+      recorder->spans.clear();
+    }
+  }
 }
 
 std::vector<int64_t> ToShape(NDArray shape_tensor) {
@@ -263,6 +329,8 @@ String ReportNode::AsCSV() const {
           s << (*it).second.as<DurationNode>()->microseconds;
         } else if ((*it).second.as<PercentNode>()) {
           s << (*it).second.as<PercentNode>()->percent;
+        } else if ((*it).second.as<RatioNode>()) {
+          s << (*it).second.as<RatioNode>()->ratio;
         } else if ((*it).second.as<StringObj>()) {
           s << "\"" << Downcast<String>((*it).second) << "\"";
         }
@@ -288,6 +356,8 @@ void print_metric(std::ostream& os, ObjectRef o) {
     os << "{\"microseconds\":" << std::setprecision(17) << std::fixed << n->microseconds << "}";
   } else if (const PercentNode* n = o.as<PercentNode>()) {
     os << "{\"percent\":" << std::setprecision(17) << std::fixed << n->percent << "}";
+  } else if (const RatioNode* n = o.as<RatioNode>()) {
+    os << "{\"ratio\":" << std::setprecision(17) << std::fixed << n->ratio << "}";
   } else {
     LOG(FATAL) << "Unprintable type " << o->GetTypeKey();
   }
@@ -301,25 +371,30 @@ String ReportNode::AsJSON() const {
   // so we would have to implement a custom data structure for each type of
   // value we want to print. Instead we construct the json by hand because it
   // is easier.
-  s << "{";
-  s << "\"calls\":[";
-  for (size_t i = 0; i < calls.size(); i++) {
-    size_t j = 0;
-    s << "{";
-    for (const auto& kv : calls[i]) {
-      s << "\"" << kv.first << "\":";
-      print_metric(s, kv.second);
-      if (j < calls[i].size() - 1) {
+  auto print_rows = [&s](const Array<Map<String, ObjectRef>>& rows) {
+    s << "[";
+    for (size_t i = 0; i < rows.size(); i++) {
+      size_t j = 0;
+      s << "{";
+      for (const auto& kv : rows[i]) {
+        s << "\"" << kv.first << "\":";
+        print_metric(s, kv.second);
+        if (j < rows[i].size() - 1) {
+          s << ",";
+        }
+        j++;
+      }
+      s << "}";
+      if (i < rows.size() - 1) {
         s << ",";
       }
-      j++;
-    }
-    s << "}";
-    if (i < calls.size() - 1) {
-      s << ",";
     }
-  }
-  s << "],";
+    s << "]";
+  };
+  s << "{";
+  s << "\"calls\":";
+  print_rows(calls);
+  s << ",";
   s << "\"device_metrics\":{";
   size_t i = 0;
   for (const auto& dev_kv : device_metrics) {
@@ -339,7 +414,61 @@ String ReportNode::AsJSON() const {
     }
     i++;
   }
-  s << "}}";
+  s << "}";
+  if (!timeline.empty()) {
+    s << ",\"timeline\":";
+    print_rows(timeline);
+  }
+  s << "}";
+  return s.str();
+}
+
+String ReportNode::AsChromeTrace() const {
+  ICHECK(!timeline.empty()) << "The report has no timeline, profile with timeline enabled";
+  std::ostringstream s;
+  s << std::setprecision(3) << std::fixed;
+  s << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  // One process per device, numbered in order of appearance.
+  std::unordered_map<std::string, int> pids;
+  for (const auto& span : timeline) {
+    std::string device = Downcast<String>(span.at("Device"));
+    if (pids.count(device)) continue;
+    int pid = static_cast<int>(pids.size()) + 1;
+    pids[device] = pid;
+    s << (pid == 1 ? "" : ",") << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << pid
+      << ",\"tid\":0,\"args\":{\"name\":\"" << device << "\"}}";
+  }
+  for (const auto& span : timeline) {
+    std::string name = Downcast<String>(span.at("Name"));
+    s << ",{\"name\":\"" << name << "\",\"cat\":\""
+      << (span.count("Task") ? "parallel" : "call") << "\",\"ph\":\"X\""
+      << ",\"ts\":" << span.at("Start (us)").as<DurationNode>()->microseconds
+      << ",\"dur\":" << span.at("Duration (us)").as<DurationNode>()->microseconds
+      << ",\"pid\":" << pids[Downcast<String>(span.at("Device"))]
+      << ",\"tid\":" << span.at("Thread").as<CountNode>()->value << ",\"args\":{";
+    bool first = true;
+    for (const auto& kv : span) {
+      if (kv.first == "Name" || kv.first == "Device" || kv.first == "Thread" ||
+          kv.first == "Start (us)" || kv.first == "Duration (us)") {
+        continue;
+      }
+      s << (first ? "" : ",") << "\"" << kv.first << "\":";
+      first = false;
+      if (const CountNode* n = kv.second.as<CountNode>()) {
+        s << n->value;
+      } else if (const DurationNode* n = kv.second.as<DurationNode>()) {
+        s << n->microseconds;
+      } else if (const PercentNode* n = kv.second.as<PercentNode>()) {
+        s << n->percent;
+      } else if (const RatioNode* n = kv.second.as<RatioNode>()) {
+        s << n->ratio;
+      } else {
+        s << "\"" << Downcast<String>(kv.second) << "\"";
+      }
+    }
+    s << "}}";
+  }
+  s << "]}";
   return s.str();
 }
 
@@ -387,16 +516,26 @@ String ReportNode::AsTable(bool sort, bool aggregate, bool compute_col_sums) con
               aggregated[metric.first] =
                   ObjectRef(make_object<PercentNode>(it->second.as<PercentNode>()->percent +
                                                      metric.second.as<PercentNode>()->percent));
+            } else if (metric.second.as<RatioNode>()) {
+              // Summed here, divided by the number of calls below.
+              aggregated[metric.first] =
+                  ObjectRef(make_object<RatioNode>(it->second.as<RatioNode>()->ratio +
+                                                   metric.second.as<RatioNode>()->ratio));
             } else if (metric.second.as<StringObj>()) {
               // Don't do anything. Assume the two strings are the same.
             } else {
               LOG(FATAL) << "Can only aggregate metrics with types DurationNode, CountNode, "
-                            "PercentNode, and StringObj, but got "
+                            "PercentNode, RatioNode, and StringObj, but got "
                          << metric.second->GetTypeKey();
             }
           }
         }
       }
+      for (auto& metric : aggregated) {
+        if (const RatioNode* n = metric.second.as<RatioNode>()) {
+          metric.second = ObjectRef(make_object<RatioNode>(n->ratio / p.second.size()));
+        }
+      }
       aggregated_calls.push_back(aggregated);
     }
   } else {
@@ -499,6 +638,10 @@ String ReportNode::AsTable(bool sort, bool aggregate, bool compute_col_sums) con
           std::stringstream s;
           s << std::fixed << std::setprecision(2) << (*it).second.as<PercentNode>()->percent;
           val = s.str();
+        } else if ((*it).second.as<RatioNode>()) {
+          std::stringstream s;
+          s << std::fixed << std::setprecision(2) << (*it).second.as<RatioNode>()->ratio;
+          val = s.str();
         } else if ((*it).second.as<StringObj>()) {
           val = Downcast<String>((*it).second);
         }
@@ -548,6 +691,7 @@ std::string DeviceString(Device dev) {
 Report Profiler::Report(bool aggregate, bool sort) {
   // sync all timers and normalize rows
   std::vector<std::unordered_map<String, ObjectRef>> rows;
+  Array<Map<String, ObjectRef>> timeline;
   for (auto& cf : calls_) {
     std::unordered_map<String, ObjectRef> row;
     double us = cf.timer->SyncAndGetElapsedNanos() / 1e3;
@@ -559,6 +703,31 @@ Report Profiler::Report(bool aggregate, bool sort) {
       row[p.first] = p.second;
     }
     rows.push_back(row);
+    if (timeline_) {
+      Map<String, ObjectRef> span(row.begin(), row.end());
+      span.erase("Count");
+      span.Set("Start (us)", ObjectRef(make_object<DurationNode>(
+                                 (cf.start_ns - timeline_origin_ns_) / 1e3)));
+      // The host sees when asynchronous devices were given the call, not how long it ran.
+      if (cf.dev.device_type == kDLCPU) {
+        span.Set("Duration (us)",
+                 ObjectRef(make_object<DurationNode>((cf.stop_ns - cf.start_ns) / 1e3)));
+      }
+      span.Set("Thread", ObjectRef(make_object<CountNode>(cf.thread)));
+      timeline.push_back(span);
+    }
+  }
+  for (const TimelineSpan& ts : timeline_spans_) {
+    Map<String, ObjectRef> span;
+    span.Set("Name", String(ts.name));
+    span.Set("Device", String(DeviceString(Device{kDLCPU, 0})));
+    span.Set("Thread", ObjectRef(make_object<CountNode>(ts.thread)));
+    span.Set("Start (us)",
+             ObjectRef(make_object<DurationNode>((ts.start_ns - timeline_origin_ns_) / 1e3)));
+    span.Set("Duration (us)",
+             ObjectRef(make_object<DurationNode>((ts.stop_ns - ts.start_ns) / 1e3)));
+    if (ts.task >= 0) span.Set("Task", ObjectRef(make_object<CountNode>(ts.task)));
+    timeline.push_back(span);
   }
 
   // the last couple of call frames are the overall times
@@ -584,14 +753,16 @@ Report Profiler::Report(bool aggregate, bool sort) {
     converted_rows.push_back(row);
   }
 
-  return profiling::Report(converted_rows, device_metrics);
+  return profiling::Report(converted_rows, device_metrics, timeline);
 }
 
 Report::Report(Array<Map<String, ObjectRef>> calls,
-               Map<String, Map<String, ObjectRef>> device_metrics) {
+               Map<String, Map<String, ObjectRef>> device_metrics,
+               Array<Map<String, ObjectRef>> timeline) {
   auto node = make_object<ReportNode>();
   node->calls = std::move(calls);
   node->device_metrics = std::move(device_metrics);
+  node->timeline = std::move(timeline);
   data_ = std::move(node);
 }
 
@@ -611,6 +782,10 @@ Map<String, ObjectRef> parse_metrics(dmlc::JSONReader* reader) {
       double percent;
       reader->Read(&percent);
       o = ObjectRef(make_object<PercentNode>(percent));
+    } else if (metric_value_name == "ratio") {
+      double ratio;
+      reader->Read(&ratio);
+      o = ObjectRef(make_object<RatioNode>(ratio));
     } else if (metric_value_name == "count") {
       int64_t count;
       reader->Read(&count);
@@ -621,7 +796,7 @@ Map<String, ObjectRef> parse_metrics(dmlc::JSONReader* reader) {
       o = String(s);
     } else {
       LOG(FATAL) << "Cannot parse metric of type " << metric_value_name
-                 << " valid types are microseconds, percent, count.";
+                 << " valid types are microseconds, percent, ratio, count.";
     }
     metrics.Set(metric_name, o);
     // Necessary to make sure that the parser hits the end of the object.
@@ -639,6 +814,7 @@ Report Report::FromJSON(String json) {
   std::string key;
   Array<Map<String, ObjectRef>> calls;
   Map<String, Map<String, ObjectRef>> device_metrics;
+  Array<Map<String, ObjectRef>> timeline;
 
   reader.BeginObject();
   while (reader.NextObjectItem(&key)) {
@@ -655,15 +831,21 @@ Report Report::FromJSON(String json) {
         device_metrics.Set(device_name, parse_metrics(&reader));
       }
       // reader.EndObject();
+    } else if (key == "timeline") {
+      reader.BeginArray();
+      while (reader.NextArrayItem()) {
+        timeline.push_back(parse_metrics(&reader));
+      }
     }
   }
 
-  return Report(calls, device_metrics);
+  return Report(calls, device_metrics, timeline);
 }
 
 TVM_REGISTER_OBJECT_TYPE(DurationNode);
 TVM_REGISTER_OBJECT_TYPE(PercentNode);
 TVM_REGISTER_OBJECT_TYPE(CountNode);
+TVM_REGISTER_OBJECT_TYPE(RatioNode);
 TVM_REGISTER_OBJECT_TYPE(ReportNode);
 TVM_REGISTER_OBJECT_TYPE(DeviceWrapperNode);
 TVM_REGISTER_OBJECT_TYPE(MetricCollectorNode);
@@ -673,6 +855,9 @@ TVM_REGISTER_GLOBAL("runtime.profiling.AsCSV").set_body_typed([](Report n) { ret
 TVM_REGISTER_GLOBAL("runtime.profiling.AsJSON").set_body_typed([](Report n) {
   return n->AsJSON();
 });
+TVM_REGISTER_GLOBAL("runtime.profiling.AsChromeTrace").set_body_typed([](Report n) {
+  return n->AsChromeTrace();
+});
 TVM_REGISTER_GLOBAL("runtime.profiling.FromJSON").set_body_typed(Report::FromJSON);
 TVM_REGISTER_GLOBAL("runtime.profiling.DeviceWrapper").set_body_typed([](Device dev) {
   return DeviceWrapper(dev);
@@ -694,6 +879,8 @@ PackedFunc ProfileFunction(Module mod, std::string func_name, int device_type, i
     for (auto& collector : collectors) {
       collector->Init({DeviceWrapper(dev)});
     }
+    // Recreate the workers so that they inherit counters opened by the collectors.
+    threading::ResetThreadPool();
     std::vector<Map<String, ObjectRef>> results;
     results.reserve(collectors.size());
     std::vector<std::pair<MetricCollector, ObjectRef>> collector_data;
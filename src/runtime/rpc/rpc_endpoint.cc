@@ -33,12 +33,14 @@
 #include <array>
 #include <chrono>
 #include <cmath>
+#include <cstring>
 #include <memory>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include "../../support/arena.h"
+#include "../../support/lz_codec.h"
 #include "../../support/ring_buffer.h"
 #include "../object_internal.h"
 #include "rpc_local_session.h"
@@ -46,6 +48,11 @@
 namespace tvm {
 namespace runtime {
 
+// Upper estimate of the size of a reply that carries no array data.
+constexpr uint64_t kReplyNumBytesEstimate = 256;
+// Maximum number of pipelined requests waiting for their replies.
+constexpr size_t kMaxPendingReplies = 4096;
+
 /*!
  * Event-driven state-machine based handlers for RPCEndpoint.
  *
@@ -663,25 +670,114 @@ void RPCEndpoint::Init() {
   // Quick function to for syscall remote.
   syscall_remote_ = PackedFunc([this](TVMArgs all_args, TVMRetValue* rv) {
     std::lock_guard<std::mutex> lock(mutex_);
-    RPCCode code = static_cast<RPCCode>(all_args[0].operator int());
-    TVMArgs args(all_args.values + 1, all_args.type_codes + 1, all_args.num_args - 1);
-
-    uint64_t packet_nbytes = sizeof(code) + handler_->PackedSeqGetNumBytes(
-                                                args.values, args.type_codes, args.num_args, true);
-
-    // All packet begins with packet nbytes
-    handler_->Write(packet_nbytes);
-    handler_->Write(code);
-    handler_->SendPackedSeq(args.values, args.type_codes, args.num_args, true);
-
-    code = HandleUntilReturnEvent(true, [rv](TVMArgs args) {
+    this->SendSysCall(all_args, [rv](TVMArgs args) {
       ICHECK_EQ(args.size(), 1);
       *rv = args[0];
     });
-    ICHECK(code == RPCCode::kReturn) << "code=" << static_cast<int>(code);
+    this->WaitPendingReplies();
+  });
+
+  pipelined_syscall_remote_ = PackedFunc([this](TVMArgs all_args, TVMRetValue* rv) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    this->SendSysCall(all_args, nullptr);
+    this->SendDroppedFrees();
+    this->FlushWriter();
   });
 }
 
+void RPCEndpoint::SendSysCall(TVMArgs all_args, RPCSession::FEncodeReturn encode_return) {
+  RPCCode code = static_cast<RPCCode>(all_args[0].operator int());
+  TVMArgs args(all_args.values + 1, all_args.type_codes + 1, all_args.num_args - 1);
+
+  uint64_t packet_nbytes = sizeof(code) + handler_->PackedSeqGetNumBytes(
+                                              args.values, args.type_codes, args.num_args, true);
+  ReserveReply(kReplyNumBytesEstimate);
+
+  // All packet begins with packet nbytes
+  handler_->Write(packet_nbytes);
+  handler_->Write(code);
+  handler_->SendPackedSeq(args.values, args.type_codes, args.num_args, true);
+  pending_.push_back({RPCCode::kReturn, encode_return, nullptr, 0, kReplyNumBytesEstimate});
+  pending_reply_nbytes_ += kReplyNumBytesEstimate;
+}
+
+void RPCEndpoint::SendDroppedFrees() {
+  // Sending may read replies which drop more handles, so pop them one at a time.
+  while (!dropped_handles_.empty()) {
+    std::pair<void*, int> handle = dropped_handles_.back();
+    dropped_handles_.pop_back();
+    TVMValue values[3];
+    int type_codes[3];
+    TVMArgsSetter setter(values, type_codes);
+    setter(0, static_cast<int>(RPCCode::kFreeHandle));
+    setter(1, handle.first);
+    setter(2, handle.second);
+    SendSysCall(TVMArgs(values, type_codes, 3), nullptr);
+  }
+}
+
+void RPCEndpoint::FlushWriter() {
+  while (writer_.bytes_available() != 0) {
+    writer_.ReadWithCallback(
+        [this](const void* data, size_t size) { return channel_->Send(data, size); },
+        writer_.bytes_available());
+  }
+}
+
+void RPCEndpoint::ReserveReply(uint64_t reply_nbytes) {
+  // A reply larger than the window is sent alone, and read before the next request is sent.
+  while (!pending_.empty() && (pending_reply_nbytes_ + reply_nbytes > pipeline_window_bytes_ ||
+                               pending_.size() >= kMaxPendingReplies)) {
+    ReadReply();
+  }
+}
+
+void RPCEndpoint::ReadReply() {
+  PendingReply reply = std::move(pending_.front());
+  pending_.pop_front();
+  pending_reply_nbytes_ -= reply.reply_nbytes;
+  RPCSession::FEncodeReturn on_return = reply.on_return;
+  if (on_return == nullptr) on_return = [](TVMArgs) {};
+  RPCCode code;
+  try {
+    code = HandleUntilReturnEvent(true, on_return);
+  } catch (const Error& e) {
+    // The replies of the later requests are still on the channel,
+    // keep reading them and raise the first error when waiting.
+    if (pending_error_ == nullptr) pending_error_ = std::current_exception();
+    return;
+  }
+  // A mismatched reply means the channel is out of sync, which no later read can recover from.
+  ICHECK(code == reply.code) << "code=" << RPCCodeToString(code);
+  if (code == RPCCode::kCopyAck) {
+    handler_->ReadArray(reinterpret_cast<char*>(reply.to_bytes), reply.nbytes);
+    handler_->FinishCopyAck();
+  }
+}
+
+void RPCEndpoint::WaitPendingReplies() {
+  SendDroppedFrees();
+  while (!pending_.empty()) {
+    ReadReply();
+    SendDroppedFrees();
+  }
+  if (pending_error_ != nullptr) {
+    std::exception_ptr error = pending_error_;
+    pending_error_ = nullptr;
+    std::rethrow_exception(error);
+  }
+}
+
+void RPCEndpoint::WaitPending() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  WaitPendingReplies();
+}
+
+void RPCEndpoint::SetPipelineWindow(uint64_t window_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  pipeline_window_bytes_ = window_bytes;
+}
+
 /*!
  * \brief Create a new RPCEndpoint instance.
  * \param channel RPCChannel used to communicate.
@@ -783,7 +879,57 @@ void RPCEndpoint::CallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_v
                            const int* arg_type_codes, int num_args,
                            RPCSession::FEncodeReturn encode_return) {
   std::lock_guard<std::mutex> lock(mutex_);
+  SendCallFunc(h, arg_values, arg_type_codes, num_args, encode_return);
+  WaitPendingReplies();
+}
+
+void RPCEndpoint::PipelinedCallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_values,
+                                    const int* arg_type_codes, int num_args,
+                                    RPCSession::FEncodeReturn encode_return) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  // Nobody waits for the return value, so the remote objects in it are freed here.
+  auto drop_return = [this, encode_return](TVMArgs args) {
+    int type_code = 0;
+    if (void* handle = RPCSession::GetReturnedHandle(args, &type_code)) {
+      dropped_handles_.emplace_back(handle, type_code);
+    } else if (encode_return != nullptr) {
+      encode_return(args);
+    }
+  };
+  SendCallFunc(h, arg_values, arg_type_codes, num_args, drop_return);
+  SendDroppedFrees();
+  FlushWriter();
+}
+
+void RPCEndpoint::CopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SendCopyToRemote(from_bytes, to, nbytes);
+  WaitPendingReplies();
+}
+
+void RPCEndpoint::PipelinedCopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SendCopyToRemote(from_bytes, to, nbytes);
+  SendDroppedFrees();
+  FlushWriter();
+}
+
+void RPCEndpoint::CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SendCopyFromRemote(from, to_bytes, nbytes);
+  WaitPendingReplies();
+}
+
+void RPCEndpoint::PipelinedCopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  SendCopyFromRemote(from, to_bytes, nbytes);
+  SendDroppedFrees();
+  FlushWriter();
+}
 
+void RPCEndpoint::SendCallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_values,
+                               const int* arg_type_codes, int num_args,
+                               RPCSession::FEncodeReturn encode_return) {
   handler_->ValidateArguments(arg_values, arg_type_codes, num_args);
   RPCCode code = RPCCode::kCallFunc;
   uint64_t handle = reinterpret_cast<uint64_t>(h);
@@ -792,17 +938,17 @@ void RPCEndpoint::CallFunc(RPCSession::PackedFuncHandle h, const TVMValue* arg_v
       sizeof(code) + sizeof(handle) +
       handler_->PackedSeqGetNumBytes(arg_values, arg_type_codes, num_args, true);
 
+  ReserveReply(kReplyNumBytesEstimate);
+
   handler_->Write(packet_nbytes);
   handler_->Write(code);
   handler_->Write(handle);
   handler_->SendPackedSeq(arg_values, arg_type_codes, num_args, true);
-
-  code = HandleUntilReturnEvent(true, encode_return);
-  ICHECK(code == RPCCode::kReturn) << "code=" << RPCCodeToString(code);
+  pending_.push_back({RPCCode::kReturn, encode_return, nullptr, 0, kReplyNumBytesEstimate});
+  pending_reply_nbytes_ += kReplyNumBytesEstimate;
 }
 
-void RPCEndpoint::CopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes) {
-  std::lock_guard<std::mutex> lock(mutex_);
+void RPCEndpoint::SendCopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes) {
   RPCCode code = RPCCode::kCopyToRemote;
 
   uint64_t tensor_total_size_bytes = static_cast<uint64_t>(GetDataSize(*to));
@@ -812,17 +958,18 @@ void RPCEndpoint::CopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes)
 
   uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(to, code, nbytes);
   uint64_t packet_nbytes = overhead + nbytes;
+  ReserveReply(kReplyNumBytesEstimate);
 
   handler_->Write(packet_nbytes);
   handler_->Write(code);
   RPCReference::SendDLTensor(handler_, to);
   handler_->Write(nbytes);
   handler_->WriteArray(reinterpret_cast<char*>(from_bytes), nbytes);
-  ICHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kReturn);
+  pending_.push_back({RPCCode::kReturn, nullptr, nullptr, 0, kReplyNumBytesEstimate});
+  pending_reply_nbytes_ += kReplyNumBytesEstimate;
 }
 
-void RPCEndpoint::CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes) {
-  std::lock_guard<std::mutex> lock(mutex_);
+void RPCEndpoint::SendCopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes) {
   RPCCode code = RPCCode::kCopyFromRemote;
 
   uint64_t tensor_total_size_bytes = static_cast<uint64_t>(GetDataSize(*from));
@@ -832,15 +979,15 @@ void RPCEndpoint::CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes
 
   uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(from, code, nbytes);
   uint64_t packet_nbytes = overhead;
+  uint64_t reply_nbytes = kReplyNumBytesEstimate + nbytes;
+  ReserveReply(reply_nbytes);
 
   handler_->Write(packet_nbytes);
   handler_->Write(code);
   RPCReference::SendDLTensor(handler_, from);
   handler_->Write(nbytes);
-  ICHECK(HandleUntilReturnEvent(true, [](TVMArgs) {}) == RPCCode::kCopyAck);
-
-  handler_->ReadArray(reinterpret_cast<char*>(to_bytes), nbytes);
-  handler_->FinishCopyAck();
+  pending_.push_back({RPCCode::kCopyAck, nullptr, to_bytes, nbytes, reply_nbytes});
+  pending_reply_nbytes_ += reply_nbytes;
 }
 
 // SysCallEventHandler functions
@@ -1010,59 +1157,68 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
   }
 
   void CopyToRemote(void* local_from_bytes, DLTensor* remote_to, uint64_t nbytes) final {
-    RPCCode code = RPCCode::kCopyToRemote;
-    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(remote_to, code, nbytes);
-    uint64_t rpc_max_size = GetRPCMaxTransferSize();
-    ICHECK_GT(rpc_max_size, overhead) << "CopyToRemote: Invalid block size!";
-    const uint64_t block_size = rpc_max_size - overhead;
-    uint64_t block_count = 0;
-    const uint64_t num_blocks = nbytes / block_size;
-    void* from_bytes;
-
-    for (block_count = 0; block_count < num_blocks; block_count++) {
-      remote_to->byte_offset = block_count * block_size;
-      from_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_from_bytes) + block_count * block_size));
-      endpoint_->CopyToRemote(from_bytes, remote_to, block_size);
+    if (UseCompression(nbytes)) {
+      CompressedCopyToRemote(static_cast<char*>(local_from_bytes), remote_to, nbytes);
+      return;
     }
-
-    const uint64_t remainder_bytes = nbytes % block_size;
-    if (remainder_bytes != 0) {
-      remote_to->byte_offset = block_count * block_size;
-      from_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_from_bytes) + block_count * block_size));
-      endpoint_->CopyToRemote(from_bytes, remote_to, remainder_bytes);
+    const uint64_t block_size = GetBlockSize(remote_to, RPCCode::kCopyToRemote, nbytes);
+    // The blocks are pipelined, the remote copies one block while the next one is in flight.
+    DLTensor to = *remote_to;
+    for (uint64_t offset = 0; offset < nbytes; offset += block_size) {
+      to.byte_offset = offset;
+      endpoint_->PipelinedCopyToRemote(static_cast<uint8_t*>(local_from_bytes) + offset, &to,
+                                       std::min(block_size, nbytes - offset));
+    }
+    if (!batch_mode_) {
+      endpoint_->WaitPending();
     }
   }
 
   void CopyFromRemote(DLTensor* remote_from, void* local_to_bytes, uint64_t nbytes) final {
-    RPCCode code = RPCCode::kCopyFromRemote;
-    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(remote_from, code, nbytes);
-    uint64_t rpc_max_size = GetRPCMaxTransferSize();
-    ICHECK_GT(rpc_max_size, overhead) << "CopyFromRemote: Invalid block size!";
-    const uint64_t block_size = rpc_max_size - overhead;
-    uint64_t block_count = 0;
-    const uint64_t num_blocks = nbytes / block_size;
-    void* to_bytes;
-
-    for (block_count = 0; block_count < num_blocks; block_count++) {
-      remote_from->byte_offset = block_count * block_size;
-      to_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_to_bytes) + block_count * block_size));
-      endpoint_->CopyFromRemote(remote_from, to_bytes, block_size);
+    if (UseCompression(nbytes)) {
+      CompressedCopyFromRemote(remote_from, static_cast<char*>(local_to_bytes), nbytes);
+      return;
     }
+    const uint64_t block_size = GetBlockSize(remote_from, RPCCode::kCopyFromRemote, nbytes);
+    DLTensor from = *remote_from;
+    for (uint64_t offset = 0; offset < nbytes; offset += block_size) {
+      from.byte_offset = offset;
+      endpoint_->PipelinedCopyFromRemote(&from, static_cast<uint8_t*>(local_to_bytes) + offset,
+                                         std::min(block_size, nbytes - offset));
+    }
+    endpoint_->WaitPending();
+  }
+
+  void PipelinedCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
+                         const int* arg_type_codes, int num_args,
+                         const FEncodeReturn& fencode_return) final {
+    endpoint_->PipelinedCallFunc(func, arg_values, arg_type_codes, num_args, fencode_return);
+  }
 
-    const uint64_t remainder_bytes = nbytes % block_size;
-    if (remainder_bytes != 0) {
-      remote_from->byte_offset = block_count * block_size;
-      to_bytes = reinterpret_cast<void*>(
-          (reinterpret_cast<uint8_t*>(local_to_bytes) + block_count * block_size));
-      endpoint_->CopyFromRemote(remote_from, to_bytes, remainder_bytes);
+  void SetBatchMode(bool enable) final {
+    batch_mode_ = enable;
+    if (!enable) {
+      endpoint_->WaitPending();
     }
   }
 
+  void WaitPending() final { endpoint_->WaitPending(); }
+
+  void SetTransferOptions(uint64_t chunk_bytes, uint64_t window_bytes) final {
+    chunk_bytes_ = chunk_bytes;
+    if (window_bytes != 0) {
+      endpoint_->SetPipelineWindow(window_bytes);
+    }
+  }
+
+  void SetCompression(uint64_t min_bytes) final { compress_min_bytes_ = min_bytes; }
+
   void FreeHandle(void* handle, int type_code) final {
-    endpoint_->SysCallRemote(RPCCode::kFreeHandle, handle, type_code);
+    if (batch_mode_) {
+      endpoint_->PipelinedSysCallRemote(RPCCode::kFreeHandle, handle, type_code);
+    } else {
+      endpoint_->SysCallRemote(RPCCode::kFreeHandle, handle, type_code);
+    }
   }
 
   void SetDevice(Device dev) final { endpoint_->SysCallRemote(RPCCode::kDevSetDevice, dev); }
@@ -1099,7 +1255,11 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
   }
 
   void FreeDataSpace(Device dev, void* ptr) final {
-    endpoint_->SysCallRemote(RPCCode::kDevFreeData, dev, ptr);
+    if (batch_mode_) {
+      endpoint_->PipelinedSysCallRemote(RPCCode::kDevFreeData, dev, ptr);
+    } else {
+      endpoint_->SysCallRemote(RPCCode::kDevFreeData, dev, ptr);
+    }
   }
 
   void CopyDataFromTo(DLTensor* from, DLTensor* to, TVMStreamHandle stream) final {
@@ -1127,6 +1287,94 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
   bool IsLocalSession() const final { return false; }
 
  private:
+  uint64_t GetBlockSize(DLTensor* tensor, RPCCode code, uint64_t nbytes) {
+    uint64_t overhead = RemoteCopyCalculatePacketOverheadSize(tensor, code, nbytes);
+    uint64_t rpc_max_size = GetRPCMaxTransferSize();
+    ICHECK_GT(rpc_max_size, overhead) << RPCCodeToString(code) << ": Invalid block size!";
+    uint64_t block_size = rpc_max_size - overhead;
+    if (chunk_bytes_ != 0 && chunk_bytes_ < block_size) {
+      // Keep the elements whole, the remote byte swaps every block on its own.
+      uint64_t elem_bytes = (tensor->dtype.bits * tensor->dtype.lanes + 7) / 8;
+      block_size = std::max(elem_bytes, chunk_bytes_ / elem_bytes * elem_bytes);
+    }
+    return block_size;
+  }
+
+  // Whether to compress a copy of nbytes, the remote has to provide the codec.
+  bool UseCompression(uint64_t nbytes) {
+    if (compress_min_bytes_ == 0 || nbytes < compress_min_bytes_) {
+      return false;
+    }
+    if (!compression_probed_) {
+      lz_copy_to_remote_ = GetFunction("tvm.rpc.server.LZCopyToRemote");
+      lz_copy_from_remote_ = GetFunction("tvm.rpc.server.LZCopyFromRemote");
+      compression_probed_ = true;
+    }
+    return lz_copy_to_remote_ != nullptr && lz_copy_from_remote_ != nullptr;
+  }
+
+  uint64_t GetCompressBlockSize(DLTensor* tensor) {
+    // Keep the elements whole, the remote byte swaps every block on its own.
+    uint64_t elem_bytes = (tensor->dtype.bits * tensor->dtype.lanes + 7) / 8;
+    return std::max(elem_bytes, kRPCCompressBlockBytes / elem_bytes * elem_bytes);
+  }
+
+  void CompressedCopyToRemote(char* local_from_bytes, DLTensor* remote_to, uint64_t nbytes) {
+    const uint64_t block_size = GetCompressBlockSize(remote_to);
+    std::vector<char> buffer(support::LZCompressBound(block_size));
+    DLTensor to = *remote_to;
+    for (uint64_t offset = 0; offset < nbytes; offset += block_size) {
+      uint64_t size = std::min(block_size, nbytes - offset);
+      to.byte_offset = offset;
+      size_t compressed = support::LZCompress(local_from_bytes + offset, size, buffer.data());
+      if (!RPCCompressionPays(compressed, size)) {
+        endpoint_->PipelinedCopyToRemote(local_from_bytes + offset, &to, size);
+        continue;
+      }
+      // The request is written out before the call returns, the buffer can be reused.
+      TVMByteArray blob{buffer.data(), compressed};
+      TVMValue values[3];
+      int type_codes[3];
+      TVMArgsSetter setter(values, type_codes);
+      setter(0, &to);
+      setter(1, blob);
+      setter(2, static_cast<int64_t>(size));
+      endpoint_->PipelinedCallFunc(lz_copy_to_remote_, values, type_codes, 3, nullptr);
+    }
+    if (!batch_mode_) {
+      endpoint_->WaitPending();
+    }
+  }
+
+  void CompressedCopyFromRemote(DLTensor* remote_from, char* local_to_bytes, uint64_t nbytes) {
+    // The replies do not fit the pipeline window, so the blocks are fetched one at a time.
+    const uint64_t block_size = GetCompressBlockSize(remote_from);
+    DLTensor from = *remote_from;
+    for (uint64_t offset = 0; offset < nbytes; offset += block_size) {
+      uint64_t size = std::min(block_size, nbytes - offset);
+      char* dst = local_to_bytes + offset;
+      from.byte_offset = offset;
+      TVMValue values[2];
+      int type_codes[2];
+      TVMArgsSetter setter(values, type_codes);
+      setter(0, &from);
+      setter(1, static_cast<int64_t>(size));
+      endpoint_->CallFunc(lz_copy_from_remote_, values, type_codes, 2, [dst, size](TVMArgs args) {
+        // args[1] is the reply: a byte telling whether the block is compressed, then the block.
+        ICHECK_EQ(args.type_codes[1], kTVMBytes);
+        const TVMByteArray* reply = static_cast<TVMByteArray*>(args.values[1].v_handle);
+        ICHECK_GE(reply->size, 1U);
+        if (reply->data[0] != 0) {
+          ICHECK(support::LZDecompress(reply->data + 1, reply->size - 1, dst, size))
+              << "CopyFromRemote: corrupted compressed block";
+        } else {
+          ICHECK_EQ(reply->size - 1, size);
+          std::memcpy(dst, reply->data + 1, size);
+        }
+      });
+    }
+  }
+
   uint64_t GetRPCMaxTransferSize() {
     if (rpc_chunk_max_size_bytes_ > 0) {
       return (uint64_t)rpc_chunk_max_size_bytes_;
@@ -1150,6 +1398,16 @@ class RPCClientSession : public RPCSession, public DeviceAPI {
 
   std::shared_ptr<RPCEndpoint> endpoint_;
   int64_t rpc_chunk_max_size_bytes_ = -1;
+  // Size of the blocks copies are split into, 0 to only split at the max transfer size.
+  uint64_t chunk_bytes_ = 0;
+  // Whether copies to the remote and frees return without waiting for the reply.
+  bool batch_mode_ = false;
+  // Compress copies of at least this many bytes, 0 to never compress.
+  uint64_t compress_min_bytes_ = 0;
+  // Whether the remote codec was looked up, the handles stay null on older servers.
+  bool compression_probed_ = false;
+  PackedFuncHandle lz_copy_to_remote_ = nullptr;
+  PackedFuncHandle lz_copy_from_remote_ = nullptr;
 };
 
 std::shared_ptr<RPCSession> CreateClientSession(std::shared_ptr<RPCEndpoint> endpoint) {
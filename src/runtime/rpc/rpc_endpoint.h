@@ -26,10 +26,13 @@
 
 #include <tvm/runtime/packed_func.h>
 
+#include <deque>
+#include <exception>
 #include <memory>
 #include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "../../support/ring_buffer.h"
 #include "../minrpc/rpc_reference.h"
@@ -47,6 +50,20 @@ const int kRPCTrackerMagic = 0x2f271;
 const int kRPCSuccess = kRPCMagic + 0;
 // cannot found matched key in server
 const int kRPCMismatch = kRPCMagic + 2;
+// default bound on the reply bytes that pipelined requests leave unread on the channel
+const uint64_t kRPCPipelineWindowBytes = 32 << 10;
+// size of the blocks compressed copies are split into
+const uint64_t kRPCCompressBlockBytes = 1 << 20;
+
+/*!
+ * \brief Whether to send a compressed block rather than the raw bytes.
+ * \param compressed_nbytes The compressed size.
+ * \param nbytes The raw size.
+ * \note The saving has to pay for the decompression on the receiver.
+ */
+inline bool RPCCompressionPays(uint64_t compressed_nbytes, uint64_t nbytes) {
+  return compressed_nbytes < nbytes - nbytes / 8;
+}
 
 /*! \brief Enumeration code for the RPC tracker */
 enum class TrackerCode : int {
@@ -148,6 +165,48 @@ class RPCEndpoint {
    */
   void CopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes);
 
+  /*!
+   * \brief Call into remote function without waiting for the reply.
+   * \param handle The function handle
+   * \param arg_values The argument values.
+   * \param arg_type_codes the type codes of the argument.
+   * \param num_args Number of arguments.
+   * \param fencode_return The function to receive return value encodings,
+   *        called when the reply is read. Remote objects returned are freed instead.
+   */
+  void PipelinedCallFunc(RPCSession::PackedFuncHandle handle, const TVMValue* arg_values,
+                         const int* arg_type_codes, int num_args,
+                         RPCSession::FEncodeReturn encode_return);
+  /*!
+   * \brief Copy bytes into remote array content without waiting for the reply.
+   * \param from_bytes The source host data, can be reused once the call returns.
+   * \param to The target array.
+   * \param nbytes The size of the memory in bytes.
+   */
+  void PipelinedCopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes);
+  /*!
+   * \brief Request bytes from remote array content without waiting for the reply.
+   * \param from The source array.
+   * \param to_bytes The target host data, written when the reply is read.
+   * \param nbytes The size of the memory in bytes.
+   */
+  void PipelinedCopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes);
+  /*!
+   * \brief Wait for the replies of all the pipelined requests.
+   * \note Raises the first error returned by any of them.
+   */
+  void WaitPending();
+  /*!
+   * \brief Set the maximum reply bytes that pipelined requests leave unread.
+   *
+   *  The remote blocks once the channel cannot buffer its replies, so the window
+   *  must stay below the buffer size of the channel, or the remote could block
+   *  while we are blocked sending it more requests.
+   *
+   * \param window_bytes The window size in bytes.
+   */
+  void SetPipelineWindow(uint64_t window_bytes);
+
   /*!
    * \brief Call a remote defined system function with arguments.
    * \param fcode The function code.
@@ -156,6 +215,13 @@ class RPCEndpoint {
    */
   template <typename... Args>
   inline TVMRetValue SysCallRemote(RPCCode fcode, Args&&... args);
+  /*!
+   * \brief Call a remote defined system function without waiting for the reply.
+   * \param fcode The function code.
+   * \param args The arguments
+   */
+  template <typename... Args>
+  inline void PipelinedSysCallRemote(RPCCode fcode, Args&&... args);
   /*!
    * \brief Create a RPC session with given channel.
    * \param channel The communication channel.
@@ -171,6 +237,36 @@ class RPCEndpoint {
 
  private:
   class EventHandler;
+  /*! \brief A request whose reply has not been read yet. */
+  struct PendingReply {
+    /*! \brief The expected reply, kReturn or kCopyAck. */
+    RPCCode code;
+    /*! \brief Receives the return value of a kReturn, can be nullptr. */
+    RPCSession::FEncodeReturn on_return;
+    /*! \brief Receives the bytes of a kCopyAck. */
+    void* to_bytes;
+    /*! \brief The number of bytes of a kCopyAck. */
+    uint64_t nbytes;
+    /*! \brief Upper estimate of the size of the reply. */
+    uint64_t reply_nbytes;
+  };
+  // Write the requests into the writer and queue their replies, with mutex_ held.
+  void SendCallFunc(RPCSession::PackedFuncHandle handle, const TVMValue* arg_values,
+                    const int* arg_type_codes, int num_args,
+                    RPCSession::FEncodeReturn encode_return);
+  void SendCopyToRemote(void* from_bytes, DLTensor* to, uint64_t nbytes);
+  void SendCopyFromRemote(DLTensor* from, void* to_bytes, uint64_t nbytes);
+  void SendSysCall(TVMArgs all_args, RPCSession::FEncodeReturn encode_return);
+  // Send the frees of dropped_handles_, with mutex_ held.
+  void SendDroppedFrees();
+  // Read the oldest replies until a reply of reply_nbytes fits in the window.
+  void ReserveReply(uint64_t reply_nbytes);
+  // Read the oldest reply, keeping its error for WaitPendingReplies.
+  void ReadReply();
+  // Read all the replies and raise the first error, with mutex_ held.
+  void WaitPendingReplies();
+  // Send out everything in the writer.
+  void FlushWriter();
   // Handle events until receives a return
   // Also flushes channels so that the function advances.
   RPCCode HandleUntilReturnEvent(bool client_mode, RPCSession::FEncodeReturn setreturn);
@@ -188,6 +284,19 @@ class RPCEndpoint {
   std::shared_ptr<EventHandler> handler_;
   // syscall remote with specified function code.
   PackedFunc syscall_remote_;
+  // syscall remote that does not wait for the reply.
+  PackedFunc pipelined_syscall_remote_;
+  // Requests sent whose replies are not read yet, oldest first.
+  std::deque<PendingReply> pending_;
+  // Sum of the reply estimates of pending_.
+  uint64_t pending_reply_nbytes_{0};
+  // Bound on pending_reply_nbytes_.
+  uint64_t pipeline_window_bytes_{kRPCPipelineWindowBytes};
+  // First error raised by a pending reply.
+  std::exception_ptr pending_error_;
+  // Remote objects returned by pipelined calls. They are found while reading a reply, when no
+  // request can be sent, and freed once the reply is handled.
+  std::vector<std::pair<void*, int>> dropped_handles_;
   // The name of the session.
   std::string name_;
   // The remote key
@@ -209,6 +318,11 @@ inline TVMRetValue RPCEndpoint::SysCallRemote(RPCCode code, Args&&... args) {
   return syscall_remote_(static_cast<int>(code), std::forward<Args>(args)...);
 }
 
+template <typename... Args>
+inline void RPCEndpoint::PipelinedSysCallRemote(RPCCode code, Args&&... args) {
+  pipelined_syscall_remote_(static_cast<int>(code), std::forward<Args>(args)...);
+}
+
 /*!
  * \brief Calculates overhead size of a CopyToRemote packet.
  * \param to DLTensor to copy.
@@ -81,7 +81,8 @@ NDArray NDArrayFromRemoteOpaqueHandle(std::shared_ptr<RPCSession> sess, void* ha
  */
 class RPCWrappedFunc : public Object {
  public:
-  RPCWrappedFunc(void* handle, std::shared_ptr<RPCSession> sess) : handle_(handle), sess_(sess) {}
+  RPCWrappedFunc(void* handle, std::shared_ptr<RPCSession> sess, bool pipelined = false)
+      : handle_(handle), sess_(sess), pipelined_(pipelined) {}
 
   void operator()(TVMArgs args, TVMRetValue* rv) const {
     std::vector<TVMValue> values(args.values, args.values + args.size());
@@ -123,6 +124,12 @@ class RPCWrappedFunc : public Object {
         }
       }
     }
+    if (pipelined_) {
+      // The reply is read after we return, so the return value is dropped. The session frees
+      // the remote objects it holds.
+      sess_->PipelinedCallFunc(handle_, values.data(), type_codes.data(), args.size(), nullptr);
+      return;
+    }
     auto set_return = [this, rv](TVMArgs args) { this->WrapRemoteReturnToValue(args, rv); };
     sess_->CallFunc(handle_, values.data(), type_codes.data(), args.size(), set_return);
   }
@@ -140,6 +147,8 @@ class RPCWrappedFunc : public Object {
   void* handle_{nullptr};
   // pointer to the session.
   std::shared_ptr<RPCSession> sess_;
+  // whether calls return without waiting for the reply.
+  bool pipelined_{false};
 
   // unwrap a remote value to the underlying handle.
   void* UnwrapRemoteValueToHandle(const TVMArgValue& arg) const;
@@ -207,6 +216,32 @@ class RPCModuleNode final : public ModuleNode {
     }
   }
 
+  PackedFunc GetPipelinedFunction(const std::string& name) {
+    RPCSession::PackedFuncHandle handle = nullptr;
+    if (module_handle_ == nullptr) {
+      handle = sess_->GetFunction(name);
+    } else {
+      // Call the remote getter directly, to keep the raw handle of the function.
+      RPCSession::PackedFuncHandle get_function =
+          sess_->GetFunction("tvm.rpc.server.ModuleGetFunction");
+      ICHECK(get_function != nullptr)
+          << "Cannot found remote function tvm.rpc.server.ModuleGetFunction";
+      TVMValue values[3];
+      int type_codes[3] = {kTVMModuleHandle, kTVMStr, kDLInt};
+      values[0].v_handle = module_handle_;
+      values[1].v_str = name.c_str();
+      values[2].v_int64 = 1;
+      sess_->CallFunc(get_function, values, type_codes, 3, [&handle](TVMArgs args) {
+        int tcode = args[0];
+        if (tcode == kTVMPackedFuncHandle) handle = args[1];
+      });
+      sess_->FreeHandle(get_function, kTVMPackedFuncHandle);
+    }
+    if (handle == nullptr) return PackedFunc();
+    auto wf = std::make_shared<RPCWrappedFunc>(handle, sess_, true);
+    return PackedFunc([wf](TVMArgs args, TVMRetValue* rv) { return wf->operator()(args, rv); });
+  }
+
   Module LoadModule(std::string name) {
     InitRemoteFunc(&remote_load_module_, "tvm.rpc.server.load_module");
     return remote_load_module_(name);
@@ -484,6 +519,32 @@ TVM_REGISTER_GLOBAL("rpc.SessTableIndex").set_body([](TVMArgs args, TVMRetValue*
   *rv = static_cast<RPCModuleNode*>(m.operator->())->sess()->table_index();
 });
 
+TVM_REGISTER_GLOBAL("rpc.GetPipelinedFunction").set_body_typed([](Module mod, std::string name) {
+  std::string tkey = mod->type_key();
+  ICHECK_EQ(tkey, "rpc");
+  return static_cast<RPCModuleNode*>(mod.operator->())->GetPipelinedFunction(name);
+});
+
+TVM_REGISTER_GLOBAL("rpc.SessSetBatchMode").set_body_typed([](Module sess, bool enable) {
+  RPCModuleGetSession(sess)->SetBatchMode(enable);
+});
+
+TVM_REGISTER_GLOBAL("rpc.SessWaitPending").set_body_typed([](Module sess) {
+  RPCModuleGetSession(sess)->WaitPending();
+});
+
+TVM_REGISTER_GLOBAL("rpc.SessSetTransferOptions")
+    .set_body_typed([](Module sess, int64_t chunk_bytes, int64_t window_bytes) {
+      ICHECK_GE(chunk_bytes, 0);
+      ICHECK_GE(window_bytes, 0);
+      RPCModuleGetSession(sess)->SetTransferOptions(chunk_bytes, window_bytes);
+    });
+
+TVM_REGISTER_GLOBAL("rpc.SessSetCompression").set_body_typed([](Module sess, int64_t min_bytes) {
+  ICHECK_GE(min_bytes, 0);
+  RPCModuleGetSession(sess)->SetCompression(min_bytes);
+});
+
 TVM_REGISTER_GLOBAL("tvm.rpc.NDArrayFromRemoteOpaqueHandle")
     .set_body_typed([](Module mod, void* remote_array, DLTensor* template_tensor, Device dev,
                        void* ndarray_handle) -> NDArray {
@@ -21,9 +21,17 @@
  * \file rpc_server_env.cc
  * \brief Server environment of the RPC.
  */
+#include <dmlc/endian.h>
+#include <tvm/runtime/device_api.h>
 #include <tvm/runtime/registry.h>
 
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "../../support/lz_codec.h"
 #include "../file_utils.h"
+#include "rpc_endpoint.h"
 
 namespace tvm {
 namespace runtime {
@@ -41,6 +49,17 @@ TVM_REGISTER_GLOBAL("tvm.rpc.server.upload").set_body([](TVMArgs args, TVMRetVal
   SaveBinaryToFile(file_name, data);
 });
 
+TVM_REGISTER_GLOBAL("tvm.rpc.server.upload_compressed")
+    .set_body([](TVMArgs args, TVMRetValue* rv) {
+      std::string file_name = RPCGetPath(args[0]);
+      std::string blob = args[1];
+      int64_t nbytes = args[2];
+      std::string data(nbytes, '\0');
+      ICHECK(support::LZDecompress(blob.data(), blob.size(), &data[0], data.size()))
+          << "upload: corrupted compressed file " << file_name;
+      SaveBinaryToFile(file_name, data);
+    });
+
 TVM_REGISTER_GLOBAL("tvm.rpc.server.download").set_body([](TVMArgs args, TVMRetValue* rv) {
   std::string file_name = RPCGetPath(args[0]);
   std::string data;
@@ -52,6 +71,101 @@ TVM_REGISTER_GLOBAL("tvm.rpc.server.download").set_body([](TVMArgs args, TVMRetV
   *rv = arr;
 });
 
+// Copy nbytes between host memory and a tensor of any device, starting at its byte_offset.
+void CopyTensorBytes(DLTensor* tensor, char* host, uint64_t nbytes, bool to_tensor) {
+  int64_t shape = static_cast<int64_t>(nbytes);
+  DLTensor remote = *tensor;
+  remote.ndim = 1;
+  remote.shape = &shape;
+  remote.strides = nullptr;
+  remote.dtype = DLDataType{kDLUInt, 8, 1};
+  DLTensor local = remote;
+  local.data = host;
+  local.device = Device{kDLCPU, 0};
+  local.byte_offset = 0;
+  DeviceAPI* api = DeviceAPI::Get(tensor->device);
+  if (to_tensor) {
+    api->CopyDataFromTo(&local, &remote, nullptr);
+  } else {
+    api->CopyDataFromTo(&remote, &local, nullptr);
+  }
+  api->StreamSync(tensor->device, nullptr);
+}
+
+// The remote half of the compressed copies of RPCClientSession.
+TVM_REGISTER_GLOBAL("tvm.rpc.server.LZCopyToRemote").set_body([](TVMArgs args, TVMRetValue* rv) {
+  DLTensor* to = args[0];
+  ICHECK_EQ(args.type_codes[1], kTVMBytes);
+  const TVMByteArray* blob = static_cast<TVMByteArray*>(args.values[1].v_handle);
+  uint64_t nbytes = args[2].operator int64_t();
+  ICHECK_LE(to->byte_offset + nbytes, GetDataSize(*to)) << "CopyToRemote: overflow in tensor size";
+  std::vector<char> temp;
+  char* dptr;
+  if (to->device.device_type == kDLCPU) {
+    dptr = static_cast<char*>(to->data) + to->byte_offset;
+  } else {
+    temp.resize(nbytes);
+    dptr = temp.data();
+  }
+  ICHECK(support::LZDecompress(blob->data, blob->size, dptr, nbytes))
+      << "CopyToRemote: corrupted compressed block";
+  if (!DMLC_IO_NO_ENDIAN_SWAP) {
+    size_t elem_bytes = (to->dtype.bits * to->dtype.lanes + 7) / 8;
+    dmlc::ByteSwap(dptr, elem_bytes, nbytes / elem_bytes);
+  }
+  if (to->device.device_type != kDLCPU) {
+    CopyTensorBytes(to, dptr, nbytes, true);
+  }
+});
+
+TVM_REGISTER_GLOBAL("tvm.rpc.server.LZCopyFromRemote").set_body([](TVMArgs args, TVMRetValue* rv) {
+  DLTensor* from = args[0];
+  uint64_t nbytes = args[1].operator int64_t();
+  ICHECK_LE(from->byte_offset + nbytes, GetDataSize(*from))
+      << "CopyFromRemote: overflow in tensor size";
+  std::vector<char> temp;
+  const char* sptr;
+  if (from->device.device_type == kDLCPU && DMLC_IO_NO_ENDIAN_SWAP) {
+    sptr = static_cast<const char*>(from->data) + from->byte_offset;
+  } else {
+    temp.resize(nbytes);
+    if (from->device.device_type == kDLCPU) {
+      std::memcpy(temp.data(), static_cast<const char*>(from->data) + from->byte_offset, nbytes);
+    } else {
+      CopyTensorBytes(from, temp.data(), nbytes, false);
+    }
+    if (!DMLC_IO_NO_ENDIAN_SWAP) {
+      size_t elem_bytes = (from->dtype.bits * from->dtype.lanes + 7) / 8;
+      dmlc::ByteSwap(temp.data(), elem_bytes, nbytes / elem_bytes);
+    }
+    sptr = temp.data();
+  }
+  // A leading byte tells whether the block is compressed.
+  std::string reply(1 + support::LZCompressBound(nbytes), '\0');
+  size_t size = support::LZCompress(sptr, nbytes, &reply[1]);
+  if (RPCCompressionPays(size, nbytes)) {
+    reply[0] = 1;
+  } else {
+    std::memcpy(&reply[1], sptr, nbytes);
+    size = nbytes;
+  }
+  reply.resize(1 + size);
+  TVMByteArray arr;
+  arr.data = reply.data();
+  arr.size = reply.size();
+  *rv = arr;
+});
+
+TVM_REGISTER_GLOBAL("rpc.LZCompress").set_body([](TVMArgs args, TVMRetValue* rv) {
+  std::string data = args[0];
+  std::string out(support::LZCompressBound(data.size()), '\0');
+  out.resize(support::LZCompress(data.data(), data.size(), &out[0]));
+  TVMByteArray arr;
+  arr.data = out.data();
+  arr.size = out.size();
+  *rv = arr;
+});
+
 TVM_REGISTER_GLOBAL("tvm.rpc.server.remove").set_body([](TVMArgs args, TVMRetValue* rv) {
   std::string file_name = RPCGetPath(args[0]);
   RemoveFile(file_name);
@@ -41,6 +41,42 @@ void RPCSession::SendException(FAsyncCallback callback, const char* msg) {
   callback(RPCCode::kException, TVMArgs(&value, &tcode, 1));
 }
 
+void* RPCSession::GetReturnedHandle(TVMArgs args, int* type_code) {
+  int tcode = args[0];
+  if (tcode == kTVMPackedFuncHandle || tcode == kTVMModuleHandle) {
+    *type_code = tcode;
+    return args[1];
+  }
+  if (tcode == kTVMDLTensorHandle || tcode == kTVMNDArrayHandle) {
+    // Arrays are returned as a view followed by the handle of the NDArray which owns it.
+    *type_code = kTVMNDArrayHandle;
+    return args[2];
+  }
+  return nullptr;
+}
+
+void RPCSession::PipelinedCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
+                                   const int* arg_type_codes, int num_args,
+                                   const FEncodeReturn& fencode_return) {
+  void* returned_handle = nullptr;
+  int returned_type_code = 0;
+  this->CallFunc(func, arg_values, arg_type_codes, num_args, [&](TVMArgs args) {
+    returned_handle = GetReturnedHandle(args, &returned_type_code);
+    if (returned_handle == nullptr && fencode_return != nullptr) fencode_return(args);
+  });
+  if (returned_handle != nullptr) {
+    this->FreeHandle(returned_handle, returned_type_code);
+  }
+}
+
+void RPCSession::SetBatchMode(bool enable) {}
+
+void RPCSession::WaitPending() {}
+
+void RPCSession::SetTransferOptions(uint64_t chunk_bytes, uint64_t window_bytes) {}
+
+void RPCSession::SetCompression(uint64_t min_bytes) {}
+
 void RPCSession::AsyncCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
                                const int* arg_type_codes, int num_args, FAsyncCallback callback) {
   try {
@@ -176,6 +176,70 @@ class RPCSession {
    */
   virtual bool IsLocalSession() const = 0;
 
+  /*!
+   * \brief Get the remote object owned by a return value.
+   * \param args The encoding of the return value given to FEncodeReturn.
+   * \param type_code Set to the type code to free the object with.
+   * \return The handle of the object, nullptr if the return value owns none.
+   */
+  static void* GetReturnedHandle(TVMArgs args, int* type_code);
+
+  // Pipelined variant of API
+  // A client session can send requests without waiting for their replies.
+  // The remote serves requests in order, so the replies are read back in
+  // order, either when too many are outstanding or in WaitPending.
+  // Sessions that cannot pipeline serve these APIs synchronously.
+
+  /*!
+   * \brief Call func without waiting for its reply.
+   * \param func The function handle.
+   * \param arg_values The argument values.
+   * \param arg_type_codes the type codes of the argument.
+   * \param num_args Number of arguments.
+   * \param fencode_return The function to set the return value, called when the
+   *        reply is read. It must not refer to state that dies before then. It is
+   *        only given values which own no remote object, those are freed instead.
+   */
+  virtual void PipelinedCallFunc(PackedFuncHandle func, const TVMValue* arg_values,
+                                 const int* arg_type_codes, int num_args,
+                                 const FEncodeReturn& fencode_return);
+
+  /*!
+   * \brief Begin or end a batch.
+   *
+   *  Inside a batch, copies to the remote and frees of remote handles return as
+   *  soon as the request is sent. Their errors are raised by a later call that
+   *  waits for its reply, or by WaitPending.
+   *
+   * \param enable Whether to begin or to end the batch.
+   */
+  virtual void SetBatchMode(bool enable);
+
+  /*!
+   * \brief Wait for the replies of all the outstanding requests.
+   * \note Raises the first error returned by any of them.
+   */
+  virtual void WaitPending();
+
+  /*!
+   * \brief Configure how copies are pipelined.
+   * \param chunk_bytes Split copies into chunks of this size, so the remote copies
+   *        one chunk while the next one is in flight. 0 sends each copy whole.
+   * \param window_bytes The maximum reply bytes left unread on the channel, must stay
+   *        below what the channel buffers. 0 keeps the current window.
+   */
+  virtual void SetTransferOptions(uint64_t chunk_bytes, uint64_t window_bytes);
+
+  /*!
+   * \brief Compress the payload of large copies.
+   *
+   *  Compression only happens when the remote provides the codec, older
+   *  servers keep receiving raw copies.
+   *
+   * \param min_bytes Compress copies of at least this many bytes, 0 disables compression.
+   */
+  virtual void SetCompression(uint64_t min_bytes);
+
   // Asynchrous variant of API
   // These APIs are used by the RPC server to allow sessions that
   // have special implementations for the async functions.
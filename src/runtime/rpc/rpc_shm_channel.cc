@@ -0,0 +1,297 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rpc_shm_channel.cc
+ * \brief Shared memory RPC channel.
+ */
+#include "rpc_shm_channel.h"
+
+#include <tvm/runtime/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+
+// Linux only for now, the rings sleep on futexes.
+#if defined(__linux__) && !defined(__ANDROID__)
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+#define TVM_RPC_SHM_SUPPORTED 1
+#endif
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief One direction of the channel, a single producer single consumer byte ring.
+ *  head and tail count the bytes ever written and read, seq is bumped on every
+ *  change of either so a sleeping peer can wait on it.
+ */
+struct ShmChannel::Ring {
+  alignas(64) std::atomic<uint64_t> head;
+  alignas(64) std::atomic<uint64_t> tail;
+  alignas(64) std::atomic<uint32_t> seq;
+  std::atomic<uint32_t> num_waiters;
+  std::atomic<uint32_t> closed;
+};
+
+/*! \brief The header of the segment, followed by the data of the two rings. */
+struct ShmChannel::Segment {
+  uint64_t magic;
+  uint64_t capacity;
+  std::atomic<uint32_t> attached;
+  // rings[0] goes from the client to the server, rings[1] back.
+  Ring rings[2];
+};
+
+#ifdef TVM_RPC_SHM_SUPPORTED
+
+namespace {
+
+constexpr uint64_t kShmMagic = 0x54564d53484d3031;  // "TVMSHM01"
+// Polls of the ring before sleeping on the futex.
+constexpr int kSpinCount = 1024;
+// Sleep at most this long at once, to check whether the peer is still alive.
+constexpr int64_t kPollPeerMs = 100;
+
+void FutexWait(std::atomic<uint32_t>* addr, uint32_t expected, int64_t timeout_ms) {
+  struct timespec ts;
+  ts.tv_sec = timeout_ms / 1000;
+  ts.tv_nsec = (timeout_ms % 1000) * 1000000;
+  // Not FUTEX_PRIVATE_FLAG, the word is shared with another process.
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAIT, expected, &ts, nullptr, 0);
+}
+
+void FutexWakeAll(std::atomic<uint32_t>* addr) {
+  syscall(SYS_futex, reinterpret_cast<uint32_t*>(addr), FUTEX_WAKE, INT32_MAX, nullptr, nullptr,
+          0);
+}
+
+// Bump the futex word of a ring and wake the peer if it sleeps on it.
+void NotifyRing(std::atomic<uint32_t>* seq, std::atomic<uint32_t>* num_waiters) {
+  seq->fetch_add(1);
+  if (num_waiters->load() != 0) FutexWakeAll(seq);
+}
+
+std::string SegmentPath(const std::string& name) { return "/dev/shm/" + name; }
+
+}  // namespace
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "the rings need lock free atomics to be shared between processes");
+
+size_t ShmChannel::DataOffset() { return (sizeof(Segment) + 63) / 64 * 64; }
+
+std::unique_ptr<ShmChannel> ShmChannel::Create(size_t capacity) {
+  if (capacity == 0) {
+    const char* env = std::getenv("TVM_RPC_SHM_CAPACITY");
+    capacity = env != nullptr ? std::strtoull(env, nullptr, 10) : kDefaultCapacity;
+  }
+  ICHECK_GT(capacity, 0) << "TVM_RPC_SHM_CAPACITY must be positive";
+  std::unique_ptr<ShmChannel> channel(new ShmChannel());
+  std::random_device rd;
+  channel->name_ = "tvm_rpc_" + std::to_string(getpid()) + "_" + std::to_string(rd());
+  channel->segment_bytes_ = DataOffset() + 2 * capacity;
+
+  int fd = open(SegmentPath(channel->name_).c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  ICHECK_NE(fd, -1) << "Cannot create shared memory segment " << channel->name_ << ": "
+                    << strerror(errno);
+  channel->owner_ = true;
+  if (ftruncate(fd, channel->segment_bytes_) != 0) {
+    close(fd);
+    LOG(FATAL) << "Cannot size shared memory segment " << channel->name_ << ": "
+               << strerror(errno);
+  }
+  void* ptr =
+      mmap(nullptr, channel->segment_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  ICHECK(ptr != MAP_FAILED) << "Cannot map shared memory segment " << channel->name_;
+  // The file starts zeroed, which is the initial state of the atomics.
+  Segment* segment = static_cast<Segment*>(ptr);
+  segment->magic = kShmMagic;
+  segment->capacity = capacity;
+  channel->segment_ = segment;
+  channel->send_ring_ = &segment->rings[0];
+  channel->recv_ring_ = &segment->rings[1];
+  channel->send_data_ = static_cast<char*>(ptr) + DataOffset();
+  channel->recv_data_ = channel->send_data_ + capacity;
+  return channel;
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::Attach(const std::string& name, support::TCPSocket sock) {
+  std::unique_ptr<ShmChannel> channel(new ShmChannel());
+  channel->name_ = name;
+  channel->sock_ = sock;
+  ICHECK(name.find('/') == std::string::npos) << "Invalid shared memory segment " << name;
+  int fd = open(SegmentPath(name).c_str(), O_RDWR);
+  ICHECK_NE(fd, -1) << "Cannot open shared memory segment " << name << ", the client must run "
+                    << "on the same host: " << strerror(errno);
+  struct stat st;
+  ICHECK_EQ(fstat(fd, &st), 0);
+  channel->segment_bytes_ = st.st_size;
+  void* ptr =
+      mmap(nullptr, channel->segment_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  ICHECK(ptr != MAP_FAILED) << "Cannot map shared memory segment " << name;
+  Segment* segment = static_cast<Segment*>(ptr);
+  channel->segment_ = segment;
+  ICHECK_EQ(segment->magic, kShmMagic) << "Invalid shared memory segment " << name;
+  ICHECK_EQ(DataOffset() + 2 * segment->capacity, channel->segment_bytes_);
+  channel->send_ring_ = &segment->rings[1];
+  channel->recv_ring_ = &segment->rings[0];
+  channel->recv_data_ = static_cast<char*>(ptr) + DataOffset();
+  channel->send_data_ = channel->recv_data_ + segment->capacity;
+  segment->attached.store(1);
+  FutexWakeAll(&segment->attached);
+  return channel;
+}
+
+void ShmChannel::WaitForServer(support::TCPSocket sock, int64_t timeout_ms) {
+  sock_ = sock;
+  auto start = std::chrono::steady_clock::now();
+  while (segment_->attached.load() == 0) {
+    int64_t elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                             std::chrono::steady_clock::now() - start)
+                             .count();
+    ICHECK(PeerAlive() && elapsed_ms < timeout_ms)
+        << "The RPC server did not attach the shared memory segment " << name_
+        << ", it must run on the same host and support the shm transport";
+    FutexWait(&segment_->attached, 0, std::min(kPollPeerMs, timeout_ms - elapsed_ms));
+  }
+  unlink(SegmentPath(name_).c_str());
+  owner_ = false;
+}
+
+ShmChannel::~ShmChannel() {
+  if (segment_ != nullptr) {
+    // Tell the peer that we neither write nor read anymore.
+    for (Ring* ring : {send_ring_, recv_ring_}) {
+      ring->closed.store(1);
+      NotifyRing(&ring->seq, &ring->num_waiters);
+    }
+    munmap(segment_, segment_bytes_);
+  }
+  if (owner_) {
+    unlink(SegmentPath(name_).c_str());
+  }
+  try {
+    if (!sock_.BadSocket()) {
+      sock_.Close();
+    }
+  } catch (...) {
+  }
+}
+
+bool ShmChannel::PeerAlive() {
+  if (sock_.IsClosed()) return true;
+  char byte;
+  ssize_t n = recv(sock_.sockfd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+  // The peer does not send anything on the socket, so a readable socket means it was closed.
+  return n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+}
+
+template <typename FReady>
+bool ShmChannel::WaitUntil(Ring* ring, FReady ready) {
+  for (int i = 0; i < kSpinCount; ++i) {
+    if (ready()) return true;
+  }
+  while (true) {
+    uint32_t seq = ring->seq.load();
+    if (ready()) return true;
+    ring->num_waiters.fetch_add(1);
+    if (!ready()) FutexWait(&ring->seq, seq, kPollPeerMs);
+    ring->num_waiters.fetch_sub(1);
+    if (ready()) return true;
+    if (ring->closed.load() != 0 || !PeerAlive()) return false;
+  }
+}
+
+size_t ShmChannel::Send(const void* data, size_t size) {
+  const uint64_t capacity = segment_->capacity;
+  Ring* ring = send_ring_;
+  uint64_t head = ring->head.load(std::memory_order_relaxed);
+  bool has_space = WaitUntil(ring, [&]() {
+    return ring->closed.load(std::memory_order_relaxed) != 0 || head - ring->tail.load() < capacity;
+  });
+  if (!has_space || ring->closed.load() != 0) {
+    LOG(FATAL) << "Shared memory channel " << name_ << " is closed by the peer";
+  }
+  size_t nbytes = std::min<uint64_t>(size, capacity - (head - ring->tail.load()));
+  size_t offset = head % capacity;
+  size_t first = std::min<uint64_t>(nbytes, capacity - offset);
+  std::memcpy(send_data_ + offset, data, first);
+  std::memcpy(send_data_, static_cast<const char*>(data) + first, nbytes - first);
+  ring->head.store(head + nbytes);
+  NotifyRing(&ring->seq, &ring->num_waiters);
+  return nbytes;
+}
+
+size_t ShmChannel::Recv(void* data, size_t size) {
+  const uint64_t capacity = segment_->capacity;
+  Ring* ring = recv_ring_;
+  uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+  if (!WaitUntil(ring, [&]() { return ring->head.load() != tail; })) {
+    // The peer closed its end, or exited.
+    return 0;
+  }
+  size_t nbytes = std::min<uint64_t>(size, ring->head.load() - tail);
+  size_t offset = tail % capacity;
+  size_t first = std::min<uint64_t>(nbytes, capacity - offset);
+  std::memcpy(data, recv_data_ + offset, first);
+  std::memcpy(static_cast<char*>(data) + first, recv_data_, nbytes - first);
+  ring->tail.store(tail + nbytes);
+  NotifyRing(&ring->seq, &ring->num_waiters);
+  return nbytes;
+}
+
+#else
+
+std::unique_ptr<ShmChannel> ShmChannel::Create(size_t capacity) {
+  LOG(FATAL) << "The shared memory RPC channel is only supported on Linux";
+  return nullptr;
+}
+
+std::unique_ptr<ShmChannel> ShmChannel::Attach(const std::string& name, support::TCPSocket sock) {
+  LOG(FATAL) << "The shared memory RPC channel is only supported on Linux";
+  return nullptr;
+}
+
+void ShmChannel::WaitForServer(support::TCPSocket sock, int64_t timeout_ms) {}
+
+ShmChannel::~ShmChannel() {}
+
+size_t ShmChannel::Send(const void* data, size_t size) { return 0; }
+
+size_t ShmChannel::Recv(void* data, size_t size) { return 0; }
+
+#endif  // TVM_RPC_SHM_SUPPORTED
+
+}  // namespace runtime
+}  // namespace tvm
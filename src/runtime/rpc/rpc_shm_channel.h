@@ -0,0 +1,105 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file rpc_shm_channel.h
+ * \brief Shared memory RPC channel between two processes on the same host.
+ *
+ *  The client creates a segment holding one ring buffer per direction and
+ *  passes its name to the server during the socket handshake. After the
+ *  server maps the segment, the bytes of the session go through the rings
+ *  instead of the kernel. The peers spin briefly and then sleep on a futex
+ *  when a ring is empty or full. The socket stays open and is only used to
+ *  notice when the peer exits.
+ */
+#ifndef TVM_RUNTIME_RPC_RPC_SHM_CHANNEL_H_
+#define TVM_RUNTIME_RPC_RPC_SHM_CHANNEL_H_
+
+#include <memory>
+#include <string>
+
+#include "../../support/socket.h"
+#include "rpc_channel.h"
+
+namespace tvm {
+namespace runtime {
+
+class ShmChannel final : public RPCChannel {
+ public:
+  /*! \brief Default capacity of each ring, can be changed with TVM_RPC_SHM_CAPACITY. */
+  static constexpr size_t kDefaultCapacity = 16 << 20;
+
+  ~ShmChannel();
+  /*!
+   * \brief Create a new segment, on the client side.
+   * \param capacity The capacity of each ring in bytes, 0 for the default.
+   * \return The channel, which is not usable until the server attaches.
+   */
+  static std::unique_ptr<ShmChannel> Create(size_t capacity = 0);
+  /*!
+   * \brief Map the segment created by a client, on the server side.
+   * \param name The name of the segment.
+   * \param sock The socket connected to the client.
+   * \return The channel.
+   */
+  static std::unique_ptr<ShmChannel> Attach(const std::string& name, support::TCPSocket sock);
+  /*!
+   * \brief Wait until the server attaches, on the client side.
+   *
+   *  The segment is unlinked afterwards, so it goes away with the two processes.
+   *
+   * \param sock The socket connected to the server.
+   * \param timeout_ms Give up after this long, the server may not support the
+   *        channel or may run on another host.
+   */
+  void WaitForServer(support::TCPSocket sock, int64_t timeout_ms);
+  /*! \return The name of the segment. */
+  const std::string& name() const { return name_; }
+
+  size_t Send(const void* data, size_t size) final;
+  size_t Recv(void* data, size_t size) final;
+
+ private:
+  struct Segment;
+  struct Ring;
+  ShmChannel() = default;
+  // Offset of the ring data from the start of the segment.
+  static size_t DataOffset();
+  // Whether the peer still holds its end of the socket.
+  bool PeerAlive();
+  // Wait until ready() holds, return false if the peer is gone first.
+  template <typename FReady>
+  bool WaitUntil(Ring* ring, FReady ready);
+
+  std::string name_;
+  Segment* segment_{nullptr};
+  size_t segment_bytes_{0};
+  // Whether we created the segment and have to unlink it.
+  bool owner_{false};
+  // Rings we write to and read from.
+  Ring* send_ring_{nullptr};
+  Ring* recv_ring_{nullptr};
+  char* send_data_{nullptr};
+  char* recv_data_{nullptr};
+  support::TCPSocket sock_;
+};
+
+}  // namespace runtime
+}  // namespace tvm
+#endif  // TVM_RUNTIME_RPC_RPC_SHM_CHANNEL_H_
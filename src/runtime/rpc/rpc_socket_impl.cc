@@ -29,6 +29,7 @@
 #include "rpc_endpoint.h"
 #include "rpc_local_session.h"
 #include "rpc_session.h"
+#include "rpc_shm_channel.h"
 
 namespace tvm {
 namespace runtime {
@@ -64,8 +65,17 @@ class SockChannel final : public RPCChannel {
   support::TCPSocket sock_;
 };
 
+// How long a client waits for the server to map the shared memory segment.
+constexpr int64_t kShmAttachTimeoutMs = 30000;
+
 std::shared_ptr<RPCEndpoint> RPCConnect(std::string url, int port, std::string key,
-                                        TVMArgs init_seq) {
+                                        TVMArgs init_seq, bool use_shm = false) {
+  std::unique_ptr<ShmChannel> shm;
+  if (use_shm) {
+    // The server parses the name from the key and maps the segment.
+    shm = ShmChannel::Create();
+    key += " -shm=" + shm->name();
+  }
   support::TCPSocket sock;
   support::SockAddr addr(url.c_str(), port);
   sock.Create(addr.ss_family());
@@ -96,14 +106,21 @@ std::shared_ptr<RPCEndpoint> RPCConnect(std::string url, int port, std::string k
     remote_key.resize(keylen);
     ICHECK_EQ(sock.RecvAll(&remote_key[0], keylen), keylen);
   }
-  auto endpt =
-      RPCEndpoint::Create(std::unique_ptr<SockChannel>(new SockChannel(sock)), key, remote_key);
+  std::unique_ptr<RPCChannel> channel;
+  if (shm != nullptr) {
+    shm->WaitForServer(sock, kShmAttachTimeoutMs);
+    channel = std::move(shm);
+  } else {
+    channel.reset(new SockChannel(sock));
+  }
+  auto endpt = RPCEndpoint::Create(std::move(channel), key, remote_key);
   endpt->InitRemoteSession(init_seq);
   return endpt;
 }
 
-Module RPCClientConnect(std::string url, int port, std::string key, TVMArgs init_seq) {
-  auto endpt = RPCConnect(url, port, "client:" + key, init_seq);
+Module RPCClientConnect(std::string url, int port, std::string key, TVMArgs init_seq,
+                        bool use_shm = false) {
+  auto endpt = RPCConnect(url, port, "client:" + key, init_seq, use_shm);
   return CreateRPCSessionModule(CreateClientSession(endpt));
 }
 
@@ -114,6 +131,11 @@ TVM_DLL void RPCServerLoop(int sockfd) {
       ->ServerLoop();
 }
 
+void RPCServerLoop(int sockfd, std::string shm_name) {
+  support::TCPSocket sock(static_cast<support::TCPSocket::SockType>(sockfd));
+  RPCEndpoint::Create(ShmChannel::Attach(shm_name, sock), "ShmServerLoop", "")->ServerLoop();
+}
+
 void RPCServerLoop(PackedFunc fsend, PackedFunc frecv) {
   RPCEndpoint::Create(std::unique_ptr<CallbackChannel>(new CallbackChannel(fsend, frecv)),
                       "SockServerLoop", "")
@@ -128,8 +150,18 @@ TVM_REGISTER_GLOBAL("rpc.Connect").set_body([](TVMArgs args, TVMRetValue* rv) {
                          TVMArgs(args.values + 3, args.type_codes + 3, args.size() - 3));
 });
 
+TVM_REGISTER_GLOBAL("rpc.ConnectShm").set_body([](TVMArgs args, TVMRetValue* rv) {
+  std::string url = args[0];
+  int port = args[1];
+  std::string key = args[2];
+  *rv = RPCClientConnect(url, port, key,
+                         TVMArgs(args.values + 3, args.type_codes + 3, args.size() - 3), true);
+});
+
 TVM_REGISTER_GLOBAL("rpc.ServerLoop").set_body([](TVMArgs args, TVMRetValue* rv) {
-  if (args[0].type_code() == kDLInt) {
+  if (args[0].type_code() == kDLInt && args.size() > 1) {
+    RPCServerLoop(args[0], args[1].operator std::string());
+  } else if (args[0].type_code() == kDLInt) {
     RPCServerLoop(args[0]);
   } else {
     RPCServerLoop(args[0].operator tvm::runtime::PackedFunc(),
@@ -0,0 +1,222 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file sampling_profiler.cc
+ * \brief Always-on profiler which times the operators of a sample of the runs.
+ */
+#include "sampling_profiler.h"
+
+#include <tvm/runtime/logging.h>
+
+#include <algorithm>
+#include <sstream>
+#include <utility>
+
+namespace tvm {
+namespace runtime {
+
+int LatencyHistogram::BucketIndex(uint64_t ns) {
+  if (ns < kSubBuckets) return static_cast<int>(ns);
+  // The position of the leading one, then the next 3 bits pick the bucket within the octave.
+  int exponent = 0;
+  for (uint64_t rest = ns >> 1; rest != 0; rest >>= 1) ++exponent;
+  int mantissa = static_cast<int>(ns >> (exponent - 3)) & (kSubBuckets - 1);
+  return (exponent - 2) * kSubBuckets + mantissa;
+}
+
+double LatencyHistogram::BucketMidpoint(int index) {
+  if (index < kSubBuckets) return index;
+  int exponent = index / kSubBuckets + 2;
+  double low = static_cast<double>(kSubBuckets + index % kSubBuckets) * (1ULL << (exponent - 3));
+  return low + static_cast<double>(1ULL << (exponent - 3)) / 2;
+}
+
+void LatencyHistogram::Add(uint64_t ns) {
+  if (counts_.empty()) counts_.resize(kNumBuckets, 0);
+  ++counts_[BucketIndex(ns)];
+  ++count_;
+  sum_ns_ += ns;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram& other) {
+  if (other.count_ == 0) return;
+  if (counts_.empty()) counts_.resize(kNumBuckets, 0);
+  for (int i = 0; i < kNumBuckets; ++i) counts_[i] += other.counts_[i];
+  count_ += other.count_;
+  sum_ns_ += other.sum_ns_;
+}
+
+void LatencyHistogram::Clear() {
+  counts_.clear();
+  count_ = 0;
+  sum_ns_ = 0;
+}
+
+double LatencyHistogram::Quantile(double q) const {
+  if (count_ == 0) return 0;
+  uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(q * count_ + 0.5));
+  uint64_t seen = 0;
+  for (int i = 0; i < kNumBuckets; ++i) {
+    seen += counts_[i];
+    if (seen >= rank) return BucketMidpoint(i);
+  }
+  return BucketMidpoint(kNumBuckets - 1);
+}
+
+namespace {
+std::atomic<uint64_t> next_profiler_id{1};
+}  // namespace
+
+SamplingProfiler::SamplingProfiler(std::vector<std::string> op_names, Config config)
+    : op_names_(std::move(op_names)),
+      config_(config),
+      id_(next_profiler_id.fetch_add(1)),
+      window_start_ns_(Now()),
+      current_(op_names_.size() + 1),
+      previous_(op_names_.size() + 1) {
+  ICHECK_GE(config_.sample_every, 1) << "sample_every must be positive";
+  ICHECK_GT(config_.window_s, 0) << "window_s must be positive";
+}
+
+bool SamplingProfiler::IntervalElapsed() {
+  uint64_t now = Now();
+  uint64_t last = last_sample_ns_.load(std::memory_order_relaxed);
+  if (last != 0 && now - last < config_.min_interval_ms * 1e6) return false;
+  // When runs race for the sample, only one of them takes it.
+  return last_sample_ns_.compare_exchange_strong(last, now, std::memory_order_relaxed);
+}
+
+SamplingProfiler::Ring* SamplingProfiler::LocalRing() {
+  // Threads usually serve one profiler, cache its ring to skip the lock.
+  struct Cache {
+    uint64_t profiler_id{0};
+    Ring* ring{nullptr};
+  };
+  static thread_local Cache cache;
+  if (cache.profiler_id == id_) return cache.ring;
+  std::lock_guard<std::mutex> lock(rings_mutex_);
+  std::unique_ptr<Ring>& ring = rings_[std::this_thread::get_id()];
+  if (ring == nullptr) {
+    ring.reset(new Ring());
+    ring_list_.push_back(ring.get());
+  }
+  cache.profiler_id = id_;
+  cache.ring = ring.get();
+  return cache.ring;
+}
+
+void SamplingProfiler::Record(uint32_t op, uint64_t duration_ns) {
+  Ring* ring = LocalRing();
+  uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+  if (tail - ring->head.load(std::memory_order_acquire) == Ring::kCapacity) {
+    num_dropped_.fetch_add(1, std::memory_order_relaxed);
+    return;
+  }
+  ring->samples[tail % Ring::kCapacity] = Sample{op, duration_ns};
+  ring->tail.store(tail + 1, std::memory_order_release);
+}
+
+void SamplingProfiler::EndRun(uint64_t duration_ns) {
+  Record(kRunIndex, duration_ns);
+  // Draining here keeps the rings from filling up, another thread may be doing it already.
+  num_sampled_runs_.fetch_add(1, std::memory_order_relaxed);
+  std::unique_lock<std::mutex> lock(mutex_, std::try_to_lock);
+  if (lock.owns_lock()) Drain();
+}
+
+void SamplingProfiler::Drain() {
+  uint64_t now = Now();
+  if (now - window_start_ns_ >= config_.window_s * 1e9) {
+    // Samples older than two windows are gone, the report covers one to two windows.
+    std::swap(previous_, current_);
+    for (LatencyHistogram& hist : current_) hist.Clear();
+    if (now - window_start_ns_ >= 2 * config_.window_s * 1e9) {
+      for (LatencyHistogram& hist : previous_) hist.Clear();
+    }
+    window_start_ns_ = now;
+  }
+  std::vector<Ring*> rings;
+  {
+    std::lock_guard<std::mutex> lock(rings_mutex_);
+    rings = ring_list_;
+  }
+  for (Ring* ring : rings) {
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    uint64_t tail = ring->tail.load(std::memory_order_acquire);
+    for (; head != tail; ++head) {
+      const Sample& sample = ring->samples[head % Ring::kCapacity];
+      size_t index = sample.op == kRunIndex ? op_names_.size() : sample.op;
+      if (index <= op_names_.size()) current_[index].Add(sample.duration_ns);
+    }
+    ring->head.store(tail, std::memory_order_release);
+  }
+}
+
+std::string SamplingProfiler::ReportJSON() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Drain();
+  std::vector<LatencyHistogram> hists = previous_;
+  for (size_t i = 0; i < hists.size(); ++i) hists[i].Merge(current_[i]);
+
+  auto write_stats = [](std::ostream& os, const LatencyHistogram& hist) {
+    os << "\"count\": " << hist.count() << ", \"mean_us\": " << hist.Mean() / 1e3
+       << ", \"p50_us\": " << hist.Quantile(0.5) / 1e3
+       << ", \"p95_us\": " << hist.Quantile(0.95) / 1e3
+       << ", \"p99_us\": " << hist.Quantile(0.99) / 1e3;
+  };
+  // The operators which take the most time in total come first.
+  std::vector<size_t> order;
+  for (size_t i = 0; i < op_names_.size(); ++i) {
+    if (hists[i].count() != 0) order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [&hists](size_t a, size_t b) {
+    return hists[a].Mean() * hists[a].count() > hists[b].Mean() * hists[b].count();
+  });
+
+  std::ostringstream os;
+  os << "{\"runs\": " << num_runs_.load() << ", \"sampled_runs\": " << num_sampled_runs_.load()
+     << ", \"dropped_samples\": " << num_dropped_.load()
+     << ", \"sample_every\": " << config_.sample_every
+     << ", \"min_interval_ms\": " << config_.min_interval_ms
+     << ", \"window_s\": " << config_.window_s << ", \"run\": {";
+  write_stats(os, hists.back());
+  os << "}, \"ops\": [";
+  for (size_t i = 0; i < order.size(); ++i) {
+    os << (i == 0 ? "" : ", ") << "{\"name\": \"" << op_names_[order[i]] << "\", ";
+    write_stats(os, hists[order[i]]);
+    os << "}";
+  }
+  os << "]}";
+  return os.str();
+}
+
+void SamplingProfiler::Reset() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Drain();
+  for (LatencyHistogram& hist : current_) hist.Clear();
+  for (LatencyHistogram& hist : previous_) hist.Clear();
+  window_start_ns_ = Now();
+  num_sampled_runs_ = 0;
+  num_runs_ = 0;
+  num_dropped_ = 0;
+}
+
+}  // namespace runtime
+}  // namespace tvm
@@ -0,0 +1,188 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file sampling_profiler.h
+ * \brief Always-on profiler which times the operators of a sample of the runs.
+ *
+ *  Unlike runtime::profiling::Profiler, which times every call while it is
+ *  enabled, this profiler is meant to stay enabled in production. Runs that
+ *  are not sampled cost one atomic increment. The operators of sampled runs
+ *  push their durations into a lock-free ring owned by the thread running
+ *  them, and the rings are drained into per operator histograms at the end of
+ *  sampled runs and when the report is read.
+ */
+#ifndef TVM_RUNTIME_SAMPLING_PROFILER_H_
+#define TVM_RUNTIME_SAMPLING_PROFILER_H_
+
+#include <tvm/runtime/c_runtime_api.h>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+
+/*!
+ * \brief Histogram of durations with 8 geometric buckets per power of two, so quantiles
+ *  are within 7% of the exact value.
+ */
+class LatencyHistogram {
+ public:
+  /*! \brief Add one duration in nanoseconds. */
+  void Add(uint64_t ns);
+  /*! \brief Add the samples of another histogram. */
+  void Merge(const LatencyHistogram& other);
+  /*! \brief Remove all the samples. */
+  void Clear();
+  /*! \return The number of samples. */
+  uint64_t count() const { return count_; }
+  /*! \return The mean duration in nanoseconds. */
+  double Mean() const { return count_ == 0 ? 0 : static_cast<double>(sum_ns_) / count_; }
+  /*!
+   * \brief Estimate a quantile.
+   * \param q The quantile, between 0 and 1.
+   * \return The duration in nanoseconds which the fraction q of the samples do not exceed.
+   */
+  double Quantile(double q) const;
+
+ private:
+  static constexpr int kSubBuckets = 8;
+  static constexpr int kNumBuckets = 64 * kSubBuckets;
+  static int BucketIndex(uint64_t ns);
+  static double BucketMidpoint(int index);
+
+  std::vector<uint32_t> counts_;
+  uint64_t count_{0};
+  uint64_t sum_ns_{0};
+};
+
+/*!
+ * \brief Times the operators of one run out of every few and keeps rolling histograms.
+ *
+ *  BeginRun, Record and EndRun can be called from any thread. Operators are identified by
+ *  their index in the names given at construction.
+ */
+class SamplingProfiler {
+ public:
+  struct Config {
+    /*! \brief Sample one run out of this many. */
+    int64_t sample_every{100};
+    /*! \brief The least time between the start of two sampled runs, 0 for no limit. */
+    double min_interval_ms{0};
+    /*! \brief Samples are dropped from the histograms after one to two windows. */
+    double window_s{60};
+  };
+
+  /*!
+   * \brief Create the profiler.
+   * \param op_names The name of each operator.
+   * \param config When to sample.
+   */
+  SamplingProfiler(std::vector<std::string> op_names, Config config);
+
+  /*! \return The time in nanoseconds on the clock the profiler uses. */
+  static uint64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  /*!
+   * \brief Count a run and decide whether to time its operators.
+   * \return Whether the run is sampled, EndRun must then be called at its end.
+   */
+  bool BeginRun() {
+    uint64_t run = num_runs_.fetch_add(1, std::memory_order_relaxed);
+    if (run % config_.sample_every != 0) return false;
+    return config_.min_interval_ms <= 0 || IntervalElapsed();
+  }
+
+  /*!
+   * \brief Record the duration of an operator in a sampled run.
+   * \param op The index of the operator.
+   * \param duration_ns The duration.
+   */
+  void Record(uint32_t op, uint64_t duration_ns);
+
+  /*!
+   * \brief End a sampled run.
+   * \param duration_ns The duration of the whole run.
+   */
+  void EndRun(uint64_t duration_ns);
+
+  /*!
+   * \brief Report the runs and the mean, p50, p95 and p99 duration of each operator.
+   * \return The report as a JSON object.
+   */
+  std::string ReportJSON();
+
+  /*! \brief Drop all the samples collected so far. */
+  void Reset();
+
+ private:
+  struct Sample {
+    uint32_t op;
+    uint64_t duration_ns;
+  };
+  // Single producer single consumer ring of one thread, full rings drop samples.
+  struct Ring {
+    static constexpr uint64_t kCapacity = 4096;
+    std::atomic<uint64_t> head{0};
+    std::atomic<uint64_t> tail{0};
+    Sample samples[kCapacity];
+  };
+  // Operator index of the duration of whole runs.
+  static constexpr uint32_t kRunIndex = UINT32_MAX;
+
+  bool IntervalElapsed();
+  Ring* LocalRing();
+  // Move the samples of every ring into the histograms, requires mutex_.
+  void Drain();
+
+  const std::vector<std::string> op_names_;
+  const Config config_;
+  // Identifies the profiler in the ring cache of the threads, addresses can be reused.
+  const uint64_t id_;
+  std::atomic<uint64_t> num_runs_{0};
+  std::atomic<uint64_t> last_sample_ns_{0};
+  std::atomic<uint64_t> num_dropped_{0};
+  std::atomic<uint64_t> num_sampled_runs_{0};
+
+  std::mutex rings_mutex_;
+  std::unordered_map<std::thread::id, std::unique_ptr<Ring>> rings_;
+  std::vector<Ring*> ring_list_;
+
+  // Guards everything below.
+  std::mutex mutex_;
+  uint64_t window_start_ns_;
+  // The histograms of the current and of the previous window, the last one is for runs.
+  std::vector<LatencyHistogram> current_;
+  std::vector<LatencyHistogram> previous_;
+};
+
+}  // namespace runtime
+}  // namespace tvm
+#endif  // TVM_RUNTIME_SAMPLING_PROFILER_H_
@@ -27,6 +27,7 @@
 #include <tvm/runtime/container/array.h>
 #include <tvm/runtime/logging.h>
 #include <tvm/runtime/packed_func.h>
+#include <tvm/runtime/profiling.h>
 #include <tvm/runtime/registry.h>
 #include <tvm/runtime/threading_backend.h>
 #if TVM_THREADPOOL_USE_OPENMP
@@ -36,11 +37,13 @@
 #include <atomic>
 #include <condition_variable>
 #include <cstring>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_set>
 #include <vector>
 
 #include "../support/utils.h"
@@ -60,11 +63,34 @@ uint32_t GetSpinCount() {
   return atoi(val);
 }
 
+bool GetSharedPoolEnabled() {
+  const char* val = getenv("TVM_THREAD_POOL_SHARED");
+  return val != nullptr && atoi(val) != 0;
+}
+
+int GetSharedPoolMaxConcurrency() {
+  const char* val = getenv("TVM_THREAD_POOL_SHARED_MAX_CONCURRENCY");
+  if (!val) {
+    return 0;
+  }
+  return atoi(val);
+}
+
+int GetWorkStealingChunks() {
+  const char* val = getenv("TVM_THREAD_POOL_WORK_STEALING");
+  if (!val) {
+    return 0;
+  }
+  return atoi(val);
+}
+
 }  // namespace
 
 // stride in the page, fit to cache line.
 constexpr int kSyncStride = 64 / sizeof(std::atomic<int>);
 
+class ThreadPool;
+
 /*!
  * \brief Thread local main environment.
  */
@@ -95,6 +121,14 @@ class ParallelLauncher {
     }
   }
   ~ParallelLauncher() { delete[] sync_counter_; }
+  // Whether a task of the last job reached a barrier, valid once the job finished.
+  bool BarrierReached() const {
+    if (env.sync_handle == nullptr) return false;
+    for (int i = 0; i < env.num_task; ++i) {
+      if (sync_counter_[i * kSyncStride].load(std::memory_order_relaxed) != 0) return true;
+    }
+    return false;
+  }
   // Wait n jobs to finish
   int WaitForJobs() {
     while (num_pending_.load() != 0) {
@@ -130,6 +164,10 @@ class ParallelLauncher {
   // Whether this thread is worker of the pool.
   // used to prevent recursive launch.
   bool is_worker{false};
+  // Set while this thread runs a task which was not given a thread of its own. Such a task
+  // must not wait at a barrier for the tasks which only start once it returns, so the barrier
+  // calls this first to start the tasks nobody has claimed yet on threads of their own.
+  std::function<void()> start_unclaimed_tasks;
 
  private:
   // The pending jobs.
@@ -142,6 +180,34 @@ class ParallelLauncher {
   std::vector<std::string> par_errors_;
 };
 
+/*!
+ * \brief The threads running the unclaimed tasks of a dynamically scheduled job after one of
+ *  its tasks reached a barrier, which such a job was not expected to do.
+ */
+class BarrierTaskThreads {
+ public:
+  ~BarrierTaskThreads() { Join(); }
+  /*! \brief Run a task on a new thread. */
+  void Start(std::function<void()> task) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    threads_.emplace_back([task]() {
+      ParallelLauncher::ThreadLocal()->is_worker = true;
+      task();
+    });
+  }
+  /*! \brief Wait for the threads, once every task of the job finished. */
+  void Join() {
+    for (std::thread& thread : threads_) {
+      thread.join();
+    }
+    threads_.clear();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::thread> threads_;
+};
+
 /*! \brief Lock-free single-producer-single-consumer queue for each thread */
 class SpscTaskQueue {
  public:
@@ -256,6 +322,68 @@ class SpscTaskQueue {
   std::condition_variable cv_;
 };
 
+/*!
+ * \brief Lock-free Chase-Lev work-stealing deque of fixed capacity.
+ *
+ * Tasks are only pushed by the thread launching the parallel job and are taken
+ * from the top by any worker, the owning worker included, so there is no
+ * owner-side pop and a single compare-and-swap arbitrates between takers.
+ */
+class StealingTaskDeque {
+ public:
+  using Task = SpscTaskQueue::Task;
+  // capacity of the ring, must be a power of two
+  static constexpr const int64_t kCapacity = 256;
+
+  StealingTaskDeque() : buffer_(new Task[kCapacity]) {}
+
+  ~StealingTaskDeque() { delete[] buffer_; }
+
+  /*!
+   * \brief Push a task at the bottom. Only called by the launching thread.
+   * \param input The task to be pushed.
+   */
+  void Push(const Task& input) {
+    const int64_t bottom = bottom_.load(std::memory_order_relaxed);
+    ICHECK_LT(bottom - top_.load(std::memory_order_acquire), kCapacity)
+        << "Too many parallel tasks queued for one worker";
+    buffer_[bottom & (kCapacity - 1)] = input;
+    bottom_.store(bottom + 1, std::memory_order_release);
+  }
+
+  /*!
+   * \brief Take a task from the top.
+   * \param output The pointer to the task taken.
+   * \return Whether a task was taken.
+   */
+  bool Steal(Task* output) {
+    int64_t top = top_.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const int64_t bottom = bottom_.load(std::memory_order_acquire);
+    while (top < bottom) {
+      Task task = buffer_[top & (kCapacity - 1)];
+      if (top_.compare_exchange_weak(top, top + 1, std::memory_order_seq_cst,
+                                     std::memory_order_acquire)) {
+        *output = task;
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  typedef char cache_line_pad_t[kL1CacheBytes];
+  Task* const buffer_;
+  cache_line_pad_t pad0_;
+  // index of the next task to take
+  std::atomic<int64_t> top_{0};
+  cache_line_pad_t pad1_;
+  // index of the next free slot
+  std::atomic<int64_t> bottom_{0};
+};
+
+constexpr const int64_t StealingTaskDeque::kCapacity;
+
 // The thread pool
 class ThreadPool {
  public:
@@ -264,6 +392,7 @@ class ThreadPool {
     if (exclude_worker0 && atoi(exclude_worker0) == 0) {
       exclude_worker0_ = false;
     }
+    SetWorkStealing(GetWorkStealingChunks());
     Init();
   }
 
@@ -281,6 +410,7 @@ class ThreadPool {
     // Destroy threads before we destory the shared queue, otherwise we segfault on MacOS
     threads_.reset();
     queues_.clear();
+    deques_.clear();
     Init();
   }
 
@@ -288,6 +418,18 @@ class ThreadPool {
     ParallelLauncher* launcher = ParallelLauncher::ThreadLocal();
     ICHECK(!launcher->is_worker)
         << "Cannot launch parallel job inside worker, consider fuse then parallel";
+    // Only kernels which are known not to reach a barrier are over-decomposed, the
+    // others need every task running on a worker of its own.
+    bool learn_barrier_free = chunks_per_worker_ > 0 && num_task == 0;
+    if (learn_barrier_free && barrier_free_.count(flambda)) {
+      int res = LaunchWorkStealing(launcher, flambda, cdata, need_sync);
+      if (launcher->BarrierReached()) {
+        // Whether the kernel reaches a barrier depends on the data, stop over-decomposing it.
+        barrier_free_.erase(flambda);
+        with_barrier_.insert(flambda);
+      }
+      return res;
+    }
     if (num_task == 0) {
       num_task = num_workers_used_;
     }
@@ -307,6 +449,7 @@ class ThreadPool {
     // use the main thread to run task 0
     if (exclude_worker0_) {
       TVMParallelGroupEnv* penv = &(tsk.launcher->env);
+      profiling::ScopedTimelineSpan span("parallel task", 0);
       if ((*tsk.launcher->flambda)(0, penv, cdata) == 0) {
         tsk.launcher->SignalJobFinish();
       } else {
@@ -314,6 +457,11 @@ class ThreadPool {
       }
     }
     int res = launcher->WaitForJobs();
+    if (launcher->BarrierReached()) {
+      with_barrier_.insert(flambda);
+    } else if (learn_barrier_free && res == 0 && !with_barrier_.count(flambda)) {
+      barrier_free_.insert(flambda);
+    }
     return res;
   }
 
@@ -331,12 +479,96 @@ class ThreadPool {
 
   int32_t NumThreads() const { return num_workers_used_; }
 
+  /*!
+   * \brief Enable or disable the work-stealing mode.
+   * \param chunks_per_worker The number of tasks each worker's share of a parallel
+   *  job is split into, 0 restores the static one-task-per-worker split.
+   */
+  void SetWorkStealing(int chunks_per_worker) {
+    ICHECK_GE(chunks_per_worker, 0);
+    ICHECK_LE(chunks_per_worker, StealingTaskDeque::kCapacity);
+    chunks_per_worker_ = chunks_per_worker;
+  }
+
+
  private:
+  // The task id that asks a worker to take its tasks from the deques.
+  static constexpr const int32_t kStealTaskId = -1;
+
+  /*!
+   * \brief Take one queued task of the current job and run it.
+   * \param worker_id The worker to start looking from, its own deque comes first.
+   * \return Whether a task was run.
+   */
+  bool RunPendingTask(int worker_id) {
+    SpscTaskQueue::Task task;
+    for (int i = 0; i < num_workers_used_; ++i) {
+      if (deques_[(worker_id + i) % num_workers_used_]->Steal(&task)) {
+        ParallelLauncher* local = ParallelLauncher::ThreadLocal();
+        local->start_unclaimed_tasks = [this]() { StartUnclaimedTasks(); };
+        RunTask(task);
+        local->start_unclaimed_tasks = nullptr;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  // Start every queued task of the current job on a thread of its own.
+  void StartUnclaimedTasks() {
+    SpscTaskQueue::Task task;
+    for (int i = 0; i < num_workers_used_; ++i) {
+      while (deques_[i]->Steal(&task)) {
+        barrier_threads_.Start([this, task]() { RunTask(task); });
+      }
+    }
+  }
+
+  int LaunchWorkStealing(ParallelLauncher* launcher, FTVMParallelLambda flambda, void* cdata,
+                         int need_sync) {
+    // Over-decompose the job so that idle workers can take over the remaining
+    // chunks of a slow one. A chunk may run after another one on the same worker,
+    // which is why only kernels seen not to reach a barrier get here. Should one reach
+    // a barrier anyway, the chunks left in the deques are started on threads of their own.
+    int num_task = num_workers_used_ * chunks_per_worker_;
+    launcher->Init(flambda, cdata, num_task, need_sync != 0);
+    SpscTaskQueue::Task tsk;
+    tsk.launcher = launcher;
+    for (int i = 0; i < num_task; ++i) {
+      tsk.task_id = i;
+      deques_[i / chunks_per_worker_]->Push(tsk);
+    }
+    tsk.task_id = kStealTaskId;
+    for (int i = exclude_worker0_; i < num_workers_used_; ++i) {
+      queues_[i]->Push(tsk);
+    }
+    if (exclude_worker0_) {
+      while (RunPendingTask(0)) {
+      }
+    }
+    int res = launcher->WaitForJobs();
+    barrier_threads_.Join();
+    return res;
+  }
+
+  void RunTask(const SpscTaskQueue::Task& task) {
+    // Shows the tasks of parallel launches on the timeline of profilers.
+    profiling::ScopedTimelineSpan span("parallel task", task.task_id);
+    TVMParallelGroupEnv* penv = &(task.launcher->env);
+    void* cdata = task.launcher->cdata;
+    if ((*task.launcher->flambda)(task.task_id, penv, cdata) == 0) {
+      task.launcher->SignalJobFinish();
+    } else {
+      task.launcher->SignalJobError(task.task_id);
+    }
+  }
+
   // Shared initialization code
   void Init() {
     for (int i = 0; i < num_workers_; ++i) {
       // The SpscTaskQueue only hosts ONE item at a time
       queues_.emplace_back(std::unique_ptr<SpscTaskQueue>(new SpscTaskQueue()));
+      deques_.emplace_back(std::unique_ptr<StealingTaskDeque>(new StealingTaskDeque()));
     }
     threads_ = std::unique_ptr<tvm::runtime::threading::ThreadGroup>(
         new tvm::runtime::threading::ThreadGroup(
@@ -349,19 +581,19 @@ class ThreadPool {
   void RunWorker(int worker_id) {
     SpscTaskQueue* queue = queues_[worker_id].get();
     SpscTaskQueue::Task task;
-    ParallelLauncher::ThreadLocal()->is_worker = true;
+    ParallelLauncher* local = ParallelLauncher::ThreadLocal();
+    local->is_worker = true;
     // Initialize the spin count (from envvar TVM_THREAD_POOL_SPIN_COUNT) on
     // the global first use of the ThreadPool.
     // TODO(tulloch): should we make this configurable via standard APIs?
     static size_t spin_count = GetSpinCount();
     while (queue->Pop(&task, spin_count)) {
       ICHECK(task.launcher != nullptr);
-      TVMParallelGroupEnv* penv = &(task.launcher->env);
-      void* cdata = task.launcher->cdata;
-      if ((*task.launcher->flambda)(task.task_id, penv, cdata) == 0) {
-        task.launcher->SignalJobFinish();
+      if (task.task_id == kStealTaskId) {
+        while (RunPendingTask(worker_id)) {
+        }
       } else {
-        task.launcher->SignalJobError(task.task_id);
+        RunTask(task);
       }
     }
   }
@@ -370,10 +602,273 @@ class ThreadPool {
   int num_workers_used_;
   // if or not to exclude worker 0 and use main to run task 0
   bool exclude_worker0_{true};
+  // number of tasks per worker in work-stealing mode, 0 when disabled
+  int chunks_per_worker_{0};
   std::vector<std::unique_ptr<SpscTaskQueue> > queues_;
+  // per-worker task deques used in work-stealing mode
+  std::vector<std::unique_ptr<StealingTaskDeque> > deques_;
+  std::unique_ptr<tvm::runtime::threading::ThreadGroup> threads_;
+  // the parallel lambdas whose last launch in work-stealing mode reached no barrier
+  std::unordered_set<FTVMParallelLambda> barrier_free_;
+  // the parallel lambdas which reached a barrier in some launch
+  std::unordered_set<FTVMParallelLambda> with_barrier_;
+  // the threads started for the current job when it unexpectedly reached a barrier
+  BarrierTaskThreads barrier_threads_;
+};
+
+/*!
+ * \brief A process-wide pool shared by every thread that launches parallel jobs.
+ *
+ * Unlike ThreadPool, of which every calling thread owns one, all callers submit
+ * their jobs into one set of workers, so N serving threads no longer create
+ * N x cores worker threads. Workers take tasks from the active jobs in round-robin
+ * order so that no caller is starved, and at most max_concurrency workers run
+ * tasks at once. The callers are not counted: each also runs tasks of its own job,
+ * which makes nested launches from inside a task safe, as a job always makes
+ * progress even if every worker is busy.
+ *
+ * Only kernels known not to reach a barrier are queued this way, and should one reach a
+ * barrier anyway, its unclaimed tasks are started on threads of their own. Every task of any
+ * other kernel is handed to an idle worker of its own at launch, and by default the
+ * job gets only as many tasks as there are such workers, so that no task waits at a
+ * barrier for one which has not started. A launch asking for more tasks than there are
+ * idle workers does not wait for more, as its caller may be occupying the worker it would
+ * wait for: the caller claims the remaining tasks itself, just like those of a queued job.
+ */
+class SharedThreadPool {
+ public:
+  static SharedThreadPool* Global() {
+    // NOTE: explicitly use new to avoid exit-time destruction of global state
+    static auto* inst = new SharedThreadPool();
+    return inst;
+  }
+
+  int Launch(FTVMParallelLambda flambda, void* cdata, int num_task, int need_sync) {
+    ThreadState* state = ThreadState::Get();
+    if (state->launchers.size() <= state->depth) {
+      state->launchers.emplace_back(new ParallelLauncher());
+    }
+    ParallelLauncher* launcher = state->launchers[state->depth].get();
+    Job job;
+    job.launcher = launcher;
+    std::unique_lock<std::mutex> lock(mu_);
+    int max_concurrency = max_concurrency_.load(std::memory_order_relaxed);
+    bool barrier_free = barrier_free_.count(flambda) != 0;
+    if (barrier_free) {
+      job.num_task = num_task != 0 ? num_task : max_concurrency;
+      launcher->Init(flambda, cdata, job.num_task, need_sync != 0);
+      jobs_.push_back(&job);
+    } else {
+      int num_assigned;
+      if (num_task != 0) {
+        ICHECK_LE(num_task - 1, num_workers_)
+            << "Request parallel sync task larger than number of threads used "
+            << " workers=" << num_workers_ + 1 << " request=" << num_task;
+        job.num_task = num_task;
+        num_assigned = std::min(NumIdle(), num_task - 1);
+      } else {
+        job.num_task = 1 + std::min(NumIdle(), std::min(max_concurrency - 1,
+                                                        std::max(0, max_concurrency - active_)));
+        num_assigned = job.num_task - 1;
+      }
+      launcher->Init(flambda, cdata, job.num_task, need_sync != 0);
+      for (int i = 1; i <= num_assigned; ++i) {
+        assigned_[idle_.back()] = Assignment{&job, i};
+        idle_.pop_back();
+        ++active_;
+      }
+      job.next_task.store(num_assigned + 1, std::memory_order_relaxed);
+    }
+    lock.unlock();
+    cv_.notify_all();
+    ++state->depth;
+    if (barrier_free) {
+      while (RunTaskOf(&job)) {
+      }
+      std::lock_guard<std::mutex> guard(mu_);
+      RemoveJob(&job);
+    } else {
+      RunTask(&job, 0, job.next_task.load(std::memory_order_relaxed) < job.num_task);
+      while (RunTaskOf(&job)) {
+      }
+    }
+    int res = launcher->WaitForJobs();
+    job.barrier_threads.Join();
+    --state->depth;
+    bool barrier_reached = launcher->BarrierReached();
+    if (barrier_reached || (!barrier_free && res == 0)) {
+      std::lock_guard<std::mutex> guard(mu_);
+      if (barrier_reached) {
+        // Whether the kernel reaches a barrier may depend on the data, keep it off the queue.
+        barrier_free_.erase(flambda);
+        with_barrier_.insert(flambda);
+      } else if (!with_barrier_.count(flambda)) {
+        barrier_free_.insert(flambda);
+      }
+    }
+    return res;
+  }
+
+  void SetMaxConcurrency(int max_concurrency) {
+    if (max_concurrency <= 0) {
+      max_concurrency = threading::MaxConcurrency();
+    }
+    {
+      std::lock_guard<std::mutex> lock(mu_);
+      max_concurrency_.store(max_concurrency, std::memory_order_relaxed);
+    }
+    cv_.notify_all();
+  }
+
+  static bool Enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  static void SetEnabled(bool enabled) { enabled_.store(enabled, std::memory_order_relaxed); }
+
+ private:
+  /*! \brief A parallel job submitted by one caller. */
+  struct Job {
+    ParallelLauncher* launcher;
+    int num_task;
+    // the next task id to hand out
+    std::atomic<int> next_task{0};
+    // the threads started for the unclaimed tasks once a task reached a barrier
+    BarrierTaskThreads barrier_threads;
+  };
+
+  /*! \brief A task handed to one worker. */
+  struct Assignment {
+    Job* job;
+    int task_id;
+  };
+
+  /*! \brief Per-thread state, used by workers and callers alike. */
+  struct ThreadState {
+    // one launcher per nesting level, a nested launch must not reuse its parent's
+    std::vector<std::unique_ptr<ParallelLauncher>> launchers;
+    size_t depth{0};
+
+    static ThreadState* Get() { return dmlc::ThreadLocalStore<ThreadState>::Get(); }
+  };
+
+  SharedThreadPool() : num_workers_(threading::MaxConcurrency() - 1) {
+    SetMaxConcurrency(GetSharedPoolMaxConcurrency());
+    assigned_.resize(num_workers_ + 1, Assignment{nullptr, 0});
+    // the callers take the place of worker 0
+    threads_ = std::unique_ptr<tvm::runtime::threading::ThreadGroup>(
+        new tvm::runtime::threading::ThreadGroup(
+            num_workers_ + 1, [this](int worker_id) { this->RunWorker(worker_id); },
+            true /* exclude_worker0 */));
+    threads_->Configure(threading::ThreadGroup::kBig, 0, true);
+  }
+
+  /*!
+   * \brief Claim and run the next task of a queued job.
+   * \return Whether there was a task left to run.
+   */
+  static bool RunTaskOf(Job* job) {
+    int task_id = job->next_task.fetch_add(1, std::memory_order_relaxed);
+    if (task_id >= job->num_task) return false;
+    RunTask(job, task_id, true);
+    return true;
+  }
+
+  static void RunTask(Job* job, int task_id, bool dynamic) {
+    profiling::ScopedTimelineSpan span("parallel task", task_id);
+    ParallelLauncher* local = ParallelLauncher::ThreadLocal();
+    std::function<void()> start_unclaimed_tasks = std::move(local->start_unclaimed_tasks);
+    local->start_unclaimed_tasks = nullptr;
+    if (dynamic) {
+      local->start_unclaimed_tasks = [job]() { StartUnclaimedTasks(job); };
+    }
+    ParallelLauncher* launcher = job->launcher;
+    if ((*launcher->flambda)(task_id, &(launcher->env), launcher->cdata) == 0) {
+      launcher->SignalJobFinish();
+    } else {
+      launcher->SignalJobError(task_id);
+    }
+    local->start_unclaimed_tasks = std::move(start_unclaimed_tasks);
+  }
+
+  // Start every unclaimed task of a job on a thread of its own.
+  static void StartUnclaimedTasks(Job* job) {
+    int task_id;
+    while ((task_id = job->next_task.fetch_add(1, std::memory_order_relaxed)) < job->num_task) {
+      job->barrier_threads.Start([job, task_id]() { RunTask(job, task_id, false); });
+    }
+  }
+
+  // Remove a job from the active list, must hold mu_.
+  void RemoveJob(Job* job) {
+    auto it = std::find(jobs_.begin(), jobs_.end(), job);
+    if (it != jobs_.end()) jobs_.erase(it);
+  }
+
+  // The number of workers waiting for a task, must hold mu_.
+  int NumIdle() const { return static_cast<int>(idle_.size()); }
+
+  void RunWorker(int worker_id) {
+    ParallelLauncher::ThreadLocal()->is_worker = true;
+    std::unique_lock<std::mutex> lock(mu_);
+    while (true) {
+      idle_.push_back(worker_id);
+      cv_.wait(lock, [this, worker_id] {
+        return assigned_[worker_id].job != nullptr ||
+               (!jobs_.empty() && active_ < max_concurrency_.load(std::memory_order_relaxed));
+      });
+      Assignment assignment = assigned_[worker_id];
+      if (assignment.job != nullptr) {
+        // The caller already took this worker off idle_ and counted it as active.
+        assigned_[worker_id].job = nullptr;
+        lock.unlock();
+        RunTask(assignment.job, assignment.task_id, false);
+        lock.lock();
+        --active_;
+        if (!jobs_.empty()) cv_.notify_one();
+        continue;
+      }
+      idle_.erase(std::find(idle_.begin(), idle_.end(), worker_id));
+      // Round-robin over the active jobs so that every caller gets its share.
+      Job* job = jobs_[next_job_++ % jobs_.size()];
+      int task_id = job->next_task.fetch_add(1, std::memory_order_relaxed);
+      if (task_id >= job->num_task) {
+        // Exhausted jobs stay alive until their caller removes them under mu_.
+        RemoveJob(job);
+        continue;
+      }
+      ++active_;
+      lock.unlock();
+      RunTask(job, task_id, true);
+      lock.lock();
+      --active_;
+      if (!jobs_.empty()) cv_.notify_one();
+    }
+  }
+
+  static std::atomic<bool> enabled_;
+  // number of worker threads, the callers not included
+  const int num_workers_;
+  std::atomic<int> max_concurrency_{1};
+  std::mutex mu_;
+  std::condition_variable cv_;
+  // the jobs that may still have unclaimed tasks
+  std::vector<Job*> jobs_;
+  // round-robin cursor into jobs_
+  size_t next_job_{0};
+  // number of workers running a task
+  int active_{0};
+  // the workers waiting for a task
+  std::vector<int> idle_;
+  // the task handed to each worker, indexed by worker id
+  std::vector<Assignment> assigned_;
+  // the parallel lambdas whose last launch reached no barrier
+  std::unordered_set<FTVMParallelLambda> barrier_free_;
+  // the parallel lambdas which reached a barrier in some launch
+  std::unordered_set<FTVMParallelLambda> with_barrier_;
   std::unique_ptr<tvm::runtime::threading::ThreadGroup> threads_;
 };
 
+std::atomic<bool> SharedThreadPool::enabled_{GetSharedPoolEnabled()};
+
 /*!
  * \brief args[0] is the AffinityMode, args[1] is the number of threads.
  *  args2 is a list of CPUs which is used to set the CPU affinity.
@@ -393,6 +888,23 @@ TVM_REGISTER_GLOBAL("runtime.config_threadpool").set_body([](TVMArgs args, TVMRe
   threading::Configure(mode, nthreads, cpus);
 });
 
+/*!
+ * \brief args[0] is the number of chunks per worker in work-stealing mode, 0 to disable.
+ */
+TVM_REGISTER_GLOBAL("runtime.config_threadpool_work_stealing")
+    .set_body_typed([](int chunks_per_worker) {
+      threading::ConfigureWorkStealing(chunks_per_worker);
+    });
+
+/*!
+ * \brief args[0] is whether to use the shared pool, args[1] is its maximum number of
+ *  concurrently running workers, 0 for all cores.
+ */
+TVM_REGISTER_GLOBAL("runtime.config_threadpool_shared")
+    .set_body_typed([](bool enable, int max_concurrency) {
+      threading::ConfigureSharedPool(enable, max_concurrency);
+    });
+
 TVM_REGISTER_GLOBAL("runtime.NumThreads").set_body_typed([]() -> int32_t {
   return threading::NumThreads();
 });
@@ -413,6 +925,20 @@ void Configure(tvm::runtime::threading::ThreadGroup::AffinityMode mode, int nthr
   tvm::runtime::ThreadPool::ThreadLocal()->UpdateWorkerConfiguration(mode, nthreads, cpus);
 }
 int32_t NumThreads() { return tvm::runtime::ThreadPool::ThreadLocal()->NumThreads(); }
+void ConfigureWorkStealing(int chunks_per_worker) {
+  tvm::runtime::ThreadPool::ThreadLocal()->SetWorkStealing(chunks_per_worker);
+}
+void ConfigureLocalThreads(int nthreads, std::vector<unsigned int> cpus) {
+  auto mode = cpus.empty() ? threading::ThreadGroup::kBig
+                          : threading::ThreadGroup::kSpecifyOneCorePerThread;
+  tvm::runtime::ThreadPool::ThreadLocal()->UpdateWorkerConfiguration(mode, nthreads, cpus);
+}
+void ConfigureSharedPool(bool enable, int max_concurrency) {
+  if (enable) {
+    tvm::runtime::SharedThreadPool::Global()->SetMaxConcurrency(max_concurrency);
+  }
+  tvm::runtime::SharedThreadPool::SetEnabled(enable);
+}
 }  // namespace threading
 }  // namespace runtime
 }  // namespace tvm
@@ -428,6 +954,9 @@ int TVMBackendParallelLaunch(FTVMParallelLambda flambda, void* cdata, int num_ta
     return 0;
   } else {
 #if !TVM_THREADPOOL_USE_OPENMP
+    if (tvm::runtime::SharedThreadPool::Enabled()) {
+      return tvm::runtime::SharedThreadPool::Global()->Launch(flambda, cdata, num_task, 1);
+    }
     int res = tvm::runtime::ThreadPool::ThreadLocal()->Launch(flambda, cdata, num_task, 1);
     return res;
 #else
@@ -452,6 +981,14 @@ int TVMBackendParallelBarrier(int task_id, TVMParallelGroupEnv* penv) {
   int num_task = penv->num_task;
   std::atomic<int>* sync_counter = reinterpret_cast<std::atomic<int>*>(penv->sync_handle);
   int old_counter = sync_counter[task_id * kSyncStride].fetch_add(1, std::memory_order_release);
+  // A waiting task must not run other tasks of its job inline: one of them could pass
+  // this barrier and then wait at the next one for the task suspended below it. A task
+  // sharing its thread with others rather makes sure every task of the job has started.
+  const std::function<void()>& start_unclaimed_tasks =
+      tvm::runtime::ParallelLauncher::ThreadLocal()->start_unclaimed_tasks;
+  if (start_unclaimed_tasks) {
+    start_unclaimed_tasks();
+  }
   for (int i = 0; i < num_task; ++i) {
     if (i != task_id) {
       while (sync_counter[i * kSyncStride].load(std::memory_order_relaxed) <= old_counter) {
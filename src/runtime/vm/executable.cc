@@ -30,6 +30,7 @@
 #include <tvm/runtime/vm/vm.h>
 
 #include <algorithm>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <memory>
@@ -70,6 +71,9 @@ PackedFunc Executable::GetFunction(const std::string& name, const ObjectPtr<Obje
     return PackedFunc([this](TVMArgs args, TVMRetValue* rv) { *rv = this->GetPrimitives(); });
   } else if (name == "get_stats") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->Stats(); });
+  } else if (name == "get_lazy_constant_stats") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->LazyConstantStats(); });
   } else if (name == "save") {
     return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->Save(); });
   } else if (name == "get_function_arity") {
@@ -92,10 +96,11 @@ PackedFunc Executable::GetFunction(const std::string& name, const ObjectPtr<Obje
     });
   } else if (name == "move_late_bound_consts") {
     return PackedFunc([this](TVMArgs args, TVMRetValue* rv) {
-      CHECK_EQ(args.size(), 2);
+      CHECK(args.size() == 2 || args.size() == 3);
       std::string path = args[0];
       uint64_t byte_limit = args[1];
-      MoveLateBoundConstantsToFile(path, static_cast<size_t>(byte_limit));
+      bool mapped = args.size() == 3 ? args[2].operator bool() : false;
+      MoveLateBoundConstantsToFile(path, static_cast<size_t>(byte_limit), mapped);
     });
   } else if (name == "load_late_bound_consts") {
     return PackedFunc([this](TVMArgs args, TVMRetValue* rv) {
@@ -168,8 +173,15 @@ std::string Executable::GetBytecode() const {
 
 std::string Executable::GetConstants() const {
   std::ostringstream oss;
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
   for (size_t i = 0; i < constants.size(); ++i) {
     const auto& constant = constants[i];
+    if (!constant.defined() && IsLazyConstant(i)) {
+      oss << "VM Const[" << i << "]: lazy " << DLDataType2String(lazy_constants_[i].dtype)
+          << " tensor of " << lazy_constants_[i].nbytes << " bytes on device index "
+          << const_device_indexes[i] << std::endl;
+      continue;
+    }
     auto ndarray = Downcast<NDArray>(constant);
     oss << "VM Const[" << i
         << "]: " << RuntimeObject2String(ndarray, virtual_devices[host_device_index])
@@ -211,9 +223,16 @@ std::string Executable::Stats() const {
 
   // Get the number of constants and the shape of each of them.
   oss << "  Constant shapes (# " << constants.size() << "): [";
-  for (const auto& it : constants) {
-    const auto constant = Downcast<NDArray>(it);
-    const auto& shape = constant.Shape();
+  for (size_t i = 0; i < constants.size(); ++i) {
+    ShapeTuple shape;
+    {
+      std::lock_guard<std::mutex> lock(lazy_mutex_);
+      if (!constants[i].defined() && IsLazyConstant(i)) {
+        shape = ShapeTuple(lazy_constants_[i].shape);
+      } else {
+        shape = Downcast<NDArray>(constants[i]).Shape();
+      }
+    }
 
     // Scalar
     if (shape.empty()) {
@@ -267,6 +286,8 @@ void SaveHeader(dmlc::Stream* strm) {
 }
 
 TVMByteArray Executable::Save() {
+  // Lazy constants are read from the old code, load them before it is overwritten.
+  LoadAllConstants();
   // Initialize the stream object.
   code_.clear();
   dmlc::MemoryStringStream strm(&code_);
@@ -300,8 +321,9 @@ void Executable::SaveVirtualDevicesSection(dmlc::Stream* strm) {
   strm->Write(host_device_index);
 }
 
-void Executable::MoveLateBoundConstantsToStream(dmlc::Stream* stream, size_t byte_limit) {
+Map<String, NDArray> Executable::MoveLateBoundConstantsToMap(size_t byte_limit) {
   ICHECK(late_bound_constant_names.empty());
+  LoadAllConstants();
   late_bound_constant_names.reserve(constants.size());
   Map<String, NDArray> map;
   size_t total_late_bound_bytes = 0;
@@ -323,10 +345,19 @@ void Executable::MoveLateBoundConstantsToStream(dmlc::Stream* stream, size_t byt
   }
   VLOG(1) << "moved " << map.size() << " constants of " << total_late_bound_bytes
           << " bytes (out of " << constants.size() << " overall) to be late-bound";
-  runtime::SaveParams(stream, map);
+  return map;
 }
 
-void Executable::MoveLateBoundConstantsToFile(const std::string& path, size_t byte_limit) {
+void Executable::MoveLateBoundConstantsToStream(dmlc::Stream* stream, size_t byte_limit) {
+  runtime::SaveParams(stream, MoveLateBoundConstantsToMap(byte_limit));
+}
+
+void Executable::MoveLateBoundConstantsToFile(const std::string& path, size_t byte_limit,
+                                              bool mapped) {
+  if (mapped) {
+    runtime::SaveMappedParams(path, MoveLateBoundConstantsToMap(byte_limit));
+    return;
+  }
   std::string bytes;
   dmlc::MemoryStringStream stream(&bytes);
   MoveLateBoundConstantsToStream(&stream, byte_limit);
@@ -338,12 +369,16 @@ void Executable::LoadLateBoundConstantsFromStream(dmlc::Stream* stream) {
     VLOG(1) << "Found no late-bound constants to load";
     return;
   }
+  LoadLateBoundConstantsFromMap(runtime::LoadParams(stream));
+}
+
+void Executable::LoadLateBoundConstantsFromMap(Map<String, NDArray> map) {
   ICHECK_EQ(late_bound_constant_names.size(), constants.size());
-  Map<String, NDArray> map = runtime::LoadParams(stream);
   VLOG(1) << "loaded " << map.size() << " late-bound constants";
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
   for (size_t const_index = 0; const_index < constants.size(); ++const_index) {
     if (!late_bound_constant_names[const_index].defined()) {
-      ICHECK(constants[const_index].defined())
+      ICHECK(constants[const_index].defined() || IsLazyConstant(const_index))
           << "Undefined immediate constant at index " << const_index;
       continue;
     }
@@ -360,6 +395,15 @@ void Executable::LoadLateBoundConstantsFromStream(dmlc::Stream* stream) {
 }
 
 void Executable::LoadLateBoundConstantsFromFile(const std::string& path) {
+  if (IsMappedParamsFile(path)) {
+    if (late_bound_constant_names.empty()) {
+      VLOG(1) << "Found no late-bound constants to load";
+      return;
+    }
+    // The constants are views into the mapped file, paged in when first used.
+    LoadLateBoundConstantsFromMap(runtime::LoadMappedParams(path));
+    return;
+  }
   std::string bytes;
   LoadBinaryFromFile(path, &bytes);
   dmlc::MemoryStringStream stream(&bytes);
@@ -428,6 +472,11 @@ void Executable::LoadConstantSection(dmlc::Stream* stream) {
   constants.resize(size);
   late_bound_constant_names.resize(size);
   bool any_late_bound = false;
+  // Lazy constants are left in the code and deserialized from their offset on first use.
+  auto* seek_stream = dynamic_cast<dmlc::SeekStream*>(stream);
+  bool lazy = lazy_constants && seek_stream != nullptr;
+  if (lazy) lazy_constants_.resize(size);
+  has_lazy_constants_ = lazy;
 
   // Load each of the constants.
   for (size_t const_index = 0; const_index < size; const_index++) {
@@ -436,9 +485,13 @@ void Executable::LoadConstantSection(dmlc::Stream* stream) {
     if (tag == kImmediateConstTag) {
       // Immediate constants tagged by 0.
       VLOG(1) << "load " << const_index << " as immediate";
-      runtime::NDArray ndarray;
-      STREAM_CHECK(ndarray.Load(stream), "constant tensor");
-      constants[const_index] = std::move(ndarray);
+      if (lazy) {
+        STREAM_CHECK(SkipConstant(seek_stream, &lazy_constants_[const_index]), "constant tensor");
+      } else {
+        runtime::NDArray ndarray;
+        STREAM_CHECK(ndarray.Load(stream), "constant tensor");
+        constants[const_index] = std::move(ndarray);
+      }
       late_bound_constant_names[const_index] = String(ObjectPtr<StringObj>(nullptr));
     } else if (tag == kLateBoundConstTag) {
       // Late-bound constants tagged by 1.
@@ -726,8 +779,94 @@ void Executable::SetLib(const runtime::Module& lib) {
   this->Import(lib);
 }
 
-runtime::Module Executable::Load(const std::string& code, const runtime::Module lib) {
+bool Executable::SkipConstant(dmlc::SeekStream* stream, LazyConstant* lazy) {
+  lazy->offset = stream->Tell();
+  uint64_t header, reserved;
+  Device dev;
+  int ndim;
+  int64_t data_byte_size;
+  if (!stream->Read(&header) || !stream->Read(&reserved) || header != kTVMNDArrayMagic ||
+      !stream->Read(&dev) || !stream->Read(&ndim) || !stream->Read(&lazy->dtype)) {
+    return false;
+  }
+  lazy->shape.resize(ndim);
+  if (ndim != 0 && !stream->ReadArray(lazy->shape.data(), ndim)) return false;
+  if (!stream->Read(&data_byte_size)) return false;
+  lazy->nbytes = static_cast<size_t>(data_byte_size);
+  stream->Seek(stream->Tell() + lazy->nbytes);
+  return true;
+}
+
+bool Executable::IsLazyConstant(Index index) const {
+  return static_cast<size_t>(index) < lazy_constants_.size() &&
+         lazy_constants_[index].offset != LazyConstant::kNotLazy;
+}
+
+ObjectRef Executable::GetConstant(Index index) {
+  // Without lazy constants the table is not written after loading, no lock is needed.
+  if (!has_lazy_constants_) return constants[index];
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
+  return LoadLazyConstant(index);
+}
+
+ObjectRef Executable::LoadLazyConstant(Index index) {
+  if (!IsLazyConstant(index) || constants[index].defined()) return constants[index];
+  auto start = std::chrono::steady_clock::now();
+  const LazyConstant& lazy = lazy_constants_[index];
+  char* code = mapped_code_ != nullptr ? mapped_code_->data() : const_cast<char*>(code_.data());
+  size_t code_size = mapped_code_ != nullptr ? mapped_code_->size() : code_.size();
+  dmlc::MemoryFixedSizeStream strm(code + lazy.offset, code_size - lazy.offset);
+  NDArray ndarray;
+  ICHECK(ndarray.Load(&strm)) << "Cannot load lazy constant " << index;
+  // The pages just read are only needed again if the constant is evicted.
+  if (mapped_code_ != nullptr) mapped_code_->Release(lazy.offset, strm.Tell());
+  constants[index] = std::move(ndarray);
+  lazy_resident_bytes_ += lazy.nbytes;
+  ++lazy_num_loads_;
+  lazy_load_time_ +=
+      std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  return constants[index];
+}
+
+size_t Executable::EvictConstant(Index index) {
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
+  if (!IsLazyConstant(index) || !constants[index].defined()) return 0;
+  constants[index] = ObjectRef();
+  lazy_resident_bytes_ -= lazy_constants_[index].nbytes;
+  ++lazy_num_evictions_;
+  return lazy_constants_[index].nbytes;
+}
+
+void Executable::LoadAllConstants() {
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
+  for (size_t i = 0; i < lazy_constants_.size(); ++i) {
+    LoadLazyConstant(i);
+  }
+  lazy_constants_.clear();
+  mapped_code_ = nullptr;
+}
+
+std::string Executable::LazyConstantStats() {
+  std::lock_guard<std::mutex> lock(lazy_mutex_);
+  size_t num_lazy = 0, total_bytes = 0;
+  for (size_t i = 0; i < lazy_constants_.size(); ++i) {
+    if (!IsLazyConstant(i)) continue;
+    ++num_lazy;
+    total_bytes += lazy_constants_[i].nbytes;
+  }
+  std::ostringstream os;
+  os << "{\"num_constants\": " << constants.size() << ", \"num_lazy\": " << num_lazy
+     << ", \"lazy_bytes\": " << total_bytes << ", \"resident_bytes\": " << lazy_resident_bytes_
+     << ", \"code_bytes\": " << code_.size() << ", \"num_loads\": " << lazy_num_loads_
+     << ", \"num_evictions\": " << lazy_num_evictions_
+     << ", \"load_time_ms\": " << lazy_load_time_ * 1000 << "}";
+  return os.str();
+}
+
+runtime::Module Executable::Load(const std::string& code, const runtime::Module lib,
+                                 bool lazy_constants) {
   auto exec = make_object<Executable>();
+  exec->lazy_constants = lazy_constants;
 
   // Support null-initialization of lib, to enable initialization during
   // deserialization before we have deserialized the imports.
@@ -737,26 +876,47 @@ runtime::Module Executable::Load(const std::string& code, const runtime::Module
 
   exec->code_ = code;
   dmlc::MemoryStringStream strm(&exec->code_);
+  exec->LoadSections(&strm);
+  return runtime::Module(exec);
+}
 
+runtime::Module Executable::LoadFromFile(const std::string& path, const runtime::Module lib,
+                                         bool lazy_constants) {
+  auto file = std::make_shared<MappedFile>(path);
+  auto exec = make_object<Executable>();
+  exec->lazy_constants = lazy_constants;
+  if (lib.defined()) {
+    exec->SetLib(lib);
+  }
+
+  dmlc::MemoryFixedSizeStream strm(file->data(), file->size());
+  exec->LoadSections(&strm);
+  // Nothing but the lazy constants is read from the file again, and code_ stays empty.
+  if (exec->has_lazy_constants_) {
+    file->Release(0, file->size());
+    exec->mapped_code_ = std::move(file);
+  }
+  return runtime::Module(exec);
+}
+
+void Executable::LoadSections(dmlc::SeekStream* strm) {
   // Load header.
-  LoadHeader(&strm);
+  LoadHeader(strm);
 
   // Virtual devices section
-  exec->LoadVirtualDevicesSection(&strm);
+  LoadVirtualDevicesSection(strm);
 
   // Global section.
-  exec->LoadGlobalSection(&strm);
+  LoadGlobalSection(strm);
 
   // Constant section.
-  exec->LoadConstantSection(&strm);
+  LoadConstantSection(strm);
 
   // Primitive names that will be invoked by `InvokePacked` instructions.
-  exec->LoadPrimitiveOpNames(&strm);
+  LoadPrimitiveOpNames(strm);
 
   // Code section.
-  exec->LoadCodeSection(&strm);
-
-  return runtime::Module(exec);
+  LoadCodeSection(strm);
 }
 
 void Executable::LoadVirtualDevicesSection(dmlc::Stream* strm) {
@@ -1038,7 +1198,8 @@ Module ExecutableLoadBinary(void* strm) {
   dmlc::Stream* stream = static_cast<dmlc::Stream*>(strm);
   std::string code;
   stream->Read(&code);
-  auto exec = Executable::Load(code, Module());
+  const char* lazy = std::getenv("TVM_VM_LAZY_CONSTANTS");
+  auto exec = Executable::Load(code, Module(), lazy != nullptr && atoi(lazy) != 0);
   return exec;
 }
 
@@ -1109,9 +1270,16 @@ TVM_REGISTER_GLOBAL("runtime.GetPrimitiveFields").set_body([](TVMArgs args, TVMR
   }
 });
 
-TVM_REGISTER_GLOBAL("runtime.Load_Executable")
-    .set_body_typed([](std::string code, runtime::Module lib) {
-      return Executable::Load(code, lib);
+TVM_REGISTER_GLOBAL("runtime.Load_Executable").set_body([](TVMArgs args, TVMRetValue* rv) {
+  std::string code = args[0];
+  runtime::Module lib = args[1];
+  bool lazy_constants = args.num_args > 2 ? args[2].operator bool() : false;
+  *rv = Executable::Load(code, lib, lazy_constants);
+});
+
+TVM_REGISTER_GLOBAL("runtime.Load_ExecutableFromFile")
+    .set_body_typed([](String path, Module lib, bool lazy_constants) {
+      return Executable::LoadFromFile(path, lib, lazy_constants);
     });
 
 }  // namespace vm
@@ -21,13 +21,18 @@
  * \file tvm/runtime/vm/memory_manager.cc
  * \brief Allocate and manage memory for the runtime.
  */
+#include <tvm/runtime/registry.h>
 #include <tvm/runtime/vm/memory_manager.h>
 
+#include <algorithm>
 #include <memory>
+#include <sstream>
 #include <utility>
 
 #include "naive_allocator.h"
 #include "pooled_allocator.h"
+#include "slab_allocator.h"
+#include "thread_cached_allocator.h"
 
 namespace tvm {
 namespace runtime {
@@ -37,6 +42,9 @@ static void BufferDeleter(Object* obj) {
   auto* ptr = static_cast<NDArray::Container*>(obj);
   ICHECK(ptr->manager_ctx != nullptr);
   Buffer* buffer = reinterpret_cast<Buffer*>(ptr->manager_ctx);
+  if (AllocTraceRecorder::Global()->enabled()) {
+    AllocTraceRecorder::Global()->RecordFree(*buffer);
+  }
   MemoryManager::GetAllocator(buffer->device)->Free(*(buffer));
   delete buffer;
   delete ptr;
@@ -112,27 +120,44 @@ MemoryManager* MemoryManager::Global() {
   return inst;
 }
 
+std::unique_ptr<Allocator> MemoryManager::CreateAllocator(Device dev, AllocatorType type) {
+  std::unique_ptr<Allocator> alloc;
+  switch (type) {
+    case kNaive: {
+      VLOG(1) << "New naive allocator for " << DeviceName(dev.device_type) << "(" << dev.device_id
+              << ")";
+      alloc.reset(new NaiveAllocator(dev));
+      break;
+    }
+    case kPooled: {
+      VLOG(1) << "New pooled allocator for " << DeviceName(dev.device_type) << "(" << dev.device_id
+              << ")";
+      alloc.reset(new PooledAllocator(dev));
+      break;
+    }
+    case kSlab: {
+      VLOG(1) << "New slab allocator for " << DeviceName(dev.device_type) << "(" << dev.device_id
+              << ")";
+      alloc.reset(new SlabAllocator(dev));
+      break;
+    }
+    case kThreadCached: {
+      VLOG(1) << "New thread cached allocator for " << DeviceName(dev.device_type) << "("
+              << dev.device_id << ")";
+      alloc.reset(new ThreadCachedAllocator(dev));
+      break;
+    }
+    default:
+      LOG(FATAL) << "Unknown allocator type: " << type;
+  }
+  return alloc;
+}
+
 Allocator* MemoryManager::GetOrCreateAllocator(Device dev, AllocatorType type) {
   MemoryManager* m = MemoryManager::Global();
   std::lock_guard<std::mutex> lock(m->mu_);
   if (m->allocators_.find(dev) == m->allocators_.end()) {
-    std::unique_ptr<Allocator> alloc;
-    switch (type) {
-      case kNaive: {
-        VLOG(1) << "New naive allocator for " << DeviceName(dev.device_type) << "(" << dev.device_id
-                << ")";
-        alloc.reset(new NaiveAllocator(dev));
-        break;
-      }
-      case kPooled: {
-        VLOG(1) << "New pooled allocator for " << DeviceName(dev.device_type) << "("
-                << dev.device_id << ")";
-        alloc.reset(new PooledAllocator(dev));
-        break;
-      }
-      default:
-        LOG(FATAL) << "Unknown allocator type: " << type;
-    }
+    std::unique_ptr<Allocator> alloc = CreateAllocator(dev, type);
     auto ret = alloc.get();
     m->allocators_.emplace(dev, std::move(alloc));
     return ret;
@@ -165,11 +190,137 @@ NDArray Allocator::Empty(std::vector<int64_t> shape, DLDataType dtype, DLDevice
   size_t alignment = GetDataAlignment(container->dl_tensor);
   Buffer* buffer = new Buffer;
   *buffer = this->Alloc(size, alignment, dtype);
+  if (AllocTraceRecorder::Global()->enabled()) {
+    AllocTraceRecorder::Global()->RecordAlloc(*buffer, size, alignment);
+  }
   container->manager_ctx = reinterpret_cast<void*>(buffer);
   container->dl_tensor.data = buffer->data;
   return NDArray(GetObjectPtr<Object>(container));
 }
 
+AllocTraceRecorder* AllocTraceRecorder::Global() {
+  static auto* inst = new AllocTraceRecorder();
+  return inst;
+}
+
+void AllocTraceRecorder::Start() {
+  std::lock_guard<std::mutex> lock(mu_);
+  events_.clear();
+  live_.clear();
+  next_id_ = 0;
+  enabled_.store(true, std::memory_order_relaxed);
+}
+
+NDArray AllocTraceRecorder::Stop() {
+  std::lock_guard<std::mutex> lock(mu_);
+  enabled_.store(false, std::memory_order_relaxed);
+  int64_t num_events = static_cast<int64_t>(events_.size() / 4);
+  NDArray trace = NDArray::Empty({num_events, 4}, DLDataType{kDLInt, 64, 1}, {kDLCPU, 0});
+  trace.CopyFromBytes(events_.data(), events_.size() * sizeof(int64_t));
+  events_.clear();
+  live_.clear();
+  return trace;
+}
+
+void AllocTraceRecorder::RecordAlloc(const Buffer& buffer, size_t nbytes, size_t alignment) {
+  std::lock_guard<std::mutex> lock(mu_);
+  int64_t id = next_id_++;
+  live_[buffer.data] = id;
+  events_.insert(events_.end(), {0, id, static_cast<int64_t>(nbytes),
+                                 static_cast<int64_t>(alignment)});
+}
+
+void AllocTraceRecorder::RecordFree(const Buffer& buffer) {
+  std::lock_guard<std::mutex> lock(mu_);
+  auto it = live_.find(buffer.data);
+  // Buffers allocated before recording started are not part of the trace.
+  if (it == live_.end()) return;
+  events_.insert(events_.end(), {1, it->second, 0, 0});
+  live_.erase(it);
+}
+
+/*!
+ * \brief Replay a trace recorded by AllocTraceRecorder against a fresh allocator.
+ *
+ * An allocation counts as reused when it is served without the allocator taking
+ * more memory from the device.
+ *
+ * \return A JSON object with the number of allocations, the reuse rate, the peak
+ *  bytes held from the device and the peak bytes requested by live buffers.
+ */
+std::string ReplayAllocTrace(NDArray trace, int alloc_type, Device dev) {
+  ICHECK_EQ(trace->ndim, 2);
+  ICHECK_EQ(trace->shape[1], 4);
+  ICHECK(trace->dtype.code == kDLInt && trace->dtype.bits == 64);
+  trace = trace.CopyTo({kDLCPU, 0});
+  const int64_t* events = static_cast<const int64_t*>(trace->data);
+  std::unique_ptr<Allocator> alloc =
+      MemoryManager::CreateAllocator(dev, static_cast<AllocatorType>(alloc_type));
+  std::unordered_map<int64_t, std::pair<Buffer, size_t>> live;
+  int64_t num_allocs = 0, num_reused = 0;
+  size_t peak_bytes = 0, live_bytes = 0, peak_live_bytes = 0;
+  DLDataType type_hint{kDLUInt, 8, 1};
+  for (int64_t i = 0; i < trace->shape[0]; ++i) {
+    const int64_t* event = events + i * 4;
+    if (event[0] == 0) {
+      size_t before = alloc->UsedMemory();
+      Buffer buf = alloc->Alloc(event[2], event[3], type_hint);
+      ++num_allocs;
+      if (alloc->UsedMemory() <= before) ++num_reused;
+      live[event[1]] = {buf, static_cast<size_t>(event[2])};
+      live_bytes += event[2];
+    } else {
+      auto it = live.find(event[1]);
+      ICHECK(it != live.end()) << "free of unknown allocation " << event[1];
+      alloc->Free(it->second.first);
+      live_bytes -= it->second.second;
+      live.erase(it);
+    }
+    peak_bytes = std::max(peak_bytes, alloc->UsedMemory());
+    peak_live_bytes = std::max(peak_live_bytes, live_bytes);
+  }
+  for (auto& kv : live) {
+    alloc->Free(kv.second.first);
+  }
+  std::ostringstream os;
+  os << "{\"num_allocs\": " << num_allocs << ", \"reuse_rate\": "
+     << (num_allocs ? static_cast<double>(num_reused) / num_allocs : 0.0)
+     << ", \"peak_bytes\": " << peak_bytes << ", \"peak_live_bytes\": " << peak_live_bytes
+     << "}";
+  return os.str();
+}
+
+TVM_REGISTER_GLOBAL("vm.memory_manager.start_alloc_trace").set_body_typed([]() {
+  AllocTraceRecorder::Global()->Start();
+});
+
+TVM_REGISTER_GLOBAL("vm.memory_manager.stop_alloc_trace").set_body_typed([]() {
+  return AllocTraceRecorder::Global()->Stop();
+});
+
+TVM_REGISTER_GLOBAL("vm.memory_manager.replay_alloc_trace")
+    .set_body_typed([](NDArray trace, int alloc_type, int device_type, int device_id) {
+      return ReplayAllocTrace(trace, alloc_type, {DLDeviceType(device_type), device_id});
+    });
+
+TVM_REGISTER_GLOBAL("vm.memory_manager.thread_cache_stats")
+    .set_body_typed([](int device_type, int device_id) {
+      Allocator* alloc = MemoryManager::GetAllocator({DLDeviceType(device_type), device_id});
+      ICHECK_EQ(alloc->type(), kThreadCached)
+          << "The allocator for " << DeviceName(device_type) << "(" << device_id
+          << ") is not thread cached";
+      return static_cast<ThreadCachedAllocator*>(alloc)->Stats();
+    });
+
+TVM_REGISTER_GLOBAL("vm.memory_manager.thread_cache_trim")
+    .set_body_typed([](int device_type, int device_id) {
+      Allocator* alloc = MemoryManager::GetAllocator({DLDeviceType(device_type), device_id});
+      ICHECK_EQ(alloc->type(), kThreadCached)
+          << "The allocator for " << DeviceName(device_type) << "(" << device_id
+          << ") is not thread cached";
+      static_cast<ThreadCachedAllocator*>(alloc)->Trim();
+    });
+
 }  // namespace vm
 }  // namespace runtime
 }  // namespace tvm
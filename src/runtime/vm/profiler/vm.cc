@@ -44,9 +44,13 @@ namespace vm {
 
 PackedFunc VirtualMachineDebug::GetFunction(const std::string& name,
                                             const ObjectPtr<Object>& sptr_to_self) {
-  if (name == "profile") {
+  // The *_timeline variants also record when each op ran. They have their own names so that
+  // the signatures clients already call, possibly over RPC, are unchanged.
+  if (name == "profile" || name == "profile_timeline") {
+    bool timeline = name == "profile_timeline";
     return TypedPackedFunc<profiling::Report(String, Array<profiling::MetricCollector>)>(
-        [sptr_to_self, this](String arg_name, Array<profiling::MetricCollector> collectors) {
+        [sptr_to_self, this, timeline](String arg_name,
+                                       Array<profiling::MetricCollector> collectors) {
           std::vector<Device> devices;
           for (auto dev : devices_) {
             if (dev.device_type > 0) {
@@ -58,9 +62,9 @@ PackedFunc VirtualMachineDebug::GetFunction(const std::string& name,
           // on remotes, we accept a nullptr for collectors.
           if (collectors.defined()) {
             std::vector<profiling::MetricCollector> cs(collectors.begin(), collectors.end());
-            prof_ = profiling::Profiler(devices, cs);
+            prof_ = profiling::Profiler(devices, cs, timeline);
           } else {
-            prof_ = profiling::Profiler(devices, {});
+            prof_ = profiling::Profiler(devices, {}, timeline);
           }
 
           auto invoke = VirtualMachine::GetFunction("invoke", sptr_to_self);
@@ -76,12 +80,13 @@ PackedFunc VirtualMachineDebug::GetFunction(const std::string& name,
           prof_ = dmlc::optional<profiling::Profiler>();  // releases hardware counters
           return report;
         });
-  } else if (name == "profile_rpc") {
+  } else if (name == "profile_rpc" || name == "profile_rpc_timeline") {
     // We cannot return a Report over RPC because TMV RPC mechanism only
     // supports a subset of Object classes. Instead we serialize it on the
     // remote (here) and deserialize it on the other end.
-    return TypedPackedFunc<std::string(std::string)>([sptr_to_self, this](std::string arg_name) {
-      PackedFunc profile = GetFunction("profile", sptr_to_self);
+    PackedFunc profile =
+        GetFunction(name == "profile_rpc" ? "profile" : "profile_timeline", sptr_to_self);
+    return TypedPackedFunc<std::string(std::string)>([profile](std::string arg_name) {
       profiling::Report report = profile(arg_name, Array<profiling::MetricCollector>());
       return report->AsJSON();
     });
@@ -97,7 +102,7 @@ void VirtualMachineDebug::LoadExecutable(const ObjectPtr<Executable>& exec) {
   }
 }
 
-void VirtualMachineDebug::OpStartHook(Instruction instr) {
+void VirtualMachineDebug::OpStartHook(const Instruction& instr) {
   if (prof_ && prof_.operator*().IsRunning()) {
     if (instr.op == Opcode::LoadConst) {
       Device dev = GetDevice(exec_->const_device_indexes[instr.const_index]);
@@ -0,0 +1,335 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file runtime/slab_allocator.h
+ * \brief Size-class allocator with a best-fit, split-and-coalesce path for large blocks.
+ *
+ * Unlike the PooledAllocator, which only reuses a buffer when a request rounds to
+ * exactly the same page count, requests here are rounded to jemalloc-style size
+ * classes (four classes per power of two), so allocations of slightly different
+ * dynamic shapes share free lists. Requests above kMaxSizeClass are served by a
+ * best-fit search over the free large blocks; on devices with addressable memory
+ * a block larger than needed is split, and neighbouring free blocks from the same
+ * device allocation are coalesced again when released.
+ *
+ * Cached memory is trimmed back to the device once it exceeds the high-water mark
+ * of live bytes by more than the configured ratio.
+ */
+#ifndef TVM_RUNTIME_VM_SLAB_ALLOCATOR_H_
+#define TVM_RUNTIME_VM_SLAB_ALLOCATOR_H_
+
+#include <tvm/runtime/device_api.h>
+#include <tvm/runtime/vm/memory_manager.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace tvm {
+namespace runtime {
+namespace vm {
+
+class SlabAllocator final : public Allocator {
+ public:
+  static constexpr size_t kDefaultPageSize = 4096;
+  /*! \brief Requests above this size take the best-fit large block path. */
+  static constexpr size_t kMaxSizeClass = 4UL << 20;
+  /*! \brief Cached bytes are trimmed once they exceed this ratio of the live high-water mark. */
+  static constexpr double kDefaultTrimRatio = 1.0;
+
+  explicit SlabAllocator(Device dev, size_t page_size = kDefaultPageSize,
+                         double trim_ratio = kDefaultTrimRatio)
+      : Allocator(kSlab),
+        page_size_(page_size),
+        trim_ratio_(trim_ratio),
+        used_memory_(0),
+        device_(dev),
+        splittable_(IsAddressable(dev)) {}
+
+  ~SlabAllocator() { ReleaseAll(); }
+
+  Buffer Alloc(size_t nbytes, size_t alignment, DLDataType type_hint) override {
+    std::lock_guard<std::recursive_mutex> lock(mu_);
+    size_t size = SizeClass(nbytes);
+    Buffer buf;
+    bool found = size <= kMaxSizeClass ? PopSmall(size, &buf) : PopLarge(size, &buf);
+    if (!found) {
+      buf = DeviceAlloc(size, alignment, type_hint);
+      if (size > kMaxSizeClass) {
+        uintptr_t addr = reinterpret_cast<uintptr_t>(buf.data);
+        large_blocks_.emplace(addr, Block{buf.size, addr, false});
+      }
+    }
+    live_bytes_ += buf.size;
+    peak_live_bytes_ = std::max(peak_live_bytes_, live_bytes_);
+    return buf;
+  }
+
+  void Free(const Buffer& buffer) override {
+    std::lock_guard<std::recursive_mutex> lock(mu_);
+    live_bytes_ -= buffer.size;
+    cached_bytes_ += buffer.size;
+    if (buffer.size <= kMaxSizeClass) {
+      small_pool_[buffer.size].push_back(buffer);
+    } else {
+      PushLarge(buffer);
+    }
+    VLOG(1) << "reclaim buffer " << buffer.size << ", cached " << cached_bytes_ << " B";
+    if (cached_bytes_ > peak_live_bytes_ * trim_ratio_) {
+      Trim();
+    }
+  }
+
+  size_t UsedMemory() const override { return used_memory_.load(std::memory_order_relaxed); }
+
+  /*!
+   * \brief Round a request to its size class.
+   *
+   * Sizes up to one page round to a page. Above that, each power-of-two interval
+   * (2^k, 2^(k+1)] is divided into four classes, bounding internal fragmentation
+   * to 25%. Large requests are only page-rounded.
+   */
+  size_t SizeClass(size_t nbytes) const {
+    if (nbytes <= page_size_) return page_size_;
+    size_t step = page_size_;
+    if (nbytes <= kMaxSizeClass) {
+      size_t pow2 = 1;
+      while ((pow2 << 1) < nbytes) pow2 <<= 1;
+      step = std::max(pow2 / 4, page_size_);
+    }
+    return ((nbytes + step - 1) / step) * step;
+  }
+
+ private:
+  /*! \brief A region of a large device allocation. */
+  struct Block {
+    /*! \brief The size of this region. */
+    size_t size;
+    /*! \brief Base address of the device allocation the region was carved from. */
+    uintptr_t arena;
+    /*! \brief Whether the region is currently on the free list. */
+    bool free;
+  };
+
+  /*! \brief Whether buffers on this device may be split with pointer arithmetic. */
+  static bool IsAddressable(Device dev) {
+    switch (static_cast<int>(dev.device_type)) {
+      case kDLCPU:
+      case kDLCUDA:
+      case kDLCUDAHost:
+      case kDLROCM:
+        return true;
+      default:
+        return false;
+    }
+  }
+
+  Buffer DeviceAlloc(size_t size, size_t alignment, DLDataType type_hint) {
+    Buffer buf;
+    buf.device = device_;
+    buf.size = size;
+    try {
+      buf.data = DeviceAPI::Get(device_)->AllocDataSpace(device_, size, alignment, type_hint);
+    } catch (InternalError& err) {
+      LOG(WARNING) << "SlabAllocator got InternalError during allocation: " << err.message();
+      LOG(WARNING) << "Trying to release all unused memory and reallocate...";
+      ReleaseAll();
+      buf.data = DeviceAPI::Get(device_)->AllocDataSpace(device_, size, alignment, type_hint);
+    }
+    used_memory_.fetch_add(size, std::memory_order_relaxed);
+    VLOG(1) << "allocate " << size << " B, used memory " << used_memory_ << " B";
+    return buf;
+  }
+
+  void DeviceFree(void* data, size_t size) {
+    DeviceAPI::Get(device_)->FreeDataSpace(device_, data);
+    used_memory_.fetch_sub(size, std::memory_order_relaxed);
+  }
+
+  bool PopSmall(size_t size, Buffer* buf) {
+    auto it = small_pool_.find(size);
+    if (it == small_pool_.end() || it->second.empty()) return false;
+    *buf = it->second.back();
+    it->second.pop_back();
+    cached_bytes_ -= buf->size;
+    return true;
+  }
+
+  bool PopLarge(size_t size, Buffer* buf) {
+    auto fit = free_large_.lower_bound(size);
+    if (fit == free_large_.end()) return false;
+    // Without splitting, a much larger block would pin memory for the lifetime of the
+    // buffer, so only accept blocks within one size class of the request.
+    if (!splittable_ && fit->first > size + size / 4) return false;
+    uintptr_t addr = fit->second;
+    free_large_.erase(fit);
+    Block& block = large_blocks_.at(addr);
+    cached_bytes_ -= block.size;
+    block.free = false;
+    if (splittable_ && block.size - size >= kMaxSizeClass) {
+      // Split the tail off as a new free block within the same arena.
+      uintptr_t tail = addr + size;
+      large_blocks_.emplace(tail, Block{block.size - size, block.arena, true});
+      free_large_.emplace(block.size - size, tail);
+      cached_bytes_ += block.size - size;
+      block.size = size;
+    }
+    buf->device = device_;
+    buf->data = reinterpret_cast<void*>(addr);
+    buf->size = block.size;
+    return true;
+  }
+
+  void PushLarge(const Buffer& buffer) {
+    uintptr_t addr = reinterpret_cast<uintptr_t>(buffer.data);
+    auto it = large_blocks_.find(addr);
+    ICHECK(it != large_blocks_.end()) << "SlabAllocator: freeing unknown block " << buffer.data;
+    if (splittable_) {
+      // Coalesce with the following block.
+      auto next = std::next(it);
+      if (next != large_blocks_.end() && next->second.free &&
+          next->second.arena == it->second.arena && next->first == addr + it->second.size) {
+        EraseFree(next->second.size, next->first);
+        it->second.size += next->second.size;
+        large_blocks_.erase(next);
+      }
+      // Coalesce with the preceding block.
+      if (it != large_blocks_.begin()) {
+        auto prev = std::prev(it);
+        if (prev->second.free && prev->second.arena == it->second.arena &&
+            prev->first + prev->second.size == addr) {
+          EraseFree(prev->second.size, prev->first);
+          prev->second.size += it->second.size;
+          large_blocks_.erase(it);
+          it = prev;
+        }
+      }
+    }
+    it->second.free = true;
+    free_large_.emplace(it->second.size, it->first);
+  }
+
+  void EraseFree(size_t size, uintptr_t addr) {
+    auto range = free_large_.equal_range(size);
+    for (auto it = range.first; it != range.second; ++it) {
+      if (it->second == addr) {
+        free_large_.erase(it);
+        return;
+      }
+    }
+    LOG(FATAL) << "SlabAllocator: free list is inconsistent";
+  }
+
+  /*!
+   * \brief Return cached memory to the device, largest first, until the cache
+   *  falls back under the trim threshold. Large blocks can only be released
+   *  once they have been coalesced back into a whole arena.
+   */
+  void Trim() {
+    size_t target = static_cast<size_t>(peak_live_bytes_ * trim_ratio_ / 2);
+    for (auto it = free_large_.rbegin(); it != free_large_.rend() && cached_bytes_ > target;) {
+      uintptr_t addr = it->second;
+      Block& block = large_blocks_.at(addr);
+      if (block.arena != addr || !IsWholeArena(addr)) {
+        ++it;
+        continue;
+      }
+      size_t size = block.size;
+      DeviceFree(reinterpret_cast<void*>(addr), size);
+      cached_bytes_ -= size;
+      large_blocks_.erase(addr);
+      it = std::make_reverse_iterator(free_large_.erase(std::next(it).base()));
+    }
+    for (auto it = small_pool_.rbegin(); it != small_pool_.rend() && cached_bytes_ > target; ++it) {
+      auto& pool = it->second;
+      while (!pool.empty() && cached_bytes_ > target) {
+        DeviceFree(pool.back().data, pool.back().size);
+        cached_bytes_ -= pool.back().size;
+        pool.pop_back();
+      }
+    }
+    VLOG(1) << "trim to " << cached_bytes_ << " B cached, used memory " << used_memory_ << " B";
+  }
+
+  /*! \brief Whether the block at addr spans its entire arena. */
+  bool IsWholeArena(uintptr_t addr) const {
+    auto next = std::next(large_blocks_.find(addr));
+    return next == large_blocks_.end() || next->second.arena != addr;
+  }
+
+  void ReleaseAll() {
+    std::lock_guard<std::recursive_mutex> lock(mu_);
+    for (auto const& it : small_pool_) {
+      for (auto const& buf : it.second) {
+        DeviceAPI::Get(buf.device)->FreeDataSpace(buf.device, buf.data);
+      }
+    }
+    small_pool_.clear();
+    // Arenas that still have live blocks cannot be released.
+    for (auto it = free_large_.begin(); it != free_large_.end();) {
+      if (it->second == large_blocks_.at(it->second).arena && IsWholeArena(it->second)) {
+        DeviceAPI::Get(device_)->FreeDataSpace(device_, reinterpret_cast<void*>(it->second));
+        large_blocks_.erase(it->second);
+        it = free_large_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    cached_bytes_ = TotalFreeLarge();
+    used_memory_ = live_bytes_ + cached_bytes_;
+    VLOG(1) << "release all buffers";
+  }
+
+  size_t TotalFreeLarge() const {
+    size_t total = 0;
+    for (auto const& it : free_large_) total += it.first;
+    return total;
+  }
+
+ private:
+  size_t page_size_;
+  double trim_ratio_;
+  std::atomic<size_t> used_memory_;
+  /*! \brief Bytes handed out and not yet freed. */
+  size_t live_bytes_{0};
+  /*! \brief High-water mark of live_bytes_. */
+  size_t peak_live_bytes_{0};
+  /*! \brief Bytes held on the free lists. */
+  size_t cached_bytes_{0};
+  /*! \brief Free lists of size-classed buffers. */
+  std::map<size_t, std::vector<Buffer>> small_pool_;
+  /*! \brief All large blocks, keyed by address so neighbours can be coalesced. */
+  std::map<uintptr_t, Block> large_blocks_;
+  /*! \brief Free large blocks, keyed by size for best-fit lookup. */
+  std::multimap<size_t, uintptr_t> free_large_;
+  std::recursive_mutex mu_;
+  Device device_;
+  bool splittable_;
+};
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_VM_SLAB_ALLOCATOR_H_
@@ -0,0 +1,335 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file runtime/thread_cached_allocator.h
+ * \brief Per-thread magazine caches in front of a shared SlabAllocator.
+ *
+ * Every thread owns a magazine of free buffers per size class and serves
+ * allocations and frees from it without taking any lock. When a thread's
+ * magazine runs empty it takes a full magazine from the shared depot, and when
+ * it overflows it hands one back, so the shared lock is taken once per
+ * kMagazineSize operations rather than once per operation. Only when the depot
+ * has nothing to offer does the request fall through to the backing allocator.
+ *
+ * A thread that stops allocating keeps up to 2 * kMagazineSize - 1 buffers per
+ * size class until it exits. Trim() returns the cached buffers to the backing
+ * allocator: the depot and the calling thread's magazines at once, the other
+ * threads' magazines on their next allocation or free.
+ */
+#ifndef TVM_RUNTIME_VM_THREAD_CACHED_ALLOCATOR_H_
+#define TVM_RUNTIME_VM_THREAD_CACHED_ALLOCATOR_H_
+
+#include <tvm/runtime/vm/memory_manager.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "slab_allocator.h"
+
+namespace tvm {
+namespace runtime {
+namespace vm {
+
+class ThreadCachedAllocator final : public Allocator {
+ public:
+  /*! \brief Number of buffers moved between a thread and the depot at once. */
+  static constexpr size_t kMagazineSize = 16;
+  /*! \brief Full magazines kept in the depot per size class before returning to the backing. */
+  static constexpr size_t kMaxDepotMagazines = 8;
+
+  explicit ThreadCachedAllocator(Device dev)
+      : Allocator(kThreadCached), id_(NextId()), backing_(dev) {
+    std::lock_guard<std::mutex> lock(RegistryMutex());
+    LiveAllocators().insert(id_);
+  }
+
+  ~ThreadCachedAllocator() {
+    {
+      std::lock_guard<std::mutex> lock(RegistryMutex());
+      LiveAllocators().erase(id_);
+    }
+    std::lock_guard<std::mutex> lock(depot_mu_);
+    for (auto& cache : caches_) {
+      for (auto& kv : cache->magazines) {
+        for (auto& buf : kv.second) backing_.Free(buf);
+      }
+    }
+    for (auto& kv : depot_) {
+      for (auto& magazine : kv.second) {
+        for (auto& buf : magazine) backing_.Free(buf);
+      }
+    }
+  }
+
+  Buffer Alloc(size_t nbytes, size_t alignment, DLDataType type_hint) override {
+    size_t size = backing_.SizeClass(nbytes);
+    if (size > SlabAllocator::kMaxSizeClass) {
+      return backing_.Alloc(nbytes, alignment, type_hint);
+    }
+    ThreadCache* cache = GetThreadCache();
+    ReleaseIfTrimmed(cache);
+    std::vector<Buffer>& magazine = cache->magazines[size];
+    if (magazine.empty()) {
+      std::lock_guard<std::mutex> lock(depot_mu_);
+      auto it = depot_.find(size);
+      if (it != depot_.end() && !it->second.empty()) {
+        magazine = std::move(it->second.back());
+        it->second.pop_back();
+        cache->refills.fetch_add(1, std::memory_order_relaxed);
+        cache->cached.fetch_add(magazine.size(), std::memory_order_relaxed);
+      }
+    }
+    if (magazine.empty()) {
+      cache->misses.fetch_add(1, std::memory_order_relaxed);
+      return backing_.Alloc(nbytes, alignment, type_hint);
+    }
+    cache->hits.fetch_add(1, std::memory_order_relaxed);
+    cache->cached.fetch_sub(1, std::memory_order_relaxed);
+    Buffer buf = magazine.back();
+    magazine.pop_back();
+    return buf;
+  }
+
+  void Free(const Buffer& buffer) override {
+    if (buffer.size > SlabAllocator::kMaxSizeClass) {
+      backing_.Free(buffer);
+      return;
+    }
+    ThreadCache* cache = GetThreadCache();
+    ReleaseIfTrimmed(cache);
+    std::vector<Buffer>& magazine = cache->magazines[buffer.size];
+    magazine.push_back(buffer);
+    cache->cached.fetch_add(1, std::memory_order_relaxed);
+    if (magazine.size() >= 2 * kMagazineSize) {
+      std::vector<Buffer> full(magazine.end() - kMagazineSize, magazine.end());
+      magazine.resize(magazine.size() - kMagazineSize);
+      cache->flushes.fetch_add(1, std::memory_order_relaxed);
+      cache->cached.fetch_sub(kMagazineSize, std::memory_order_relaxed);
+      PushDepot(buffer.size, std::move(full));
+    }
+  }
+
+  size_t UsedMemory() const override { return backing_.UsedMemory(); }
+
+  /*!
+   * \brief Return the cached buffers to the backing allocator.
+   *
+   * Only its owner touches a magazine, so the magazines of the other threads are
+   * released the next time those threads allocate or free a buffer of at most
+   * SlabAllocator::kMaxSizeClass bytes, or when they exit.
+   */
+  void Trim() {
+    trim_epoch_.fetch_add(1, std::memory_order_relaxed);
+    ReleaseIfTrimmed(GetThreadCache());
+    std::lock_guard<std::mutex> lock(depot_mu_);
+    for (auto& kv : depot_) {
+      for (auto& magazine : kv.second) {
+        for (auto& buf : magazine) backing_.Free(buf);
+      }
+    }
+    depot_.clear();
+  }
+
+  /*!
+   * \brief Counters summed over all threads, including those which have exited.
+   * \return A JSON object with the number of threads which have a cache, the number of
+   *  allocations served from a thread cache
+   *  (hits), served by the backing allocator (misses), and the number of magazines
+   *  taken from (refills) and handed back to (flushes) the shared depot, and the number of
+   *  free buffers held in the thread caches and the depot (cached).
+   */
+  std::string Stats() {
+    int64_t hits = 0, misses = 0, refills = 0, flushes = 0, cached = 0;
+    size_t num_threads = 0;
+    {
+      std::lock_guard<std::mutex> lock(depot_mu_);
+      num_threads = caches_.size();
+      hits = retired_.hits;
+      misses = retired_.misses;
+      refills = retired_.refills;
+      flushes = retired_.flushes;
+      for (auto& cache : caches_) {
+        hits += cache->hits.load(std::memory_order_relaxed);
+        misses += cache->misses.load(std::memory_order_relaxed);
+        refills += cache->refills.load(std::memory_order_relaxed);
+        flushes += cache->flushes.load(std::memory_order_relaxed);
+        cached += cache->cached.load(std::memory_order_relaxed);
+      }
+      for (auto& kv : depot_) {
+        for (auto& magazine : kv.second) cached += magazine.size();
+      }
+    }
+    std::ostringstream os;
+    os << "{\"threads\": " << num_threads << ", \"hits\": " << hits
+       << ", \"misses\": " << misses << ", \"refills\": " << refills
+       << ", \"flushes\": " << flushes << ", \"cached\": " << cached
+       << ", \"used_memory\": " << UsedMemory() << "}";
+    return os.str();
+  }
+
+ private:
+  /*! \brief The counters of the caches of the threads which have exited. */
+  struct RetiredCounters {
+    int64_t hits{0};
+    int64_t misses{0};
+    int64_t refills{0};
+    int64_t flushes{0};
+  };
+
+  /*! \brief The magazines of one thread. Only touched by its owner until the thread exits. */
+  struct ThreadCache {
+    std::map<size_t, std::vector<Buffer>> magazines;
+    std::atomic<int64_t> hits{0};
+    std::atomic<int64_t> misses{0};
+    std::atomic<int64_t> refills{0};
+    std::atomic<int64_t> flushes{0};
+    /*! \brief The number of buffers in the magazines, for Stats. */
+    std::atomic<int64_t> cached{0};
+    /*! \brief The value of trim_epoch_ when the magazines were last released. */
+    uint64_t trim_epoch{0};
+  };
+
+  /*!
+   * \brief The thread-local map from allocator id to that allocator's cache for the
+   *  current thread. On thread exit, the caches of the allocators that are still alive are
+   *  retired. The caches of the other allocators were freed along with them.
+   */
+  struct ThreadCacheTable {
+    std::unordered_map<uint64_t, std::pair<ThreadCachedAllocator*, ThreadCache*>> entries;
+
+    ~ThreadCacheTable() {
+      std::lock_guard<std::mutex> lock(RegistryMutex());
+      for (auto& kv : entries) {
+        if (LiveAllocators().count(kv.first) == 0) continue;
+        kv.second.first->RetireCache(kv.second.second);
+      }
+    }
+  };
+
+  ThreadCache* GetThreadCache() {
+    static thread_local ThreadCacheTable table;
+    auto it = table.entries.find(id_);
+    if (it != table.entries.end()) return it->second.second;
+    {
+      // A thread meets a new allocator rarely, drop the entries of the destroyed ones then.
+      std::lock_guard<std::mutex> lock(RegistryMutex());
+      for (auto entry = table.entries.begin(); entry != table.entries.end();) {
+        if (LiveAllocators().count(entry->first) == 0) {
+          entry = table.entries.erase(entry);
+        } else {
+          ++entry;
+        }
+      }
+    }
+    std::lock_guard<std::mutex> lock(depot_mu_);
+    caches_.emplace_back(new ThreadCache());
+    ThreadCache* cache = caches_.back().get();
+    cache->trim_epoch = trim_epoch_.load(std::memory_order_relaxed);
+    table.entries[id_] = {this, cache};
+    return cache;
+  }
+
+  /*! \brief Move the buffers and counters of the cache of an exiting thread here, and free it. */
+  void RetireCache(ThreadCache* cache) {
+    ReleaseIfTrimmed(cache);
+    std::lock_guard<std::mutex> lock(depot_mu_);
+    for (auto& magazine : cache->magazines) {
+      if (!magazine.second.empty()) PushDepotLocked(magazine.first, std::move(magazine.second));
+    }
+    retired_.hits += cache->hits.load(std::memory_order_relaxed);
+    retired_.misses += cache->misses.load(std::memory_order_relaxed);
+    retired_.refills += cache->refills.load(std::memory_order_relaxed);
+    retired_.flushes += cache->flushes.load(std::memory_order_relaxed);
+    caches_.erase(std::find_if(
+        caches_.begin(), caches_.end(),
+        [cache](const std::unique_ptr<ThreadCache>& owned) { return owned.get() == cache; }));
+  }
+
+  /*! \brief Free the magazines of the calling thread if Trim was called since they were last. */
+  void ReleaseIfTrimmed(ThreadCache* cache) {
+    uint64_t epoch = trim_epoch_.load(std::memory_order_relaxed);
+    if (cache->trim_epoch == epoch) return;
+    cache->trim_epoch = epoch;
+    for (auto& kv : cache->magazines) {
+      for (auto& buf : kv.second) backing_.Free(buf);
+      kv.second.clear();
+    }
+    cache->cached.store(0, std::memory_order_relaxed);
+  }
+
+  void PushDepot(size_t size, std::vector<Buffer> magazine) {
+    std::lock_guard<std::mutex> lock(depot_mu_);
+    PushDepotLocked(size, std::move(magazine));
+  }
+
+  /*! \brief Add a full magazine to the depot, with depot_mu_ held. */
+  void PushDepotLocked(size_t size, std::vector<Buffer> magazine) {
+    auto& magazines = depot_[size];
+    if (magazines.size() < kMaxDepotMagazines) {
+      magazines.emplace_back(std::move(magazine));
+      return;
+    }
+    // The depot is full, let the backing allocator decide whether to keep or trim them.
+    for (auto& buf : magazine) backing_.Free(buf);
+  }
+
+  static uint64_t NextId() {
+    static std::atomic<uint64_t> next_id{0};
+    return next_id.fetch_add(1, std::memory_order_relaxed);
+  }
+
+  static std::mutex& RegistryMutex() {
+    static auto* mu = new std::mutex();
+    return *mu;
+  }
+
+  static std::unordered_set<uint64_t>& LiveAllocators() {
+    static auto* ids = new std::unordered_set<uint64_t>();
+    return *ids;
+  }
+
+  /*! \brief Unique id, so a thread's cache table never confuses a reused address. */
+  uint64_t id_;
+  SlabAllocator backing_;
+  std::mutex depot_mu_;
+  /*! \brief Full magazines shared between threads, per size class. */
+  std::unordered_map<size_t, std::vector<std::vector<Buffer>>> depot_;
+  /*! \brief The caches of the threads which have used this allocator and not exited. */
+  std::vector<std::unique_ptr<ThreadCache>> caches_;
+  /*! \brief The counters of the caches removed from caches_. */
+  RetiredCounters retired_;
+  /*! \brief Bumped by Trim, each thread releases its magazines when it sees a new value. */
+  std::atomic<uint64_t> trim_epoch_{0};
+};
+
+}  // namespace vm
+}  // namespace runtime
+}  // namespace tvm
+
+#endif  // TVM_RUNTIME_VM_THREAD_CACHED_ALLOCATOR_H_
@@ -26,21 +26,42 @@
 #include <tvm/runtime/container/adt.h>
 #include <tvm/runtime/data_type.h>
 #include <tvm/runtime/debug.h>
+#include <tvm/runtime/device_api.h>
 #include <tvm/runtime/logging.h>
 #include <tvm/runtime/memory.h>
 #include <tvm/runtime/object.h>
+#include <tvm/runtime/threading_backend.h>
 #include <tvm/runtime/vm/vm.h>
 
 #include <algorithm>
 #include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <future>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <thread>
 #include <vector>
 
 #include "../file_utils.h"
+#include "../sampling_profiler.h"
 
 using namespace tvm::runtime;
 
+/*
+ * With GCC and clang, RunLoop jumps through a table of label addresses instead of the
+ * switch. The compiler duplicates the indirect jump into the end of every handler, so
+ * each opcode gets its own branch prediction history.
+ */
+#if defined(__GNUC__) && !defined(TVM_VM_DISABLE_COMPUTED_GOTO)
+#define TVM_VM_COMPUTED_GOTO 1
+#else
+#define TVM_VM_COMPUTED_GOTO 0
+#endif
+
 namespace tvm {
 namespace runtime {
 namespace vm {
@@ -54,6 +75,116 @@ VMClosure::VMClosure(size_t func_index, std::vector<ObjectRef> free_vars) {
   data_ = std::move(ptr);
 }
 
+/*!
+ * \brief Runs VM invocations on worker threads, each with its own VirtualMachine.
+ *
+ * A VirtualMachine keeps its call stack and registers in its members, so each worker owns
+ * a VM created by VirtualMachine::CreateWorker. The workers share the executable, devices
+ * and allocators, so the host control flow of one request overlaps the kernels of another.
+ * Each worker launches its parallel kernels on a pool of its own, bound to a slice of the cores.
+ */
+class VMAsyncExecutor {
+ public:
+  using Task = std::function<void(VirtualMachine*)>;
+
+  VMAsyncExecutor(std::vector<ObjectPtr<VirtualMachine>> vms, int intra_op_threads)
+      : vms_(std::move(vms)) {
+    int num_cores = threading::MaxConcurrency();
+    for (size_t i = 0; i < vms_.size(); ++i) {
+      std::vector<unsigned int> cpus;
+      for (int j = 0; j < intra_op_threads; ++j) {
+        cpus.push_back(static_cast<unsigned int>((i * intra_op_threads + j) % num_cores));
+      }
+      threads_.emplace_back([this, i, intra_op_threads, cpus]() {
+        threading::ConfigureLocalThreads(intra_op_threads, cpus);
+        this->WorkerLoop(vms_[i].get());
+      });
+    }
+  }
+
+  ~VMAsyncExecutor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    cv_.notify_all();
+    for (auto& thread : threads_) thread.join();
+  }
+
+  size_t NumWorkers() const { return vms_.size(); }
+
+  void Submit(Task task) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      tasks_.push_back(std::move(task));
+    }
+    cv_.notify_one();
+  }
+
+ private:
+  void WorkerLoop(VirtualMachine* vm) {
+    while (true) {
+      Task task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this]() { return stop_ || !tasks_.empty(); });
+        // Pending requests are still run on shutdown, their callers may be waiting.
+        if (tasks_.empty()) return;
+        task = std::move(tasks_.front());
+        tasks_.pop_front();
+      }
+      task(vm);
+    }
+  }
+
+  std::vector<ObjectPtr<VirtualMachine>> vms_;
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<Task> tasks_;
+  bool stop_{false};
+};
+
+/*! \brief The handle of an invocation running on the VMAsyncExecutor. */
+class VMFutureNode : public ModuleNode {
+ public:
+  explicit VMFutureNode(std::shared_future<ObjectRef> result) : result_(std::move(result)) {}
+
+  const char* type_key() const final { return "VMFuture"; }
+
+  PackedFunc GetFunction(const std::string& name, const ObjectPtr<Object>& sptr_to_self) final {
+    if (name == "is_ready") {
+      return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+        *rv = result_.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+      });
+    } else if (name == "wait") {
+      return PackedFunc(
+          [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = result_.get(); });
+    } else if (name == "get_output") {
+      return TypedPackedFunc<NDArray(int64_t)>([sptr_to_self, this](int64_t index) {
+        const ObjectRef& result = result_.get();
+        if (const auto* adt = result.as<ADTObj>()) {
+          ICHECK_LT(index, adt->size);
+          return Downcast<NDArray>((*adt)[index]);
+        }
+        CHECK_EQ(index, 0) << "VM output contains only one item, but you are trying to get the "
+                           << index << "th.";
+        return Downcast<NDArray>(result);
+      });
+    } else if (name == "get_num_outputs") {
+      return TypedPackedFunc<int64_t(void)>([sptr_to_self, this]() -> int64_t {
+        const ObjectRef& result = result_.get();
+        if (const auto* adt = result.as<ADTObj>()) return adt->size;
+        return 1;
+      });
+    }
+    return PackedFunc();
+  }
+
+ private:
+  std::shared_future<ObjectRef> result_;
+};
+
 void VMFunctionPrint(std::ostream& os, const VMFunction& vm_func) {
   os << vm_func.name << ": " << std::endl;
   for (size_t i = 0; i < vm_func.instructions.size(); ++i) {
@@ -117,7 +248,7 @@ std::vector<int64_t> ToShape(NDArray shape_tensor) {
   return shape;
 }
 
-void VirtualMachine::OpStartHook(Instruction instr) {}
+void VirtualMachine::OpStartHook(const Instruction& instr) {}
 void VirtualMachine::OpStopHook() {}
 
 PackedFunc VirtualMachine::GetFunction(const std::string& name,
@@ -130,7 +261,7 @@ PackedFunc VirtualMachine::GetFunction(const std::string& name,
       auto git = exec_->global_map.find(func_name);
       ICHECK(git != exec_->global_map.end())
           << "Cannot find function " << func_name << " in the executable";
-      auto func = exec_->functions[git->second];
+      const auto& func = exec_->functions[git->second];
       if (func.params.empty()) {
         *rv = Invoke(func, {});
       } else {
@@ -223,6 +354,57 @@ PackedFunc VirtualMachine::GetFunction(const std::string& name,
       std::string path = args[0];
       exec_->LoadLateBoundConstantsFromFile(path);
     });
+  } else if (name == "set_superinstructions") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      use_super_instructions_ = args[0];
+    });
+  } else if (name == "invoke_async") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      ICHECK(exec_) << "The executable is not created yet.";
+      std::string func_name = args[0];
+      std::vector<ObjectRef> func_args;
+      if (args.size() > 1) {
+        func_args = ConvertInputs(func_name, args, 1);
+      } else if (!CheckAndGetVMFunction(func_name).params.empty()) {
+        auto it = inputs_.find(func_name);
+        ICHECK(it != inputs_.end()) << "Input has not been set for function " << func_name;
+        func_args = it->second;
+      }
+      *rv = InvokeAsync(func_name, std::move(func_args));
+    });
+  } else if (name == "set_async_workers") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int num_workers = args[0];
+      int intra_op_threads = args.num_args > 1 ? args[1].operator int() : 0;
+      ICHECK_GE(num_workers, 0);
+      ICHECK_GE(intra_op_threads, 0);
+      num_async_workers_ = num_workers;
+      async_intra_op_threads_ = intra_op_threads;
+      // Blocks until the old workers have run the queued requests. New ones are created on the
+      // next request.
+      async_executor_.reset();
+    });
+  } else if (name == "set_constant_memory_budget") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      int64_t budget = args[0];
+      ICHECK_GE(budget, 0);
+      const_budget_bytes_ = static_cast<size_t>(budget);
+    });
+  } else if (name == "get_constant_stats") {
+    return PackedFunc(
+        [sptr_to_self, this](TVMArgs args, TVMRetValue* rv) { *rv = this->ConstantStats(); });
+  } else if (name == "set_sampling_profiler") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      double min_interval_ms = args.num_args > 1 ? args[1].operator double() : 0;
+      double window_s = args.num_args > 2 ? args[2].operator double() : 60;
+      this->SetSamplingProfiler(args[0], min_interval_ms, window_s);
+    });
+  } else if (name == "get_sampling_profile") {
+    return PackedFunc([sptr_to_self, this](TVMArgs args, TVMRetValue* rv) {
+      ICHECK(sampling_profiler_ != nullptr)
+          << "The sampling profiler is disabled, enable it with set_sampling_profiler";
+      *rv = sampling_profiler_->ReportJSON();
+    });
   } else {
     LOG(FATAL) << "Unknown packed function: " << name;
     return PackedFunc([sptr_to_self, name](TVMArgs args, TVMRetValue* rv) {});
@@ -230,6 +412,13 @@ PackedFunc VirtualMachine::GetFunction(const std::string& name,
 }
 
 void VirtualMachine::SetInput(std::string func_name, TVMArgs args, int offset) {
+  std::vector<ObjectRef> func_args = ConvertInputs(func_name, args, offset);
+  inputs_.erase(func_name);
+  inputs_.emplace(func_name, std::move(func_args));
+}
+
+std::vector<ObjectRef> VirtualMachine::ConvertInputs(const std::string& func_name, TVMArgs args,
+                                                     int offset) {
   const auto& vm_func = CheckAndGetVMFunction(func_name);
   size_t params_num = vm_func.params.size();
   ICHECK_EQ(args.size() - offset, params_num)
@@ -240,8 +429,54 @@ void VirtualMachine::SetInput(std::string func_name, TVMArgs args, int offset) {
     Device dev = GetDevice(vm_func.param_device_indexes[index]);
     SetInputTensorWithIndex(func_args, args[i], index, dev);
   }
-  inputs_.erase(func_name);
-  inputs_.emplace(func_name, func_args);
+  return func_args;
+}
+
+ObjectPtr<VirtualMachine> VirtualMachine::CreateWorker() const {
+  auto vm = make_object<VirtualMachine>();
+  vm->LoadExecutable(exec_);
+  vm->devices_ = devices_;
+  vm->allocators_ = allocators_;
+  vm->use_super_instructions_ = use_super_instructions_;
+  vm->const_budget_bytes_ = const_budget_bytes_;
+  // Share the device copies of the constants loaded so far rather than copying them again.
+  vm->const_pool_ = const_pool_;
+  vm->const_pool_sizes_ = const_pool_sizes_;
+  vm->const_last_use_ = const_last_use_;
+  vm->const_pool_bytes_ = const_pool_bytes_;
+  vm->sampling_profiler_ = sampling_profiler_;
+  return vm;
+}
+
+Module VirtualMachine::InvokeAsync(const std::string& func_name, std::vector<ObjectRef> args) {
+  ICHECK(!devices_.empty()) << "Did you forget to init the VirtualMachine with devices?";
+  if (async_executor_ == nullptr) {
+    int num_workers = num_async_workers_;
+    if (num_workers == 0) {
+      const char* env = std::getenv("TVM_VM_ASYNC_WORKERS");
+      num_workers = env != nullptr ? std::max(atoi(env), 1) : 2;
+    }
+    int intra_op_threads = async_intra_op_threads_;
+    if (intra_op_threads == 0) {
+      intra_op_threads = std::max(1, threading::MaxConcurrency() / num_workers);
+    }
+    std::vector<ObjectPtr<VirtualMachine>> vms;
+    for (int i = 0; i < num_workers; ++i) {
+      vms.push_back(CreateWorker());
+    }
+    async_executor_ = std::make_shared<VMAsyncExecutor>(std::move(vms), intra_op_threads);
+  }
+  auto promise = std::make_shared<std::promise<ObjectRef>>();
+  std::shared_future<ObjectRef> result = promise->get_future().share();
+  async_executor_->Submit(
+      [promise, func_name, args = std::move(args)](VirtualMachine* vm) {
+        try {
+          promise->set_value(vm->Invoke(func_name, args));
+        } catch (...) {
+          promise->set_exception(std::current_exception());
+        }
+      });
+  return Module(make_object<VMFutureNode>(result));
 }
 
 void VirtualMachine::SetOneInput(std::string func_name, const TVMArgValue& tag,
@@ -335,6 +570,7 @@ Index VirtualMachine::PopFrame() {
   const VMFrame& fr = frames_.back();
   func_index_ = fr.func_index;
   code_ = fr.code;
+  super_code_ = GetSuperInstructions(func_index_);
   pc_ = fr.pc;
   auto call_stack_size = frames_.size();
   frames_.pop_back();
@@ -352,9 +588,41 @@ void VirtualMachine::InvokeGlobal(const VMFunction& func, const std::vector<Obje
   }
 
   code_ = func.instructions.data();
+  // Functions of the executable are located by address to find their superinstructions.
+  const VMFunction* funcs = exec_->functions.data();
+  bool in_exec = &func >= funcs && &func < funcs + exec_->functions.size();
+  func_index_ = in_exec ? static_cast<Index>(&func - funcs) : -1;
+  super_code_ = GetSuperInstructions(func_index_);
   pc_ = 0;
 }
 
+void VirtualMachine::DecodeSuperInstructions() {
+  super_instructions_.clear();
+  for (const VMFunction& func : exec_->functions) {
+    const std::vector<Instruction>& code = func.instructions;
+    std::vector<SuperInstruction> table(code.size(), SuperInstruction::kNone);
+    for (size_t pc = 0; pc + 1 < code.size(); ++pc) {
+      const Instruction& instr = code[pc];
+      const Instruction& next = code[pc + 1];
+      if (instr.op == Opcode::AllocStorage && next.op == Opcode::AllocTensor &&
+          next.alloc_tensor.storage == instr.dst) {
+        table[pc] = SuperInstruction::kAllocStorageTensor;
+      } else if (instr.op == Opcode::InvokePacked && next.op == Opcode::KillRegister) {
+        table[pc] = SuperInstruction::kInvokePackedKill;
+      }
+    }
+    super_instructions_.push_back(std::move(table));
+  }
+}
+
+const SuperInstruction* VirtualMachine::GetSuperInstructions(Index func_index) const {
+  if (!use_super_instructions_ || func_index < 0 ||
+      static_cast<size_t>(func_index) >= super_instructions_.size()) {
+    return nullptr;
+  }
+  return super_instructions_[func_index].data();
+}
+
 ObjectRef VirtualMachine::Invoke(const VMFunction& func, const std::vector<ObjectRef>& args) {
   DLOG(INFO) << "Executing Function: " << std::endl << func;
   for (int i = 0; i < static_cast<int>(devices_.size()); ++i) {
@@ -363,8 +631,17 @@ ObjectRef VirtualMachine::Invoke(const VMFunction& func, const std::vector<Objec
                << (i == exec_->host_device_index ? " (using as host device)" : "");
   }
 
+  sampling_run_ = sampling_profiler_ != nullptr && sampling_profiler_->BeginRun();
+  if (!sampling_run_) {
+    InvokeGlobal(func, args);
+    RunLoop();
+    return return_register_;
+  }
+  uint64_t start = SamplingProfiler::Now();
   InvokeGlobal(func, args);
   RunLoop();
+  sampling_run_ = false;
+  sampling_profiler_->EndRun(SamplingProfiler::Now() - start);
   return return_register_;
 }
 
@@ -416,10 +693,83 @@ void VirtualMachine::InvokePacked(Index packed_index, const PackedFunc& func, In
     }
   }
 
-  if (!is_empty_output) {
-    TVMRetValue rv;
+  if (is_empty_output) return;
+  TVMRetValue rv;
+  if (!sampling_run_) {
     func.CallPacked(TVMArgs(values.data(), codes.data(), arity), &rv);
+    return;
+  }
+  uint64_t start = SamplingProfiler::Now();
+  func.CallPacked(TVMArgs(values.data(), codes.data(), arity), &rv);
+  // Launches on accelerators return before the kernel is done.
+  for (const Device& dev : devices_) {
+    if (dev.device_type != kDLCPU) DeviceAPI::Get(dev)->StreamSync(dev, nullptr);
+  }
+  sampling_profiler_->Record(packed_index, SamplingProfiler::Now() - start);
+}
+
+void VirtualMachine::LoadConstant(Index const_index) {
+  if (const_pool_.size() <= static_cast<size_t>(const_index)) {
+    const_pool_.resize(const_index + 1);
+    const_pool_sizes_.resize(const_index + 1, 0);
+    const_last_use_.resize(const_index + 1, 0);
+  }
+  // A lazy constant is deserialized here, the first time any VM loads it.
+  ObjectRef constant_obj = exec_->GetConstant(const_index);
+  Device dev = GetDevice(exec_->const_device_indexes[const_index]);
+  const_pool_[const_index] = CopyTo(constant_obj, dev);
+  if (const auto* ndarray = const_pool_[const_index].as<NDArray::Container>()) {
+    const_pool_sizes_[const_index] = GetDataSize(ndarray->dl_tensor);
+  }
+  const_pool_bytes_ += const_pool_sizes_[const_index];
+  const_last_use_[const_index] = ++const_clock_;
+  if (const_budget_bytes_ == 0) return;
+  // Evict the least recently used constants until the pool fits the budget again. The
+  // executable drops its copy too, so lazy constants are deserialized again when needed.
+  while (const_pool_bytes_ > const_budget_bytes_) {
+    int64_t victim = -1;
+    for (size_t i = 0; i < const_pool_.size(); ++i) {
+      if (static_cast<Index>(i) == const_index || !const_pool_[i].defined()) continue;
+      if (victim < 0 || const_last_use_[i] < const_last_use_[victim]) victim = i;
+    }
+    if (victim < 0) break;
+    const_pool_[victim] = ObjectRef();
+    const_pool_bytes_ -= const_pool_sizes_[victim];
+    exec_->EvictConstant(victim);
+    ++const_pool_evictions_;
+  }
+}
+
+std::string VirtualMachine::ConstantStats() const {
+  size_t num_cached = 0;
+  for (const auto& constant : const_pool_) {
+    if (constant.defined()) ++num_cached;
   }
+  std::ostringstream os;
+  os << "{\"num_constants\": " << exec_->constants.size() << ", \"num_cached\": " << num_cached
+     << ", \"cached_bytes\": " << const_pool_bytes_
+     << ", \"budget_bytes\": " << const_budget_bytes_
+     << ", \"num_evictions\": " << const_pool_evictions_ << "}";
+  return os.str();
+}
+
+void VirtualMachine::SetSamplingProfiler(int64_t sample_every, double min_interval_ms,
+                                         double window_s) {
+  ICHECK_GE(sample_every, 0);
+  ICHECK(exec_) << "The executable is not created yet.";
+  sampling_profiler_ = nullptr;
+  if (sample_every != 0) {
+    // The kernels are identified by their index in the packed function table.
+    std::vector<std::string> op_names(packed_funcs_.size());
+    for (const auto& it : exec_->primitive_map) op_names[it.second] = it.first;
+    SamplingProfiler::Config config;
+    config.sample_every = sample_every;
+    config.min_interval_ms = min_interval_ms;
+    config.window_s = window_s;
+    sampling_profiler_ = std::make_shared<SamplingProfiler>(std::move(op_names), config);
+  }
+  // Workers are created again on the next async request, with the new profiler.
+  async_executor_.reset();
 }
 
 void VirtualMachine::LoadExecutable(const ObjectPtr<Executable>& exec) {
@@ -447,6 +797,7 @@ void VirtualMachine::LoadExecutable(const ObjectPtr<Executable>& exec) {
   for (size_t i = 0; i < packed_funcs_.size(); ++i) {
     ICHECK(packed_funcs_[i] != nullptr) << "Packed function " << i << " is not initialized";
   }
+  DecodeSuperInstructions();
 }
 
 void VirtualMachine::Init(const std::vector<Device>& physical_devices,
@@ -481,32 +832,49 @@ inline void VirtualMachine::WriteRegister(Index r, const ObjectRef& val) {
   frames_.back().register_file[r] = val;
 }
 
-ObjectRef VirtualMachine::ReadRegister(Index r) const { return frames_.back().register_file[r]; }
+inline void VirtualMachine::WriteRegister(Index r, ObjectRef&& val) {
+  frames_.back().register_file[r] = std::move(val);
+}
+
+const ObjectRef& VirtualMachine::ReadRegister(Index r) const {
+  return frames_.back().register_file[r];
+}
 
 int64_t VirtualMachine::LoadScalarInt(Index r) const {
   int64_t result = 0;
   const auto& obj = ReadRegister(r);
-  NDArray array = Downcast<NDArray>(CopyTo(obj, GetDevice(exec_->host_device_index)));
+  // Scalars are almost always on the host already, read them in place.
+  const DLTensor* array = nullptr;
+  NDArray copy;
+  const auto* container = obj.as<NDArray::Container>();
+  if (container != nullptr && container->dl_tensor.device.device_type ==
+                                  GetDevice(exec_->host_device_index).device_type) {
+    array = &container->dl_tensor;
+  } else {
+    copy = Downcast<NDArray>(CopyTo(obj, GetDevice(exec_->host_device_index)));
+    array = copy.operator->();
+  }
+  const void* data = static_cast<const char*>(array->data) + array->byte_offset;
 
   switch (array->dtype.bits) {
     case 1: {
-      result = reinterpret_cast<bool*>(array->data)[0];
+      result = static_cast<const bool*>(data)[0];
       break;
     }
     case 8: {
-      result = reinterpret_cast<int8_t*>(array->data)[0];
+      result = static_cast<const int8_t*>(data)[0];
       break;
     }
     case 16: {
-      result = reinterpret_cast<int16_t*>(array->data)[0];
+      result = static_cast<const int16_t*>(data)[0];
       break;
     }
     case 32: {
-      result = reinterpret_cast<int32_t*>(array->data)[0];
+      result = static_cast<const int32_t*>(data)[0];
       break;
     }
     case 64: {
-      result = reinterpret_cast<int64_t*>(array->data)[0];
+      result = static_cast<const int64_t*>(data)[0];
       break;
     }
     default:
@@ -515,9 +883,32 @@ int64_t VirtualMachine::LoadScalarInt(Index r) const {
   return result;
 }
 
+/*! \brief Allocate the tensor of an AllocTensor instruction from its storage. */
+NDArray AllocTensorFromStorage(const Instruction& instr, const Storage& storage, int64_t offset) {
+  std::vector<int64_t> shape(instr.alloc_tensor.shape,
+                             instr.alloc_tensor.shape + instr.alloc_tensor.ndim);
+  return storage->AllocNDArray(offset, shape, instr.alloc_tensor.dtype);
+}
+
 void VirtualMachine::RunLoop() {
   ICHECK(this->exec_);
   ICHECK(this->code_);
+#if TVM_VM_COMPUTED_GOTO
+  // Indexed by the value of Opcode.
+  static const void* const kDispatchTable[] = {
+      &&op_Move,         &&op_Ret,          &&op_Invoke,         &&op_InvokeClosure,
+      &&op_InvokePacked, &&op_AllocTensor,  &&op_AllocTensorReg, &&op_AllocADT,
+      &&op_AllocClosure, &&op_GetField,     &&op_If,             &&op_LoadConst,
+      &&op_Goto,         &&op_GetTag,       &&op_LoadConsti,     &&op_Fatal,
+      &&op_AllocStorage, &&op_ShapeOf,      &&op_ReshapeTensor,  &&op_DeviceCopy,
+      &&op_KillRegister};
+  constexpr size_t kNumOpcodes = sizeof(kDispatchTable) / sizeof(kDispatchTable[0]);
+#define TVM_VM_CASE(name) \
+  case Opcode::name:      \
+  op_##name:
+#else
+#define TVM_VM_CASE(name) case Opcode::name:
+#endif
   pc_ = 0;
   Index frame_start = frames_.size();
   while (true) {
@@ -525,34 +916,30 @@ void VirtualMachine::RunLoop() {
     auto const& instr = code_[this->pc_];
     VLOG(2) << "Executing(" << pc_ << "): " << instr;
 
+#if TVM_VM_COMPUTED_GOTO
+    if (static_cast<size_t>(instr.op) < kNumOpcodes) {
+      goto* kDispatchTable[static_cast<size_t>(instr.op)];
+    }
+#endif
     switch (instr.op) {
-      case Opcode::Move: {
-        ObjectRef from_obj;
-        from_obj = ReadRegister(instr.from);
-        WriteRegister(instr.dst, from_obj);
+      TVM_VM_CASE(Move) {
+        WriteRegister(instr.dst, ReadRegister(instr.from));
         pc_++;
         goto main_loop;
       }
-      case Opcode::Fatal: {
-        throw std::runtime_error("VM encountered fatal error");
-      }
-      case Opcode::LoadConst: {
+      TVM_VM_CASE(Fatal) { throw std::runtime_error("VM encountered fatal error"); }
+      TVM_VM_CASE(LoadConst) {
         bool is_not_cached = const_pool_.size() <= static_cast<size_t>(instr.const_index) ||
                              !const_pool_[instr.const_index].defined();
-        if (is_not_cached) {
-          OpStartHook(instr);
-        }
-        auto constant_obj = exec_->constants[instr.const_index];
         // We cache the allocated object in the constant pool. To measure, the
         // first iteration will set the pool up. The other iterations will
         // directly reuse the allocated objects.
-        if (const_pool_.size() <= static_cast<size_t>(instr.const_index)) {
-          const_pool_.resize(instr.const_index + 1);
+        if (is_not_cached) {
+          OpStartHook(instr);
+          LoadConstant(instr.const_index);
         }
-
-        if (!const_pool_[instr.const_index].defined()) {
-          Device dev = GetDevice(exec_->const_device_indexes[instr.const_index]);
-          const_pool_[instr.const_index] = CopyTo(constant_obj, dev);
+        if (const_budget_bytes_ != 0) {
+          const_last_use_[instr.const_index] = ++const_clock_;
         }
         WriteRegister(instr.dst, const_pool_[instr.const_index]);
         if (is_not_cached) {
@@ -561,15 +948,16 @@ void VirtualMachine::RunLoop() {
         pc_++;
         goto main_loop;
       }
-      case Opcode::LoadConsti: {
+      TVM_VM_CASE(LoadConsti) {
         auto tensor = NDArray::Empty({1}, {kDLInt, 64, 1}, GetDevice(exec_->host_device_index));
         reinterpret_cast<int64_t*>(tensor->data)[0] = instr.load_consti.val;
-        WriteRegister(instr.dst, tensor);
+        WriteRegister(instr.dst, std::move(tensor));
         pc_++;
         goto main_loop;
       }
-      case Opcode::Invoke: {
+      TVM_VM_CASE(Invoke) {
         std::vector<ObjectRef> args;
+        args.reserve(instr.num_args);
         for (Index i = 0; i < instr.num_args; ++i) {
           args.push_back(ReadRegister(instr.invoke_args_registers[i]));
         }
@@ -577,19 +965,20 @@ void VirtualMachine::RunLoop() {
         frames_.back().caller_return_register = instr.dst;
         goto main_loop;
       }
-      case Opcode::InvokePacked: {
+      TVM_VM_CASE(InvokePacked) {
         ICHECK_LE(instr.packed_index, packed_funcs_.size());
         const auto& func = packed_funcs_[instr.packed_index];
         const auto& arity = instr.arity;
-        std::vector<ObjectRef> args;
+        // The buffer is reused across calls to save an allocation per kernel.
+        std::vector<ObjectRef> args = std::move(packed_args_);
+        args.clear();
         for (Index i = 0; i < arity; ++i) {
-          auto arg = ReadRegister(instr.packed_args[i]);
-          args.push_back(arg);
+          args.push_back(ReadRegister(instr.packed_args[i]));
 #if TVM_LOG_DEBUG
           if (i < arity) {
             const bool is_input = i < arity - instr.output_size;
             VLOG(2) << (is_input ? "input" : "placeholder") << " arg " << i << " = "
-                    << RuntimeObject2String(arg, GetDevice(exec_->host_device_index),
+                    << RuntimeObject2String(args.back(), GetDevice(exec_->host_device_index),
                                             /*show_contents=*/is_input);
           }
 #endif
@@ -598,23 +987,36 @@ void VirtualMachine::RunLoop() {
         // We no longer need to write the registers back, we write directly
         // through the registers mutably.
         InvokePacked(instr.packed_index, func, arity, instr.output_size, args);
+        // Drop the references so killed registers free their memory.
+        args.clear();
+        packed_args_ = std::move(args);
 
 #if TVM_LOG_DEBUG
         for (Index i = arity - instr.output_size; i < arity; ++i) {
-          auto arg = ReadRegister(instr.packed_args[i]);
           VLOG(2) << "output arg " << i << " = "
-                  << RuntimeObject2String(arg, GetDevice(exec_->host_device_index));
+                  << RuntimeObject2String(ReadRegister(instr.packed_args[i]),
+                                          GetDevice(exec_->host_device_index));
         }
 #endif
 
         pc_++;
+        if (super_code_ != nullptr &&
+            super_code_[pc_ - 1] == SuperInstruction::kInvokePackedKill) {
+          // Release the registers the kernel was the last user of without a dispatch each.
+          while (code_[pc_].op == Opcode::KillRegister) {
+            OpStartHook(code_[pc_]);
+            WriteRegister(code_[pc_].dst, ObjectRef());
+            OpStopHook();
+            pc_++;
+          }
+        }
         goto main_loop;
       }
-      case Opcode::InvokeClosure: {
-        auto object = ReadRegister(instr.closure);
-        const auto* closure = object.as<VMClosureObj>();
+      TVM_VM_CASE(InvokeClosure) {
+        const auto* closure = ReadRegister(instr.closure).as<VMClosureObj>();
         ICHECK(closure);
         std::vector<ObjectRef> args;
+        args.reserve(closure->free_vars.size() + instr.num_closure_args);
         for (auto free_var : closure->free_vars) {
           args.push_back(free_var);
         }
@@ -625,29 +1027,27 @@ void VirtualMachine::RunLoop() {
         frames_.back().caller_return_register = instr.dst;
         goto main_loop;
       }
-      case Opcode::GetField: {
-        auto object = ReadRegister(instr.object);
-        const auto& tuple = Downcast<ADT>(object);
-        auto field = tuple[instr.field_index];
-        WriteRegister(instr.dst, field);
+      TVM_VM_CASE(GetField) {
+        const auto* tuple = ReadRegister(instr.object).as<ADTObj>();
+        ICHECK(tuple) << "GetField expects an ADT";
+        WriteRegister(instr.dst, (*tuple)[instr.field_index]);
         pc_++;
         goto main_loop;
       }
-      case Opcode::GetTag: {
-        auto object = ReadRegister(instr.get_tag.object);
-        const auto& adt = Downcast<ADT>(object);
+      TVM_VM_CASE(GetTag) {
+        const auto& adt = Downcast<ADT>(ReadRegister(instr.get_tag.object));
         auto tag = adt.tag();
         auto tag_tensor = NDArray::Empty({1}, {kDLInt, 32, 1}, GetDevice(exec_->host_device_index));
         reinterpret_cast<int32_t*>(tag_tensor->data)[0] = tag;
-        WriteRegister(instr.dst, tag_tensor);
+        WriteRegister(instr.dst, std::move(tag_tensor));
         pc_++;
         goto main_loop;
       }
-      case Opcode::Goto: {
+      TVM_VM_CASE(Goto) {
         pc_ += instr.pc_offset;
         goto main_loop;
       }
-      case Opcode::If: {
+      TVM_VM_CASE(If) {
         int32_t test_val = LoadScalarInt(instr.if_op.test);
         int32_t target_val = LoadScalarInt(instr.if_op.target);
 
@@ -661,58 +1061,51 @@ void VirtualMachine::RunLoop() {
 
         goto main_loop;
       }
-      case Opcode::AllocTensor: {
+      TVM_VM_CASE(AllocTensor) {
         OpStartHook(instr);
-        auto shape = std::vector<int64_t>(instr.alloc_tensor.ndim);
-
-        for (uint32_t i = 0; i < instr.alloc_tensor.ndim; ++i) {
-          shape[i] = instr.alloc_tensor.shape[i];
-        }
-
-        auto storage_obj = ReadRegister(instr.alloc_tensor.storage);
+        auto storage = Downcast<Storage>(ReadRegister(instr.alloc_tensor.storage));
         auto offset = LoadScalarInt(instr.alloc_tensor.offset);
-        auto storage = Downcast<Storage>(storage_obj);
-        auto obj = storage->AllocNDArray(offset, shape, instr.alloc_tensor.dtype);
+        auto obj = AllocTensorFromStorage(instr, storage, offset);
         VLOG(2) << "allocated "
                 << RuntimeObject2String(obj, GetDevice(exec_->host_device_index),
                                         /*show_contents=*/false);
 
-        WriteRegister(instr.dst, obj);
+        WriteRegister(instr.dst, std::move(obj));
         OpStopHook();
         pc_++;
         goto main_loop;
       }
-      case Opcode::AllocTensorReg: {
+      TVM_VM_CASE(AllocTensorReg) {
         OpStartHook(instr);
         Device cpu_dev = GetDevice(exec_->host_device_index);
-        auto shape_obj = ReadRegister(instr.alloc_tensor_reg.shape_register);
-        NDArray shape_tensor = Downcast<NDArray>(CopyTo(shape_obj, cpu_dev));
+        NDArray shape_tensor =
+            Downcast<NDArray>(CopyTo(ReadRegister(instr.alloc_tensor_reg.shape_register), cpu_dev));
         auto shape = ToShape(shape_tensor);
-        auto storage_obj = ReadRegister(instr.alloc_tensor_reg.storage);
-        auto storage = Downcast<Storage>(storage_obj);
+        auto storage = Downcast<Storage>(ReadRegister(instr.alloc_tensor_reg.storage));
         auto offset = LoadScalarInt(instr.alloc_tensor.offset);
         auto obj = storage->AllocNDArray(offset, shape, instr.alloc_tensor_reg.dtype);
         VLOG(2) << "allocated "
                 << RuntimeObject2String(obj, GetDevice(exec_->host_device_index),
                                         /*show_contents=*/false);
 
-        WriteRegister(instr.dst, obj);
+        WriteRegister(instr.dst, std::move(obj));
         OpStopHook();
         pc_++;
         goto main_loop;
       }
-      case Opcode::AllocADT: {
+      TVM_VM_CASE(AllocADT) {
         std::vector<ObjectRef> fields;
+        fields.reserve(instr.num_fields);
         for (Index i = 0; i < instr.num_fields; ++i) {
           fields.push_back(ReadRegister(instr.datatype_fields[i]));
         }
-        ObjectRef obj = ADT(instr.constructor_tag, fields);
-        WriteRegister(instr.dst, obj);
+        WriteRegister(instr.dst, ADT(instr.constructor_tag, std::move(fields)));
         pc_++;
         goto main_loop;
       }
-      case Opcode::AllocClosure: {
+      TVM_VM_CASE(AllocClosure) {
         std::vector<ObjectRef> free_vars;
+        free_vars.reserve(instr.num_freevar);
         for (Index i = 0; i < instr.num_freevar; i++) {
           free_vars.push_back(ReadRegister(instr.free_vars[i]));
         }
@@ -720,7 +1113,7 @@ void VirtualMachine::RunLoop() {
         pc_++;
         goto main_loop;
       }
-      case Opcode::AllocStorage: {
+      TVM_VM_CASE(AllocStorage) {
         OpStartHook(instr);
         auto size = LoadScalarInt(instr.alloc_storage.allocation_size);
         auto alignment = instr.alloc_storage.alignment;
@@ -733,28 +1126,42 @@ void VirtualMachine::RunLoop() {
                 << ", device_index=" << instr.alloc_storage.device_index;
 
         storage_obj->buffer = allocator->Alloc(size, alignment, instr.alloc_storage.dtype_hint);
+        storage_obj->allocator = allocator;
+        if (AllocTraceRecorder::Global()->enabled()) {
+          AllocTraceRecorder::Global()->RecordAlloc(storage_obj->buffer, size, alignment);
+        }
         Storage storage(storage_obj);
         WriteRegister(instr.dst, storage);
         OpStopHook();
         pc_++;
+        if (super_code_ != nullptr &&
+            super_code_[pc_ - 1] == SuperInstruction::kAllocStorageTensor) {
+          // Allocate the tensor from the storage we hold rather than reading it back.
+          const Instruction& next = code_[pc_];
+          OpStartHook(next);
+          auto obj = AllocTensorFromStorage(next, storage, LoadScalarInt(next.alloc_tensor.offset));
+          WriteRegister(next.dst, std::move(obj));
+          OpStopHook();
+          pc_++;
+        }
         goto main_loop;
       }
-      case Opcode::ShapeOf: {
-        auto input = ReadRegister(instr.shape_of.tensor);
-        NDArray input_array = Downcast<NDArray>(input);
-        int ndim = input_array->ndim;
+      TVM_VM_CASE(ShapeOf) {
+        const auto* input_array = ReadRegister(instr.shape_of.tensor).as<NDArray::Container>();
+        ICHECK(input_array) << "ShapeOf expects a tensor";
+        int ndim = input_array->dl_tensor.ndim;
         auto out_tensor =
             NDArray::Empty({ndim}, {kDLInt, 64, 1}, GetDevice(exec_->host_device_index));
         for (int i = 0; i < ndim; ++i) {
-          reinterpret_cast<int64_t*>(out_tensor->data)[i] = input_array->shape[i];
+          reinterpret_cast<int64_t*>(out_tensor->data)[i] = input_array->dl_tensor.shape[i];
         }
         VLOG(2) << "shape = "
                 << RuntimeObject2String(out_tensor, GetDevice(exec_->host_device_index));
-        WriteRegister(instr.dst, out_tensor);
+        WriteRegister(instr.dst, std::move(out_tensor));
         pc_++;
         goto main_loop;
       }
-      case Opcode::Ret: {
+      TVM_VM_CASE(Ret) {
         // If we have hit the point from which we started
         // running, we should return to the caller breaking
         // the dispatch loop.
@@ -769,14 +1176,13 @@ void VirtualMachine::RunLoop() {
           goto main_loop;
         }
       }
-      case Opcode::ReshapeTensor: {
+      TVM_VM_CASE(ReshapeTensor) {
         OpStartHook(instr);
         Device cpu_dev = GetDevice(exec_->host_device_index);
-        auto tensor_obj = ReadRegister(instr.reshape_tensor.tensor);
-        NDArray tensor_arr = Downcast<NDArray>(tensor_obj);
+        NDArray tensor_arr = Downcast<NDArray>(ReadRegister(instr.reshape_tensor.tensor));
         // Read the shape from shape tensor
-        auto shape_obj = ReadRegister(instr.reshape_tensor.newshape);
-        NDArray shape_tensor = Downcast<NDArray>(CopyTo(shape_obj, cpu_dev));
+        NDArray shape_tensor =
+            Downcast<NDArray>(CopyTo(ReadRegister(instr.reshape_tensor.newshape), cpu_dev));
         const DLTensor* dl_tensor = shape_tensor.operator->();
         ICHECK_EQ(dl_tensor->dtype.code, 0u);
         ICHECK_EQ(dl_tensor->dtype.bits, 64u);
@@ -786,17 +1192,16 @@ void VirtualMachine::RunLoop() {
         // Reshape the input tensor
         auto out_tensor = tensor_arr.CreateView(shape, tensor_arr->dtype);
         VLOG(2) << "reshaped "
-                << RuntimeObject2String(tensor_obj, GetDevice(exec_->host_device_index)) << " to "
+                << RuntimeObject2String(tensor_arr, GetDevice(exec_->host_device_index)) << " to "
                 << RuntimeObject2String(out_tensor, GetDevice(exec_->host_device_index));
-        WriteRegister(instr.dst, out_tensor);
+        WriteRegister(instr.dst, std::move(out_tensor));
         OpStopHook();
         pc_++;
         goto main_loop;
       }
-      case Opcode::DeviceCopy: {
+      TVM_VM_CASE(DeviceCopy) {
         OpStartHook(instr);
-        auto tensor_src = ReadRegister(instr.device_copy.src);
-        NDArray src_data = Downcast<NDArray>(tensor_src);
+        NDArray src_data = Downcast<NDArray>(ReadRegister(instr.device_copy.src));
         Device actual_src_dev = src_data->device;
         Device inst_src_dev = GetDevice(instr.device_copy.src_device_index);
         ICHECK_EQ(actual_src_dev.device_type, inst_src_dev.device_type);
@@ -804,12 +1209,12 @@ void VirtualMachine::RunLoop() {
         Device dst_dev = GetDevice(instr.device_copy.dst_device_index);
 
         NDArray dst_data = src_data.CopyTo(dst_dev);
-        WriteRegister(instr.dst, dst_data);
+        WriteRegister(instr.dst, std::move(dst_data));
         OpStopHook();
         pc_++;
         goto main_loop;
       }
-      case Opcode::KillRegister: {
+      TVM_VM_CASE(KillRegister) {
         OpStartHook(instr);
         WriteRegister(instr.dst, ObjectRef());
         OpStopHook();
@@ -820,6 +1225,7 @@ void VirtualMachine::RunLoop() {
         LOG(FATAL) << "Unknown instruction opcode: " << int(instr.op);
     }
   }
+#undef TVM_VM_CASE
 }
 
 runtime::Module CreateVirtualMachine(Executable* exec) {
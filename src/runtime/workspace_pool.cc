@@ -23,7 +23,12 @@
  */
 #include "workspace_pool.h"
 
+#include <tvm/runtime/logging.h>
+
+#include <map>
 #include <memory>
+#include <unordered_map>
+#include <utility>
 
 namespace tvm {
 namespace runtime {
@@ -31,10 +36,63 @@ namespace runtime {
 // page size.
 constexpr size_t kWorkspacePageSize = 4 << 10;
 
+namespace {
+/*! \brief The workspace counters of one device, shared by every pool of the device. */
+struct WorkspaceCounters {
+  std::atomic<int64_t> live{0};
+  std::atomic<int64_t> peak_live{0};
+  std::atomic<int64_t> held{0};
+  std::atomic<int64_t> peak_held{0};
+
+  static void Add(std::atomic<int64_t>* value, std::atomic<int64_t>* peak, int64_t delta) {
+    int64_t now = value->fetch_add(delta, std::memory_order_relaxed) + delta;
+    int64_t prev = peak->load(std::memory_order_relaxed);
+    while (now > prev && !peak->compare_exchange_weak(prev, now, std::memory_order_relaxed)) {
+    }
+  }
+  void AddLive(int64_t delta) { Add(&live, &peak_live, delta); }
+  void AddHeld(int64_t delta) { Add(&held, &peak_held, delta); }
+};
+
+/*! \brief Get the counters of a device, they live until the process exits. */
+WorkspaceCounters* GetCounters(Device dev) {
+  static auto* mutex = new std::mutex();
+  static auto* counters = new std::map<std::pair<int, int>, std::unique_ptr<WorkspaceCounters>>();
+  std::lock_guard<std::mutex> lock(*mutex);
+  auto& entry = (*counters)[std::make_pair(static_cast<int>(dev.device_type), dev.device_id)];
+  if (entry == nullptr) entry.reset(new WorkspaceCounters());
+  return entry.get();
+}
+
+DLDataType WorkspaceType() {
+  DLDataType type;
+  type.code = kDLUInt;
+  type.bits = 8;
+  type.lanes = 1;
+  return type;
+}
+}  // namespace
+
+WorkspaceStats GetWorkspaceStats(Device dev) {
+  WorkspaceCounters* counters = GetCounters(dev);
+  WorkspaceStats stats;
+  stats.live_bytes = counters->live.load(std::memory_order_relaxed);
+  stats.peak_live_bytes = counters->peak_live.load(std::memory_order_relaxed);
+  stats.held_bytes = counters->held.load(std::memory_order_relaxed);
+  stats.peak_held_bytes = counters->peak_held.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void ResetWorkspacePeak(Device dev) {
+  WorkspaceCounters* counters = GetCounters(dev);
+  counters->peak_live.store(counters->live.load(std::memory_order_relaxed));
+  counters->peak_held.store(counters->held.load(std::memory_order_relaxed));
+}
+
 class WorkspacePool::Pool {
  public:
   // constructor
-  Pool() {
+  explicit Pool(WorkspaceCounters* counters) : counters_(counters) {
     // safe guard header on each list.
     Entry e;
     e.data = nullptr;
@@ -58,12 +116,15 @@ class WorkspacePool::Pool {
       if (e.size < nbytes) {
         // resize the page
         device->FreeDataSpace(dev, e.data);
+        counters_->AddHeld(-static_cast<int64_t>(e.size));
         e.data = device->AllocDataSpace(dev, nbytes, kTempAllocaAlignment, type);
         e.size = nbytes;
+        counters_->AddHeld(e.size);
       }
     } else if (free_list_.size() == 1) {
       e.data = device->AllocDataSpace(dev, nbytes, kTempAllocaAlignment, type);
       e.size = nbytes;
+      counters_->AddHeld(e.size);
     } else {
       if (free_list_.back().size >= nbytes) {
         // find smallest fit
@@ -77,11 +138,14 @@ class WorkspacePool::Pool {
         e = free_list_.back();
         free_list_.pop_back();
         device->FreeDataSpace(dev, e.data);
+        counters_->AddHeld(-static_cast<int64_t>(e.size));
         e.data = device->AllocDataSpace(dev, nbytes, kTempAllocaAlignment, type);
         e.size = nbytes;
+        counters_->AddHeld(e.size);
       }
     }
     allocated_.push_back(e);
+    counters_->AddLive(e.size);
     return e.data;
   }
   // free resource back to pool
@@ -99,6 +163,7 @@ class WorkspacePool::Pool {
       e = allocated_[index];
       allocated_.erase(allocated_.begin() + index);
     }
+    counters_->AddLive(-static_cast<int64_t>(e.size));
     if (free_list_.back().size < e.size) {
       free_list_.push_back(e);
     } else if (free_list_.size() == 2) {
@@ -117,6 +182,7 @@ class WorkspacePool::Pool {
   void Release(Device dev, DeviceAPI* device) {
     for (size_t i = 1; i < free_list_.size(); ++i) {
       device->FreeDataSpace(dev, free_list_[i].data);
+      counters_->AddHeld(-static_cast<int64_t>(free_list_[i].size));
     }
     free_list_.clear();
   }
@@ -131,6 +197,8 @@ class WorkspacePool::Pool {
   std::vector<Entry> free_list_;
   /*! \brief List of allocated items */
   std::vector<Entry> allocated_;
+  /*! \brief The workspace counters of the device */
+  WorkspaceCounters* counters_;
 };
 
 WorkspacePool::WorkspacePool(DLDeviceType device_type, DeviceAPI* device)
@@ -153,7 +221,7 @@ void* WorkspacePool::AllocWorkspace(Device dev, size_t size) {
     array_.resize(dev.device_id + 1, nullptr);
   }
   if (array_[dev.device_id] == nullptr) {
-    array_[dev.device_id] = new Pool();
+    array_[dev.device_id] = new Pool(GetCounters(dev));
   }
   return array_[dev.device_id]->Alloc(dev, device_, size);
 }
@@ -163,5 +231,242 @@ void WorkspacePool::FreeWorkspace(Device dev, void* ptr) {
   array_[dev.device_id]->Free(ptr);
 }
 
+class SharedWorkspacePool::Pool {
+ public:
+  Pool(Device dev, DeviceAPI* device, WorkspaceCounters* counters)
+      : dev_(dev), device_(device), counters_(counters) {
+    for (auto& chunk : chunks_) chunk.store(nullptr, std::memory_order_relaxed);
+    for (auto& head : free_lists_) head.store(0, std::memory_order_relaxed);
+  }
+  ~Pool() {
+    Trim();
+    for (auto& chunk : chunks_) delete[] chunk.load(std::memory_order_relaxed);
+  }
+  // allocate from pool
+  void* Alloc(size_t nbytes) {
+    size_t size = SharedWorkspacePool::SizeClass(nbytes);
+    if (size <= kMaxCachedSize) {
+      uint32_t idx = Pop(&free_lists_[ClassIndex(size)]);
+      if (idx != kNoNode) {
+        cached_bytes_.fetch_sub(size, std::memory_order_relaxed);
+        counters_->AddLive(size);
+        return GetNode(idx).data;
+      }
+    }
+    void* data = device_->AllocDataSpace(dev_, size, kTempAllocaAlignment, WorkspaceType());
+    uint32_t idx = NewNode();
+    GetNode(idx).data = data;
+    GetNode(idx).size = size;
+    {
+      Shard& shard = GetShard(data);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.nodes[data] = idx;
+    }
+    counters_->AddHeld(size);
+    counters_->AddLive(size);
+    return data;
+  }
+  // free resource back to pool
+  void Free(void* data, int64_t cache_limit) {
+    uint32_t idx;
+    {
+      Shard& shard = GetShard(data);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      auto it = shard.nodes.find(data);
+      ICHECK(it != shard.nodes.end()) << "trying to free things that has not been allocated";
+      idx = it->second;
+    }
+    size_t size = GetNode(idx).size;
+    counters_->AddLive(-static_cast<int64_t>(size));
+    if (size > kMaxCachedSize ||
+        (cache_limit >= 0 && cached_bytes_.load(std::memory_order_relaxed) +
+                                     static_cast<int64_t>(size) >
+                                 cache_limit)) {
+      Release(idx);
+      return;
+    }
+    cached_bytes_.fetch_add(size, std::memory_order_relaxed);
+    Push(&free_lists_[ClassIndex(size)], idx);
+  }
+  // Release all cached workspaces
+  void Trim() {
+    for (auto& head : free_lists_) {
+      for (uint32_t idx = Pop(&head); idx != kNoNode; idx = Pop(&head)) {
+        cached_bytes_.fetch_sub(GetNode(idx).size, std::memory_order_relaxed);
+        Release(idx);
+      }
+    }
+  }
+  int64_t CachedBytes() const { return cached_bytes_.load(std::memory_order_relaxed); }
+
+ private:
+  /*!
+   * \brief The bookkeeping of a workspace. Nodes are never deallocated before the pool, so
+   *  a node can be read after another thread popped it from a list.
+   */
+  struct Node {
+    void* data = nullptr;
+    size_t size = 0;
+    /*! \brief The index of the next node plus one, zero at the end of a list. */
+    std::atomic<uint32_t> next{0};
+  };
+  /*! \brief A slice of the map from workspace to node, sliced to spread the locking. */
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_map<void*, uint32_t> nodes;
+  };
+  static constexpr uint32_t kNoNode = 0xFFFFFFFF;
+  static constexpr uint32_t kChunkSize = 256;
+  static constexpr uint32_t kMaxChunks = 4096;
+  static constexpr int kNumShards = 64;
+  static constexpr int kNumClasses = 64;
+
+  /*! \brief The index of the free list of a size class. */
+  static int ClassIndex(size_t size) {
+    if (size <= 4 * kWorkspacePageSize) return static_cast<int>(size / kWorkspacePageSize) - 1;
+    int log2 = 0;
+    while ((size_t(2) << log2) < size) ++log2;
+    size_t granularity = (size_t(1) << log2) / 4;
+    int sub = static_cast<int>((size - (size_t(1) << log2)) / granularity) - 1;
+    int log2_min = 0;
+    while ((size_t(1) << log2_min) < 4 * kWorkspacePageSize) ++log2_min;
+    int index = 4 + (log2 - log2_min) * 4 + sub;
+    ICHECK(index >= 0 && index < kNumClasses);
+    return index;
+  }
+  Node& GetNode(uint32_t idx) {
+    return chunks_[idx / kChunkSize].load(std::memory_order_acquire)[idx % kChunkSize];
+  }
+  uint32_t NewNode() {
+    uint32_t idx = Pop(&spare_nodes_);
+    if (idx != kNoNode) return idx;
+    idx = num_nodes_.fetch_add(1, std::memory_order_relaxed);
+    ICHECK_LT(idx, kChunkSize * kMaxChunks) << "too many workspaces in the pool";
+    std::atomic<Node*>& chunk = chunks_[idx / kChunkSize];
+    if (chunk.load(std::memory_order_acquire) == nullptr) {
+      std::lock_guard<std::mutex> lock(chunk_mutex_);
+      if (chunk.load(std::memory_order_relaxed) == nullptr) {
+        chunk.store(new Node[kChunkSize], std::memory_order_release);
+      }
+    }
+    return idx;
+  }
+  /*! \brief Return a workspace to the device and keep its node for reuse. */
+  void Release(uint32_t idx) {
+    Node& node = GetNode(idx);
+    {
+      Shard& shard = GetShard(node.data);
+      std::lock_guard<std::mutex> lock(shard.mutex);
+      shard.nodes.erase(node.data);
+    }
+    device_->FreeDataSpace(dev_, node.data);
+    counters_->AddHeld(-static_cast<int64_t>(node.size));
+    node.data = nullptr;
+    node.size = 0;
+    Push(&spare_nodes_, idx);
+  }
+  Shard& GetShard(void* data) {
+    return shards_[(reinterpret_cast<uintptr_t>(data) / kWorkspacePageSize) % kNumShards];
+  }
+  /*!
+   * \brief Push a node on a lock-free list. The head keeps the index of the first node plus
+   *  one in its low half and a version in its high half, so a head which was popped and
+   *  pushed again in between never matches a stale compare-and-swap.
+   */
+  void Push(std::atomic<uint64_t>* head, uint32_t idx) {
+    uint64_t old_head = head->load(std::memory_order_relaxed);
+    uint64_t new_head;
+    do {
+      GetNode(idx).next.store(static_cast<uint32_t>(old_head), std::memory_order_relaxed);
+      new_head = (((old_head >> 32) + 1) << 32) | (idx + 1);
+    } while (!head->compare_exchange_weak(old_head, new_head, std::memory_order_release,
+                                          std::memory_order_relaxed));
+  }
+  /*! \brief Pop a node from a lock-free list, kNoNode when it is empty. */
+  uint32_t Pop(std::atomic<uint64_t>* head) {
+    uint64_t old_head = head->load(std::memory_order_acquire);
+    while (static_cast<uint32_t>(old_head) != 0) {
+      uint32_t idx = static_cast<uint32_t>(old_head) - 1;
+      uint64_t next = GetNode(idx).next.load(std::memory_order_relaxed);
+      uint64_t new_head = (((old_head >> 32) + 1) << 32) | next;
+      if (head->compare_exchange_weak(old_head, new_head, std::memory_order_acquire,
+                                      std::memory_order_acquire)) {
+        return idx;
+      }
+    }
+    return kNoNode;
+  }
+
+  Device dev_;
+  DeviceAPI* device_;
+  WorkspaceCounters* counters_;
+  /*! \brief The free list of every size class */
+  std::atomic<uint64_t> free_lists_[kNumClasses];
+  /*! \brief The list of nodes whose workspace was returned to the device */
+  std::atomic<uint64_t> spare_nodes_{0};
+  /*! \brief The nodes, allocated a chunk at a time so that their addresses never change */
+  std::atomic<Node*> chunks_[kMaxChunks];
+  std::atomic<uint32_t> num_nodes_{0};
+  std::mutex chunk_mutex_;
+  Shard shards_[kNumShards];
+  /*! \brief The bytes in the free lists */
+  std::atomic<int64_t> cached_bytes_{0};
+};
+
+SharedWorkspacePool::SharedWorkspacePool(DLDeviceType device_type, DeviceAPI* device)
+    : device_type_(device_type), device_(device) {
+  for (auto& pool : array_) pool.store(nullptr, std::memory_order_relaxed);
+}
+
+SharedWorkspacePool::~SharedWorkspacePool() {
+  for (auto& pool : array_) delete pool.load(std::memory_order_relaxed);
+}
+
+size_t SharedWorkspacePool::SizeClass(size_t nbytes) {
+  // Allocate align to page.
+  size_t size = (nbytes + (kWorkspacePageSize - 1)) / kWorkspacePageSize * kWorkspacePageSize;
+  if (size == 0) size = kWorkspacePageSize;
+  if (size <= 4 * kWorkspacePageSize || size > kMaxCachedSize) return size;
+  // Four classes per power of two bounds the rounding waste to a quarter.
+  size_t granularity = kWorkspacePageSize;
+  while (granularity * 8 < size) granularity *= 2;
+  return (size + granularity - 1) / granularity * granularity;
+}
+
+SharedWorkspacePool::Pool* SharedWorkspacePool::GetPool(Device dev) {
+  ICHECK(dev.device_id >= 0 && dev.device_id < kMaxDevices)
+      << "device id " << dev.device_id << " is out of the range of the shared workspace pool";
+  Pool* pool = array_[dev.device_id].load(std::memory_order_acquire);
+  if (pool != nullptr) return pool;
+  std::lock_guard<std::mutex> lock(mutex_);
+  pool = array_[dev.device_id].load(std::memory_order_relaxed);
+  if (pool == nullptr) {
+    pool = new Pool(dev, device_, GetCounters(dev));
+    array_[dev.device_id].store(pool, std::memory_order_release);
+  }
+  return pool;
+}
+
+void* SharedWorkspacePool::AllocWorkspace(Device dev, size_t size) {
+  return GetPool(dev)->Alloc(size);
+}
+
+void SharedWorkspacePool::FreeWorkspace(Device dev, void* ptr) {
+  GetPool(dev)->Free(ptr, cache_limit_.load(std::memory_order_relaxed));
+}
+
+void SharedWorkspacePool::SetCacheLimit(int64_t limit) {
+  cache_limit_.store(limit, std::memory_order_relaxed);
+  // Bring the cached bytes of every device under the new limit.
+  for (auto& entry : array_) {
+    Pool* pool = entry.load(std::memory_order_acquire);
+    if (pool != nullptr && limit >= 0 && pool->CachedBytes() > limit) pool->Trim();
+  }
+}
+
+void SharedWorkspacePool::Trim(Device dev) { GetPool(dev)->Trim(); }
+
+int64_t SharedWorkspacePool::CachedBytes(Device dev) { return GetPool(dev)->CachedBytes(); }
+
 }  // namespace runtime
 }  // namespace tvm
@@ -26,11 +26,37 @@
 
 #include <tvm/runtime/device_api.h>
 
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <vector>
 
 namespace tvm {
 namespace runtime {
+/*!
+ * \brief The workspace usage of a device, summed over every workspace pool of the device.
+ */
+struct WorkspaceStats {
+  /*! \brief Bytes handed out to callers and not freed yet. */
+  int64_t live_bytes = 0;
+  /*! \brief The largest value of live_bytes since the last reset. */
+  int64_t peak_live_bytes = 0;
+  /*! \brief Bytes allocated from the device, whether handed out or cached in a pool. */
+  int64_t held_bytes = 0;
+  /*! \brief The largest value of held_bytes since the last reset. */
+  int64_t peak_held_bytes = 0;
+};
+/*!
+ * \brief Get the workspace usage of a device.
+ * \param dev The device.
+ */
+TVM_DLL WorkspaceStats GetWorkspaceStats(Device dev);
+/*!
+ * \brief Reset the peaks of the workspace usage of a device to the current usage.
+ * \param dev The device.
+ */
+TVM_DLL void ResetWorkspacePeak(Device dev);
 /*!
  * \brief A workspace pool to manage
  *
@@ -76,6 +102,80 @@ class TVM_DLL WorkspacePool {
   DeviceAPI* device_;
 };
 
+/*!
+ * \brief A workspace pool shared by every thread of the process.
+ *
+ *  Unlike WorkspacePool, which is kept per thread and assumes a stack-like
+ *  allocation order, this pool rounds every request up to a size class and keeps
+ *  one lock-free free list per size class and device. Frees can come in any order
+ *  and from any thread, and the idle memory of one thread is reused by the others
+ *  instead of being duplicated per thread.
+ */
+class TVM_DLL SharedWorkspacePool {
+ public:
+  /*! \brief The largest size class, larger requests go to the device directly. */
+  static constexpr size_t kMaxCachedSize = size_t(1) << 28;
+  /*!
+   * \brief Create pool with specific device type and device.
+   * \param device_type The device type.
+   * \param device_api The device API.
+   */
+  SharedWorkspacePool(DLDeviceType device_type, DeviceAPI* device_api);
+  /*! \brief destructor */
+  ~SharedWorkspacePool();
+  /*!
+   * \brief Allocate temporal workspace.
+   * \param dev The device of allocation.
+   * \param size The size to be allocated.
+   */
+  void* AllocWorkspace(Device dev, size_t size);
+  /*!
+   * \brief Free temporal workspace in backend execution.
+   * \param dev The device of allocation.
+   * \param ptr The pointer to be freed.
+   */
+  void FreeWorkspace(Device dev, void* ptr);
+  /*!
+   * \brief Set the most bytes kept cached per device. Freed workspaces which would
+   *  exceed it are returned to the device.
+   * \param limit The limit in bytes, negative for no limit.
+   */
+  void SetCacheLimit(int64_t limit);
+  /*!
+   * \brief Return every cached workspace of a device to the device.
+   * \param dev The device.
+   */
+  void Trim(Device dev);
+  /*!
+   * \brief Get the bytes cached in the pool for a device.
+   * \param dev The device.
+   */
+  int64_t CachedBytes(Device dev);
+  /*!
+   * \brief Round a request up to its size class, the multiple of the page size for small
+   *  requests and a quarter of a power of two for larger ones.
+   * \param nbytes The request in bytes.
+   */
+  static size_t SizeClass(size_t nbytes);
+
+ private:
+  class Pool;
+  /*! \brief The largest number of devices of the type. */
+  static constexpr int kMaxDevices = 64;
+  /*! \brief Get the pool of a device, creating it on first use. */
+  Pool* GetPool(Device dev);
+  /*! \brief pool of every device, only created and never replaced */
+  std::atomic<Pool*> array_[kMaxDevices];
+  /*! \brief protects the creation of the pools */
+  std::mutex mutex_;
+  /*! \brief device type this pool support */
+  DLDeviceType device_type_;
+  /*! \brief The device API */
+  DeviceAPI* device_;
+  /*! \brief The most bytes cached per device, negative for no limit. */
+  std::atomic<int64_t> cache_limit_{-1};
+};
+
 }  // namespace runtime
 }  // namespace tvm
 #endif  // TVM_RUNTIME_WORKSPACE_POOL_H_
@@ -0,0 +1,186 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*!
+ * \file lz_codec.h
+ * \brief A small LZ77 codec in the spirit of the LZ4 block format.
+ *
+ *  The output is a sequence of (literals, match) pairs. Each pair starts with a
+ *  token whose high nibble is the literal count and low nibble the match length
+ *  minus kMinMatch, 15 meaning that more length bytes follow. The literals come
+ *  next, then the match as a 2 byte little endian offset into the last 64KB of
+ *  output. The final pair has literals only. The codec favors speed over
+ *  ratio, it is meant for data sent over links slower than the codec itself.
+ */
+#ifndef TVM_SUPPORT_LZ_CODEC_H_
+#define TVM_SUPPORT_LZ_CODEC_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace tvm {
+namespace support {
+
+namespace lz {
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 65535;
+// Bytes at the end of the input that are always sent as literals.
+constexpr size_t kLastLiterals = 5;
+constexpr int kHashBits = 16;
+
+inline uint32_t Load32(const uint8_t* ptr) {
+  uint32_t value;
+  std::memcpy(&value, ptr, sizeof(value));
+  return value;
+}
+
+inline uint32_t Hash(uint32_t sequence) { return (sequence * 2654435761U) >> (32 - kHashBits); }
+
+inline uint8_t* WriteLength(uint8_t* out, size_t len) {
+  for (; len >= 255; len -= 255) *out++ = 255;
+  *out++ = static_cast<uint8_t>(len);
+  return out;
+}
+
+inline bool ReadLength(const uint8_t** ip, const uint8_t* iend, size_t* len) {
+  uint8_t byte;
+  do {
+    if (*ip == iend) return false;
+    byte = *(*ip)++;
+    *len += byte;
+  } while (byte == 255);
+  return true;
+}
+
+// Write literals and, when match_len is not 0, the match that follows them.
+inline uint8_t* WriteSequence(uint8_t* out, const uint8_t* literals, size_t num_literals,
+                              size_t offset, size_t match_len) {
+  uint8_t* token = out++;
+  *token = static_cast<uint8_t>(std::min<size_t>(num_literals, 15) << 4);
+  if (num_literals >= 15) out = WriteLength(out, num_literals - 15);
+  if (num_literals != 0) std::memcpy(out, literals, num_literals);
+  out += num_literals;
+  if (match_len == 0) return out;
+  *out++ = static_cast<uint8_t>(offset & 0xff);
+  *out++ = static_cast<uint8_t>(offset >> 8);
+  size_t len = match_len - kMinMatch;
+  *token |= static_cast<uint8_t>(std::min<size_t>(len, 15));
+  if (len >= 15) out = WriteLength(out, len - 15);
+  return out;
+}
+}  // namespace lz
+
+/*!
+ * \brief Upper bound of the compressed size of n bytes.
+ * \param n The input size.
+ * \return The size the output buffer of LZCompress needs.
+ */
+inline size_t LZCompressBound(size_t n) { return n + n / 255 + 16; }
+
+/*!
+ * \brief Compress a buffer.
+ * \param src The input.
+ * \param n The input size, less than 4GB.
+ * \param dst The output, with room for LZCompressBound(n) bytes.
+ * \return The compressed size.
+ */
+inline size_t LZCompress(const void* src, size_t n, void* dst) {
+  using namespace lz;
+  const uint8_t* in = static_cast<const uint8_t*>(src);
+  uint8_t* out = static_cast<uint8_t*>(dst);
+  size_t anchor = 0;
+  if (n >= kMinMatch + kLastLiterals) {
+    std::vector<uint32_t> table(1 << kHashBits, 0);
+    const size_t limit = n - kLastLiterals - kMinMatch + 1;
+    size_t ip = 0;
+    while (ip < limit) {
+      uint32_t sequence = Load32(in + ip);
+      uint32_t& slot = table[Hash(sequence)];
+      size_t ref = slot;
+      slot = static_cast<uint32_t>(ip);
+      if (ref < ip && ip - ref <= kMaxOffset && Load32(in + ref) == sequence) {
+        size_t len = kMinMatch;
+        while (ip + len < n - kLastLiterals && in[ref + len] == in[ip + len]) ++len;
+        out = WriteSequence(out, in + anchor, ip - anchor, ip - ref, len);
+        ip += len;
+        anchor = ip;
+      } else {
+        // Step faster through data that does not compress.
+        ip += 1 + ((ip - anchor) >> 6);
+      }
+    }
+  }
+  out = lz::WriteSequence(out, in + anchor, n - anchor, 0, 0);
+  return out - static_cast<uint8_t*>(dst);
+}
+
+/*!
+ * \brief Decompress a buffer.
+ * \param src The compressed input.
+ * \param n The compressed size.
+ * \param dst The output.
+ * \param dst_n The decompressed size.
+ * \return Whether the input was valid and decompressed to exactly dst_n bytes.
+ */
+inline bool LZDecompress(const void* src, size_t n, void* dst, size_t dst_n) {
+  using namespace lz;
+  const uint8_t* ip = static_cast<const uint8_t*>(src);
+  const uint8_t* iend = ip + n;
+  uint8_t* const ostart = static_cast<uint8_t*>(dst);
+  uint8_t* op = ostart;
+  uint8_t* const oend = op + dst_n;
+  while (ip < iend) {
+    uint8_t token = *ip++;
+    size_t num_literals = token >> 4;
+    if (num_literals == 15 && !ReadLength(&ip, iend, &num_literals)) return false;
+    if (num_literals > static_cast<size_t>(iend - ip) ||
+        num_literals > static_cast<size_t>(oend - op)) {
+      return false;
+    }
+    if (num_literals != 0) std::memcpy(op, ip, num_literals);
+    ip += num_literals;
+    op += num_literals;
+    if (ip == iend) break;
+    if (iend - ip < 2) return false;
+    size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+    ip += 2;
+    size_t len = token & 15;
+    if (len == 15 && !ReadLength(&ip, iend, &len)) return false;
+    len += kMinMatch;
+    if (offset == 0 || offset > static_cast<size_t>(op - ostart) ||
+        len > static_cast<size_t>(oend - op)) {
+      return false;
+    }
+    const uint8_t* match = op - offset;
+    if (offset >= len) {
+      std::memcpy(op, match, len);
+      op += len;
+    } else {
+      // The match overlaps the bytes it produces.
+      for (size_t i = 0; i < len; ++i) *op++ = match[i];
+    }
+  }
+  return op == oend;
+}
+
+}  // namespace support
+}  // namespace tvm
+#endif  // TVM_SUPPORT_LZ_CODEC_H_
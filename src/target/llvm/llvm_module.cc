@@ -24,12 +24,20 @@
 #ifdef TVM_LLVM_VERSION
 
 #include <tvm/ir/module.h>
+#include <tvm/ir/transform.h>
 #include <tvm/relay/runtime.h>
 #include <tvm/runtime/packed_func.h>
 #include <tvm/runtime/registry.h>
+#include <tvm/support/parallel_for.h>
 #include <tvm/target/codegen.h>
+#include <tvm/tir/stmt_functor.h>
 
+#include <algorithm>
 #include <mutex>
+#include <numeric>
+#include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "../../runtime/file_utils.h"
 #include "../../runtime/library_module.h"
@@ -102,7 +110,18 @@ class LLVMModuleNode final : public runtime::ModuleNode {
     } else {
       faddr = reinterpret_cast<TVMBackendPackedCFunc>(GetFunctionAddr(name));
     }
-    if (faddr == nullptr) return PackedFunc();
+    if (faddr == nullptr) {
+      for (runtime::Module& part : parts_) {
+        PackedFunc pf = part->GetFunction(name, false);
+        // The part resolves environment functions through this module, which must outlive it.
+        if (pf != nullptr) {
+          return PackedFunc([pf, sptr_to_self](TVMArgs args, TVMRetValue* rv) {
+            pf.CallPacked(args, rv);
+          });
+        }
+      }
+      return PackedFunc();
+    }
     return WrapPackedFunc(faddr, sptr_to_self);
   }
 
@@ -115,7 +134,9 @@ class LLVMModuleNode final : public runtime::ModuleNode {
     llvm::raw_fd_ostream dest(file_name, ecode, llvm::sys::fs::OF_None);
 #endif
     ICHECK_EQ(ecode.value(), 0) << "Cannot open file: " << file_name << " " << ecode.message();
-    if (fmt == "o" || fmt == "obj") {
+    if ((fmt == "o" || fmt == "obj") && !object_code_.empty()) {
+      dest << object_code_;
+    } else if (fmt == "o" || fmt == "obj") {
 #if TVM_LLVM_VERSION <= 60
       std::unique_ptr<llvm::Module> m = llvm::CloneModule(mptr_);
 #else
@@ -362,6 +383,44 @@ class LLVMModuleNode final : public runtime::ModuleNode {
     tm_ = GetLLVMTargetMachine(Target(target_metadata));
   }
 
+  /*! \brief Generate the object code of the module now rather than when it is saved. */
+  void EmitObjectCode() {
+    llvm::SmallString<0> buffer;
+    llvm::raw_svector_ostream dest(buffer);
+    std::unique_ptr<llvm::Module> m = llvm::CloneModule(*mptr_);
+    llvm::legacy::PassManager pass;
+    ICHECK(tm_);
+#if TVM_LLVM_VERSION <= 90
+    ICHECK(tm_->addPassesToEmitFile(pass, dest, nullptr, llvm::TargetMachine::CGFT_ObjectFile) ==
+           0)
+        << "Cannot emit target CGFT_ObjectFile";
+#else
+    ICHECK(tm_->addPassesToEmitFile(pass, dest, nullptr, llvm::CGFT_ObjectFile) == 0)
+        << "Cannot emit target CGFT_ObjectFile";
+#endif
+    pass.run(*m);
+    object_code_ = std::string(buffer.data(), buffer.size());
+  }
+
+  /*!
+   * \brief Make the functions of the other modules the IRModule of this one was split into
+   *  available from this module.
+   *
+   *  The parts look up environment functions, such as device kernels, among the imports of
+   *  this module, since only this one gets the imports of the build.
+   * \param parts The other modules, which this module must also import.
+   */
+  void SetParts(std::vector<runtime::Module> parts) {
+    for (runtime::Module& part : parts) {
+      auto* node = static_cast<LLVMModuleNode*>(part.operator->());
+      for (const String& name : node->function_names_) {
+        function_names_.push_back(name);
+      }
+      node->env_ = this;
+    }
+    parts_ = std::move(parts);
+  }
+
   void LoadIR(const std::string& file_name) {
     auto ctx = std::make_shared<llvm::LLVMContext>();
     llvm::SMDiagnostic err;
@@ -415,7 +474,7 @@ class LLVMModuleNode final : public runtime::ModuleNode {
 
     if (void** ctx_addr =
             reinterpret_cast<void**>(GetGlobalAddr(runtime::symbol::tvm_module_ctx))) {
-      *ctx_addr = this;
+      *ctx_addr = env_ != nullptr ? env_ : this;
     }
     runtime::InitContextFunctions(
         [this](const char* name) { return reinterpret_cast<void*>(GetGlobalAddr(name)); });
@@ -454,10 +513,140 @@ class LLVMModuleNode final : public runtime::ModuleNode {
   std::shared_ptr<llvm::LLVMContext> ctx_;
   /* \brief names of the functions declared in this module */
   Array<String> function_names_;
+  // The object code emitted by a parallel build, empty when it is emitted on save.
+  std::string object_code_;
+  // The other modules of a parallel build, imported by this one.
+  std::vector<runtime::Module> parts_;
+  // The module of a parallel build whose imports this part uses, null if it uses its own.
+  LLVMModuleNode* env_{nullptr};
 };
 
+TVM_REGISTER_PASS_CONFIG_OPTION("codegen.llvm.num_parallel_modules", Integer);
+
+/*!
+ * \brief Split the PrimFuncs of an IRModule into groups which can be compiled separately.
+ *
+ *  Functions which refer to each other by name, through direct or packed calls, stay together
+ *  so that every module resolves its calls when it is JIT compiled on its own. The group of
+ *  the entry function and of the linked parameters comes first.
+ * \return The groups, merged into at most num_parts parts with about the same amount of IR.
+ */
+std::vector<IRModule> PartitionForParallelCodegen(const IRModule& mod, int num_parts) {
+  std::vector<GlobalVar> gvars;
+  std::unordered_map<std::string, int> index_of_symbol;
+  for (const auto& kv : mod->functions) {
+    index_of_symbol[kv.first->name_hint] = gvars.size();
+    if (auto global_symbol = kv.second->GetAttr<String>(tvm::attr::kGlobalSymbol)) {
+      index_of_symbol[global_symbol.value()] = gvars.size();
+    }
+    gvars.push_back(kv.first);
+  }
+
+  std::vector<int> parent(gvars.size());
+  std::iota(parent.begin(), parent.end(), 0);
+  std::function<int(int)> find = [&](int i) {
+    return parent[i] == i ? i : parent[i] = find(parent[i]);
+  };
+  std::vector<int64_t> cost(gvars.size(), 1);
+  // Always placed in the first part.
+  int first = -1;
+  for (size_t i = 0; i < gvars.size(); ++i) {
+    BaseFunc func = mod->Lookup(gvars[i]);
+    const auto* prim_func = func.as<PrimFuncNode>();
+    if (prim_func == nullptr || prim_func->HasNonzeroAttr(tir::attr::kIsEntryFunc) ||
+        gvars[i]->name_hint == ::tvm::runtime::symbol::tvm_lookup_linked_param) {
+      if (first < 0) first = i;
+      parent[find(i)] = find(first);
+      if (prim_func == nullptr) continue;
+    }
+    tir::PostOrderVisit(prim_func->body, [&](const ObjectRef& node) {
+      ++cost[i];
+      std::string name;
+      if (const auto* str = node.as<tir::StringImmNode>()) {
+        name = str->value;
+      } else if (const auto* call = node.as<tir::CallNode>()) {
+        if (const auto* gvar = call->op.as<GlobalVarNode>()) name = gvar->name_hint;
+      }
+      if (name.empty()) return;
+      auto it = index_of_symbol.find(name);
+      if (it != index_of_symbol.end()) {
+        parent[find(i)] = find(it->second);
+      }
+    });
+  }
+
+  std::unordered_map<int, std::vector<int>> groups;
+  std::unordered_map<int, int64_t> group_cost;
+  for (size_t i = 0; i < gvars.size(); ++i) {
+    groups[find(i)].push_back(i);
+    group_cost[find(i)] += cost[i];
+  }
+  std::vector<int> roots;
+  for (const auto& kv : groups) roots.push_back(kv.first);
+  std::sort(roots.begin(), roots.end(), [&](int a, int b) {
+    return group_cost[a] != group_cost[b] ? group_cost[a] > group_cost[b] : a < b;
+  });
+  // Largest group first into the least loaded part.
+  std::vector<Map<GlobalVar, BaseFunc>> parts(num_parts);
+  std::vector<int64_t> load(num_parts, 0);
+  for (int root : roots) {
+    int part = 0;
+    if (first < 0 || root != find(first)) {
+      part = std::min_element(load.begin(), load.end()) - load.begin();
+    }
+    for (int i : groups[root]) {
+      parts[part].Set(gvars[i], mod->Lookup(gvars[i]));
+    }
+    load[part] += group_cost[root];
+  }
+
+  std::vector<IRModule> result;
+  for (size_t i = 0; i < parts.size(); ++i) {
+    if (i == 0 || !parts[i].empty()) {
+      result.push_back(IRModule(parts[i], {}, {}, {}, mod->attrs));
+    }
+  }
+  return result;
+}
+
+/*!
+ * \brief Build an LLVM module for each part of an IRModule in parallel.
+ *
+ *  Each part gets its own LLVMContext and is optimized and turned into object code on its own
+ *  thread. The first part imports the others, so exporting it writes one object file per part
+ *  for the linker, and forwards the lookups of their functions when it is used in process.
+ */
+runtime::Module BuildLLVMParallel(const IRModule& mod, const Target& target, int num_parts) {
+  InitializeLLVM();
+  std::vector<IRModule> parts = PartitionForParallelCodegen(mod, num_parts);
+  std::vector<ObjectPtr<LLVMModuleNode>> nodes(parts.size());
+  support::parallel_for(0, parts.size(), [&](int i) {
+    nodes[i] = make_object<LLVMModuleNode>();
+    nodes[i]->Init(parts[i], target);
+    nodes[i]->EmitObjectCode();
+  });
+  runtime::Module primary(nodes[0]);
+  std::vector<runtime::Module> others;
+  for (size_t i = 1; i < nodes.size(); ++i) {
+    others.push_back(runtime::Module(nodes[i]));
+    primary.Import(others.back());
+  }
+  nodes[0]->SetParts(others);
+  return primary;
+}
+
 TVM_REGISTER_GLOBAL("target.build.llvm")
     .set_body_typed([](IRModule mod, Target target) -> runtime::Module {
+      int num_parts = tvm::transform::PassContext::Current()
+                          ->GetConfig<Integer>("codegen.llvm.num_parallel_modules", Integer(1))
+                          .value()
+                          ->value;
+      relay::Runtime runtime = mod->GetAttr<relay::Runtime>(tvm::attr::kRuntime)
+                                   .value_or(relay::Runtime::Create("cpp"));
+      // The C runtime finds the functions of a system library in one registry per module.
+      if (num_parts > 1 && runtime->name != "crt") {
+        return BuildLLVMParallel(mod, target, num_parts);
+      }
       auto n = make_object<LLVMModuleNode>();
       n->Init(mod, target);
       return runtime::Module(n);
@@ -34,18 +34,23 @@ int32_t DataType2Int(const tvm::DataType& dtype) {
   return converter.dst;
 }
 
-String Int2DataTypeStr(int32_t dtype) {
+DLDataType Int2DLDataType(int32_t dtype) {
   union {
     DLDataType dst;
     int32_t src;
   } converter;
   converter.src = dtype;
+  return converter.dst;
+}
+
+String Int2DataTypeStr(int32_t dtype) {
+  DLDataType dl_dtype = Int2DLDataType(dtype);
   static std::string type_code_tab[] = {"int", "uint", "float", "handle", "bfloat"};
   std::ostringstream os;
-  os << type_code_tab[converter.dst.code];
-  os << static_cast<int>(converter.dst.bits);
-  if (converter.dst.lanes != 1) {
-    os << "x" << static_cast<int>(converter.dst.lanes);
+  os << type_code_tab[dl_dtype.code];
+  os << static_cast<int>(dl_dtype.bits);
+  if (dl_dtype.lanes != 1) {
+    os << "x" << static_cast<int>(dl_dtype.lanes);
   }
   return os.str();
 }
@@ -126,6 +131,27 @@ class FlopEstimator : private ExprFunctor<TResult(const PrimExpr& n)>,
 
   TResult VisitExpr_(const BufferLoadNode* op) override { return TResult(); }
   TResult VisitStmt_(const BufferStoreNode* store) override { return VisitExpr(store->value); }
+  // Flattened TIR, as produced by lowering, indexes with Load and Store.
+  TResult VisitExpr_(const LoadNode* op) override { return TResult(); }
+  TResult VisitStmt_(const StoreNode* store) override { return VisitExpr(store->value); }
+  TResult VisitExpr_(const RampNode* op) override { return TResult(); }
+  TResult VisitExpr_(const BroadcastNode* op) override { return VisitExpr(op->value); }
+  TResult VisitExpr_(const LetNode* op) override {
+    TResult result = VisitExpr(op->value);
+    result += VisitExpr(op->body);
+    return result;
+  }
+  TResult VisitStmt_(const LetStmtNode* op) override {
+    TResult result = VisitExpr(op->value);
+    result += VisitStmt(op->body);
+    return result;
+  }
+  TResult VisitStmt_(const AttrStmtNode* op) override { return VisitStmt(op->body); }
+  TResult VisitStmt_(const AssertStmtNode* op) override { return VisitStmt(op->body); }
+  TResult VisitStmt_(const AllocateNode* op) override { return VisitStmt(op->body); }
+  TResult VisitStmt_(const AllocateConstNode* op) override { return VisitStmt(op->body); }
+  TResult VisitStmt_(const BufferRealizeNode* op) override { return VisitStmt(op->body); }
+  TResult VisitStmt_(const EvaluateNode* op) override { return VisitExpr(op->value); }
   TResult VisitStmt_(const BlockRealizeNode* block) override {
     return VisitStmt(block->block->body);
   }
@@ -184,7 +210,8 @@ class FlopEstimator : private ExprFunctor<TResult(const PrimExpr& n)>,
 double PostprocessResults(const TResult& result) {
   double cnt = 0.0;
   for (const auto& kv : result.data_) {
-    cnt += kv.second;
+    // An operation on a vector counts once per lane.
+    cnt += kv.second * DataType(Int2DLDataType(kv.first)).lanes();
   }
   return cnt;
 }
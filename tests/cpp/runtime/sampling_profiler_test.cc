@@ -0,0 +1,87 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "../../../src/runtime/sampling_profiler.h"
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace tvm::runtime;
+
+TEST(LatencyHistogram, Quantiles) {
+  LatencyHistogram hist;
+  for (uint64_t ns = 1; ns <= 100000; ++ns) hist.Add(ns);
+  EXPECT_EQ(hist.count(), 100000);
+  EXPECT_NEAR(hist.Mean(), 50000.5, 1e-6);
+  for (double q : {0.5, 0.95, 0.99}) {
+    EXPECT_NEAR(hist.Quantile(q), q * 100000, q * 100000 * 0.07);
+  }
+  LatencyHistogram other;
+  other.Add(5);
+  hist.Merge(other);
+  EXPECT_EQ(hist.count(), 100001);
+  hist.Clear();
+  EXPECT_EQ(hist.Quantile(0.5), 0);
+}
+
+TEST(SamplingProfiler, SamplesOneRunInN) {
+  SamplingProfiler::Config config;
+  config.sample_every = 10;
+  SamplingProfiler profiler({"a", "b"}, config);
+  int sampled = 0;
+  for (int i = 0; i < 1000; ++i) {
+    if (profiler.BeginRun()) {
+      ++sampled;
+      profiler.Record(0, 1000);
+      profiler.Record(1, 3000);
+      profiler.EndRun(4000);
+    }
+  }
+  EXPECT_EQ(sampled, 100);
+  std::string report = profiler.ReportJSON();
+  EXPECT_NE(report.find("\"runs\": 1000"), std::string::npos);
+  EXPECT_NE(report.find("\"sampled_runs\": 100"), std::string::npos);
+  // b takes longer in total, so it comes first.
+  EXPECT_LT(report.find("\"name\": \"b\""), report.find("\"name\": \"a\""));
+  profiler.Reset();
+  EXPECT_NE(profiler.ReportJSON().find("\"ops\": []"), std::string::npos);
+}
+
+TEST(SamplingProfiler, RecordFromManyThreads) {
+  SamplingProfiler::Config config;
+  config.sample_every = 1;
+  SamplingProfiler profiler({"op"}, config);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&profiler]() {
+      for (int i = 0; i < 1000; ++i) {
+        ASSERT_TRUE(profiler.BeginRun());
+        profiler.Record(0, 100);
+        profiler.EndRun(200);
+      }
+    });
+  }
+  for (std::thread& t : threads) t.join();
+  std::string report = profiler.ReportJSON();
+  EXPECT_NE(report.find("\"dropped_samples\": 0"), std::string::npos);
+  EXPECT_NE(report.find("{\"name\": \"op\", \"count\": 4000"), std::string::npos);
+}
@@ -0,0 +1,166 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "../../../src/runtime/vm/thread_cached_allocator.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace tvm;
+using namespace tvm::runtime;
+using namespace tvm::runtime::vm;
+
+namespace {
+
+int64_t StatOf(const std::string& stats, const std::string& key) {
+  std::string pattern = "\"" + key + "\": ";
+  size_t pos = stats.find(pattern);
+  EXPECT_NE(pos, std::string::npos) << key << " missing from " << stats;
+  return std::stoll(stats.substr(pos + pattern.size()));
+}
+
+}  // namespace
+
+TEST(ThreadCachedAllocator, CrossThreadAllocFree) {
+  const Device dev{kDLCPU, 0};
+  const DLDataType type_hint{kDLUInt, 8, 1};
+  const int kNumThreads = 4;
+  const int kNumRounds = 200;
+  const int kBatch = 24;
+  ThreadCachedAllocator alloc(dev);
+
+  // Every thread frees half of its buffers itself and hands the other half to the next
+  // thread, so buffers regularly go back through a cache other than the one they came from.
+  std::mutex mu;
+  std::vector<std::deque<Buffer>> handoff(kNumThreads);
+  std::unordered_set<void*> live;
+  std::atomic<bool> duplicate{false}, corrupted{false};
+
+  auto check_and_free = [&](const Buffer& buf) {
+    uint8_t tag = *static_cast<uint8_t*>(buf.data);
+    for (size_t i = 0; i < buf.size; i += 512) {
+      if (static_cast<uint8_t*>(buf.data)[i] != tag) corrupted = true;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mu);
+      live.erase(buf.data);
+    }
+    alloc.Free(buf);
+  };
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      std::mt19937 rng(t);
+      for (int round = 0; round < kNumRounds; ++round) {
+        std::vector<Buffer> bufs;
+        for (int i = 0; i < kBatch; ++i) {
+          Buffer buf = alloc.Alloc(512 * (1 + rng() % 8), 64, type_hint);
+          {
+            std::lock_guard<std::mutex> lock(mu);
+            if (!live.insert(buf.data).second) duplicate = true;
+          }
+          uint8_t tag = static_cast<uint8_t>(t * 31 + round + i);
+          for (size_t j = 0; j < buf.size; j += 512) static_cast<uint8_t*>(buf.data)[j] = tag;
+          bufs.push_back(buf);
+        }
+        std::vector<Buffer> received;
+        {
+          std::lock_guard<std::mutex> lock(mu);
+          for (int i = 0; i < kBatch / 2; ++i) handoff[(t + 1) % kNumThreads].push_back(bufs[i]);
+          received.assign(handoff[t].begin(), handoff[t].end());
+          handoff[t].clear();
+        }
+        for (int i = kBatch / 2; i < kBatch; ++i) check_and_free(bufs[i]);
+        for (const Buffer& buf : received) check_and_free(buf);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  for (auto& queue : handoff) {
+    for (const Buffer& buf : queue) check_and_free(buf);
+  }
+
+  EXPECT_FALSE(duplicate) << "a buffer was handed out twice";
+  EXPECT_FALSE(corrupted) << "a buffer was written by two owners";
+  EXPECT_TRUE(live.empty());
+
+  std::string stats = alloc.Stats();
+  EXPECT_EQ(StatOf(stats, "hits") + StatOf(stats, "misses"), kNumThreads * kNumRounds * kBatch);
+  EXPECT_GT(StatOf(stats, "hits"), 0);
+  EXPECT_GT(StatOf(stats, "flushes"), 0);
+  // The workers have exited, so their buffers are all in the depot or the main thread's cache.
+  EXPECT_GT(StatOf(stats, "cached"), 0);
+
+  alloc.Trim();
+  EXPECT_EQ(StatOf(alloc.Stats(), "cached"), 0);
+}
+
+TEST(ThreadCachedAllocator, TrimReleasesOtherThreadOnNextUse) {
+  const Device dev{kDLCPU, 0};
+  const DLDataType type_hint{kDLUInt, 8, 1};
+  const int kNumBuffers = 2 * ThreadCachedAllocator::kMagazineSize - 1;
+  ThreadCachedAllocator alloc(dev);
+
+  std::mutex mu;
+  std::condition_variable cv;
+  int step = 0;
+  auto wait_for = [&](int value) {
+    std::unique_lock<std::mutex> lock(mu);
+    cv.wait(lock, [&]() { return step == value; });
+  };
+  auto advance = [&]() {
+    std::lock_guard<std::mutex> lock(mu);
+    ++step;
+    cv.notify_all();
+  };
+
+  std::thread worker([&]() {
+    // Fill the magazine to just below the flush threshold and stay alive holding it.
+    std::vector<Buffer> bufs;
+    for (int i = 0; i < kNumBuffers; ++i) bufs.push_back(alloc.Alloc(4096, 64, type_hint));
+    for (const Buffer& buf : bufs) alloc.Free(buf);
+    advance();
+    wait_for(2);
+    alloc.Free(alloc.Alloc(4096, 64, type_hint));
+    advance();
+    wait_for(4);
+  });
+
+  wait_for(1);
+  EXPECT_EQ(StatOf(alloc.Stats(), "cached"), kNumBuffers);
+  alloc.Trim();
+  // The worker has not touched the allocator since, so it still holds its magazine.
+  EXPECT_EQ(StatOf(alloc.Stats(), "cached"), kNumBuffers);
+  advance();
+  wait_for(3);
+  EXPECT_EQ(StatOf(alloc.Stats(), "cached"), 1);
+  advance();
+  worker.join();
+}
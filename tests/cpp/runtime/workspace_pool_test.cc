@@ -0,0 +1,91 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied.  See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include "../../../src/runtime/workspace_pool.h"
+
+#include <gtest/gtest.h>
+#include <tvm/runtime/device_api.h>
+
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace tvm;
+using namespace tvm::runtime;
+
+TEST(SharedWorkspacePool, SizeClass) {
+  for (size_t nbytes : {size_t(0), size_t(1), size_t(4096), size_t(10000), size_t(70000),
+                        size_t(1) << 20, (size_t(1) << 20) + 1, size_t(12345678)}) {
+    size_t size = SharedWorkspacePool::SizeClass(nbytes);
+    EXPECT_GE(size, std::max<size_t>(nbytes, 1));
+    EXPECT_EQ(size % 4096, 0);
+    EXPECT_LE(size, std::max<size_t>(nbytes, 4096) * 5 / 4 + 4096);
+    EXPECT_EQ(SharedWorkspacePool::SizeClass(size), size);
+  }
+}
+
+TEST(SharedWorkspacePool, OutOfOrderFreeAcrossThreads) {
+  Device dev{kDLCPU, 0};
+  SharedWorkspacePool pool(kDLCPU, DeviceAPI::Get(dev));
+  ResetWorkspacePeak(dev);
+  WorkspaceStats before = GetWorkspaceStats(dev);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&pool, dev, t]() {
+      std::mt19937 rng(t);
+      for (int round = 0; round < 100; ++round) {
+        std::vector<void*> ptrs;
+        for (int i = 0; i < 8; ++i) {
+          ptrs.push_back(pool.AllocWorkspace(dev, 1024 * (1 + rng() % 64)));
+        }
+        std::shuffle(ptrs.begin(), ptrs.end(), rng);
+        for (void* ptr : ptrs) pool.FreeWorkspace(dev, ptr);
+      }
+    });
+  }
+  for (auto& thread : threads) thread.join();
+  WorkspaceStats after = GetWorkspaceStats(dev);
+  EXPECT_EQ(after.live_bytes, before.live_bytes);
+  EXPECT_GT(after.peak_live_bytes, before.live_bytes);
+  EXPECT_GT(pool.CachedBytes(dev), 0);
+  // The cached workspaces are shared, so a later thread reuses them without allocating.
+  std::thread([&pool, dev, after]() {
+    pool.FreeWorkspace(dev, pool.AllocWorkspace(dev, 4096));
+    EXPECT_EQ(GetWorkspaceStats(dev).held_bytes, after.held_bytes);
+  }).join();
+  pool.Trim(dev);
+  EXPECT_EQ(pool.CachedBytes(dev), 0);
+  EXPECT_EQ(GetWorkspaceStats(dev).held_bytes, before.held_bytes);
+}
+
+TEST(SharedWorkspacePool, CacheLimit) {
+  Device dev{kDLCPU, 0};
+  SharedWorkspacePool pool(kDLCPU, DeviceAPI::Get(dev));
+  pool.SetCacheLimit(8192);
+  void* a = pool.AllocWorkspace(dev, 4096);
+  void* b = pool.AllocWorkspace(dev, 4096);
+  void* c = pool.AllocWorkspace(dev, 4096);
+  pool.FreeWorkspace(dev, a);
+  pool.FreeWorkspace(dev, b);
+  pool.FreeWorkspace(dev, c);
+  EXPECT_EQ(pool.CachedBytes(dev), 8192);
+  pool.SetCacheLimit(0);
+  EXPECT_EQ(pool.CachedBytes(dev), 0);
+}
@@ -22,6 +22,7 @@
 #include <tvm/runtime/c_backend_api.h>
 #include <tvm/runtime/threading_backend.h>
 
+#include <algorithm>
 #include <atomic>
 #include <memory>
 #include <sstream>
@@ -185,3 +186,165 @@ TEST(ThreadingBackend, TVMBackendAffinityConfigure) {
     t->join();
   }
 }
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchWorkStealing) {
+  tvm::runtime::threading::ConfigureWorkStealing(4);
+  for (int i = 0; i < 10; ++i) {
+    std::atomic<size_t> acc(0);
+    TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
+    EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+  }
+  tvm::runtime::threading::ConfigureWorkStealing(0);
+}
+
+static FTVMParallelLambda barrier_task_id = [](int task_id, TVMParallelGroupEnv* penv,
+                                               void* cdata) -> int {
+  auto* arrived = reinterpret_cast<std::atomic<int>*>(cdata);
+  arrived->fetch_add(1);
+  TVMBackendParallelBarrier(task_id, penv);
+  // Every task must have arrived before any task leaves the barrier.
+  return arrived->load() == penv->num_task ? 0 : -1;
+};
+
+TEST(ThreadingBackend, TVMBackendParallelBarrierWorkStealing) {
+  tvm::runtime::threading::ConfigureWorkStealing(4);
+  for (int i = 0; i < 10; ++i) {
+    std::atomic<int> arrived(0);
+    EXPECT_EQ(TVMBackendParallelLaunch(barrier_task_id, &arrived, 0), 0);
+  }
+  tvm::runtime::threading::ConfigureWorkStealing(0);
+}
+
+static FTVMParallelLambda two_barriers_task_id = [](int task_id, TVMParallelGroupEnv* penv,
+                                                    void* cdata) -> int {
+  auto* arrived = reinterpret_cast<std::atomic<int>*>(cdata);
+  for (int phase = 0; phase < 2; ++phase) {
+    arrived[phase].fetch_add(1);
+    TVMBackendParallelBarrier(task_id, penv);
+    if (arrived[phase].load() != penv->num_task) return -1;
+  }
+  return 0;
+};
+
+TEST(ThreadingBackend, TVMBackendParallelTwoBarriersWorkStealing) {
+  tvm::runtime::threading::ConfigureWorkStealing(4);
+  for (int i = 0; i < 10; ++i) {
+    std::atomic<int> arrived[2];
+    arrived[0] = 0;
+    arrived[1] = 0;
+    EXPECT_EQ(TVMBackendParallelLaunch(two_barriers_task_id, arrived, 0), 0);
+  }
+  tvm::runtime::threading::ConfigureWorkStealing(0);
+}
+
+struct DataDependentBarrier {
+  bool reach_barrier;
+  std::atomic<int> arrived[2];
+};
+
+static FTVMParallelLambda data_dependent_barrier_task_id = [](int task_id,
+                                                              TVMParallelGroupEnv* penv,
+                                                              void* cdata) -> int {
+  auto* data = reinterpret_cast<DataDependentBarrier*>(cdata);
+  for (int phase = 0; phase < 2; ++phase) {
+    data->arrived[phase].fetch_add(1);
+    if (!data->reach_barrier) continue;
+    TVMBackendParallelBarrier(task_id, penv);
+    if (data->arrived[phase].load() != penv->num_task) return -1;
+  }
+  return 0;
+};
+
+// Launches a kernel which reaches its barriers only on some launches, after launches which
+// let the pool learn that it reaches none.
+void LaunchDataDependentBarriers() {
+  for (int i = 0; i < 4; ++i) {
+    for (bool reach_barrier : {false, false, true, false, true}) {
+      DataDependentBarrier data;
+      data.reach_barrier = reach_barrier;
+      data.arrived[0] = 0;
+      data.arrived[1] = 0;
+      EXPECT_EQ(TVMBackendParallelLaunch(data_dependent_barrier_task_id, &data, 0), 0);
+    }
+  }
+}
+
+TEST(ThreadingBackend, TVMBackendParallelDataDependentBarrierWorkStealing) {
+  tvm::runtime::threading::ConfigureWorkStealing(4);
+  LaunchDataDependentBarriers();
+  tvm::runtime::threading::ConfigureWorkStealing(0);
+}
+
+TEST(ThreadingBackend, TVMBackendParallelDataDependentBarrierSharedPool) {
+  tvm::runtime::threading::ConfigureSharedPool(true, 0);
+  LaunchDataDependentBarriers();
+  tvm::runtime::threading::ConfigureSharedPool(false, 0);
+}
+
+static FTVMParallelLambda nested_launch_task_id = [](int task_id, TVMParallelGroupEnv* penv,
+                                                     void* cdata) -> int {
+  auto* acc = reinterpret_cast<std::atomic<size_t>*>(cdata);
+  std::atomic<size_t> inner(0);
+  int ret = TVMBackendParallelLaunch(atomic_add_task_id, &inner, 0);
+  acc->fetch_add(inner.load(std::memory_order_relaxed));
+  return ret;
+};
+
+static FTVMParallelLambda nested_explicit_launch_task_id = [](int task_id,
+                                                              TVMParallelGroupEnv* penv,
+                                                              void* cdata) -> int {
+  // The outer job occupies every worker, so the inner jobs cannot get one for each task.
+  auto* acc = reinterpret_cast<std::atomic<size_t>*>(cdata);
+  std::atomic<size_t> inner(0);
+  int ret = TVMBackendParallelLaunch(atomic_add_task_id, &inner, penv->num_task);
+  acc->fetch_add(inner.load(std::memory_order_relaxed));
+  std::atomic<int> arrived(0);
+  return ret | TVMBackendParallelLaunch(barrier_task_id, &arrived, penv->num_task);
+};
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchSharedPool) {
+  tvm::runtime::threading::ConfigureSharedPool(true, 0);
+  std::vector<std::unique_ptr<std::thread>> ts;
+  for (int i = 0; i < 4; ++i) {
+    ts.emplace_back(new std::thread([&]() {
+      for (int j = 0; j < 10; ++j) {
+        std::atomic<size_t> acc(0);
+        TVMBackendParallelLaunch(atomic_add_task_id, &acc, 0);
+        EXPECT_EQ(acc.load(std::memory_order_relaxed), N * (N - 1) / 2);
+        std::atomic<int> arrived(0);
+        EXPECT_EQ(TVMBackendParallelLaunch(barrier_task_id, &arrived, 0), 0);
+        std::atomic<int> arrived_twice[2];
+        arrived_twice[0] = 0;
+        arrived_twice[1] = 0;
+        EXPECT_EQ(TVMBackendParallelLaunch(two_barriers_task_id, arrived_twice, 0), 0);
+      }
+    }));
+  }
+  for (auto& t : ts) {
+    t->join();
+  }
+  tvm::runtime::threading::ConfigureSharedPool(false, 0);
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchNestedSharedPool) {
+  tvm::runtime::threading::ConfigureSharedPool(true, 2);
+  // A kernel which may reach a barrier needs a worker for each task.
+  int num_task = std::min(4, tvm::runtime::threading::MaxConcurrency());
+  for (int i = 0; i < 2; ++i) {
+    std::atomic<size_t> acc(0);
+    EXPECT_EQ(TVMBackendParallelLaunch(nested_launch_task_id, &acc, num_task), 0);
+    EXPECT_EQ(acc.load(std::memory_order_relaxed), static_cast<size_t>(num_task) * N * (N - 1) / 2);
+  }
+  tvm::runtime::threading::ConfigureSharedPool(false, 0);
+}
+
+TEST(ThreadingBackend, TVMBackendParallelLaunchNestedExplicitSharedPool) {
+  tvm::runtime::threading::ConfigureSharedPool(true, 0);
+  int num_task = tvm::runtime::threading::MaxConcurrency();
+  for (int i = 0; i < 4; ++i) {
+    std::atomic<size_t> acc(0);
+    EXPECT_EQ(TVMBackendParallelLaunch(nested_explicit_launch_task_id, &acc, num_task), 0);
+    EXPECT_EQ(acc.load(std::memory_order_relaxed), static_cast<size_t>(num_task) * N * (N - 1) / 2);
+  }
+  tvm::runtime::threading::ConfigureSharedPool(false, 0);
+}
@@ -0,0 +1,61 @@
+# Licensed to the Apache Software Foundation (ASF) under one
+# or more contributor license agreements.  See the NOTICE file
+# distributed with this work for additional information
+# regarding copyright ownership.  The ASF licenses this file
+# to you under the Apache License, Version 2.0 (the
+# "License"); you may not use this file except in compliance
+# with the License.  You may obtain a copy of the License at
+#
+#   http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing,
+# software distributed under the License is distributed on an
+# "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+# KIND, either express or implied.  See the License for the
+# specific language governing permissions and limitations
+# under the License.
+import json
+import sys
+
+import pytest
+
+import tvm
+import tvm.testing
+from tvm import te
+from tvm.contrib import roofline
+from tvm.relay.testing import mlp
+
+
+def test_estimate_bytes():
+    A = te.placeholder((16, 32), name="A")
+    B = te.compute((16,), lambda i: A[i, 0] * 2.0, name="B")
+    func = tvm.lower(te.create_schedule(B.op), [A, B])["main"]
+    assert roofline.estimate_bytes(func) == (16 * 32 + 16) * 4
+
+
+@tvm.testing.requires_llvm
+def test_roofline_analysis():
+    mod, params = mlp.get_workload(1)
+    report = roofline.roofline_analysis(
+        mod, params, "llvm", tvm.cpu(), peak_gflops=100.0, peak_gbps=10.0
+    )
+    calls = [call for call in json.loads(report.json())["calls"] if "Percent of Roofline" in call]
+    assert any("dense" in call["Name"]["string"] for call in calls)
+    for call in calls:
+        assert call["Estimated Bytes"]["count"] > 0
+        assert call["Bound"]["string"] in ("compute", "memory")
+        assert call["Percent of Roofline"]["percent"] > 0
+    assert "Peak GFLOP/s" in str(report)
+    table = roofline.roofline_table(report, top=3)
+    assert len(table.splitlines()) == 4
+
+
+@tvm.testing.requires_llvm
+def test_measure_peaks():
+    dev = tvm.cpu()
+    assert roofline.measure_peak_bandwidth("llvm", dev, nbytes=1 << 20, number=1) > 0
+    assert roofline.measure_peak_flops("llvm", dev, iters=1000, number=1) > 0
+
+
+if __name__ == "__main__":
+    sys.exit(pytest.main([__file__] + sys.argv[1:]))
@@ -14,6 +14,8 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import threading
+
 import numpy as np
 import pytest
 from unittest.mock import patch
@@ -349,6 +351,136 @@ def test_graph_executor_api():
         assert dtype_dict[name] == ty.dtype
 
 
+def test_graph_executor_session():
+    x = relay.var("x", shape=(10, 5))
+    y = relay.var("y", shape=(1, 5))
+    func = relay.Function([x, y], relay.exp(relay.add(x, y)))
+    y_data = np.random.rand(1, 5).astype("float32")
+    lib = relay.build(tvm.IRModule.from_expr(func), "llvm", params={"y": y_data})
+    mod = graph_executor.GraphModule(lib["default"](tvm.cpu(0)))
+
+    sessions = [mod.create_session() for _ in range(4)]
+    inputs = [np.random.rand(10, 5).astype("float32") for _ in sessions]
+    for sess, x_data in zip(sessions, inputs):
+        sess.set_input(x=x_data)
+    # Each session keeps its own activations.
+    for sess in sessions:
+        sess.run()
+    for sess, x_data in zip(sessions, inputs):
+        tvm.testing.assert_allclose(
+            sess.get_output(0).numpy(), np.exp(x_data + y_data), atol=1e-5, rtol=1e-5
+        )
+
+    # Parameters are shared with the parent, so an update is visible in every session. The build
+    # binds y and lifts it back out as a parameter under a new name.
+    (param_name,) = lib.get_params().keys()
+    new_y = np.random.rand(1, 5).astype("float32")
+    mod.set_input(param_name, new_y)
+    sessions[0].run()
+    tvm.testing.assert_allclose(
+        sessions[0].get_output(0).numpy(), np.exp(inputs[0] + new_y), atol=1e-5, rtol=1e-5
+    )
+
+
+def test_graph_executor_session_set_input_weights():
+    x = relay.var("x", shape=(10, 5))
+    w = relay.var("w", shape=(1, 5))
+    func = relay.Function([x, w], relay.exp(relay.add(x, w)))
+    lib = relay.build(tvm.IRModule.from_expr(func), "llvm")
+    mod = graph_executor.GraphModule(lib["default"](tvm.cpu(0)))
+    # Weights given as ordinary inputs rather than build parameters.
+    w_data = np.random.rand(1, 5).astype("float32")
+    mod.set_input(w=w_data)
+
+    sessions = [mod.create_session() for _ in range(4)]
+    inputs = [np.random.rand(10, 5).astype("float32") for _ in sessions]
+    errors = []
+
+    def serve(sess, x_data):
+        try:
+            for _ in range(10):
+                sess.set_input(x=x_data)
+                sess.run()
+                tvm.testing.assert_allclose(
+                    sess.get_output(0).numpy(), np.exp(x_data + w_data), atol=1e-5, rtol=1e-5
+                )
+        except Exception as err:  # pylint: disable=broad-except
+            errors.append(err)
+
+    threads = [
+        threading.Thread(target=serve, args=(sess, x_data))
+        for sess, x_data in zip(sessions, inputs)
+    ]
+    for thread in threads:
+        thread.start()
+    for thread in threads:
+        thread.join()
+    assert not errors, errors
+
+
+def test_graph_executor_inter_op_parallel():
+    # Parallel branches whose intermediates share storage in the sequential plan.
+    x = relay.var("x", shape=(16, 16))
+    branches = []
+    for i in range(4):
+        out = x
+        for _ in range(3):
+            out = relay.exp(relay.add(out, relay.const(0.1 * (i + 1))))
+            out = relay.nn.relu(relay.multiply(out, relay.const(0.5)))
+        branches.append(out)
+    func = relay.Function([x], relay.concatenate(branches, axis=0))
+    with tvm.transform.PassContext(opt_level=0):
+        lib = relay.build(tvm.IRModule.from_expr(func), "llvm")
+    x_data = np.random.rand(16, 16).astype("float32")
+
+    ref = graph_executor.GraphModule(lib["default"](tvm.cpu(0)))
+    ref.set_input(x=x_data)
+    ref.run()
+    expected = ref.get_output(0).numpy()
+
+    mod = graph_executor.GraphModule(lib["default"](tvm.cpu(0)))
+    mod.set_inter_op_threads(4, 1)
+    mod.set_input(x=x_data)
+    for _ in range(10):
+        mod.run()
+        tvm.testing.assert_allclose(mod.get_output(0).numpy(), expected, rtol=1e-5)
+
+    mod.set_inter_op_threads(0)
+    mod.run()
+    tvm.testing.assert_allclose(mod.get_output(0).numpy(), expected, rtol=1e-5)
+
+
+def test_graph_executor_sampling_profiler():
+    x = relay.var("x", shape=(16, 16))
+    func = relay.Function([x], relay.nn.relu(relay.exp(relay.add(x, relay.const(1.0)))))
+    with tvm.transform.PassContext(opt_level=0):
+        lib = relay.build(tvm.IRModule.from_expr(func), "llvm")
+    mod = graph_executor.GraphModule(lib["default"](tvm.cpu(0)))
+    mod.set_input(x=np.random.rand(16, 16).astype("float32"))
+    with pytest.raises(tvm.TVMError):
+        mod.get_sampling_profile()
+
+    mod.set_sampling_profiler(sample_every=4)
+    for _ in range(20):
+        mod.run()
+    mod.set_inter_op_threads(2, 1)
+    sess = mod.create_session()
+    sess.set_input(x=np.random.rand(16, 16).astype("float32"))
+    for _ in range(20):
+        sess.run()
+    profile = mod.get_sampling_profile()
+    assert profile["runs"] == 40
+    assert profile["sampled_runs"] == 10
+    assert profile["run"]["count"] == 10
+    assert len(profile["ops"]) == 3
+    for op in profile["ops"]:
+        assert op["count"] == 10
+        assert 0 < op["p50_us"] <= op["p99_us"]
+
+    mod.set_sampling_profiler(0)
+    mod.run()
+
+
 @tvm.testing.requires_llvm
 def test_benchmark():
     mod, params = mlp.get_workload(1)
@@ -370,6 +370,49 @@ def test_fold_dropout():
     tvm.ir.assert_structural_equal(run_infer_type(before_mod["main"]), after_mod["main"])
 
 
+def test_fold_native_kernels():
+    """The ops run on the host give the values of the compiled kernels."""
+
+    def before():
+        w = relay.const(np.random.uniform(-100, 100, size=(2, 8, 3, 5)).astype("float32"))
+        scale = relay.const(np.random.uniform(-2, 2, size=(8, 1, 1)).astype("float32"))
+        x = relay.var("x", shape=(2, 3, 5, 2, 4), dtype="int8")
+        blocked = relay.layout_transform(w, "NCHW", "NCHW4c")
+        outputs = [
+            relay.transpose(w, axes=(0, 2, 3, 1)),
+            relay.reshape(w, newshape=(2, -1)),
+            blocked,
+            relay.layout_transform(blocked, "NCHW4c", "NCHW"),
+            relay.cast(w, "int8"),
+            relay.cast(relay.cast(w, "int32"), "float64"),
+            relay.negative(relay.multiply(w, scale)),
+            relay.maximum(relay.subtract(w, scale), relay.divide(w, scale)),
+            relay.add(relay.cast(w, "int32"), relay.const(7, "int32")),
+            relay.add(x, relay.cast(relay.transpose(w, (0, 2, 3, 1)), "int8")),
+        ]
+        return relay.Function([x], relay.Tuple(outputs))
+
+    func = before()
+    with tvm.transform.PassContext(config={"relay.FoldConstant.native_kernels": False}):
+        expected = run_opt_pass(func, transform.FoldConstant())
+    folded = run_opt_pass(func, transform.FoldConstant())
+    assert all(isinstance(field, relay.Constant) for field in folded.body.fields[:-1])
+    tvm.ir.assert_structural_equal(folded, expected)
+
+
+def test_fold_shared_kernel():
+    """Calls differing only in the values of their arguments share a kernel."""
+    values = [np.random.uniform(size=(3, 4)).astype("float32") for _ in range(3)]
+    outputs = [relay.exp(relay.const(value)) for value in values]
+    num_compiled_kernels = tvm.get_global_func("relay._transform.FoldConstantNumCompiledKernels")
+    before = num_compiled_kernels()
+    folded = run_opt_pass(relay.Function([], relay.Tuple(outputs)), transform.FoldConstant())
+    assert num_compiled_kernels() - before == 1
+    for field, value in zip(folded.body.fields, values):
+        assert isinstance(field, relay.Constant)
+        np.testing.assert_allclose(field.data.numpy(), np.exp(value), rtol=1e-5)
+
+
 def test_pass_link_params():
     """
     This test checks ensures that proper executor is passed to interpreter instance
@@ -420,9 +420,100 @@ def test_pipeline():
 
                 assert pipeline_module_test.num_executing_pipeline == round + 1
 
+            # Every stage ran once per request and the slowest one bounds the throughput.
+            profile = pipeline_module_test.get_stage_profile()
+            assert len(profile["stages"]) == 3
+            for stage in profile["stages"]:
+                assert stage["requests"] == len(datas) and stage["micro_batch"] == 1
+            bottleneck = profile["stages"][profile["bottleneck"]]
+            assert bottleneck["per_request_us"] == profile["bound_us"] <= profile["serial_us"]
+            pipeline_module_test.reset_stage_profile()
+            assert pipeline_module_test.get_stage_profile()["stages"][0]["runs"] == 0
+
+            # Every forwarding queue carried one data per request and drained afterwards.
+            queue_stats = pipeline_module_test.get_queue_stats()
+            assert len(queue_stats) == 5
+            for stats in queue_stats:
+                assert stats["pushes"] == len(datas)
+                assert 1 <= stats["max_occupancy"] <= stats["capacity"]
+            # The outputs of the finished requests were all read, so waiting for one times out.
+            assert len(pipeline_module_test.get_output(timeout_ms=10)) == 0
+
             # Reset the cpu affinity after a test.
             reset_cpu_affinity(affinity)
 
 
+def get_micro_batch_mods(dshape, micro_batch):
+    # The second module takes "micro_batch" requests of the first one stacked along the first axis.
+    data = relay.var("data_0", relay.TensorType(dshape, "float32"))
+    mod1 = tvm.IRModule.from_expr(relay.Function([data], relay.add(data, relay.const(1.0))))
+    batch_shape = (dshape[0] * micro_batch,) + dshape[1:]
+    data = relay.var("data_0", relay.TensorType(batch_shape, "float32"))
+    bias = relay.const(np.arange(dshape[-1]).astype("float32"))
+    net = relay.multiply(relay.add(data, bias), relay.const(2.0))
+    mod2 = tvm.IRModule.from_expr(relay.Function([data], net))
+    return mod1, mod2
+
+
+def test_pipeline_micro_batch():
+    if pipeline_executor.pipeline_executor_enabled():
+        dshape = (2, 3)
+        micro_batch = 2
+        mod1, mod2 = get_micro_batch_mods(dshape, micro_batch)
+        pipe_config = pipeline_executor.PipelineConfig()
+        pipe_config["input"]["data_a"].connect(pipe_config[mod1]["input"]["data_0"])
+        pipe_config[mod1]["output"][0].connect(pipe_config[mod2]["input"]["data_0"])
+        pipe_config[mod2]["output"][0].connect(pipe_config["output"]["0"])
+        for mod in [mod1, mod2]:
+            pipe_config[mod].target = "llvm"
+            pipe_config[mod].dev = tvm.cpu(0)
+        pipe_config[mod2].micro_batch = micro_batch
+        with tvm.transform.PassContext(opt_level=3):
+            pipeline_mod_factory = pipeline_executor.build(pipe_config)
+        pipeline_module = pipeline_executor.PipelineModule(pipeline_mod_factory)
+
+        # The same modules running one request at a time give the expected outputs.
+        serial_modules = []
+        for mod in get_micro_batch_mods(dshape, 1):
+            with tvm.transform.PassContext(opt_level=3):
+                lib = relay.build(mod, "llvm")
+            serial_modules.append(graph_executor.GraphModule(lib["default"](tvm.cpu())))
+
+        # All the requests are queued before any output is read, so that the second module can
+        # coalesce them. Their number is odd, so the last micro batch is only partly filled.
+        datas = [np.random.uniform(size=dshape).astype("float32") for _ in range(5)]
+        for data in datas:
+            pipeline_module.set_input("data_a", data)
+            pipeline_module.run()
+
+        for data in datas:
+            expected = data
+            for module in serial_modules:
+                module.set_input("data_0", expected)
+                module.run()
+                expected = module.get_output(0).numpy()
+            outputs = pipeline_module.get_output(timeout_ms=10000)
+            assert len(outputs) == 1
+            tvm.testing.assert_allclose(outputs[0].numpy(), expected, rtol=1e-6)
+
+        stage = pipeline_module.get_stage_profile()["stages"][1]
+        assert stage["micro_batch"] == micro_batch
+        assert stage["requests"] == len(datas)
+        assert (len(datas) + micro_batch - 1) // micro_batch <= stage["runs"] <= len(datas)
+
+
+def test_suggest_split_points():
+    costs = [1, 2, 3, 4, 5, 6, 7, 8, 9]
+    splits, stage_costs = pipeline_executor.suggest_split_points(costs, 3)
+    assert splits == [5, 7]
+    assert stage_costs == [15, 13, 17]
+    # A heavy operator is never split and bounds the slowest stage.
+    splits, stage_costs = pipeline_executor.suggest_split_points([1, 10, 1, 1], 3)
+    assert max(stage_costs) == 10 and len(stage_costs) <= 3
+    # Fewer operators than stages gives one stage per operator.
+    splits, stage_costs = pipeline_executor.suggest_split_points([1, 1], 4)
+    assert splits == [1] and stage_costs == [1, 1]
+
+
 if __name__ == "__main__":
     pytest.main([__file__])
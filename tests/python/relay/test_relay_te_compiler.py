@@ -14,6 +14,8 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import os
+
 import numpy as np
 import tvm
 from tvm import te
@@ -21,6 +23,7 @@ import tvm.testing
 from tvm import relay
 from tvm import autotvm
 from tvm import topi
+from tvm.contrib import graph_executor
 from tvm.relay.backend import te_compiler
 from tvm.relay.testing import run_infer_type
 from tvm.relay.testing.temp_op_attr import TempOpAttr
@@ -285,6 +288,63 @@ def test_compile_propogate_hash():
         assert "hash" in f.attrs.keys()
 
 
+def test_compile_disk_cache(tmpdir, monkeypatch):
+    # relay.build enters the TopHub context, whose records are part of the keys.
+    monkeypatch.delenv("TOPHUB_LOCATION", raising=False)
+
+    def get_mod():
+        x = relay.var("x", shape=(4, 8))
+        w = relay.var("w", shape=(16, 8))
+        y = relay.nn.relu(relay.nn.dense(x, w))
+        return tvm.IRModule.from_expr(relay.Function([x, w], relay.exp(y) + relay.const(1.0)))
+
+    def build_and_run(config):
+        with tvm.transform.PassContext(opt_level=3, config=config):
+            lib = relay.build(get_mod(), "llvm")
+        mod = graph_executor.GraphModule(lib["default"](tvm.cpu()))
+        mod.run(x=np.ones((4, 8), "float32"), w=np.full((16, 8), 0.1, "float32"))
+        return mod.get_output(0).numpy()
+
+    def list_entries():
+        return [name for name in os.listdir(cache_dir) if name.endswith(".tecache")]
+
+    cache_dir = str(tmpdir.join("te_cache"))
+    config = {"relay.backend.te_compiler_cache_dir": cache_dir}
+    expected = build_and_run({})
+    tvm.testing.assert_allclose(build_and_run(config), expected, rtol=1e-5)
+    entries = list_entries()
+    assert entries
+    get_hits = tvm.get_global_func("relay.backend._TECompilerDiskCacheHits")
+    # Builds served from the cache produce the same code.
+    hits = get_hits()
+    tvm.testing.assert_allclose(build_and_run(config), expected, rtol=1e-5)
+    assert get_hits() - hits == len(entries)
+
+    # Other tuning records give other keys, which are cached in turn.
+    with autotvm.apply_history_best([]) as records:
+        cfg = autotvm.task.space.FallbackConfigEntity()
+        records.update(tvm.target.Target("llvm"), ("test/unused",), cfg)
+        hits = get_hits()
+        tvm.testing.assert_allclose(build_and_run(config), expected, rtol=1e-5)
+        assert get_hits() == hits
+        num_new_entries = len(list_entries()) - len(entries)
+        assert num_new_entries > 0
+        tvm.testing.assert_allclose(build_and_run(config), expected, rtol=1e-5)
+        assert get_hits() - hits == num_new_entries
+
+    # Corrupted entries are dropped and rewritten.
+    for name in entries:
+        with open(os.path.join(cache_dir, name), "r+b") as entry:
+            entry.truncate(20)
+    tvm.testing.assert_allclose(build_and_run(config), expected, rtol=1e-5)
+    assert all(os.path.getsize(os.path.join(cache_dir, name)) > 20 for name in entries)
+
+    # Entries over the size limit are evicted.
+    config["relay.backend.te_compiler_cache_max_mb"] = 0
+    tvm.testing.assert_allclose(build_and_run(config), expected, rtol=1e-5)
+    assert not [name for name in os.listdir(cache_dir) if name.endswith(".tecache")]
+
+
 if __name__ == "__main__":
     test_get_valid_implementations()
     test_select_implementation()
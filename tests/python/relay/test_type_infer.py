@@ -17,6 +17,7 @@
 """Test that type checker correcly computes types
    for expressions.
 """
+import numpy as np
 import pytest
 import tvm
 from tvm import IRModule, parser, relay, te
@@ -544,6 +545,82 @@ def test_repeat_register():
         assert "Operator custom_log3 is registered before" in str(cm.execption)
 
 
+def test_incremental_infer_type():
+    x = relay.var("x", shape=(1, 8, 16, 16))
+    w = relay.var("w", shape=(8, 8, 3, 3))
+    c = relay.const(np.ones((1, 8, 1, 1), "float32"))
+    conv = relay.nn.conv2d(x, w, padding=(1, 1))
+    mod = tvm.IRModule.from_expr(relay.Function([x, w], relay.add(conv, relay.add(c, c))))
+
+    with tvm.transform.PassContext(config={"relay.InferType.incremental": True}):
+        typed = transform.InferType()(mod)
+        # An unchanged function is not typed again.
+        assert transform.InferType()(typed)["main"].same_as(typed["main"])
+        # The function passes type their result, only the nodes they create get new types.
+        folded = transform.FoldConstant()(typed)
+    assert folded["main"].body.args[0].same_as(typed["main"].body.args[0])
+
+    expected = transform.InferType()(transform.FoldConstant()(mod))
+    tvm.ir.assert_structural_equal(folded, expected)
+    assert folded["main"].checked_type == expected["main"].checked_type
+    assert folded["main"].body.checked_type == expected["main"].body.checked_type
+
+
+def test_incremental_infer_type_callee_changed():
+    f = relay.GlobalVar("f")
+    mod = tvm.IRModule()
+    a = relay.var("a", shape=(4,))
+    mod[f] = relay.Function([a], relay.nn.relu(a))
+    x = relay.var("x", shape=(4,))
+    mod["main"] = relay.Function([x], f(x))
+
+    with tvm.transform.PassContext(config={"relay.InferType.incremental": True}):
+        typed = transform.InferType()(mod)
+        # The types of main depend on the signature of f, so main is typed again.
+        b = relay.var("b", shape=(8,))
+        typed[f] = relay.Function([b], relay.nn.relu(b))
+        with pytest.raises(tvm.error.DiagnosticError):
+            transform.InferType()(typed)
+
+
+def test_incremental_infer_type_callee_unchanged():
+    f = relay.GlobalVar("f")
+    mod = tvm.IRModule()
+    a = relay.var("a", shape=(4,))
+    mod[f] = relay.Function([a], relay.nn.relu(a))
+    x = relay.var("x", shape=(4,))
+    mod["main"] = relay.Function([x], f(x))
+
+    with tvm.transform.PassContext(config={"relay.InferType.incremental": True}):
+        typed = transform.InferType()(mod)
+        # The signature of f is the one the first inference completed, so main is reused.
+        y = relay.var("y", shape=(4,))
+        typed["g"] = relay.Function([y], relay.nn.relu(y))
+        retyped = transform.InferType()(typed)
+    assert retyped["main"].same_as(typed["main"])
+
+
+def test_incremental_infer_type_let_rebound():
+    x = relay.var("x", shape=(4,))
+    v = relay.var("v")
+    w = relay.var("w")
+    body = relay.Let(w, relay.multiply(v, v), w)
+    mod = tvm.IRModule.from_expr(relay.Function([x], relay.Let(v, relay.add(x, x), body)))
+
+    with tvm.transform.PassContext(config={"relay.InferType.incremental": True}):
+        typed = transform.InferType()(mod)
+        # The first let is new, the ones it leads to are reused.
+        let = typed["main"].body
+        typed["main"] = relay.Function(typed["main"].params, relay.Let(let.var, x, let.body))
+        retyped = transform.InferType()(typed)
+
+    expected = transform.InferType()(
+        tvm.IRModule.from_expr(relay.Function([x], relay.Let(v, x, body)))
+    )
+    tvm.ir.assert_structural_equal(retyped, expected)
+    assert retyped["main"].body.checked_type == expected["main"].body.checked_type
+
+
 if __name__ == "__main__":
     import sys
 
@@ -14,6 +14,8 @@
 # KIND, either express or implied.  See the License for the
 # specific language governing permissions and limitations
 # under the License.
+import json
+
 import numpy as np
 import pytest
 import time
@@ -266,6 +268,62 @@ def test_sum_loop(target, dev):
     check_result(target, dev, [i_data, accum_data], sum(range(1, loop_bound + 1)), mod)
 
 
+def test_superinstructions():
+    """Fused instruction sequences give the same results as dispatching each instruction"""
+    mod = tvm.IRModule({})
+    loop = relay.GlobalVar("loop")
+    i = relay.var("i", shape=[], dtype="int32")
+    x = relay.var("x", shape=(4, 4), dtype="float32")
+    sb = ScopeBuilder()
+    with sb.if_scope(relay.equal(i, relay.const(0, "int32"))):
+        sb.ret(x)
+    with sb.else_scope():
+        one_less = relay.subtract(i, relay.const(1, "int32"))
+        sb.ret(relay.Call(loop, [one_less, relay.nn.relu(relay.add(x, relay.const(1.0)))]))
+    mod[loop] = relay.Function([i, x], sb.get())
+    iarg = relay.var("i", shape=[], dtype="int32")
+    xarg = relay.var("x", shape=(4, 4), dtype="float32")
+    mod["main"] = relay.Function([iarg, xarg], loop(iarg, xarg))
+    exe = relay.vm.compile(mod, target="llvm")
+    assert "alloc_storage" in exe.bytecode and "kill" in exe.bytecode
+
+    x_data = np.random.uniform(-1, 1, size=(4, 4)).astype("float32")
+    expected = x_data
+    for _ in range(20):
+        expected = np.maximum(expected + 1.0, 0)
+    vm_exec = runtime.vm.VirtualMachine(exe, tvm.cpu())
+    for enabled in [True, False]:
+        vm_exec.module["set_superinstructions"](enabled)
+        result = vm_exec.invoke("main", np.array(20, dtype="int32"), x_data)
+        tvm.testing.assert_allclose(result.numpy(), expected, rtol=1e-5)
+
+
+def test_invoke_async():
+    """Many requests can be in flight on one VM, each with its own inputs"""
+    x = relay.var("x", shape=(8, 8), dtype="float32")
+    y = relay.var("y", shape=(8, 8), dtype="float32")
+    mod = tvm.IRModule.from_expr(relay.Function([x, y], relay.Tuple([x + y, x * y])))
+    exe = relay.vm.compile(mod, target="llvm")
+    vm_exec = runtime.vm.VirtualMachine(exe, tvm.cpu())
+    vm_exec.set_async_workers(3)
+
+    inputs = [
+        (np.random.rand(8, 8).astype("float32"), np.random.rand(8, 8).astype("float32"))
+        for _ in range(10)
+    ]
+    futures = [vm_exec.invoke_async("main", x_data, y=y_data) for x_data, y_data in inputs]
+    for (x_data, y_data), future in zip(inputs, futures):
+        add, mul = future.get_outputs()
+        assert future.done()
+        tvm.testing.assert_allclose(add.numpy(), x_data + y_data)
+        tvm.testing.assert_allclose(mul.numpy(), x_data * y_data)
+
+    # Without arguments the inputs set on the VM are used.
+    vm_exec.set_input("main", *inputs[0])
+    add, _ = vm_exec.invoke_async("main").get_outputs()
+    tvm.testing.assert_allclose(add.numpy(), inputs[0][0] + inputs[0][1])
+
+
 def test_tuple_fst(target, dev):
     ttype = relay.TupleType([relay.TensorType((1,)), relay.TensorType((10,))])
     tup = relay.var("tup", type_annotation=ttype)
@@ -1343,6 +1401,109 @@ def test_large_constants():
     tvm.testing.assert_allclose(expected, actual.numpy())
 
 
+def test_large_constants_mapped():
+    """Large constants can be mapped into memory from a file outside of the executable"""
+    dev = tvm.cpu()
+    x = relay.var("x", shape=(1000, 1000))
+    const_data = np.random.rand(1000, 1000).astype("float32")
+    func = relay.Function([x], relay.op.add(x, relay.const(const_data, dtype="float32")))
+    vm_exec = vm.compile(tvm.IRModule.from_expr(func), target="llvm")
+
+    temp = utils.tempdir()
+    path_consts = temp.relpath("consts")
+    vm_exec.move_late_bound_consts(path_consts, byte_limit=256, mapped=True)
+    path_dso = temp.relpath("lib.so")
+    vm_exec.mod.export_library(path_dso)
+
+    exe = runtime.vm.Executable(runtime.load_module(path_dso))
+    exe.load_late_bound_consts(path_consts)
+    x_data = np.random.rand(1000, 1000).astype("float32")
+    actual = runtime.vm.VirtualMachine(exe, dev).invoke("main", x_data)
+    tvm.testing.assert_allclose(x_data + const_data, actual.numpy())
+
+
+def test_lazy_constants():
+    """Constants are deserialized on first use and reloaded after being evicted"""
+    dev = tvm.cpu()
+    x = relay.var("x", shape=(256, 256))
+    c0 = np.random.rand(256, 256).astype("float32")
+    c1 = np.random.rand(256, 256).astype("float32")
+    out = relay.op.add(relay.op.add(x, relay.const(c0)), relay.const(c1))
+    vm_exec = vm.compile(tvm.IRModule.from_expr(relay.Function([x], out)), target="llvm")
+    code, lib = vm_exec.save()
+
+    exe = runtime.vm.Executable.load_exec(code, lib, lazy_constants=True)
+    stats = exe.get_lazy_constant_stats()
+    assert stats["num_lazy"] == 2
+    assert stats["resident_bytes"] == 0
+
+    des_vm = runtime.vm.VirtualMachine(exe, dev)
+    # Room for one constant only, so each run evicts and reloads both.
+    des_vm.set_constant_memory_budget(c0.nbytes)
+    x_data = np.random.rand(256, 256).astype("float32")
+    for _ in range(2):
+        actual = des_vm.invoke("main", x_data)
+        tvm.testing.assert_allclose(x_data + c0 + c1, actual.numpy(), rtol=1e-5)
+    vm_stats = des_vm.get_constant_stats()
+    assert vm_stats["cached_bytes"] <= c0.nbytes
+    assert vm_stats["num_evictions"] >= 3
+    assert exe.get_lazy_constant_stats()["num_loads"] >= 4
+    # Loaded from bytes, the executable holds on to the serialized constants.
+    assert exe.get_lazy_constant_stats()["code_bytes"] == len(code)
+
+
+def test_lazy_constants_from_file():
+    """Lazy constants of an executable loaded from a file are read from the file"""
+    x = relay.var("x", shape=(256, 256))
+    c0 = np.random.rand(256, 256).astype("float32")
+    c1 = np.random.rand(256, 256).astype("float32")
+    out = relay.op.add(relay.op.add(x, relay.const(c0)), relay.const(c1))
+    vm_exec = vm.compile(tvm.IRModule.from_expr(relay.Function([x], out)), target="llvm")
+    code, lib = vm_exec.save()
+    path = utils.tempdir().relpath("exec.ro")
+    with open(path, "wb") as fo:
+        fo.write(code)
+
+    exe = runtime.vm.Executable.load_exec_from_file(path, lib, lazy_constants=True)
+    stats = exe.get_lazy_constant_stats()
+    assert stats["num_lazy"] == 2
+    assert stats["resident_bytes"] == 0
+    assert stats["code_bytes"] == 0
+
+    des_vm = runtime.vm.VirtualMachine(exe, tvm.cpu())
+    des_vm.set_constant_memory_budget(c0.nbytes)
+    x_data = np.random.rand(256, 256).astype("float32")
+    for _ in range(2):
+        actual = des_vm.invoke("main", x_data)
+        tvm.testing.assert_allclose(x_data + c0 + c1, actual.numpy(), rtol=1e-5)
+    assert exe.get_lazy_constant_stats()["resident_bytes"] <= c0.nbytes
+
+    # Saving deserializes the remaining constants and no longer needs the file.
+    exe.save()
+    assert exe.get_lazy_constant_stats()["num_lazy"] == 0
+    actual = des_vm.invoke("main", x_data)
+    tvm.testing.assert_allclose(x_data + c0 + c1, actual.numpy(), rtol=1e-5)
+
+
+def test_vm_sampling_profiler():
+    dev = tvm.cpu()
+    x = relay.var("x", shape=(64, 64))
+    out = relay.nn.relu(relay.op.add(x, relay.const(1.0)))
+    vm_exec = vm.compile(tvm.IRModule.from_expr(relay.Function([x], out)), target="llvm")
+    des_vm = runtime.vm.VirtualMachine(vm_exec, dev)
+    des_vm.set_sampling_profiler(sample_every=2)
+    x_data = np.random.rand(64, 64).astype("float32")
+    for _ in range(6):
+        actual = des_vm.invoke("main", x_data)
+        tvm.testing.assert_allclose(np.maximum(x_data + 1.0, 0), actual.numpy(), rtol=1e-5)
+    des_vm.invoke_async("main", x_data).result()
+    profile = des_vm.get_sampling_profile()
+    assert profile["runs"] == 7
+    assert profile["sampled_runs"] == 4
+    assert len(profile["ops"]) >= 1
+    assert all(op["count"] >= 4 for op in profile["ops"])
+
+
 def test_load_late_bound_consts_with_no_late_bound_consts():
     """Check that load_late_bound_consts handles a model with no late bound consts."""
     target = tvm.target.Target("llvm")
@@ -1405,6 +1566,36 @@ def test_vm_save_and_load_without_designating_late_bound_consts():
     tvm.testing.assert_allclose(expected, actual.numpy())
 
 
+def test_replay_alloc_trace():
+    x = relay.var("x", shape=(relay.Any(), 16), dtype="float32")
+    y = relay.nn.relu(relay.add(x, relay.const(1.0)))
+    mod = tvm.IRModule.from_expr(relay.Function([x], relay.multiply(y, y)))
+    exe = runtime.vm.VirtualMachine(vm.compile(mod, target="llvm"), tvm.cpu())
+
+    tvm.get_global_func("vm.memory_manager.start_alloc_trace")()
+    for batch in [1, 7, 8, 31, 32, 33]:
+        exe.invoke("main", np.random.rand(batch, 16).astype("float32"))
+    trace = tvm.get_global_func("vm.memory_manager.stop_alloc_trace")()
+    assert trace.shape[1] == 4
+    assert trace.shape[0] > 0
+
+    replay = tvm.get_global_func("vm.memory_manager.replay_alloc_trace")
+    cpu = tvm.cpu()
+    naive = json.loads(replay(trace, runtime.vm.VirtualMachine.NAIVE_ALLOCATOR, cpu.device_type, 0))
+    pooled = json.loads(
+        replay(trace, runtime.vm.VirtualMachine.POOLED_ALLOCATOR, cpu.device_type, 0)
+    )
+    slab = json.loads(replay(trace, runtime.vm.VirtualMachine.SLAB_ALLOCATOR, cpu.device_type, 0))
+    cached = json.loads(
+        replay(trace, runtime.vm.VirtualMachine.THREAD_CACHED_ALLOCATOR, cpu.device_type, 0)
+    )
+    assert naive["num_allocs"] == pooled["num_allocs"] == slab["num_allocs"]
+    assert cached["num_allocs"] == slab["num_allocs"]
+    assert naive["reuse_rate"] == 0
+    assert slab["reuse_rate"] >= pooled["reuse_rate"]
+    assert slab["peak_bytes"] >= slab["peak_live_bytes"]
+
+
 if __name__ == "__main__":
     import sys
 
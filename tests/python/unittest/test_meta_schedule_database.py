@@ -26,7 +26,7 @@ import tvm
 from tvm import tir
 from tvm.ir.module import IRModule
 from tvm.meta_schedule.arg_info import ArgInfo
-from tvm.meta_schedule.database import JSONDatabase, TuningRecord
+from tvm.meta_schedule.database import IndexedDatabase, JSONDatabase, TuningRecord
 from tvm.script import tir as T
 from tvm.tir import Schedule
 
@@ -295,5 +295,82 @@ def test_meta_schedule_database_reload():
             _equal_record(ret[1], records[2])
 
 
+def _create_matmul_record(token, trace, run_secs):
+    return TuningRecord(
+        trace,
+        run_secs,
+        token,
+        tvm.target.Target("llvm"),
+        ArgInfo.from_prim_func(func=Matmul["main"]),  # pylint: disable=unsubscriptable-object
+    )
+
+
+def test_meta_schedule_indexed_database_reload():
+    mod: IRModule = Matmul
+    with tempfile.TemporaryDirectory() as tmpdir:
+        path = osp.join(tmpdir, "tuning_records.bin")
+        database = IndexedDatabase(path)
+        token = database.commit_workload(mod)
+        trace = _create_schedule(mod, _schedule_matmul).trace
+        records = [
+            _create_matmul_record(token, trace, run_secs)
+            for run_secs in ([7.0, 8.0, 9.0], [1.0, 2.0, 3.0], [4.0, 5.0, 6.0])
+        ]
+        for record in records:
+            database.commit_tuning_record(record)
+        assert len(database) == 3
+        new_database = IndexedDatabase(path)
+        assert new_database.has_workload(mod)
+        assert not new_database.has_workload(MatmulRelu)
+        assert len(new_database) == 3
+        token = new_database.commit_workload(mod)
+        ret = new_database.get_top_k(token, 2)
+        assert len(ret) == 2
+        _equal_record(ret[0], records[1])
+        _equal_record(ret[1], records[2])
+
+
+def test_meta_schedule_indexed_database_keep_top_k():
+    mod: IRModule = Matmul
+    with tempfile.TemporaryDirectory() as tmpdir:
+        path = osp.join(tmpdir, "tuning_records.bin")
+        database = IndexedDatabase(path, keep_top_k=2)
+        token = database.commit_workload(mod)
+        trace = _create_schedule(mod, _schedule_matmul).trace
+        # Enough dropped records to compact the log on the way.
+        for i in range(2000):
+            database.commit_tuning_record(_create_matmul_record(token, trace, [float(2000 - i)]))
+        assert len(database) == 2
+        size = osp.getsize(path)
+        ret = database.get_top_k(token, 5)
+        assert [float(r.run_secs[0]) for r in ret] == [1.0, 2.0]
+        # Slower records are not stored.
+        database.commit_tuning_record(_create_matmul_record(token, trace, [3000.0]))
+        assert osp.getsize(path) == size
+        new_database = IndexedDatabase(path, keep_top_k=2)
+        ret = new_database.get_top_k(new_database.commit_workload(mod), 5)
+        assert [float(r.run_secs[0]) for r in ret] == [1.0, 2.0]
+
+
+def test_meta_schedule_indexed_database_truncated():
+    mod: IRModule = Matmul
+    with tempfile.TemporaryDirectory() as tmpdir:
+        path = osp.join(tmpdir, "tuning_records.bin")
+        database = IndexedDatabase(path)
+        token = database.commit_workload(mod)
+        trace = _create_schedule(mod, _schedule_matmul).trace
+        database.commit_tuning_record(_create_matmul_record(token, trace, [1.0]))
+        database.commit_tuning_record(_create_matmul_record(token, trace, [2.0]))
+        size = osp.getsize(path)
+        # Cut the last record in the middle, as a crash during a commit would.
+        with open(path, "r+b") as log:
+            log.truncate(size - 10)
+        new_database = IndexedDatabase(path)
+        assert len(new_database) == 1
+        (ret,) = new_database.get_top_k(new_database.commit_workload(mod), 2)
+        assert float(ret.run_secs[0]) == 1.0
+        assert osp.getsize(path) < size - 10
+
+
 if __name__ == "__main__":
     sys.exit(pytest.main([__file__] + sys.argv[1:]))
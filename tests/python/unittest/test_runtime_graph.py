@@ -138,6 +138,34 @@ def test_load_unexpected_params():
     rt_mod.load_params(runtime.save_param_dict(new_params))
 
 
+def test_load_mapped_params():
+    x = relay.var("x", shape=(1, 10))
+    w = relay.var("w", shape=(64, 10))
+    b = relay.var("b", shape=(64,))
+    func = relay.Function([x, w, b], relay.nn.bias_add(relay.nn.dense(x, w), b))
+    lib = relay.build(tvm.IRModule.from_expr(func), target="llvm")
+    params = {
+        "w": np.random.uniform(size=(64, 10)).astype("float32"),
+        "b": np.random.uniform(size=(64,)).astype("float32"),
+    }
+
+    temp = utils.tempdir()
+    path = temp.relpath("params.bin")
+    runtime.save_mapped_param_dict(params, path)
+    loaded = runtime.load_mapped_param_dict(path)
+    for name, value in params.items():
+        np.testing.assert_equal(loaded[name].numpy(), value)
+
+    mod = graph_executor.create(lib.get_graph_json(), lib.get_lib(), tvm.cpu(0))
+    mod.load_mapped_params(path)
+    x_in = np.random.uniform(size=(1, 10)).astype("float32")
+    mod.run(x=x_in)
+    tvm.testing.assert_allclose(
+        mod.get_output(0).numpy(), x_in @ params["w"].T + params["b"], rtol=1e-5
+    )
+
+
 if __name__ == "__main__":
     test_graph_simple()
     test_load_unexpected_params()
+    test_load_mapped_params()
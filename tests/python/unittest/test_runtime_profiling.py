@@ -133,6 +133,32 @@ def test_papi(target, dev):
     assert any([float(x) > 0 for x in csv[metric]])
 
 
+@tvm.testing.requires_llvm
+def test_perf_event():
+    mod, params = mlp.get_workload(1)
+
+    exe = relay.vm.compile(mod, "llvm", params=params)
+    vm = profiler_vm.VirtualMachineProfiler(exe, tvm.cpu())
+
+    data = np.random.rand(1, 1, 28, 28).astype("float32")
+    # Machines without access to the counters still profile, without the counters.
+    report = vm.profile(
+        data,
+        func_name="main",
+        collectors=[tvm.runtime.profiling.PerfEventMetricCollector()],
+    )
+    assert "fused_nn_softmax" in str(report)
+    csv = read_csv(report)
+    if "Instructions" not in csv:
+        pytest.skip("perf_event counters are not available")
+    assert any(int(x) > 0 for x in csv["Instructions"] if x)
+    assert "IPC" in csv and "Memory Bandwidth (GB/s)" in csv
+    report2 = Report.from_json(report.json())
+    assert report.table(aggregate=False, col_sums=False) == report2.table(
+        aggregate=False, col_sums=False
+    )
+
+
 @tvm.testing.requires_llvm
 def test_json():
     mod, params = mlp.get_workload(1)
@@ -154,6 +180,30 @@ def test_json():
         assert isinstance(call["Duration (us)"]["microseconds"], float)
 
 
+@tvm.testing.requires_llvm
+def test_chrome_trace():
+    mod, params = mlp.get_workload(1)
+
+    exe = relay.build(mod, "llvm", params=params)
+    gr = debug_executor.create(exe.get_graph_json(), exe.lib, tvm.cpu())
+
+    data = np.random.rand(1, 1, 28, 28).astype("float32")
+    report = gr.profile(data=data, timeline=True)
+    assert len(report.timeline) > len(report.calls)
+    trace = json.loads(report.chrome_trace())
+    events = [e for e in trace["traceEvents"] if e["ph"] == "X"]
+    assert {"name": "cpu0"} in [e["args"] for e in trace["traceEvents"] if e["ph"] == "M"]
+    assert "fused_nn_softmax" in [e["name"] for e in events]
+    total = next(e for e in events if e["name"] == "Total")
+    for event in events:
+        assert event["dur"] >= 0
+        assert total["ts"] <= event["ts"] <= total["ts"] + total["dur"] + 0.01
+
+    # The timeline survives serialization, reports without one are unchanged.
+    assert json.loads(Report.from_json(report.json()).chrome_trace()) == trace
+    assert "timeline" not in json.loads(gr.profile(data=data).json())
+
+
 @tvm.testing.requires_llvm
 def test_rpc_vm():
     server = rpc.Server(key="profiling")
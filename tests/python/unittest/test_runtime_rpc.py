@@ -157,6 +157,89 @@ def test_rpc_large_array():
     check_remote()
 
 
+@tvm.testing.requires_rpc
+def test_rpc_pipelined():
+    server = rpc.Server(key="x1")
+    client = rpc.connect("127.0.0.1", server.port, key="x1")
+
+    def check_remote():
+        dev = client.cpu(0)
+        client.set_transfer_options(chunk_bytes=4096, window_bytes=1 << 16)
+        a_np = np.random.uniform(size=(257, 129)).astype("float32")
+        arrays = []
+        with client.batch():
+            for _ in range(4):
+                arrays.append(tvm.nd.array(a_np, dev))
+        for arr in arrays:
+            np.testing.assert_equal(arr.numpy(), a_np)
+
+        faddone = client.get_pipelined_function("rpc.test.addone")
+        for i in range(100):
+            assert faddone(i) is None
+        client.wait()
+
+        # The remote objects returned by pipelined calls are freed.
+        use_count = client.get_function("rpc.test.shared_nd_use_count")
+        num_uses = use_count()
+        fget = client.get_pipelined_function("rpc.test.get_shared_nd")
+        for _ in range(10):
+            assert fget() is None
+        client.wait()
+        assert use_count() == num_uses
+
+        client.get_pipelined_function("rpc.test.except")("abc")
+        faddone(1)
+        with pytest.raises(tvm._ffi.base.TVMError):
+            client.wait()
+        assert client.get_function("rpc.test.addone")(10) == 11
+
+    check_remote()
+
+
+@tvm.testing.requires_rpc
+def test_rpc_compression():
+    server = rpc.Server(key="x1")
+    client = rpc.connect("127.0.0.1", server.port, key="x1")
+
+    def check_remote():
+        dev = client.cpu(0)
+        client.set_compression(1 << 16)
+        # several blocks and a partial one, each mostly zeros or incompressible
+        sparse_np = np.random.uniform(size=(1031, 1029)).astype("float32")
+        sparse_np[sparse_np < 0.8] = 0
+        random_np = np.random.randint(0, 1 << 16, size=(1031, 1029)).astype("uint16")
+        for a_np in [sparse_np, random_np, np.zeros((7, 9), "float32")]:
+            a = tvm.nd.array(a_np, dev)
+            np.testing.assert_equal(a.numpy(), a_np)
+            with client.batch():
+                b = tvm.nd.array(a_np, dev)
+            np.testing.assert_equal(b.numpy(), a_np)
+
+        blob = bytearray(b"tvm" * 100000)
+        client.upload(blob, "dat.bin")
+        assert client.download("dat.bin") == blob
+        client.set_compression(0)
+        np.testing.assert_equal(tvm.nd.array(sparse_np, dev).numpy(), sparse_np)
+
+    check_remote()
+
+
+@tvm.testing.requires_rpc
+@pytest.mark.skipif(not sys.platform.startswith("linux"), reason="shm transport needs Linux")
+def test_rpc_shm():
+    server = rpc.Server(key="x1")
+    client = rpc.connect("127.0.0.1", server.port, key="x1", transport="shm")
+
+    def check_remote():
+        assert client.get_function("rpc.test.addone")(10) == 11
+        # larger than the ring, so the copy wraps around it
+        a_np = np.random.uniform(size=(2048, 2048 + 3)).astype("float32")
+        a = tvm.nd.array(a_np, client.cpu(0))
+        np.testing.assert_equal(a.numpy(), a_np)
+
+    check_remote()
+
+
 @tvm.testing.requires_rpc
 def test_rpc_echo():
     def check(remote):
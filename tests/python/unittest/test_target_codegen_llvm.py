@@ -932,5 +932,60 @@ def test_raise_exception_during_codegen():
     assert msg.find("Nested parallel loop is not supported") != -1
 
 
+@tvm.testing.requires_llvm
+def test_llvm_parallel_codegen():
+    n = 64
+    A = te.placeholder((n,), name="A")
+    funcs = {}
+    for i in range(6):
+        B = te.compute((n,), lambda j: A[j] * float(i + 1), name="B")
+        s = te.create_schedule(B.op)
+        funcs["scale%d" % i] = tvm.lower(s, [A, B], name="scale%d" % i)["scale%d" % i]
+    mod = tvm.IRModule({name: func for name, func in funcs.items()})
+    with tvm.transform.PassContext(config={"codegen.llvm.num_parallel_modules": 3}):
+        lib = tvm.build(mod, target="llvm")
+    assert len(lib.imported_modules) == 2
+    assert all(m.type_key == "llvm" for m in lib.imported_modules)
+
+    temp = utils.tempdir()
+    path = temp.relpath("parallel.so")
+    lib.export_library(path)
+    loaded = tvm.runtime.load_module(path)
+    dev = tvm.cpu(0)
+    a = tvm.nd.array(np.random.uniform(size=n).astype(A.dtype), dev)
+    for m in [lib, loaded]:
+        for i in range(6):
+            b = tvm.nd.empty((n,), A.dtype, dev)
+            m["scale%d" % i](a, b)
+            tvm.testing.assert_allclose(b.numpy(), a.numpy() * (i + 1), rtol=1e-6)
+
+
+@tvm.testing.requires_llvm
+@tvm.testing.requires_cuda
+def test_llvm_parallel_codegen_device_kernels():
+    # The host functions in every part launch kernels of the device module the first part imports.
+    n = 64
+    A = te.placeholder((n,), name="A")
+    funcs = {}
+    for i in range(6):
+        B = te.compute((n,), lambda j: A[j] * float(i + 1), name="B")
+        s = te.create_schedule(B.op)
+        bx, tx = s[B].split(B.op.axis[0], factor=32)
+        s[B].bind(bx, te.thread_axis("blockIdx.x"))
+        s[B].bind(tx, te.thread_axis("threadIdx.x"))
+        funcs["scale%d" % i] = tvm.lower(s, [A, B], name="scale%d" % i)["scale%d" % i]
+    mod = tvm.IRModule({name: func for name, func in funcs.items()})
+    with tvm.transform.PassContext(config={"codegen.llvm.num_parallel_modules": 3}):
+        lib = tvm.build(mod, target="cuda", target_host="llvm")
+    assert sum(m.type_key == "llvm" for m in lib.imported_modules) == 2
+
+    dev = tvm.cuda(0)
+    a = tvm.nd.array(np.random.uniform(size=n).astype(A.dtype), dev)
+    for i in range(6):
+        b = tvm.nd.empty((n,), A.dtype, dev)
+        lib["scale%d" % i](a, b)
+        tvm.testing.assert_allclose(b.numpy(), a.numpy() * (i + 1), rtol=1e-6)
+
+
 if __name__ == "__main__":
     sys.exit(pytest.main([__file__] + sys.argv[1:]))
@@ -18,6 +18,8 @@
 import sys
 
 import pytest
+import tvm
+from tvm import te
 from tvm.ir import IRModule
 from tvm.meta_schedule.testing.te_workload import create_te_workload
 from tvm.tir.analysis import estimate_tir_flops
@@ -47,5 +49,16 @@ def test_te_workload(workload, flops):
     assert float(flops) == estimate_tir_flops(mod)
 
 
+def test_lowered_vectorized():
+    A = te.placeholder((1024,), name="A")
+    B = te.compute((1024,), lambda i: A[i] * 2.0 + 1.0, name="B")
+    s = te.create_schedule(B.op)
+    _, inner = s[B].split(B.op.axis[0], factor=8)
+    s[B].vectorize(inner)
+    mod = tvm.lower(s, [A, B])
+    # One multiply and one add per element, counted per lane once vectorized.
+    assert estimate_tir_flops(mod) == 2048
+
+
 if __name__ == "__main__":
     sys.exit(pytest.main([__file__] + sys.argv[1:]))